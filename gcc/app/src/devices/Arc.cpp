@@ -65,7 +65,6 @@ uint32_t USBArc::Init(uint32_t parent, uint32_t port, uint32_t lowspeed)
 	uint32_t	rcode = 0;
 	UsbDevice	*p = NULL;
 	EpInfo		*oldep_ptr = NULL;
-	uint32_t 	adkproto = -1;
 	uint32_t	num_of_conf = 0;
 
 	/* Get memory address of USB device address pool */
@@ -351,6 +350,9 @@ USBArcController::USBArcController(uint8_t encoderCount, bool pushButton) : USBA
 	
 	for(int ring = 0; ring < ARC_MAX_ENCODERS; ring++)
 		lastDelta[ring] = 0;
+
+	/* Nothing is known about what the rings are showing until they get their first maps */
+	memset(this->shown, 0xFF, sizeof(this->shown));
 }
 
 uint8_t USBArcController::getEncoderCount()
@@ -376,34 +378,14 @@ void USBArcController::switchPage(uint8_t page)
 
 void USBArcController::refreshArc()
 {	
-	uint8_t ring0[34], ring1[34], ring2[34], ring3[34];
-	ring0[0] = ring1[0] = ring2[0] = ring3[0] = 0x92;
-	ring0[1] = 0; ring1[1] = 1; ring2[1] = 2; ring3[1] = 3;
-	for (int i = 0; i < 32; i++)
-	{
-		ring0[i+2] = (this->values[this->currentPage][0][i*2+1] & 0xF) | (this->values[this->currentPage][0][i*2] << 4);
-		ring1[i+2] = (this->values[this->currentPage][1][i*2+1] & 0xF) | (this->values[this->currentPage][1][i*2] << 4);
-		ring2[i+2] = (this->values[this->currentPage][2][i*2+1] & 0xF) | (this->values[this->currentPage][2][i*2] << 4);
-		ring3[i+2] = (this->values[this->currentPage][3][i*2+1] & 0xF) | (this->values[this->currentPage][3][i*2] << 4);
-	}
-	this->write(34, ring0);
-	delay(2);
-	this->write(34, ring1);
-	delay(2);
-	this->write(34, ring2);
-	delay(2);
-	this->write(34, ring3);
-	delay(2);
+	/* Only the LEDs that differ from what the rings show are sent, on the next tick */
+	this->dirtyRings = ARC_ALL_RINGS;
 }
 
 void USBArcController::setLED(uint8_t page, uint8_t ring, uint8_t led, uint8_t value)
 {
 	this->values[page][ring][led] = value;
-	if (page == this->currentPage)
-	{
-		uint8_t serial[4] = {0x90, ring, led, value};
-		this->write(4, serial);
-	}
+	if (page == this->currentPage) this->dirtyRings |= 1 << ring;
 }
 
 void USBArcController::clearLED(uint8_t page, uint8_t ring, uint8_t led)
@@ -415,11 +397,7 @@ void USBArcController::setRing(uint8_t page, uint8_t ring, uint8_t value)
 {
 	for (uint8_t led = 0; led < ARC_MAX_LEDS; led++)
 		this->values[page][ring][led] = value;
-	if (page == this->currentPage)
-	{
-		uint8_t serial[3] = {0x91, ring, value};
-		this->write(3, serial);
-	}
+	if (page == this->currentPage) this->dirtyRings |= 1 << ring;
 }
 
 void USBArcController::clearRing(uint8_t page, uint8_t ring)
@@ -434,11 +412,7 @@ void USBArcController::setRange(uint8_t page, uint8_t ring, uint8_t startLed, ui
 	for (uint8_t led = startLed; led <= wrappedEndLed; led++)
 		this->values[page][ring][led % ARC_MAX_LEDS] = value;
 		
-	if (page == this->currentPage)
-	{
-		uint8_t serial[5] = {0x93, ring, startLed, endLed, value};
-		this->write(5, serial);
-	}
+	if (page == this->currentPage) this->dirtyRings |= 1 << ring;
 }
 
 void USBArcController::clearRange(uint8_t page, uint8_t ring, uint8_t startLed, uint8_t endLed)
@@ -446,6 +420,126 @@ void USBArcController::clearRange(uint8_t page, uint8_t ring, uint8_t startLed,
 	this->setRange(page, ring, startLed, endLed, 0);
 }
 
+void USBArcController::flushArc()
+{
+	unsigned long t = millis();
+
+	/* However many LEDs changed, the rings get at most one update per tick */
+	if (!this->dirtyRings || (t == this->lastFlush)) return;
+
+	this->lastFlush = t;
+
+	uint8_t rings = this->dirtyRings;
+	this->dirtyRings = 0;
+
+	for (uint8_t ring = 0; ring < ARC_MAX_ENCODERS; ring++)
+	{
+		if (!(rings & (1 << ring))) continue;
+
+		/* Ring maps sent back to back get garbled, so the rest wait for the next tick */
+		if (this->writeRing(ring))
+		{
+			this->dirtyRings |= rings & ~((2 << ring) - 1);
+			return;
+		}
+	}
+}
+
+bool USBArcController::writeRing(uint8_t ring)
+{
+	uint8_t levels[ARC_MAX_LEDS];
+	bool changed = false;
+	bool uniform = true;
+
+	for (uint8_t led = 0; led < ARC_MAX_LEDS; led++)
+	{
+		uint8_t value = this->values[this->currentPage][ring][led];
+
+		levels[led] = (value > 15) ? 15 : value;
+		changed = changed || (levels[led] != this->shown[ring][led]);
+		uniform = uniform && (levels[led] == levels[0]);
+	}
+
+	if (!changed) return false;
+
+	/* A ring that's all one level is a single ring all command */
+	if (uniform)
+	{
+		uint8_t serial[3] = {0x91, ring, levels[0]};
+		this->write(3, serial);
+
+		memset(this->shown[ring], levels[0], ARC_MAX_LEDS);
+		return false;
+	}
+
+	/* 
+		Otherwise each run of changed LEDs that are going to the same level is one
+		ring range command, or ring set if it's a single LED. Unchanged LEDs in the
+		middle of a run are sent again rather than splitting it. If that's going to
+		cost more than a ring map, the map goes instead.
+	*/
+	uint8_t runStart[ARC_MAX_LEDS / 2];
+	uint8_t runEnd[ARC_MAX_LEDS / 2];
+	uint8_t runs = 0;
+	uint8_t length = 0;
+
+	for (uint8_t led = 0; (led < ARC_MAX_LEDS) && (length < ARC_RING_MAP_LENGTH); led++)
+	{
+		if (levels[led] == this->shown[ring][led]) continue;
+
+		uint8_t end = led;
+
+		for (uint8_t next = led + 1; (next < ARC_MAX_LEDS) && (levels[next] == levels[led]); next++)
+		{
+			if (levels[next] != this->shown[ring][next]) end = next;
+		}
+
+		runStart[runs] = led;
+		runEnd[runs] = end;
+		runs++;
+
+		length += (end == led) ? 4 : 5;
+		led = end;
+	}
+
+	if (length >= ARC_RING_MAP_LENGTH)
+	{
+		uint8_t serial[ARC_RING_MAP_LENGTH];
+		serial[0] = 0x92;
+		serial[1] = ring;
+
+		for (int i = 0; i < ARC_MAX_LEDS / 2; i++)
+		{
+			serial[i + 2] = (levels[i * 2] << 4) | levels[(i * 2) + 1];
+		}
+
+		this->write(ARC_RING_MAP_LENGTH, serial);
+
+		memcpy(this->shown[ring], levels, ARC_MAX_LEDS);
+		return true;
+	}
+
+	for (uint8_t run = 0; run < runs; run++)
+	{
+		uint8_t value = levels[runStart[run]];
+
+		if (runStart[run] == runEnd[run])
+		{
+			uint8_t serial[4] = {0x90, ring, runStart[run], value};
+			this->write(4, serial);
+		}
+		else
+		{
+			uint8_t serial[5] = {0x93, ring, runStart[run], runEnd[run], value};
+			this->write(5, serial);
+		}
+
+		memset(&this->shown[ring][runStart[run]], value, runEnd[run] - runStart[run] + 1);
+	}
+
+	return false;
+}
+
 void USBArcController::task()
 {
 	USBArc::task();
@@ -458,6 +552,7 @@ void USBArcController::task()
 		if (!arcInitialized)
 		{	
 			this->currentPage = 0;
+			memset(this->shown, 0xFF, sizeof(this->shown));
 			this->refreshArc();
 			
 			arcInitialized = true;
@@ -510,5 +605,8 @@ void USBArcController::task()
 				//Serial.println(command, HEX);
 			}
 		}
+
+		/* Whatever changed this tick, including from the encoder handlers, goes out together */
+		this->flushArc();
 	}	
 }
\ No newline at end of file
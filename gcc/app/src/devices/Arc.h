@@ -30,7 +30,7 @@
 #include "Usb.h"
 #include "EventManager.h"
 #include "confdescparser.h"
-#include "aJSON/aJson.h"
+#include "aJSON/aJSON.h"
 #include "Grid.h"
 
 #define bmREQ_FTDI_OUT  0x40
@@ -42,6 +42,8 @@
 #define ARC_MAX_PAGES 16
 #define ARC_MAX_ENCODERS 4
 #define ARC_MAX_LEDS 64
+#define ARC_ALL_RINGS 0x0F
+#define ARC_RING_MAP_LENGTH 34
 
 
 namespace nw2s
@@ -108,6 +110,14 @@ class nw2s::USBArcController : public USBArc
 		uint8_t lastPressed = 0;
 		uint8_t lastReleased = 0;
 		uint8_t currentPage = 0;
+
+		/* What each ring is showing, and the rings that may not match the current page */
+		uint8_t shown[ARC_MAX_ENCODERS][ARC_MAX_LEDS];
+		uint8_t dirtyRings = 0;
+		unsigned long lastFlush = 0;
+
+		void flushArc();
+		bool writeRing(uint8_t ring);
 			
 		virtual void encoderPositionChanged(uint8_t ring, int8_t delta) = 0;
 		virtual void buttonPressed(uint8_t encoder) = 0;
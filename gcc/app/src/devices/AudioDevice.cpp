@@ -19,9 +19,157 @@
 */
 
 #include "AudioDevice.h"
+#include <Arduino.h>
 
 
 using namespace nw2s;
 
 AudioDevice* AudioDevice::device0 = 0;
 AudioDevice* AudioDevice::device1 = 0;
+
+uint16_t AudioDevice::stream[2][AUDIO_BLOCK_SIZE * 2];
+int AudioDevice::streamLength = 0;
+int AudioDevice::streamNext = 0;
+SampleRateInterrupt AudioDevice::streamRate = SR_24000;
+
+/* DACC_MR_TRGSEL for TIOA on TC0 channel 0 */
+static const uint32_t AUDIO_TRIGGER_TIOA0 = 1;
+
+void AudioDevice::startOutput(PinAudioOut pin, SampleRateInterrupt sri)
+{
+	/* The event handler needs static references to these devices */
+	if (pin == DUE_DAC0) AudioDevice::device0 = this;
+	if (pin == DUE_DAC1) AudioDevice::device1 = this;
+
+	/* Make sure the dac is zeroed and on */
+	analogWriteResolution(12);
+  	analogWrite(pin, 0);
+
+	this->sri = sri;
+	this->tag = (pin == DUE_DAC0) ? 0 : (1 << 12);
+	this->phase = 0;
+	this->step = 1UL << 16;
+	this->source[0] = 0;
+	this->rendered = 0;
+	
+	/* Adding a device changes the interleave and maybe the rate, so start over */
+	AudioDevice::startStream();
+}
+
+void AudioDevice::setSampleRate(SampleRateInterrupt sri)
+{
+	this->sri = sri;
+
+	/* Can't go faster than the stream, so anything above it is played at the stream rate */
+	this->step = (sri <= AudioDevice::streamRate) ? (1UL << 16) : (((uint32_t)AudioDevice::streamRate << 16) / sri);
+}
+
+void AudioDevice::startStream()
+{
+	/* Stop the DMA and its trigger while we reconfigure */
+	DACC_INTERFACE->DACC_PTCR = DACC_PTCR_TXTDIS;
+	TC_Stop(TC0, 0);
+	
+	AudioDevice* devices[2] = { AudioDevice::device0, AudioDevice::device1 };
+	int channels = 0;
+	
+	AudioDevice::streamRate = 0;
+	
+	for (int i = 0; i < 2; i++)
+	{
+		if (devices[i] == NULL) continue;
+		
+		if ((AudioDevice::streamRate == 0) || (devices[i]->sri < AudioDevice::streamRate)) AudioDevice::streamRate = devices[i]->sri;
+		channels++;
+	}
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (devices[i] != NULL) devices[i]->setSampleRate(devices[i]->sri);
+	}
+
+	/* Start with two blocks of silence. The devices may not be fully constructed yet. */
+	AudioDevice::streamLength = AUDIO_BLOCK_SIZE * channels;
+	AudioDevice::streamNext = 0;
+	
+	for (int i = 0; i < AudioDevice::streamLength; i++)
+	{
+		uint16_t tag = ((channels == 2) && (i & 1)) ? (1 << 12) : (AudioDevice::device0 == NULL) ? (1 << 12) : 0;
+		
+		AudioDevice::stream[0][i] = tag;
+		AudioDevice::stream[1][i] = tag;
+	}
+
+	/* Tagged half-word samples, converted on each rising edge of TIOA0 */
+	pmc_enable_periph_clk(ID_DACC);
+	DACC_INTERFACE->DACC_MR = (DACC_INTERFACE->DACC_MR & (DACC_MR_REFRESH_Msk | DACC_MR_STARTUP_Msk)) | DACC_MR_TRGEN_EN | DACC_MR_TRGSEL(AUDIO_TRIGGER_TIOA0) | DACC_MR_WORD_HALF | DACC_MR_TAG_EN;
+	DACC_INTERFACE->DACC_CHER = ((AudioDevice::device0 != NULL) ? DACC_CHER_CH0 : 0) | ((AudioDevice::device1 != NULL) ? DACC_CHER_CH1 : 0);
+
+	DACC_INTERFACE->DACC_TPR = (uintptr_t)AudioDevice::stream[0];
+	DACC_INTERFACE->DACC_TCR = AudioDevice::streamLength;
+	DACC_INTERFACE->DACC_TNPR = (uintptr_t)AudioDevice::stream[1];
+	DACC_INTERFACE->DACC_TNCR = AudioDevice::streamLength;
+	
+	DACC_INTERFACE->DACC_IER = DACC_IER_ENDTX;
+	NVIC_EnableIRQ(DACC_IRQn);
+	DACC_INTERFACE->DACC_PTCR = DACC_PTCR_TXTEN;
+
+	/* TIOA0 rises once per RC. The SR values are for MCK/8, the trigger runs on MCK/2. */
+	uint32_t rc = ((uint32_t)AudioDevice::streamRate * 4) / channels;
+	
+  	pmc_set_writeprotect(false);
+	pmc_enable_periph_clk(ID_TC0);
+	
+	TC_Configure(TC0, 0, TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC | TC_CMR_TCCLKS_TIMER_CLOCK1 | TC_CMR_ACPA_CLEAR | TC_CMR_ACPC_SET);
+	TC_SetRA(TC0, 0, rc / 2);
+	TC_SetRC(TC0, 0, rc);
+	TC_Start(TC0, 0);
+}
+
+void AudioDevice::block_handler()
+{
+	/* The buffer that just finished is free again - render into it and queue it up behind the other one */
+	uint16_t* block = AudioDevice::stream[AudioDevice::streamNext];
+	int stride = ((AudioDevice::device0 != NULL) && (AudioDevice::device1 != NULL)) ? 2 : 1;
+	
+	if (AudioDevice::device0 != NULL) AudioDevice::device0->fill(block, stride);
+	if (AudioDevice::device1 != NULL) AudioDevice::device1->fill(block + stride - 1, stride);
+
+	DACC_INTERFACE->DACC_TNPR = (uintptr_t)block;
+	DACC_INTERFACE->DACC_TNCR = AudioDevice::streamLength;
+	
+	AudioDevice::streamNext ^= 1;
+}
+
+void AudioDevice::fill(uint16_t* block, int stride)
+{
+	/* Render just as many samples as this block will use at the device's own rate. Each */
+	/* output needs the source samples either side of it, and some may be left from last time. */
+	int count = ((this->phase + (this->step * (AUDIO_BLOCK_SIZE - 1))) >> 16) + 1;
+	
+	if (count > this->rendered) this->render(this->source + 1 + this->rendered, count - this->rendered);
+	
+	uint32_t position = this->phase;
+	
+	/* A device at the stream rate lands exactly on its samples, a slower one is interpolated between them */
+	for (int i = 0; i < AUDIO_BLOCK_SIZE; i++)
+	{
+		int index = position >> 16;
+		int32_t s0 = this->source[index] & 0x0FFF;
+		int32_t s1 = this->source[index + 1] & 0x0FFF;
+		
+		block[i * stride] = (s0 + (((s1 - s0) * (int32_t)(position & 0xFFFF)) >> 16)) | this->tag;
+		position += this->step;
+	}
+	
+	/* Keep the sample we're between and anything rendered past it for the next block */
+	int consumed = position >> 16;
+	
+	for (int i = 0; i <= count - consumed; i++)
+	{
+		this->source[i] = this->source[consumed + i];
+	}
+	
+	this->rendered = count - consumed;
+	this->phase = position - (consumed << 16);
+}
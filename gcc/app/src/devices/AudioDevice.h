@@ -21,19 +21,76 @@
 #ifndef AudioDevice_h
 #define AudioDevice_h
 
+#include "IO.h"
+
 namespace nw2s
 {
+	/* Sample rates are the timer RC value for MCK/8 */
+	typedef int SampleRateInterrupt;
+	
+	static const SampleRateInterrupt SR_10000 = 1050; 
+	static const SampleRateInterrupt SR_12000 = 875; 
+	static const SampleRateInterrupt SR_24000 = 437;   // Close enough 
+	static const SampleRateInterrupt SR_48000 = 219;   // Closer... 
+	static const SampleRateInterrupt SR_44100 = 238;   // Really close!  
+	
+	/* Samples per DAC per DMA transfer - the DACC interrupt fires once per block */
+	static const int AUDIO_BLOCK_SIZE = 64;
+	
 	class AudioDevice;
 }
 
+/*
+
+	Both DACs are fed from a single DACC stream. The PDC drains a ping-pong pair of
+	buffers into the DACC, paced by TIOA on TC0 channel 0, with the channel number
+	tagged into each sample so DAC0 and DAC1 can be interleaved. When a buffer has
+	been sent, DACC_Handler asks each device to render the next block into it.
+	
+	The stream runs at the fastest device's sample rate, so a device can't play any
+	faster than the other one. A device at a slower rate still renders at its own
+	rate and is linearly interpolated up to the stream's. That's a gentle low-pass
+	rather than the images a sample-and-hold would leave, but anything the slow
+	device has near its own Nyquist is still softened on the way up.
+
+*/
 class nw2s::AudioDevice
 {
 	public:
 		static nw2s::AudioDevice* device0;
 		static nw2s::AudioDevice* device1;
-				
-		virtual void timer_handler() = 0;
+		
+		/* Called from DACC_Handler each time the PDC has finished a block */
+		static void block_handler();
+		
+		/* Fill the block with the next samples as 12 bit unsigned DAC values */
+		virtual void render(uint16_t* block, int samples) = 0;
+
+	protected:
+		void startOutput(PinAudioOut pin, SampleRateInterrupt sri);
+		void setSampleRate(SampleRateInterrupt sri);
+	
+	private:
+		SampleRateInterrupt sri;
+		uint16_t tag;
+		
+		/* Position in source in 16.16, and how far it moves per stream sample */
+		uint32_t phase;
+		uint32_t step;
+		
+		/* The first sample is the one the phase is counted from, and the next 'rendered' are already done */
+		uint16_t source[AUDIO_BLOCK_SIZE + 1];
+		int rendered;
+		
+		void fill(uint16_t* block, int stride);
+		
+		static uint16_t stream[2][AUDIO_BLOCK_SIZE * 2];
+		static int streamLength;
+		static int streamNext;
+		static SampleRateInterrupt streamRate;
+		
+		static void startStream();
 };
 
 
-#endif
\ No newline at end of file
+#endif
@@ -27,6 +27,15 @@
 using namespace std;
 using namespace nw2s;
 
+/* The beat timer is TC1 channel 0 (TC3_Handler), counting at MCK/2 */
+static Tc* const CLOCK_BEAT_TC = TC1;
+static const uint32_t CLOCK_BEAT_CHANNEL = 0;
+static const IRQn_Type CLOCK_BEAT_IRQ = TC3_IRQn;
+static const uint32_t CLOCK_BEAT_TICKS_PER_US = 42;
+
+/* A 32 bit count at 42MHz runs out after about 100s, so anything further out is re-armed on the way */
+static const long CLOCK_BEAT_MAX_WAIT = 60000000L;
+
 int nw2s::clockDivisionFromName(char* name)
 {	
 	if (strcmp("whole", name) == 0)
@@ -94,10 +103,38 @@ int nw2s::clockDivisionFromName(char* name)
 	return DIV_QUARTER;
 }
 
+unsigned long nw2s::clockDivisionTicks(int clockDivision)
+{
+	/* Divisions are in thousandths of a beat, which can't say a third. Anything within a thousandth */
+	/* of a 48th of a beat is taken to mean exactly that, so 333 and 666 are a third and two thirds. */
+	unsigned long exact = (unsigned long)clockDivision * CLOCK_TICKS_PER_BEAT;
+	unsigned long snapped = ((exact + (CLOCK_SNAP_TICKS * 500UL)) / (CLOCK_SNAP_TICKS * 1000UL)) * CLOCK_SNAP_TICKS;
+	long error = (long)(snapped * 1000UL) - (long)exact;
+	
+	if ((snapped > 0) && (error <= CLOCK_TICKS_PER_BEAT) && (error >= -CLOCK_TICKS_PER_BEAT)) return snapped;
+	
+	/* Otherwise just round it onto the tick grid */
+	unsigned long ticks = (exact + 500UL) / 1000UL;
+	
+	return (ticks < 1) ? 1 : ticks;
+}
+
+Groove nw2s::grooveFromSwing(int swingdivision, int swingpercentage)
+{
+	if (swingdivision <= 0) return GROOVE_NONE;
+	
+	int amount = (swingpercentage < SWING_STRAIGHT) ? SWING_STRAIGHT : (swingpercentage > SWING_MAX) ? SWING_MAX : swingpercentage;
+	unsigned long division = clockDivisionTicks(swingdivision);
+	Groove groove = { division, ((division * 2 * amount) + 50) / 100 };
+	
+	return groove;
+}
+
 BeatDevice::BeatDevice()
 {
 	this->clock_division = DIV_QUARTER;
 	this->next_time = 0;
+	this->next_tick = 0;
 }
 
 int BeatDevice::getclockdivision()
@@ -136,11 +173,36 @@ unsigned long BeatDevice::getNextTime()
 	return this->next_time;
 }
 
+void BeatDevice::setNextTick(unsigned long tick)
+{
+	this->next_tick = tick;
+}
+
+unsigned long BeatDevice::getNextTick()
+{
+	return this->next_tick;
+}
+
+void BeatDevice::setSwing(int swingdivision, int swingpercentage)
+{
+	this->groove = grooveFromSwing(swingdivision, swingpercentage);
+}
+
+Groove BeatDevice::getGroove()
+{
+	return this->groove;
+}
+
 void BeatDevice::setStopInput(PinDigitalIn input)
 {
 	this->stopInput = input;
 }
 
+bool BeatDevice::edge()
+{
+	return false;
+}
+
 void BeatDevice::calculate()
 {
 	/* 
@@ -244,21 +306,50 @@ PassthruClock* PassthruClock::create(aJsonObject* data)
 
 void Clock::registerDevice(BeatDevice* device)
 {
+	/* The beat interrupt walks the device list, so keep it out while the list changes */
+	noInterrupts();
+	
+	/* Devices added to a running clock start on the current beat */
+	if (this->started)
+	{
+		device->setNextTick(this->beat_tick);
+		device->setNextTime(this->last_clock_t);
+	}
+	
 	this->devices.push_back(device);	
+	this->reset_pending.push_back(0);
+	this->calculate_pending.push_back(0);
+	
+	interrupts();
+}
+
+void Clock::registerDevice(BeatDevice* device, aJsonObject* data)
+{
+	/* Any swing on the device wins over the clock's, so "swing": 50 plays a device straight on a swung clock */
+	if (aJson.getObjectItem(data, "swing") != NULL) device->setSwing(getSwingDivisionFromJSON(data), getSwingFromJSON(data));
+	
+	this->registerDevice(device);
 }
 
 Clock::Clock()
 {
 	IOUtils::displayBeat(1, this);
 
-	this->swingpercentage = 0;
-	this->swingdivision = 1000;
+	this->period = 0;
+	this->groove = GROOVE_NONE;
+	this->started = false;
+	this->beat_tick = 0;
+	this->measure_tick = 0;
+	this->tick_us = 0;
+	this->tick_period = 0;
+	this->last_clock_t = 0;
+	this->next_clock_t = 0;
+	this->beat_pending = false;
 }
 
 void Clock::setSwing(int swingdivision, int swingpercentage)
 {
-	this->swingpercentage = (swingpercentage < -100) ? -100 : (swingpercentage > 100) ? 100 : swingpercentage;
-	this->swingdivision = swingdivision;
+	this->groove = grooveFromSwing(swingdivision, swingpercentage);
 }
 
 FixedClock::FixedClock(int tempo, unsigned char beats_per_measure)
@@ -267,95 +358,341 @@ FixedClock::FixedClock(int tempo, unsigned char beats_per_measure)
 	int normalized_tempo = (tempo < 1) ? 1 : (tempo > 500) ? 500 : tempo;
 		
 	this->beat = 0;
-	this->period = 60000UL / normalized_tempo;
+	this->period = 60000000UL / normalized_tempo;
 	this->beats_per_measure = beats_per_measure;
+}
 
-	this->last_clock_t = 0;
-	this->next_clock_t = 0;
+Clock* Clock::beatClock = NULL;
+
+void Clock::beat_handler()
+{
+	TC_GetStatus(CLOCK_BEAT_TC, CLOCK_BEAT_CHANNEL);
+	
+	Clock* clock = Clock::beatClock;
+	unsigned long now = micros();
+	
+	/* Triggers and gates change right away. CV lands with the main loop's frame if we're inside one. */
+	AnalogOut::beginFrame();
+	clock->fire(now);
+	AnalogOut::endFrame();
+	
+	clock->armBeatTimer(now);
 }
 
 void Clock::timer(unsigned long t)
 {	
-	/* Call reset on devices first */
-	if (this->period > 0)
+	unsigned long now = micros();
+	
+	/* Beat edges are fired from the beat timer's interrupt. This just starts the clock, */
+	/* picks up tempo changes and fires anything the interrupt hasn't got to yet. */
+	noInterrupts();
+	
+	/* Beats are always a whole period after the last one rather than after whenever */
+	/* we got polled, so the clock can't drift. */
+	if (!this->started)
 	{
-		for (int i = 0; i < this->devices.size(); i++)
+		this->started = true;
+		this->last_clock_t = now;
+		this->beat_tick = 0;
+		
+		for (unsigned int i = 0; i < this->devices.size(); i++)
 		{
-			if (this->devices[i]->getNextTime() <= t)
-			{
-				if (!this->devices[i]->isStopped())
-				{
-					this->devices[i]->reset();
-				}
-			}
-		}	
+			this->devices[i]->setNextTick(0);
+			this->devices[i]->setNextTime(now);
+		}
+		
+		this->nextBeat();
+	}
+	
+	bool fired = this->fire(now);
+	bool beat = this->beat_pending;
+	this->beat_pending = false;
+	
+	if (fired && !beat) this->armBeatTimer(now);
+	
+	interrupts();
+	
+	/* The tempo is looked at once per beat. It sets the length of the beat that just started. */
+	if (beat)
+	{
+		this->updateTempo(t);
+		
+		noInterrupts();
+		this->retime();
+		this->armBeatTimer(micros());
+		interrupts();
 	}
 	
+	/* Resets are too slow for the interrupt, so they follow the edge from here */
+	this->resetPending();
+	
 	/* Then update the timer on all devices */
-	for (int i = 0; i < this->devices.size(); i++)
+	for (unsigned int i = 0; i < this->devices.size(); i++)
 	{
 		this->devices[i]->timer(t);
 	}	
 
-	/* Then update the clock display */
-	if ((t >= this->next_clock_t) && (this->period > 0))
+	/* Then let devices that fired do any work they wanted deferred */
+	for (unsigned int i = 0; i < this->devices.size(); i++)
+	{		
+		if (this->calculate_pending[i])
+		{
+			this->calculate_pending[i] = 0;
+			this->devices[i]->calculate();
+		}
+	}
+}
+
+bool Clock::fire(unsigned long now)
+{
+	/* Runs with interrupts off or from the beat interrupt itself */
+	if (!this->started || (this->period <= 0)) return false;
+	
+	bool fired = false;
+	
+	/* Move along to the current beat */
+	while ((long)(now - this->next_clock_t) >= 0)
 	{
-		IOUtils::displayBeat(this->beat, this);				
-		this->beat = (this->beat + 1) % this->beats_per_measure;		
+		this->last_clock_t = this->next_clock_t;
+		this->beat_tick += CLOCK_TICKS_PER_BEAT;
+		this->nextBeat();
+		fired = true;
+	}
+	
+	/* Fire the edges that are due and work out when they're next due. Anything */
+	/* more than an edge waits for the main loop, see resetPending(). */
+	for (unsigned int i = 0; i < this->devices.size(); i++)
+	{
+		if (this->isDue(this->devices[i], now))
+		{
+			if (!this->devices[i]->isStopped() && !this->devices[i]->edge())
+			{
+				this->reset_pending[i] = 1;
+			}
+			
+			this->scheduleDevice(this->devices[i], now);
+			this->calculate_pending[i] = 1;
+			fired = true;
+		}
+	}
+	
+	return fired;
+}
 
-		this->updateTempo(t);
+void Clock::resetPending()
+{
+	for (unsigned int i = 0; i < this->devices.size(); i++)
+	{
+		noInterrupts();
+		
+		bool pending = this->reset_pending[i];
+		this->reset_pending[i] = 0;
+		
+		interrupts();
+		
+		if (pending) this->devices[i]->reset();
 	}
-	else if (this->last_clock_t == 0)
+}
+
+void Clock::armBeatTimer(unsigned long now)
+{
+	/* The first clock to get here gets the timer */
+	if (Clock::beatClock == NULL)
 	{
-		IOUtils::displayBeat(this->beat, this);				
-		this->beat = (this->beat + 1) % this->beats_per_measure;		
+		Clock::beatClock = this;
 
-		this->updateTempo(t);
-	}	
+		pmc_set_writeprotect(false);
+		pmc_enable_periph_clk(ID_TC3);
+		
+		TC_Configure(CLOCK_BEAT_TC, CLOCK_BEAT_CHANNEL, TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC | TC_CMR_TCCLKS_TIMER_CLOCK1);
+		CLOCK_BEAT_TC->TC_CHANNEL[CLOCK_BEAT_CHANNEL].TC_IER = TC_IER_CPCS;
+		CLOCK_BEAT_TC->TC_CHANNEL[CLOCK_BEAT_CHANNEL].TC_IDR = ~TC_IER_CPCS;
+		NVIC_EnableIRQ(CLOCK_BEAT_IRQ);
+	}
+	
+	if (Clock::beatClock != this) return;
+	
+	TC_Stop(CLOCK_BEAT_TC, CLOCK_BEAT_CHANNEL);
+	
+	if (!this->started || (this->period <= 0)) return;
+	
+	/* The next edge is the next beat or the first device reset before it */
+	unsigned long next_us = this->next_clock_t;
+	
+	for (unsigned int i = 0; i < this->devices.size(); i++)
+	{
+		if ((this->devices[i]->getNextTick() != CLOCK_TICK_NEVER) && ((long)(this->devices[i]->getNextTime() - next_us) < 0))
+		{
+			next_us = this->devices[i]->getNextTime();
+		}
+	}
+	
+	long wait = (long)(next_us - now);
+	
+	if (wait < 1) wait = 1;
+	if (wait > CLOCK_BEAT_MAX_WAIT) wait = CLOCK_BEAT_MAX_WAIT;
+	
+	/* Starting the channel resets the count, so the compare is relative to now */
+	TC_SetRC(CLOCK_BEAT_TC, CLOCK_BEAT_CHANNEL, wait * CLOCK_BEAT_TICKS_PER_US);
+	TC_Start(CLOCK_BEAT_TC, CLOCK_BEAT_CHANNEL);
+}
 
-	/* Then calculate new time on devices and let them do any work they wanted deferred */
-	for (int i = 0; i < this->devices.size(); i++)
-	{		
-		if (this->devices[i]->getNextTime() <= t)
+unsigned long Clock::nextWake(unsigned long t)
+{
+	/* Until there's a tempo there's nothing to wait for */
+	if (!this->started || (this->period <= 0)) return t + 1;
+	
+	/* The interrupt fires the edges, but the tempo and any calculate() wait for us, */
+	/* so sleep until just after the next beat or the first device reset */
+	unsigned long now = micros();
+	
+	noInterrupts();
+	
+	unsigned long next_us = this->next_clock_t;
+	
+	for (unsigned int i = 0; i < this->devices.size(); i++)
+	{
+		if ((this->devices[i]->getNextTick() != CLOCK_TICK_NEVER) && ((long)(this->devices[i]->getNextTime() - next_us) < 0))
 		{
-			int clockDivision = this->devices[i]->getclockdivision();
-			
-			//TODO: !!!!! Need to make sure the time divisions on on the measure rather than based on last_t !!!!!!
-			
-			this->devices[i]->setNextTime((((unsigned long)(clockDivision) * (unsigned long)(this->period)) / 1000UL) + t);
+			next_us = this->devices[i]->getNextTime();
+		}
+	}
+	
+	interrupts();
+	
+	long wait = (long)(next_us - now);
+	unsigned long next = (wait <= 0) ? t + 1 : t + (wait / 1000) + 1;
 
-			this->devices[i]->calculate();
+	/* ...or until a device wants its timer */
+	for (unsigned int i = 0; i < this->devices.size(); i++)
+	{
+		unsigned long device_next = this->devices[i]->nextWake(t);
+		if ((long)(device_next - next) < 0) next = device_next;
+	}
+	
+	return next;
+}
+
+void Clock::nextBeat()
+{
+	if (this->beat == 0) this->measure_tick = this->beat_tick;
+	
+	IOUtils::displayBeat(this->beat, this);				
+	this->beat = (this->beat + 1) % this->beats_per_measure;		
+
+	/* Until the main loop has looked at the tempo, the beat is as long as the last one */
+	this->beat_pending = true;
+	this->retime();
+}
+
+void Clock::retime()
+{
+	this->next_clock_t = this->last_clock_t + this->period;
+
+	/* If the tempo moved, so did every device's next time */
+	if (this->period != this->tick_period)
+	{
+		this->tick_period = this->period;
+		this->tick_us = (this->period > 0) ? (unsigned long)((((unsigned long long)this->period << 16) + (CLOCK_TICKS_PER_BEAT / 2)) / CLOCK_TICKS_PER_BEAT) : 0;
+		
+		for (unsigned int i = 0; i < this->devices.size(); i++)
+		{
+			unsigned long tick = this->devices[i]->getNextTick();
+			if (tick != CLOCK_TICK_NEVER) this->devices[i]->setNextTime(this->deviceTime(this->devices[i], tick));
 		}
 	}
+}
+
+unsigned long Clock::tickTime(unsigned long tick)
+{
+	/* 64 bit because long divisions at slow tempos overflow the product. Rounded so whole beats land on the beat. */
+	long ticks = (long)(tick - this->beat_tick);
 	
-	// /* There is a swingpercentage, and the clock division is smaller than the swing division */			
-	// 
-	// /* Calculate all the times for swinging */
-	// int swingfactor = (this->swingpercentage == 0) ? 1000 : 1000 - ((333 * this->swingpercentage) / 100);
-	// int swingfactor2 = (this->swingpercentage == 0) ? 1000 : 1000 + ((333 * this->swingpercentage) / 100);
-	// int t_measure = t % this->period;
-	// 
-	// if (t % (this->swingdivision * 2) < this->swingdivision)
-	// {
-	// 	/* We're in the front half of the swing */				
-	// 	int t_swung = (t_measure * swingfactor) / 1000;
-	// 
-	// 	if (t_swung % (((unsigned long)this->devices[i]->getclockdivision() * (unsigned long)this->period) / 1000UL) == 0)
-	// 	{
-	// 		this->devices[i]->reset();
-	// 	}				
-	// }
-	// else
-	// {
-	// 	/* We're in the back half of the swing */
-	// 	int t_firsthalf = ((this->swingdivision * swingfactor) / 1000);
-	// 	int t_swung2 = t_firsthalf + ((t_measure * swingfactor2) / 1000);
-	// 
-	// 	if (t_swung2 % (((unsigned long)this->devices[i]->getclockdivision() * (unsigned long)this->period) / 1000UL) == 0)
-	// 	{
-	// 		this->devices[i]->reset();
-	// 	}				 
-	// }	
+	return this->last_clock_t + (long)((((long long)ticks * (long long)this->tick_us) + 0x8000) >> 16);
+}
+
+unsigned long Clock::measureStart(unsigned long tick)
+{
+	unsigned long measure_ticks = this->beats_per_measure * CLOCK_TICKS_PER_BEAT;
+	unsigned long start = this->measure_tick;
+	
+	/* Ticks are almost always in this measure or at the start of the next one */
+	while ((long)(tick - start) < 0) start -= measure_ticks;
+	while ((long)(tick - (start + measure_ticks)) >= 0) start += measure_ticks;
+	
+	return start;
+}
+
+unsigned long Clock::swingTick(unsigned long tick, Groove groove)
+{
+	if (groove.split == groove.division) return tick;
+	
+	/* Swing pairs are counted from the start of the measure */
+	unsigned long pair = groove.division * 2;
+	unsigned long position = (tick - this->measureStart(tick)) % pair;
+	unsigned long swung;
+	
+	/* Stretch the first half of the pair and squeeze the second, so finer divisions swing along with it */
+	if (position < groove.division)
+	{
+		swung = (position * groove.split) / groove.division;
+	}
+	else
+	{
+		swung = groove.split + (((position - groove.division) * (pair - groove.split)) / groove.division);
+	}
+
+	return tick - position + swung;
+}
+
+unsigned long Clock::deviceTime(BeatDevice* device, unsigned long tick)
+{
+	Groove deviceGroove = device->getGroove();
+	
+	return this->tickTime(this->swingTick(tick, (deviceGroove.division > 0) ? deviceGroove : this->groove));
+}
+
+bool Clock::isDue(BeatDevice* device, unsigned long now)
+{
+	return (device->getNextTick() != CLOCK_TICK_NEVER) && ((long)(now - device->getNextTime()) >= 0);
+}
+
+void Clock::scheduleDevice(BeatDevice* device, unsigned long now)
+{
+	int clockDivision = device->getclockdivision();
+	
+	if (clockDivision <= 0)
+	{
+		device->setNextTick(CLOCK_TICK_NEVER);
+		return;
+	}
+	
+	unsigned long ticks = clockDivisionTicks(clockDivision);
+	unsigned long measure_ticks = this->beats_per_measure * CLOCK_TICKS_PER_BEAT;
+	unsigned long next = device->getNextTick();
+	
+	/* Step along the grid from the tick the device just fired on. Normally that's one step, */
+	/* but if we got behind, skip whatever we missed rather than firing it all at once. */
+	do
+	{
+		if (ticks <= measure_ticks)
+		{
+			/* Divisions are counted from the start of the measure and start over on the downbeat */
+			unsigned long start = this->measureStart(next);
+			
+			next = start + ((((next - start) / ticks) + 1) * ticks);
+			if (next > start + measure_ticks) next = start + measure_ticks;
+		}
+		else
+		{
+			/* Anything longer than a measure just keeps counting */
+			next += ticks;
+		}
+	}
+	while ((long)(this->deviceTime(device, next) - now) <= 0);
+	
+	device->setNextTick(next);
+	device->setNextTime(this->deviceTime(device, next));
 }
 
 void Clock::updateTempo(unsigned long t)
@@ -365,8 +702,7 @@ void Clock::updateTempo(unsigned long t)
 
 void FixedClock::updateTempo(unsigned long t)
 {
-	this->next_clock_t = (t + this->period);
-	this->last_clock_t = t;	
+	
 }
 
 VariableClock::VariableClock(int mintempo, int maxtempo, PinAnalogIn input, unsigned char beats_per_measure)
@@ -379,35 +715,22 @@ VariableClock::VariableClock(int mintempo, int maxtempo, PinAnalogIn input, unsi
 	this->mintempo = (mintempo < 1) ? 1 : (mintempo > 500) ? 500 : mintempo;
 	this->maxtempo = (maxtempo < 1) ? 1 : (maxtempo > 500) ? 500 : maxtempo;
 	
-	pastvalues[0] = analogReadmV(this->input);
-	pastvalues[1] = analogReadmV(this->input);
-	pastvalues[2] = analogReadmV(this->input);
-	pastvalues[3] = analogReadmV(this->input);
-	
-	int movingaverage = (pastvalues[0] + pastvalues[1] + pastvalues[2] + pastvalues[3]) / 4;
+	/* The ADC scan already averages the input, so one read is enough */
+	int movingaverage = analogReadmV(this->input);
 	if (movingaverage < 0) movingaverage = 0;
 	
 	int tempo = ((((unsigned long)this->maxtempo - (unsigned long)this->mintempo) * ((unsigned long)movingaverage) / 5000UL)) + this->mintempo;
- 	this->period = 60000UL / tempo;
-		
-	this->last_clock_t = 0;
+ 	this->period = 60000000UL / tempo;
 }
 
 void VariableClock::updateTempo(unsigned long t)
 {
-	pastvalues[0] = analogReadmV(this->input);
-	pastvalues[1] = analogReadmV(this->input);
-	pastvalues[2] = analogReadmV(this->input);
-	pastvalues[3] = analogReadmV(this->input);
-
-	int movingaverage = (pastvalues[0] + pastvalues[1] + pastvalues[2] + pastvalues[3]) / 4;
+	/* The ADC scan already averages the input, so one read is enough */
+	int movingaverage = analogReadmV(this->input);
 	if (movingaverage < 0) movingaverage = 0;
 
 	int tempo = ((((unsigned long)this->maxtempo - (unsigned long)this->mintempo) * ((unsigned long)movingaverage) / 5000UL)) + this->mintempo;
- 	this->period = 60000UL / tempo;
-
-	this->next_clock_t = (t + this->period);
-	this->last_clock_t = t;		
+ 	this->period = 60000000UL / tempo;
 }
 
 RandomTempoClock::RandomTempoClock(int mintempo, int maxtempo, unsigned char beats_per_measure)
@@ -418,17 +741,12 @@ RandomTempoClock::RandomTempoClock(int mintempo, int maxtempo, unsigned char bea
 	/* The random clock operates on a period based on randomly changing value */
 	this->mintempo = (mintempo < 1) ? 1 : (mintempo > 500) ? 500 : mintempo;
 	this->maxtempo = (maxtempo < 1) ? 1 : (maxtempo > 500) ? 500 : maxtempo;
-	
-	this->last_clock_t = 0;
 }
 
 void RandomTempoClock::updateTempo(unsigned long t)
 {
 	int tempo = random(mintempo, maxtempo);
- 	this->period = 60000UL / tempo;
-
-	this->next_clock_t = (t + this->period);
-	this->last_clock_t = t;	
+ 	this->period = 60000000UL / tempo;
 }
 
 TapTempoClock* TapTempoClock::tapTempoClock;
@@ -441,15 +759,14 @@ TapTempoClock::TapTempoClock(PinDigitalIn input, PinDigitalIn resetInput, unsign
 	this->resetInput = resetInput;
 	this->beats_per_measure = beats_per_measure;
 			
-	int tempo = 0;
- 	this->period = 0;
+	this->period = 0;
 		
 	this->last_clock_t = 0;
 	
 	attachInterrupt(input, onTempoTap, RISING);
 }
 
-void TapTempoClock::timer(uint32_t t)
+void TapTempoClock::timer(unsigned long t)
 {
 	Clock::timer(t);
 
@@ -460,10 +777,15 @@ void TapTempoClock::timer(uint32_t t)
 	}	
 }
 
+unsigned long TapTempoClock::nextWake(unsigned long t)
+{
+	/* Taps arrive whenever they like, so keep polling */
+	return t + 1;
+}
+
 void TapTempoClock::updateTempo(unsigned long t)
 {
-	this->next_clock_t = (t + this->period);
-	this->last_clock_t = t;	
+	
 }
 
 void TapTempoClock::tap(uint32_t t)
@@ -477,35 +799,33 @@ void TapTempoClock::tap(uint32_t t)
 	if ((t > (this->lastT + 20)) && (this->lastT > 0) && (t < (this->lastT + 4000)) && (t > (this->lastTapStateT + 20)))
 	{
 		/* Update the period to be the difference in your taps */
-		this->period = t - lastT;	
+		this->period = (t - lastT) * 1000;	
 
-		IOUtils::displayBeat(this->beat, this);				
-		this->beat = (this->beat + 1) % this->beats_per_measure;		
+		/* The tap starts a new beat */
+		if (this->started) 
+		{
+			this->beat_tick += CLOCK_TICKS_PER_BEAT;
+		}
+		else
+		{
+			this->started = true;
+			this->beat_tick = 0;
+		}
 
-		this->updateTempo(t);
+		unsigned long now = micros();
+		this->last_clock_t = now;
+		this->nextBeat();
 		
 		/* Now that we've updated the tempo, recalculate the next time for devices */
-		for (int i = 0; i < this->devices.size(); i++)
+		for (unsigned int i = 0; i < this->devices.size(); i++)
 		{
-			if (this->devices[i]->getclockdivision() != DIV_NEVER)
-			{
-				this->devices[i]->setNextTime((((unsigned long)(this->devices[i]->getclockdivision()) * (unsigned long)(this->period)) / 1000UL) + t);
+			this->devices[i]->setNextTick(this->beat_tick);
+			this->scheduleDevice(this->devices[i], now);
 
-				this->devices[i]->calculate();
-			}
+			if (this->devices[i]->getNextTick() != CLOCK_TICK_NEVER) this->devices[i]->calculate();
 		}
 		
-		/* Call reset on any devices that need it */
-		for (int i = 0; i < this->devices.size(); i++)
-		{
-			if (this->devices[i]->getNextTime() <= t)
-			{
-				if (!this->devices[i]->isStopped())
-				{
-					this->devices[i]->reset();
-				}
-			}
-		}					
+		this->armBeatTimer(now);
 	}
 
 	this->lastT = t;	
@@ -537,7 +857,7 @@ PassthruClock::PassthruClock(PinDigitalIn input, unsigned char beats_per_measure
 	attachInterrupt(input, onTap, RISING);
 }
 
-void PassthruClock::timer(uint32_t t)
+void PassthruClock::timer(unsigned long t)
 {
 	Clock::timer(t);
 
@@ -548,9 +868,15 @@ void PassthruClock::timer(uint32_t t)
 	}	
 }
 
+unsigned long PassthruClock::nextWake(unsigned long t)
+{
+	/* Taps arrive whenever they like, so keep polling */
+	return t + 1;
+}
+
 void PassthruClock::updateTempo(unsigned long t)
 {
-	this->last_clock_t = t;
+	
 }
 
 void PassthruClock::tap(uint32_t t)
@@ -560,7 +886,7 @@ void PassthruClock::tap(uint32_t t)
 		IOUtils::displayBeat(this->beat, this);				
 		this->beat = (this->beat + 1) % this->beats_per_measure;		
 
-		for (int i = 0; i < this->devices.size(); i++)
+		for (unsigned int i = 0; i < this->devices.size(); i++)
 		{
 			if (!this->devices[i]->isStopped())
 			{
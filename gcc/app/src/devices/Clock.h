@@ -30,6 +30,12 @@
 
 #define CLOCK_DIVISION_COUNT 15
 
+/* Beat positions are kept in ticks so that triplets and dotted notes land exactly */
+#define CLOCK_TICKS_PER_BEAT 960
+
+/* Every named division is a whole number of 48ths of a beat */
+#define CLOCK_SNAP_TICKS (CLOCK_TICKS_PER_BEAT / 48)
+
 using namespace std;
 using namespace nw2s;
 
@@ -52,6 +58,24 @@ namespace nw2s
 	static const int DIV_THIRTYSECOND_DOT = 188;
 	static const int DIV_THIRTYSECOND_TRIPLET = 83;
 	
+	static const unsigned long CLOCK_TICK_NEVER = ~0UL;
+	
+	/* 
+		A groove delays the second half of every pair of swing divisions, MPC style. The
+		swing amount is where that second half lands as a percentage of the pair, so 50 is
+		straight, 66 is a triplet shuffle and 75 is a dotted feel. Grooves are kept in ticks
+		so they don't need recalculating when the tempo changes.
+	*/
+	struct Groove
+	{
+		unsigned long division;
+		unsigned long split;
+	};
+
+	static const int SWING_STRAIGHT = 50;
+	static const int SWING_MAX = 75;
+	static const Groove GROOVE_NONE = { 0, 0 };
+
 	static const int CLOCK_DIVISIONS[CLOCK_DIVISION_COUNT] = { DIV_WHOLE, DIV_HALF_DOT, DIV_HALF, DIV_QUARTER_DOT, DIV_QUARTER, DIV_QUARTER_TRIPLET, DIV_EIGHTH_DOT, DIV_EIGHTH, DIV_EIGHTH_TRIPLET, DIV_SIXTEENTH_DOT, DIV_SIXTEENTH, DIV_SIXTEENTH_TRIPLET, DIV_THIRTYSECOND_DOT, DIV_THIRTYSECOND, DIV_THIRTYSECOND_TRIPLET };
 	
 	class BeatDevice;
@@ -63,6 +87,8 @@ namespace nw2s
 	class PassthruClock;
 	
 	int clockDivisionFromName(char* name);
+	unsigned long clockDivisionTicks(int clockDivision);
+	Groove grooveFromSwing(int swingdivision, int swingpercentage);
 }
 
 class nw2s::BeatDevice : public TimeBasedDevice
@@ -71,13 +97,25 @@ class nw2s::BeatDevice : public TimeBasedDevice
 		virtual int getclockdivision();
 		virtual void reset() = 0;
 		virtual void calculate();
+		
+		/* Called from the beat interrupt right on the edge. Only touch outputs here, and return */
+		/* true if that was everything. Otherwise reset() follows from the main loop. */
+		virtual bool edge();
+		
+		/* Next reset time in microseconds and its position on the clock's tick grid */
 		void setNextTime(unsigned long t);
 		unsigned long getNextTime();
+		void setNextTick(unsigned long tick);
+		unsigned long getNextTick();
 		
 		void setStopInput(PinDigitalIn input);
 		void setClockDivisionInput(PinAnalogIn input);
 		bool isStopped();
 		
+		/* A device with its own swing ignores the clock's */
+		void setSwing(int swingdivision, int swingpercentage);
+		Groove getGroove();
+		
 	protected:
 		
 		int clock_division;
@@ -87,6 +125,8 @@ class nw2s::BeatDevice : public TimeBasedDevice
 		
 	private:
 		unsigned long next_time = 0;
+		unsigned long next_tick = 0;
+		Groove groove = GROOVE_NONE;
 		PinDigitalIn stopInput = DIGITAL_IN_NONE;
 		PinAnalogIn clockDivisionInput = ANALOG_IN_NONE;
 };
@@ -95,20 +135,56 @@ class nw2s::Clock : public nw2s::TimeBasedDevice
 {
 	public:
 		virtual void timer(unsigned long t);
+		virtual unsigned long nextWake(unsigned long t);
  		void registerDevice(BeatDevice* device);
+		void registerDevice(BeatDevice* device, aJsonObject* data);
 		void setSwing(int swingdivision, int swingpercentage);
 		
+		/* The beat timer's compare interrupt, see Timers.cpp */
+		static void beat_handler();
+		
 	protected:
+		/* Note - the beat timer is interrupt-driven, so only the first clock to start gets it. */
+		/* Any others still fire their beats, but only as often as timer() gets called. */
+		static Clock* beatClock;
+		
+		/* The period and beat times are in microseconds */
 		volatile int period;
 		volatile unsigned long last_clock_t;
 		volatile unsigned long next_clock_t;
 		unsigned char beats_per_measure;
 		vector<BeatDevice*> devices;
 		int beat;
-		int swingpercentage;
-		int swingdivision;
+		Groove groove;
+		bool started;
+		
+		/* Set when the interrupt has fired a beat, so the main loop knows to look at the tempo */
+		volatile bool beat_pending;
+		
+		/* Devices that have fired and are waiting for the main loop to call reset() and calculate() */
+		vector<unsigned char> reset_pending;
+		vector<unsigned char> calculate_pending;
+		
+		/* Tick positions of the current beat and the current measure */
+		unsigned long beat_tick;
+		unsigned long measure_tick;
+		
+		/* Microseconds per tick in 16.16 fixed point, worked out once per tempo change */
+		unsigned long tick_us;
+		int tick_period;
 
 		Clock();
+		bool fire(unsigned long now);
+		void resetPending();
+		void nextBeat();
+		void retime();
+		void armBeatTimer(unsigned long now);
+		void scheduleDevice(BeatDevice* device, unsigned long now);
+		unsigned long tickTime(unsigned long tick);
+		unsigned long measureStart(unsigned long tick);
+		unsigned long swingTick(unsigned long tick, Groove groove);
+		unsigned long deviceTime(BeatDevice* device, unsigned long tick);
+		bool isDue(BeatDevice* device, unsigned long now);
 		
 	private:
 		virtual void updateTempo(unsigned long t);
@@ -137,7 +213,6 @@ class nw2s::VariableClock : public Clock
 		int mintempo;
 		int maxtempo;
 		int input;
-		int pastvalues[4];
 		int valuepointer;
 
 		VariableClock(int mintempo, int maxtempo, PinAnalogIn input, unsigned char beats_per_measure);
@@ -181,7 +256,8 @@ class nw2s::TapTempoClock : public Clock
 		
 		TapTempoClock(PinDigitalIn input, PinDigitalIn resetInput, unsigned char beats_per_measure);
 		virtual void updateTempo(unsigned long t);
-		virtual void timer(uint32_t t);
+		virtual void timer(unsigned long t);
+		virtual unsigned long nextWake(unsigned long t);
 		void reset();
 		void tap(uint32_t t);
 		static void onTempoTap();
@@ -209,7 +285,8 @@ class nw2s::PassthruClock : public Clock
 		
 		PassthruClock(PinDigitalIn input, unsigned char beats_per_measure);
 		virtual void updateTempo(unsigned long t);
-		virtual void timer(uint32_t t);
+		virtual void timer(unsigned long t);
+		virtual unsigned long nextWake(unsigned long t);
 		void reset();
 		void tap(uint32_t t);
 		static void onTap();
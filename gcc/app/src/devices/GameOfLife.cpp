@@ -77,6 +77,9 @@ GameOfLife::GameOfLife(GridDevice deviceType, uint8_t columnCount, uint8_t rowCo
 		}
 	}
 
+	memset(this->lifecells, 0, sizeof(this->lifecells));
+	this->columnMask = (LifeRow)~0 >> (LIFE_MAX_COLUMNS - columnCount);
+
 	readConfig();
 	renderControlPage();
 	
@@ -119,7 +122,7 @@ void GameOfLife::readConfig()
 	uint fileSize = configFile.fileSize();
 	char configData[fileSize + 1];
 	configFile.read(configData, fileSize);
-	configData[fileSize] == '\0';
+	configData[fileSize] = '\0';
 		
 	aJsonObject* sdConfig = aJson.parse(configData);
 
@@ -313,7 +316,7 @@ void GameOfLife::timer(unsigned long t)
 					int _x = wrapX(x+i);
 					int _y = wrapY(y+j);
 					this->cells[0][_x][_y] = 15;
-					lifecells[generation][_x][_y] = 15;
+					setCell(generation, _x, _y, 15);
 				}
 				
 		refresh = true;
@@ -447,24 +450,61 @@ int GameOfLife::wrapY(int y)
 	return (y + rowCount) % rowCount;
 }
 
+LifeRow GameOfLife::rotateRow(LifeRow bits, int deltaX)
+{
+	/* Moves every cell deltaX columns to the right (-columnCount < deltaX < columnCount), wrapping at the edge of the grid */
+	if (deltaX < 0) deltaX += columnCount;
+	if (deltaX == 0) return bits;
+
+	return ((bits << deltaX) | (bits >> (columnCount - deltaX))) & columnMask;
+}
+
+LifeRow GameOfLife::liveRow(int gen, int row)
+{
+	return lifecells[gen][0][row] | lifecells[gen][1][row] | lifecells[gen][2][row] | lifecells[gen][3][row];
+}
+
+uint8_t GameOfLife::cellLevel(int gen, int column, int row)
+{
+	uint8_t level = 0;
+
+	for (int bit = 0; bit < LIFE_LEVEL_BITS; bit++)
+		level |= ((lifecells[gen][bit][row] >> column) & 1) << bit;
+
+	return level;
+}
+
+void GameOfLife::setCell(int gen, int column, int row, uint8_t level)
+{
+	for (int bit = 0; bit < LIFE_LEVEL_BITS; bit++)
+	{
+		if (level & (1 << bit))
+			lifecells[gen][bit][row] |= (LifeRow)1 << column;
+		else
+			lifecells[gen][bit][row] &= ~((LifeRow)1 << column);
+	}
+}
+
 int GameOfLife::calculateNeighbours(int gen, int j, int  k)
 {
-	return 
-		(lifecells[gen][wrapX(j-1)][wrapY(k-1)] ? 1 : 0) + 
-		(lifecells[gen][wrapX(j-1)][wrapY(k)] ? 1 : 0) + 
-		(lifecells[gen][wrapX(j-1)][wrapY(k+1)] ? 1 : 0) + 
-		(lifecells[gen][wrapX(j)][wrapY(k-1)] ? 1 : 0) + 
-		(lifecells[gen][wrapX(j)][wrapY(k+1)] ? 1 : 0) + 
-		(lifecells[gen][wrapX(j+1)][wrapY(k-1)] ? 1 : 0) + 
-		(lifecells[gen][wrapX(j+1)][wrapY(k)] ? 1 : 0) + 
-		(lifecells[gen][wrapX(j+1)][wrapY(k+1)] ? 1 : 0);
+	int neighbours = 0;
+
+	for (int dy = -1; dy <= 1; dy++)
+	{
+		LifeRow row = liveRow(gen, wrapY(k + dy));
+
+		for (int dx = -1; dx <= 1; dx++)
+			if (dx || dy) neighbours += (row >> wrapX(j + dx)) & 1;
+	}
+
+	return neighbours;
 }
 
 int GameOfLife::countColumn(int gen, int column)
 {
 	int cv = 0;
 	for (int j = 0; j < rowCount; j++)
-		cv += lifecells[gen][column][j] ? 1 : 0;
+		cv += (liveRow(gen, j) >> column) & 1;
 	return cv;
 }
 
@@ -474,7 +514,7 @@ void GameOfLife::copyCellsToGrid(int gen)
 	{
 		for (uint8_t row = 0; row < rowCount; row++)
 		{
-			this->cells[0][column][row] = lifecells[gen][column][row];
+			this->cells[0][column][row] = cellLevel(gen, column, row);
 		}
 	}
 }
@@ -482,11 +522,11 @@ void GameOfLife::copyCellsToGrid(int gen)
 void GameOfLife::shiftCells(int deltaX, int deltaY)
 {
 	int nextGen = (generation + 1) % 2;
-	for (uint8_t column = 0; column < columnCount; column++)
+	for (uint8_t row = 0; row < rowCount; row++)
 	{
-		for (uint8_t row = 0; row < rowCount; row++)
+		for (int bit = 0; bit < LIFE_LEVEL_BITS; bit++)
 		{
-			lifecells[nextGen][wrapX(column + deltaX)][wrapY(row + deltaY)] = lifecells[generation][column][row];
+			lifecells[nextGen][bit][wrapY(row + deltaY)] = rotateRow(lifecells[generation][bit][row], deltaX);
 		}
 	}
 	copyCellsToGrid(nextGen);
@@ -498,63 +538,127 @@ int GameOfLife::aRead(PinAnalogIn analogIn)
 	return constrain((analogRead(analogIn) - 2048) * 2, 0, 4095); // TODO not sure yet how to fix this for using bipolar CVs into the analog ins
 }
 
+/* A full adder working on every column of a row at once */
+static inline void addBits(LifeRow a, LifeRow b, LifeRow c, LifeRow& sum, LifeRow& carry)
+{
+	sum = a ^ b ^ c;
+	carry = (a & b) | (c & (a ^ b));
+}
+
+void GameOfLife::stepCells(int gen, int nextGen, uint16_t birthCounts, uint16_t surviveCounts)
+{
+	LifeRow live[LIFE_MAX_ROWS];
+
+	for (int row = 0; row < rowCount; row++)
+		live[row] = liveRow(gen, row);
+
+	for (int row = 0; row < rowCount; row++)
+	{
+		LifeRow above = live[(row == 0) ? rowCount - 1 : row - 1];
+		LifeRow centre = live[row];
+		LifeRow below = live[(row == rowCount - 1) ? 0 : row + 1];
+
+		/* Count the eight neighbours of every cell in the row as a 4 bit number spread over ones, twos, fours and eights */
+		LifeRow aboveSum, aboveCarry, belowSum, belowCarry, ones, onesCarry, x, y;
+
+		addBits(rotateRow(above, 1), above, rotateRow(above, -1), aboveSum, aboveCarry);
+		addBits(rotateRow(below, 1), below, rotateRow(below, -1), belowSum, belowCarry);
+		addBits(aboveSum, belowSum, rotateRow(centre, 1) ^ rotateRow(centre, -1), ones, onesCarry);
+		addBits(aboveCarry, belowCarry, rotateRow(centre, 1) & rotateRow(centre, -1), x, y);
+
+		LifeRow twos = x ^ onesCarry;
+		LifeRow fours = y ^ (x & onesCarry);
+		LifeRow eights = y & (x & onesCarry);
+
+		LifeRow births = 0;
+		LifeRow survivors = 0;
+
+		for (int count = 0; count <= 8; count++)
+		{
+			if (!((birthCounts | surviveCounts) & (1 << count))) continue;
+
+			LifeRow matches = ((count & 1) ? ones : ~ones) & ((count & 2) ? twos : ~twos) & ((count & 4) ? fours : ~fours) & ((count & 8) ? eights : ~eights);
+
+			if (birthCounts & (1 << count)) births |= matches;
+			if (surviveCounts & (1 << count)) survivors |= matches;
+		}
+
+		births &= ~centre & columnMask;
+		survivors &= centre;
+
+		/* Survivors fade a step down to 4, anything already at 4 or below sits at 4, and births start at 15 */
+		LifeRow b0 = lifecells[gen][0][row];
+		LifeRow b1 = lifecells[gen][1][row];
+		LifeRow b2 = lifecells[gen][2][row];
+		LifeRow b3 = lifecells[gen][3][row];
+
+		LifeRow fade = survivors & (b3 | (b2 & (b1 | b0)));
+		LifeRow bottom = survivors & ~fade;
+		LifeRow borrow0 = fade & ~b0;
+		LifeRow borrow1 = borrow0 & ~b1;
+		LifeRow borrow2 = borrow1 & ~b2;
+
+		lifecells[nextGen][0][row] = ((b0 ^ fade) & fade) | births;
+		lifecells[nextGen][1][row] = ((b1 ^ borrow0) & fade) | births;
+		lifecells[nextGen][2][row] = ((b2 ^ borrow1) & fade) | bottom | births;
+		lifecells[nextGen][3][row] = ((b3 ^ borrow2) & fade) | births;
+	}
+}
+
 void GameOfLife::nextGeneration()
 {
 	int nextGen = (generation + 1) % 2;
 	bool isRandom = digitalRead(generateRandomTrigger);
 
-	for (int column = 0; column < columnCount; column++)
+	/* The rules and density are read once for the whole generation */
+	int density = isRandom ? aRead(randomDensityCV) : 0;
+	int minNew = 3, maxNew = 3, minSurvive = 2, maxSurvive = 3;
+	
+	if (!isRandom && digitalRead(cvRulesOnSwitch))
 	{
-		for (int row = 0; row < rowCount; row++)
-		{
-			if (isRandom)
-			{
-				lifecells[nextGen][column][row] = random(0, 4096) < aRead(randomDensityCV) ? 15 : 0;
-			}
-			else 
-			{
-				int minNew = 3, maxNew = 3, minSurvive = 2, maxSurvive = 3;
-				if (digitalRead(cvRulesOnSwitch))
-				{
-					minNew = aRead(minNewCV) * 9 / 4096;
-					maxNew = aRead(maxNewCV) * 9 / 4096;
-					minSurvive = aRead(minSurviveCV) * 9 / 4096;
-					maxSurvive = aRead(maxSurviveCV) * 9 / 4096;
-				}
-				int neighbours = calculateNeighbours(generation, column, row);
-				if (debug)
-				{
-					Serial.print(neighbours);
-				}
-				lifecells[nextGen][column][row] = 0;
-				if ((neighbours >= minSurvive && neighbours <= maxSurvive) && lifecells[generation][column][row])
-					lifecells[nextGen][column][row] = constrain(lifecells[generation][column][row] - 1, 4, 15);
-				else if ((neighbours >= minNew && neighbours <= maxNew) && !lifecells[generation][column][row])
-					lifecells[nextGen][column][row] = 15;
-			}
-		}
-		if (debug)
+		minNew = aRead(minNewCV) * 9 / 4096;
+		maxNew = aRead(maxNewCV) * 9 / 4096;
+		minSurvive = aRead(minSurviveCV) * 9 / 4096;
+		maxSurvive = aRead(maxSurviveCV) * 9 / 4096;
+	}
+
+	if (isRandom)
+	{
+		memset(lifecells[nextGen], 0, sizeof(lifecells[nextGen]));
+
+		for (int column = 0; column < columnCount; column++)
+			for (int row = 0; row < rowCount; row++)
+				if (random(0, 4096) < density) setCell(nextGen, column, row, 15);
+	}
+	else
+	{
+		/* The rules become a bit per neighbour count */
+		uint16_t birthCounts = 0;
+		uint16_t surviveCounts = 0;
+
+		for (int count = 0; count <= 8; count++)
 		{
-			Serial.println();
+			if (count >= minNew && count <= maxNew) birthCounts |= 1 << count;
+			if (count >= minSurvive && count <= maxSurvive) surviveCounts |= 1 << count;
 		}
+
+		stepCells(generation, nextGen, birthCounts, surviveCounts);
 	}
 
 	this->copyCellsToGrid(nextGen);
 	
 	int totalPopulation = 0;
-	for (int i = 0; i < columnCount; i++)
+	for (int row = 0; row < rowCount; row++)
 	{
-		for (int j = 0; j < rowCount; j++)
-		{
-			totalPopulation += (lifecells[nextGen][i][j] ? 1 : 0);
-		}
+		totalPopulation += __builtin_popcount(liveRow(nextGen, row));
 	}
 	digitalWrite(INDEX_DIGITAL_OUT[1], totalPopulation + populationThreshold > (columnCount * rowCount) ? HIGH : LOW);
 	digitalWrite(INDEX_DIGITAL_OUT[2], totalPopulation < populationThreshold ? HIGH : LOW);
 	
+	LifeRow topRowBirths = liveRow(nextGen, 0) & ~liveRow(generation, 0);
 	for (int i = 2; i < columnCount; i++)
 	{
-		digitalWrite(INDEX_DIGITAL_OUT[i + 1], !lifecells[generation][i][0] && lifecells[nextGen][i][0] ? HIGH : LOW);
+		digitalWrite(INDEX_DIGITAL_OUT[i + 1], (topRowBirths >> i) & 1 ? HIGH : LOW);
 	}
 	triggerStart = currentTime;
 	
@@ -565,7 +669,7 @@ void GameOfLife::nextGeneration()
 		{
 			for (int j = 0; j < rowCount; j++)
 			{
-				Serial.print(lifecells[generation][i][j]);
+				Serial.print(cellLevel(generation, i, j));
 			}
 			Serial.println();
 		}
@@ -583,7 +687,7 @@ void GameOfLife::nextGeneration()
 		{
 			for (int j = 0; j < rowCount; j++)
 			{
-				Serial.print(lifecells[nextGen][i][j]);
+				Serial.print(cellLevel(nextGen, i, j));
 			}
 			Serial.println();
 		}
@@ -669,19 +773,19 @@ void GameOfLife::buttonPressed(uint8_t column, uint8_t row)
 	}
 	else
 	{
-		if (lifecells[generation][column][row])
+		if (cellLevel(generation, column, row))
 		{
 			this->cells[0][column][row] = 0;
-			lifecells[generation][column][row] = 0;
+			setCell(generation, column, row, 0);
 		}
 		else
 		{
 			this->cells[0][column][row] = 15;
-			lifecells[generation][column][row] = 15;
+			setCell(generation, column, row, 15);
 		}
 		if (row == 0)
 		{
-			digitalWrite(INDEX_DIGITAL_OUT[column + 1], lifecells[generation][column][row] ? HIGH : LOW);
+			digitalWrite(INDEX_DIGITAL_OUT[column + 1], cellLevel(generation, column, row) ? HIGH : LOW);
 			triggerStart = currentTime;
 		}
 		cvout[column]->outputCV(constrain((config.cvRangeMax[column] - config.cvRangeMin[column]) * countColumn(generation, column) / rowCount + config.cvRangeMin[column], 0, 4095));
@@ -37,6 +37,13 @@ namespace nw2s
 	class GameOfLifeConfig;
 }
 
+/* The board is a bitboard, one word per row with a bit per column. A wider LifeRow and more rows make a bigger board */
+typedef uint16_t LifeRow;
+
+#define LIFE_MAX_COLUMNS (sizeof(LifeRow) * 8)
+#define LIFE_MAX_ROWS 16
+#define LIFE_LEVEL_BITS 4
+
 static const int newShapesCount = 13;
 static const int newShapes[newShapesCount][3][3] 
 	{
@@ -84,6 +91,9 @@ class nw2s::GameOfLife : public BeatDevice, public USBGridController
 		
 	private:
 
+		/* The host test checks the bitboard against the per-cell rules it replaced */
+		friend class GameOfLifeTest;
+
 		GameOfLife(GridDevice deviceType, uint8_t columnCount, uint8_t rowCount, bool varibright);
 		
 		void readConfig();
@@ -94,8 +104,13 @@ class nw2s::GameOfLife : public BeatDevice, public USBGridController
 		void renderControlPage();
 		int wrapX(int x);
 		int wrapY(int y);
+		LifeRow rotateRow(LifeRow bits, int deltaX);
+		LifeRow liveRow(int gen, int row);
+		uint8_t cellLevel(int gen, int column, int row);
+		void setCell(int gen, int column, int row, uint8_t level);
 		int calculateNeighbours(int gen, int j, int  k);
 		int countColumn(int gen, int column);
+		void stepCells(int gen, int nextGen, uint16_t birthCounts, uint16_t surviveCounts);
 		void copyCellsToGrid(int gen);
 		void shiftCells(int deltaX, int deltaY);
 		void nextGeneration();
@@ -123,7 +138,8 @@ class nw2s::GameOfLife : public BeatDevice, public USBGridController
 		
 		GameOfLifeConfig config;
 		int debug = 0;
-		int lifecells[2][16][16]; // indices are generation, column, row
+		LifeRow lifecells[2][LIFE_LEVEL_BITS][LIFE_MAX_ROWS]; // indices are generation, brightness bit, row
+		LifeRow columnMask = 0;
 		int generation = 0; // currently displayed generation
 
 		// variables to track trigger inputs
@@ -33,6 +33,7 @@
 #include "Grid.h"
 #include "JSONUtil.h"
 #include "EventManager.h"
+#include "b.h"
 
 using namespace nw2s;
 
@@ -104,7 +105,6 @@ uint32_t USBGrid::Init(uint32_t parent, uint32_t port, uint32_t lowspeed)
 	uint32_t	rcode = 0;
 	UsbDevice	*p = NULL;
 	EpInfo		*oldep_ptr = NULL;
-	uint32_t 	adkproto = -1;
 	uint32_t	num_of_conf = 0;
 
 	/* Get memory address of USB device address pool */
@@ -410,6 +410,9 @@ USBGridController::USBGridController(GridDevice deviceType, uint8_t columnCount,
 {
 	this->columnCount = columnCount;
 	this->rowCount = rowCount;
+
+	/* Nothing is known about what the device is showing until it gets its first frames */
+	memset(this->shown, 0xFF, sizeof(this->shown));
 }
 
 void USBGridController::setLED(uint8_t page, uint8_t column, uint8_t row, uint8_t value)
@@ -428,7 +431,7 @@ void USBGridController::setLED(uint8_t page, uint8_t column, uint8_t row, uint8_
 		{
 			case DEVICE_40H_TRELLIS:
 			{
-				uint8_t setCommand[] = { 0x21, (column << 4) | (row & 0x0F) };
+				uint8_t setCommand[] = { 0x21, (uint8_t)((column << 4) | (row & 0x0F)) };
 				this->write(2, setCommand);
 				
 				break;
@@ -436,7 +439,8 @@ void USBGridController::setLED(uint8_t page, uint8_t column, uint8_t row, uint8_
 			case DEVICE_SERIES:
 			case DEVICE_GRIDS:
 			{
-				this->refreshGrid();
+				/* Goes out with everything else that changed this tick */
+				this->dirtyQuadrants |= GRID_QUADRANT(column, row);
 				break;		
 			}			
 		}
@@ -453,7 +457,7 @@ void USBGridController::clearLED(uint8_t page, uint8_t column, uint8_t row)
 		{
 			case DEVICE_40H_TRELLIS:
 			{
-				uint8_t setCommand[] = { 0x20, (column << 4) | (row & 0x0F) };
+				uint8_t setCommand[] = { 0x20, (uint8_t)((column << 4) | (row & 0x0F)) };
 				this->write(2, setCommand);
 				
 				break;
@@ -462,7 +466,7 @@ void USBGridController::clearLED(uint8_t page, uint8_t column, uint8_t row)
 			case DEVICE_SERIES:
 			case DEVICE_GRIDS:
 			{
-				this->refreshGrid();
+				this->dirtyQuadrants |= GRID_QUADRANT(column, row);
 				break;			
 			}						
 		}
@@ -508,7 +512,7 @@ void USBGridController::refreshGrid()
 				{
 					if (this->cells[this->currentPage][column][row])
 					{
-						gridCommand[(column * 2) + 1] = gridCommand[(column * 2) + 1] | (1 << (this->rowCount - 1) - row);
+						gridCommand[(column * 2) + 1] = gridCommand[(column * 2) + 1] | (1 << ((this->rowCount - 1) - row));
 					}
 				}
 			}
@@ -519,224 +523,183 @@ void USBGridController::refreshGrid()
 		}
 		
 		case DEVICE_SERIES:
+		case DEVICE_GRIDS:
 		{
-			/* Quadrant-based commands are most efficient for full screen refresh */
-			
-			/* 64 - one quadrant */
-			uint8_t quadrant1[] = { (0x08 << 4) | 0, 0, 0, 0, 0, 0, 0, 0, 0};
-	
-			/* 128 - two quadrants */
-			uint8_t quadrant2[] = { (0x08 << 4) | 1, 0, 0, 0, 0, 0, 0, 0, 0};
-			
-			/* 256 - four quadrants */
-			uint8_t quadrant3[] = { (0x08 << 4) | 2, 0, 0, 0, 0, 0, 0, 0, 0};
-			uint8_t quadrant4[] = { (0x08 << 4) | 3, 0, 0, 0, 0, 0, 0, 0, 0};
-			
-			//TODO: Only working with 64 right now to get this running. 
-			/* The LED_FRAME command for series is per row, not column */
-			for (uint8_t row = 0; row < this->rowCount; row++)
-			{
-				for (uint8_t column = 0; column < this->columnCount; column++)
-				{
-					/* quadrant 1 */
-					if (column < 8 && row < 8)
-					{
-						if (this->cells[this->currentPage][column][row])
-						{
-							quadrant1[(row % 8) + 1] = quadrant1[(row % 8) + 1] | (1 << (column % 8));
-						}
-					}
+			/* Only the cells that differ from what the device shows are sent, on the next tick */
+			this->dirtyQuadrants = GRID_ALL_QUADRANTS;
+			break;
+		}
+	}
+}
 
-					/* quadrant 2 */
-					if (column <= 8 && row < 8)
-					{
-						if (this->cells[this->currentPage][column][row])
-						{
-							quadrant2[(row % 8) + 1] = quadrant2[(row % 8) + 1] | (1 << (column % 8));
-						}
-					}
+bool USBGridController::isVaribright()
+{
+	/* Only the grids protocol has levels - series and 40h devices are always rendered off and on */
+	return (this->deviceType == DEVICE_GRIDS) && this->varibright;
+}
 
-					/* quadrant 3 */
-					if (column <= 8 && row < 8)
-					{
-						if (this->cells[this->currentPage][column][row])
-						{
-							quadrant3[(row % 8) + 1] = quadrant3[(row % 8) + 1] | (1 << (column % 8));
-						}
-					}
+uint8_t USBGridController::ledLevel(uint8_t value)
+{
+	/* Varibright grids show 16 levels, anything brighter is just full on */
+	if (this->isVaribright())
+	{
+		return (value > 15) ? 15 : value;
+	}
+	else
+	{
+		return value ? 1 : 0;
+	}
+}
 
-					/* quadrant 4 */
-					if (column <= 8 && row < 8)
-					{
-						if (this->cells[this->currentPage][column][row])
-						{
-							quadrant4[(row % 8) + 1] = quadrant4[(row % 8) + 1] | (1 << (column % 8));
-						}
-					}
-				}				
-			}
+void USBGridController::flushGrid()
+{
+	unsigned long t = millis();
 
-			this->write(9, quadrant1);
-			this->write(9, quadrant2);
-			this->write(9, quadrant3);
-			this->write(9, quadrant4);
-			delay(5);
-	
-			break;
-		}
-			
-		case DEVICE_GRIDS:
+	/* However many cells changed, the device gets at most one update per tick */
+	if (!this->dirtyQuadrants || (t == this->lastFlush)) return;
+
+	this->lastFlush = t;
+
+	uint8_t changedQuadrants = 0;
+	uint16_t changes = 0;
+	uint8_t changedColumns[GRID_SINGLE_LED_CHANGES];
+	uint8_t changedRows[GRID_SINGLE_LED_CHANGES];
+
+	for (uint8_t column = 0; column < this->columnCount; column++)
+	{
+		for (uint8_t row = 0; row < this->rowCount; row++)
 		{
-			if (!varibright)
-			{
-				/* If it's not varibright, then it's just boolean off and on */
+			uint8_t quadrant = GRID_QUADRANT(column, row);
 
-				/* Quadrant-based commands are most efficient for full screen refresh */
-			
-				/* 64 - one quadrant */
-				uint8_t quadrant1[] = { 0x14, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-	
-				/* 128 - two quadrants */
-				uint8_t quadrant2[] = { 0x14, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-			
-				/* 256 - four quadrants */
-				uint8_t quadrant3[] = { 0x14, 0, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-				uint8_t quadrant4[] = { 0x14, 8, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-			
-				/* The LED_FRAME command for grids is per row, not column */
-				for (uint8_t row = 0; row < this->rowCount; row++)
+			if ((this->dirtyQuadrants & quadrant) && (this->ledLevel(this->cells[this->currentPage][column][row]) != this->shown[column][row]))
+			{
+				if (changes < GRID_SINGLE_LED_CHANGES)
 				{
-					for (uint8_t column = 0; column < this->columnCount; column++)
-					{
-						/* quadrant 1 */
-						if (column < 8 && row < 8)
-						{
-							if (this->cells[this->currentPage][column][row])
-							{
-								quadrant1[(row % 8) + 3] = quadrant1[(row % 8) + 3] | (1 << (column % 8));
-							}
-						}
-
-						/* quadrant 2 */
-						if (column >= 8 && row < 8)
-						{
-							if (this->cells[this->currentPage][column][row])
-							{
-								quadrant2[(row % 8) + 3] = quadrant2[(row % 8) + 3] | (1 << (column % 8));
-							}
-						}
-
-						/* quadrant 3 */
-						if (column < 8 && row >= 8)
-						{
-							if (this->cells[this->currentPage][column][row])
-							{
-								quadrant3[(row % 8) + 3] = quadrant3[(row % 8) + 3] | (1 << (column % 8));
-							}
-						}
-
-						/* quadrant 4 */
-						if (column >= 8 && row >= 8)
-						{
-							if (this->cells[this->currentPage][column][row])
-							{
-								quadrant4[(row % 8) + 3] = quadrant4[(row % 8) + 3] | (1 << (column % 8));
-							}
-						}
-					}				
+					changedColumns[changes] = column;
+					changedRows[changes] = row;
 				}
-				
-				//TODO: We don't need to send them all if the size isn't that big
-				this->write(11, quadrant1);
-				this->write(11, quadrant2);
-				this->write(11, quadrant3);
-				this->write(11, quadrant4);
 
-				delay(5);
+				changedQuadrants |= quadrant;
+				changes++;
 			}
-			else
+		}
+	}
+
+	this->dirtyQuadrants = 0;
+
+	/* A couple of cells are cheaper as single LED commands than as whole quadrants */
+	if (changes <= GRID_SINGLE_LED_CHANGES)
+	{
+		for (uint8_t i = 0; i < changes; i++)
+		{
+			this->writeCell(changedColumns[i], changedRows[i]);
+		}
+
+		return;
+	}
+
+	for (uint8_t quadrant = 0; quadrant < 4; quadrant++)
+	{
+		if (changedQuadrants & (1 << quadrant))
+		{
+			/* Level maps sent back to back get garbled, so the rest wait for the next tick */
+			if (this->writeQuadrant(quadrant))
 			{
-				/* If it is varibright, then it's 4 bits of brightness */
+				this->dirtyQuadrants = changedQuadrants & ~((2 << quadrant) - 1);
+				return;
+			}
+		}
+	}
+}
 
-				/* Quadrant-based commands are most efficient for full screen refresh */
-			
-				/* 64 - one quadrant */
-				uint8_t quadrant1[] = { 0x1A, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-	
-				/* 128 - two quadrants */
-				uint8_t quadrant2[] = { 0x1A, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-			
-				/* 256 - four quadrants */
-				uint8_t quadrant3[] = { 0x1A, 0, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-				uint8_t quadrant4[] = { 0x1A, 8, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-			
-				/* The LED_FRAME command for grids is per row, not column */
-				for (uint8_t row = 0; row < this->rowCount; row++)
-				{
-					for (uint8_t column = 0; column < this->columnCount; column++)
-					{
-						/* quadrant 1 */
-						if (column < 8 && row < 8)
-						{
-							if (this->cells[this->currentPage][column][row])
-							{
-								quadrant1[((row % 8) * 4) + ((column % 8) / 2) + 3] = quadrant1[((row % 8) * 4) + ((column % 8) / 2) + 3] | ((this->cells[this->currentPage][column][row] & 0x0F) << (((column + 1) % 2) * 4));
-							}
-						}
-
-						/* quadrant 2 */
-						if (column >= 8 && row < 8)
-						{
-							if (this->cells[this->currentPage][column][row])
-							{
-								quadrant2[((row % 8) * 4) + ((column % 8) / 2) + 3] = quadrant2[((row % 8) * 4) + ((column % 8) / 2) + 3] | ((this->cells[this->currentPage][column][row] & 0x0F) << (((column + 1) % 2) * 4));
-							}
-						}
-
-						/* quadrant 3 */
-						if (column < 8 && row >= 8)
-						{
-							if (this->cells[this->currentPage][column][row])
-							{
-								quadrant3[((row % 8) * 4) + ((column % 8) / 2) + 3] = quadrant3[((row % 8) * 4) + ((column % 8) / 2) + 3] | ((this->cells[this->currentPage][column][row] & 0x0F) << (((column + 1) % 2) * 4));
-							}
-						}
-
-						/* quadrant 4 */
-						if (column >= 8 && row >= 8)
-						{
-							if (this->cells[this->currentPage][column][row])
-							{
-								quadrant4[((row % 8) * 4) + ((column % 8) / 2) + 3] = quadrant4[((row % 8) * 4) + ((column % 8) / 2) + 3] | ((this->cells[this->currentPage][column][row] & 0x0F) << (((column + 1) % 2) * 4));
-							}
-						}
-					}				
-				}
+void USBGridController::writeCell(uint8_t column, uint8_t row)
+{
+	uint8_t level = this->ledLevel(this->cells[this->currentPage][column][row]);
 
-				//TODO: Not sure why it screws up without the delay
+	if (this->deviceType == DEVICE_SERIES)
+	{
+		/* 0x20 is on, 0x30 is off, the position is packed into one byte */
+		uint8_t command[] = { (uint8_t)(level ? 0x20 : 0x30), (uint8_t)((column << 4) | (row & 0x0F)) };
+		this->write(2, command);
+	}
+	else if (this->isVaribright())
+	{
+		/* 0x18 sets the level of one LED */
+		uint8_t command[] = { 0x18, column, row, level };
+		this->write(4, command);
+	}
+	else
+	{
+		/* 0x11 is on, 0x10 is off */
+		uint8_t command[] = { (uint8_t)(level ? 0x11 : 0x10), column, row };
+		this->write(3, command);
+	}
 
-				this->write(35, quadrant1);
-				if (this->columnCount > 8) 
-				{
-					delay(3);
-					this->write(35, quadrant2);
+	this->shown[column][row] = level;
+}
 
-					if (this->rowCount > 8) 
-					{
-						delay(3);
-						this->write(35, quadrant3);
-						
-						delay(3);
-						this->write(35, quadrant4);						
-					}	
-				}	
+bool USBGridController::writeQuadrant(uint8_t quadrant)
+{
+	uint8_t columnOffset = (quadrant & 0x01) ? 8 : 0;
+	uint8_t rowOffset = (quadrant & 0x02) ? 8 : 0;
+
+	uint8_t levels[8][8] = { { 0 } };
+	bool levelMap = false;
+
+	for (uint8_t row = 0; row < 8; row++)
+	{
+		for (uint8_t column = 0; column < 8; column++)
+		{
+			if (((columnOffset + column) >= this->columnCount) || ((rowOffset + row) >= this->rowCount)) continue;
+
+			levels[row][column] = this->ledLevel(this->cells[this->currentPage][columnOffset + column][rowOffset + row]);
+			this->shown[columnOffset + column][rowOffset + row] = levels[row][column];
+
+			/* A varibright quadrant that's only off and full on still fits in a plain map */
+			if (this->isVaribright() && levels[row][column] && (levels[row][column] < 15)) levelMap = true;
+		}
+	}
+
+	uint8_t frame[35] = { 0 };
+	uint8_t* rows;
+	uint8_t length;
 
-				delay(5);				
+	if (this->deviceType == DEVICE_SERIES)
+	{
+		/* The series LED_FRAME names the quadrant in the command */
+		frame[0] = 0x80 | quadrant;
+		rows = &frame[1];
+		length = 9;
+	}
+	else
+	{
+		/* The grids map commands carry the x and y offset of the quadrant */
+		frame[0] = levelMap ? 0x1A : 0x14;
+		frame[1] = columnOffset;
+		frame[2] = rowOffset;
+		rows = &frame[3];
+		length = levelMap ? 35 : 11;
+	}
+
+	/* Frames are per row, not column - one bit per LED, or 4 bits per LED for level maps with the left one high */
+	for (uint8_t row = 0; row < 8; row++)
+	{
+		for (uint8_t column = 0; column < 8; column++)
+		{
+			if (levelMap)
+			{
+				rows[(row * 4) + (column / 2)] |= levels[row][column] << (((column + 1) % 2) * 4);
+			}
+			else if (levels[row][column])
+			{
+				rows[row] |= 1 << column;
 			}
-	
-			break;
 		}
 	}
+
+	this->write(length, frame);
+
+	return levelMap;
 }
 
 void USBGridController::task()
@@ -751,6 +714,7 @@ void USBGridController::task()
 		if (!gridInitialized)
 		{	
 			this->currentPage = 0;
+			memset(this->shown, 0xFF, sizeof(this->shown));
 			this->refreshGrid();
 			
 			gridInitialized = true;
@@ -759,120 +723,181 @@ void USBGridController::task()
 		/* See if there is any data to read */
 	    int rcode = read(&nbread, 64, buf);
 	
-		if (rcode > 1)
+		if ((rcode > 1) && b::debugMode)
 		{
 			Serial.print("Read error: ");
 			Serial.println(rcode, HEX);
 		}
-			
-		/* Only problem, if we don't get the whole chunk at once, we'll drop half */
-		for (uint8_t i = 0; i < nbread; i++)
+
+		/* The series and grids are FTDI devices, which start every USB packet with two modem status bytes */
+		uint32_t packetSize = this->epInfo[epDataInIndex].maxPktSize ? this->epInfo[epDataInIndex].maxPktSize : 64;
+		bool ftdi = (this->deviceType == DEVICE_SERIES) || (this->deviceType == DEVICE_GRIDS);
+
+		/* Packets can be split across reads, so the parser picks up wherever the last read left off */
+		for (uint32_t i = 0; i < nbread; i++)
 		{
-			if (deviceType == DEVICE_40H_TRELLIS)
-			{
-				uint8_t command = buf[i++];			
-				uint8_t data = buf[i];
-			
-				uint8_t column = data >> 4;
-				uint8_t row = data & 0x0F;
+			if (ftdi && ((i % packetSize) < FTDI_STATUS_LENGTH)) continue;
 
-				if (command == 0x01)
-				{
-					//TODO: refactor to a struct
-					this->lastpress[0] = column;
-					this->lastpress[1] = row;
-				
-					this->buttonPressed(column, row);
-				}
-				else if (command == 0x00)
-				{
-					this->lastrelease[0] = column;
-					this->lastrelease[1] = row;
-				
-					this->buttonReleased(column, row);
-				}
-				else
-				{
-					Serial.print("Unknown command: ");
-					Serial.println(command, HEX);
-				}
-			}
-			else if (deviceType == DEVICE_SERIES)
-			{
-				uint8_t command = buf[i++];			
-				uint8_t data = buf[i];
-			
-				uint8_t column = data >> 4;
-				uint8_t row = data & 0x0F;
+			this->parseInput(buf[i]);
+		}
 
-				if (command == 0x00)
-				{
-					//TODO: refactor to a struct
-					this->lastpress[0] = column;
-					this->lastpress[1] = row;
-				
-					this->buttonPressed(column, row);
-				}
-				else if (command == 0x10)
-				{
-					this->lastrelease[0] = column;
-					this->lastrelease[1] = row;
-				
-					this->buttonReleased(column, row);
-				}
-				else if (command == 0x31)
-				{
-					/* Not sure why the monome is spitting this out constantly */
-				}
-				else
-				{
-					Serial.print("Unknown command: ");
-					Serial.println(command, HEX);
-				}
+		this->dispatchKeys();
+
+		/* Whatever changed this tick, including from the button handlers, goes out together */
+		this->flushGrid();
+	}	
+}
+
+uint8_t USBGridController::packetLength(uint8_t command)
+{
+	if (this->deviceType != DEVICE_GRIDS)
+	{
+		/* 40h and series messages are always a command byte and a data byte */
+		return 2;
+	}
+
+	/* mext messages are sized by their command, anything unknown is skipped a byte at a time until it makes sense again */
+	switch (command)
+	{
+		case 0x00:	/* query response */
+		case 0x02:	/* grid offset */
+		case 0x03:	/* grid size */
+		case 0x04:	/* address */
+		case 0x20:	/* key up */
+		case 0x21:	/* key down */
+		case 0x50:	/* encoder delta */
+			return 3;
+
+		case 0x01:	/* id */
+			return 33;
+
+		case 0x0F:	/* firmware version */
+			return 9;
+
+		case 0x51:	/* encoder switch up */
+		case 0x52:	/* encoder switch down */
+			return 2;
+
+		case 0x61:	/* tilt */
+			return 8;
+
+		default:
+			return 1;
+	}
+}
+
+void USBGridController::parseInput(uint8_t data)
+{
+	if (this->inputIndex == 0)
+	{
+		this->inputLength = this->packetLength(data);
+	}
+
+	/* Only the key packets matter and they fit, the tail of anything longer is just counted off */
+	if (this->inputIndex < sizeof(this->inputPacket))
+	{
+		this->inputPacket[this->inputIndex] = data;
+	}
+
+	if (++this->inputIndex < this->inputLength) return;
+
+	this->inputIndex = 0;
+
+	uint8_t command = this->inputPacket[0];
+
+	switch (this->deviceType)
+	{
+		case DEVICE_40H_TRELLIS:
+		{
+			if ((command == 0x01) || (command == 0x00))
+			{
+				this->queueKey(this->inputPacket[1] >> 4, this->inputPacket[1] & 0x0F, command == 0x01);
+				return;
 			}
-			else if (deviceType == DEVICE_GRIDS)
+
+			break;
+		}
+
+		case DEVICE_SERIES:
+		{
+			if ((command == 0x00) || (command == 0x10))
 			{
-				uint8_t command = buf[i++];			
-				
-				if (command == 0x21)
-				{
-					uint8_t column = buf[i++];
-					uint8_t row = buf[i];
+				this->queueKey(this->inputPacket[1] >> 4, this->inputPacket[1] & 0x0F, command == 0x00);
+				return;
+			}
 
-					this->lastpress[0] = column;
-					this->lastpress[1] = row;
-				
-					this->buttonPressed(column, row);
-					
-					Serial.print(column, HEX);
-					Serial.print(" ");
-					Serial.println(row, HEX);
-				}
-				else if (command == 0x20)
-				{
-					uint8_t column = buf[i++];
-					uint8_t row = buf[i];
+			break;
+		}
 
-					this->lastrelease[0] = column;
-					this->lastrelease[1] = row;
-				
-					this->buttonReleased(column, row);
-				}
-				else if (command == 0x31)
-				{
-					/* Not sure why the monome is spitting this out constantly */
-				}
-				else
-				{
-					Serial.print("Unknown command: ");
-					Serial.println(command, HEX);
-				}
+		case DEVICE_GRIDS:
+		{
+			if ((command == 0x21) || (command == 0x20))
+			{
+				this->queueKey(this->inputPacket[1], this->inputPacket[2], command == 0x21);
+				return;
 			}
+
+			/* System responses are well formed, they're just not used */
+			if (this->inputLength > 1) return;
+
+			break;
 		}
-	}	
+	}
+
+	if (b::debugMode)
+	{
+		Serial.print("Unknown command: ");
+		Serial.println(command, HEX);
+	}
+}
+
+void USBGridController::queueKey(uint8_t column, uint8_t row, bool pressed)
+{
+	/* A 64 byte read holds at most 32 key packets and the queue is emptied after every read */
+	if ((this->keyHead - this->keyTail) >= GRID_KEY_QUEUE_SIZE)
+	{
+		if (b::debugMode) Serial.println("Key queue full, dropped a key");
+		return;
+	}
+
+	GridKeyEvent* event = &this->keyEvents[this->keyHead % GRID_KEY_QUEUE_SIZE];
+
+	event->column = column;
+	event->row = row;
+	event->pressed = pressed;
+
+	this->keyHead = this->keyHead + 1;
 }
 
+void USBGridController::dispatchKeys()
+{
+	while (this->keyTail != this->keyHead)
+	{
+		GridKeyEvent event = this->keyEvents[this->keyTail % GRID_KEY_QUEUE_SIZE];
 
+		this->keyTail = this->keyTail + 1;
 
+		if (b::debugMode)
+		{
+			Serial.print(event.pressed ? "Key down " : "Key up ");
+			Serial.print(event.column, HEX);
+			Serial.print(" ");
+			Serial.println(event.row, HEX);
+		}
 
+		if (event.pressed)
+		{
+			this->lastpress[0] = event.column;
+			this->lastpress[1] = event.row;
 
+			this->buttonPressed(event.column, event.row);
+		}
+		else
+		{
+			this->lastrelease[0] = event.column;
+			this->lastrelease[1] = event.row;
+
+			this->buttonReleased(event.column, event.row);
+		}
+	}
+}
@@ -37,7 +37,7 @@
 #include <usbhost/Usb.h>
 #include "EventManager.h"
 #include "confdescparser.h"
-#include "aJSON/aJson.h"
+#include "aJSON/aJSON.h"
 
 //define MAX_ENDPOINTS 3
 
@@ -46,6 +46,16 @@
 #define FTDI_SIO_SET_BAUD_RATE 3
 #define FTDI_SIO_SET_FLOW_CTRL 2
 #define FTDI_SIO_DISABLE_FLOW_CTRL 0x0
+#define FTDI_STATUS_LENGTH 2
+
+/* Quadrants are 8x8 - bit 0 is top left, 1 top right, 2 bottom left, 3 bottom right */
+#define GRID_QUADRANT(column, row) (1 << (((column) >> 3) | (((row) >> 3) << 1)))
+#define GRID_ALL_QUADRANTS 0x0F
+
+/* Up to this many changed cells are sent as single LED commands rather than quadrant frames */
+#define GRID_SINGLE_LED_CHANGES 2
+
+#define GRID_KEY_QUEUE_SIZE 32
 
 
 namespace nw2s
@@ -66,6 +76,14 @@ namespace nw2s
 	} 
 	LineCoding;
 
+	typedef struct
+	{
+		uint8_t column;
+		uint8_t row;
+		bool pressed;
+	}
+	GridKeyEvent;
+
 	class USBGrid;
 	class USBGridController;
 
@@ -123,6 +141,7 @@ class nw2s::USBGridController : public USBGrid
 {
 	protected:
 		
+		/* Varibright grids get 4 bit level maps, everything else is off and on */
 		bool varibright = false;	
 		
 		uint8_t beat = 0;
@@ -139,10 +158,37 @@ class nw2s::USBGridController : public USBGrid
 		uint8_t lastrelease[2] = {0, 0};
 		uint8_t currentPage = 0;
 
+		/* What the device is showing [column][row], and the quadrants that may not match the current page */
+		uint8_t shown[16][16];
+		uint8_t dirtyQuadrants = 0;
+		unsigned long lastFlush = 0;
+
+		/* The input packet being put together, which may have been split across reads */
+		uint8_t inputPacket[3];
+		uint8_t inputLength = 0;
+		uint8_t inputIndex = 0;
+
+		/* 
+			A single producer, single consumer ring of key events. parseInput() adds them
+			at head and dispatchKeys() hands them out from tail, so neither has to lock.
+		*/
+		GridKeyEvent keyEvents[GRID_KEY_QUEUE_SIZE];
+		volatile uint32_t keyHead = 0;
+		volatile uint32_t keyTail = 0;
+
 		void setLED(uint8_t page, uint8_t column, uint8_t row, uint8_t value);
 		void clearLED(uint8_t page, uint8_t column, uint8_t row);
 		void switchPage(uint8_t page);
 		void refreshGrid();
+		void flushGrid();
+		bool writeQuadrant(uint8_t quadrant);
+		void writeCell(uint8_t column, uint8_t row);
+		bool isVaribright();
+		uint8_t ledLevel(uint8_t value);
+		uint8_t packetLength(uint8_t command);
+		void parseInput(uint8_t data);
+		void queueKey(uint8_t column, uint8_t row, bool pressed);
+		void dispatchKeys();
 			
 		virtual void buttonPressed(uint8_t column, uint8_t row) = 0;
 		virtual void buttonReleased(uint8_t column, uint8_t row) = 0;
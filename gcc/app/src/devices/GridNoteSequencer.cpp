@@ -280,7 +280,7 @@ void GridNoteSequencer::reset()
 		{
 			if (getValue((this->currentPage % 4) + (voice * 4), beat, i + 1))
 			{
-				if (this->notes[voice] != NULL) this->outs[voice]->outputCV(this->key->getNoteMillivolt(this->notes[voice][rowCount - i - 2][0], this->notes[voice][rowCount - i - 2][1]));
+				this->outs[voice]->outputCV(this->key->getNoteMillivolt(this->notes[voice][rowCount - i - 2][0], this->notes[voice][rowCount - i - 2][1]));
 				this->gates[voice]->reset();
 			}
 		}
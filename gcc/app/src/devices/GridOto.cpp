@@ -338,25 +338,25 @@ void GridOto::reset()
 	
 	if (topevent.isActive)
 	{
-		if (this->notes[0] != NULL) this->outs[0]->outputCV(this->key->getNoteMillivolt(this->notes[0][topevent.column][0], this->notes[0][topevent.column][1]));
+		this->outs[0]->outputCV(this->key->getNoteMillivolt(this->notes[0][topevent.column][0], this->notes[0][topevent.column][1]));
 		gates[0]->reset();
 	}	
 
 	if (rightevent.isActive)
 	{
-		if (this->notes[1] != NULL) this->outs[1]->outputCV(this->key->getNoteMillivolt(this->notes[1][rightevent.row][0],this->notes[1][rightevent.row][1]));
+		this->outs[1]->outputCV(this->key->getNoteMillivolt(this->notes[1][rightevent.row][0],this->notes[1][rightevent.row][1]));
 		gates[1]->reset();
 	}	
 
 	if (bottomevent.isActive)
 	{
-		if (this->notes[2] != NULL) this->outs[2]->outputCV(this->key->getNoteMillivolt(this->notes[2][bottomevent.column][0],this->notes[2][bottomevent.column][1]));
+		this->outs[2]->outputCV(this->key->getNoteMillivolt(this->notes[2][bottomevent.column][0],this->notes[2][bottomevent.column][1]));
 		gates[2]->reset();
 	}	
 
 	if (leftevent.isActive)
 	{
-		if (this->notes[3] != NULL) this->outs[3]->outputCV(this->key->getNoteMillivolt(this->notes[3][leftevent.row][0],this->notes[3][leftevent.row][1]));
+		this->outs[3]->outputCV(this->key->getNoteMillivolt(this->notes[3][leftevent.row][0],this->notes[3][leftevent.row][1]));
 		gates[3]->reset();
 	}	
 
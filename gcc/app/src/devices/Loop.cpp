@@ -24,10 +24,16 @@
 #include "JSONUtil.h"
 #include "Entropy.h"
 #include "Constants.h"
+#include "Mix.h"
+#include "Key.h"
+#include "AnalogScanner.h"
 #include <Arduino.h>
 
 #define CONTROL_CHANGE_THRESHOLD 25
 
+/* Where 0V sits in CVFREQUENCY, which is the speed the loop was recorded at */
+#define PITCH_CONTROL_UNITY 2048
+
 
 using namespace nw2s;
 
@@ -57,6 +63,21 @@ SampleRateInterrupt sampleRateFromName(char* name)
 	return SR_24000;
 }
 
+StreamChannel channelFromName(char* name)
+{
+	if ((name != NULL) && (strcmp(name, "left") == 0))
+	{
+		return CHANNEL_LEFT;
+	}
+	if ((name != NULL) && (strcmp(name, "right") == 0))
+	{
+		return CHANNEL_RIGHT;
+	}
+
+	/* Stereo files are mixed down unless a side is picked */
+	return CHANNEL_MIX;
+}
+
 Looper* Looper::create(PinAudioOut pin, LoopPath loops[], unsigned int loopcount, SampleRateInterrupt sri)
 {
 	Looper* looper = new Looper(pin, loops, loopcount, sri);
@@ -82,6 +103,12 @@ Looper* Looper::create(aJsonObject* data)
 	static const char startcontrolNodeName[] = "startcontrol";
 	static const char bitcontrolNodeName[] = "bitcontrol";
 	static const char triggeroutputNodeName[] = "triggerout";
+	static const char buffersNodeName[] = "buffers";
+	static const char buffersizeNodeName[] = "buffersize";
+	static const char cachesizeNodeName[] = "cachesize";
+	static const char pitchcontrolNodeName[] = "pitchcontrol";
+	static const char interpolationNodeName[] = "interpolation";
+	static const char channelNodeName[] = "channel";
 	
 	char* subfolder = getStringFromJSON(data, subFolderNodeName);
 	char* filename = getStringFromJSON(data, filenameNodeName);
@@ -98,8 +125,14 @@ Looper* Looper::create(aJsonObject* data)
 	PinAnalogIn lengthcontrol = getAnalogInputFromJSON(data, lengthcontrolNodeName);
 	PinAnalogIn finelengthcontrol = getAnalogInputFromJSON(data, finelengthcontrolNodeName);
 	PinAnalogIn startcontrol = getAnalogInputFromJSON(data, startcontrolNodeName);
+	PinAnalogIn pitchcontrol = getAnalogInputFromJSON(data, pitchcontrolNodeName);
 	char* mixmodeVal = getStringFromJSON(data, mixmodeNodeName);
 	char* reversemodeVal = getStringFromJSON(data, reversemodeNodeName);
+	char* interpolationVal = getStringFromJSON(data, interpolationNodeName);
+	StreamChannel channel = channelFromName(getStringFromJSON(data, channelNodeName));
+	int buffers = getIntFromJSON(data, buffersNodeName, STREAM_BUFFER_COUNT, 2, STREAM_BUFFER_COUNT_MAX);
+	int buffersize = getIntFromJSON(data, buffersizeNodeName, STREAM_BUFFER_SIZE, STREAM_BUFFER_MIN, STREAM_BUFFER_MAX);
+	int cachesize = getIntFromJSON(data, cachesizeNodeName, STREAM_CACHE_SIZE, 0, STREAM_CACHE_BUDGET);
 
 	aJsonObject* loops = aJson.getObjectItem(data, loopsNodeName);
 		
@@ -116,8 +149,20 @@ Looper* Looper::create(aJsonObject* data)
 
 			char* subfolder = getStringFromJSON(loopPathNode, subFolderNodeName);
 			char* filename = getStringFromJSON(loopPathNode, filenameNodeName);
+
+			/* Each loop can have its own buffering, otherwise it gets the looper's */
+			int loopbuffers = getIntFromJSON(loopPathNode, buffersNodeName, buffers, 2, STREAM_BUFFER_COUNT_MAX);
+			int loopbuffersize = getIntFromJSON(loopPathNode, buffersizeNodeName, buffersize, STREAM_BUFFER_MIN, STREAM_BUFFER_MAX);
+			int loopcachesize = getIntFromJSON(loopPathNode, cachesizeNodeName, cachesize, 0, STREAM_CACHE_BUDGET);
+
+			/* Loops with their own pitch control play at their own speed */
+			PinAnalogIn looppitchcontrol = getAnalogInputFromJSON(loopPathNode, pitchcontrolNodeName);
+			looppitchcontrol = (looppitchcontrol != ANALOG_IN_NONE) ? looppitchcontrol : pitchcontrol;
+
+			char* loopchannelVal = getStringFromJSON(loopPathNode, channelNodeName);
+			StreamChannel loopchannel = (loopchannelVal != NULL) ? channelFromName(loopchannelVal) : channel;
 			
-			loopPaths[i] = { subfolder, filename };
+			loopPaths[i] = { subfolder, filename, loopbuffers, loopbuffersize, loopcachesize, looppitchcontrol, loopchannel };
 		}
 
 		looper = new Looper(output, loopPaths, loopcount, sri);
@@ -125,7 +170,7 @@ Looper* Looper::create(aJsonObject* data)
 	else
 	{
 		//TODO: error if we can't find the nodes/filenames
-		LoopPath lp[] = { { subfolder, filename } };
+		LoopPath lp[] = { { subfolder, filename, buffers, buffersize, cachesize, pitchcontrol, channel } };
 			
 		looper = new Looper(output, lp, 1, sri);
 	}
@@ -167,7 +212,7 @@ Looper* Looper::create(aJsonObject* data)
 	}
 	
 	/* TRIGGER OUTPUT */
-	if (triggerout != ANALOG_OUT_NONE)
+	if (triggerout != DIGITAL_OUT_NONE)
 	{
 		looper->setTriggerOut(triggerout);
 	}
@@ -236,12 +281,37 @@ Looper* Looper::create(aJsonObject* data)
 		looper->setReverseMode(REVERSE_TRIGGER);
 	}
 
+	/* INTERPOLATION */
+	if (interpolationVal == NULL)
+	{
+		/* Keep the default */
+	}
+	else if (strcmp(interpolationVal, "none") == 0)
+	{
+		looper->setInterpolation(INTERPOLATION_NONE);
+	}
+	else if (strcmp(interpolationVal, "linear") == 0)
+	{
+		looper->setInterpolation(INTERPOLATION_LINEAR);
+	}
+	else if (strcmp(interpolationVal, "hermite") == 0)
+	{
+		looper->setInterpolation(INTERPOLATION_HERMITE);
+	}
+
 	return looper;
 }
 
-EFLooper* EFLooper::create(PinAnalogOut pin, PinAnalogIn windowsize, PinAnalogIn scale, PinAnalogIn threshold, char* subfoldername, char* filename)
+EFLooper* EFLooper::create(PinAnalogOut pin, PinAnalogIn windowsize, PinAnalogIn scale, PinAnalogIn threshold, const char* subfoldername, const char* filename, SampleRateInterrupt sri)
 {
-	EFLooper* looper = new EFLooper(pin, windowsize, scale, threshold, subfoldername, filename);
+	EFLooper* looper = new EFLooper(pin, windowsize, scale, threshold, ANALOG_IN_NONE, subfoldername, filename, sri);
+
+	return looper;
+}
+
+EFLooper* EFLooper::create(PinAnalogOut pin, PinAnalogIn windowsize, PinAnalogIn scale, PinAnalogIn threshold, PinAnalogIn input)
+{
+	EFLooper* looper = new EFLooper(pin, windowsize, scale, threshold, input, NULL, NULL, SR_24000);
 
 	return looper;
 }
@@ -253,77 +323,216 @@ EFLooper* EFLooper::create(aJsonObject* data)
 	static const char windowsizeNodeName[] = "windowsize";
 	static const char scaleNodeName[] = "scale";
 	static const char fthresholdNodeName[] = "threshold";
+	static const char inputNodeName[] = "input";
+	static const char controlrateNodeName[] = "controlrate";
+	static const char attackNodeName[] = "attack";
+	static const char releaseNodeName[] = "release";
 	
-	char* subfolder = getStringFromJSON(data, subFolderNodeName);
-	char* filename = getStringFromJSON(data, filenameNodeName);
 	PinAnalogOut output = getAnalogOutputFromJSON(data);
 	PinAnalogIn windowsize = getAnalogInputFromJSON(data, windowsizeNodeName);
 	PinAnalogIn scale = getAnalogInputFromJSON(data, scaleNodeName);
 	PinAnalogIn threshold = getAnalogInputFromJSON(data, fthresholdNodeName);
-		
-	EFLooper* looper = new EFLooper(output, windowsize, scale, threshold, subfolder, filename);
+	PinAnalogIn input = getAnalogInputFromJSON(data, inputNodeName);
+	int controlrate = getIntFromJSON(data, controlrateNodeName, 1, 1, EF_CONTROL_RATE_MAX);
+	int attack = getIntFromJSON(data, attackNodeName, 0, 0, EF_SMOOTHING_MAX);
+	int release = getIntFromJSON(data, releaseNodeName, 0, 0, EF_SMOOTHING_MAX);
+
+	EFLooper* looper;
+	
+	/* Live audio on an input takes the place of a file */
+	if (input != ANALOG_IN_NONE)
+	{
+		looper = new EFLooper(output, windowsize, scale, threshold, input, NULL, NULL, SR_24000);
+	}
+	else
+	{
+		char* subfolder = getStringFromJSON(data, subFolderNodeName);
+		char* filename = getStringFromJSON(data, filenameNodeName);
+		SampleRateInterrupt sri = getSampleRateFromJSON(data);
+
+		looper = new EFLooper(output, windowsize, scale, threshold, ANALOG_IN_NONE, subfolder, filename, sri);
+	}
+
+	looper->setControlRate(controlrate);
+	looper->setAttack(attack);
+	looper->setRelease(release);
 
 	return looper;
 }
 
-EFLooper::EFLooper(PinAnalogOut pin, PinAnalogIn windowsize, PinAnalogIn scale, PinAnalogIn threshold, char* subfoldername, char* filename)
+EFLooper::EFLooper(PinAnalogOut pin, PinAnalogIn windowsize, PinAnalogIn scale, PinAnalogIn threshold, PinAnalogIn input, const char* subfoldername, const char* filename, SampleRateInterrupt sri)
 {
 	this->output = AnalogOut::create(pin);
 	this->thresholdin = threshold;
 	this->windowsizein = windowsize;
 	this->scalein = scale;
-	this->signalData = StreamingSignalData::fromSDFile("loops", subfoldername, filename, true);	
+	this->input = input;
+
+	/* Live audio is followed at the rate the ADC scans, not once a tick */
+	AnalogScanner::stream(input);
+	this->inputPosition = 0;
+
+	this->signalData = (input == ANALOG_IN_NONE) ? StreamingSignalData::fromSDFile("loops", subfoldername, filename, true) : NULL;
 
-	this->windowsize = analogReadmV(this->windowsizein, 0, 5000) / 10;
+	/* The SR values are timer counts at MCK/8 */
+	this->rate = 10500000 / sri;
+	this->owed = 0;
+	this->period = 1;
+	this->level = 0;
+	this->setAttack(0);
+	this->setRelease(0);
+
+	memset(this->window, 0, sizeof(this->window));
+	this->windowHead = 0;
+	this->windowSum = 0;
+	this->windowsize = 1;
+
+	this->resizeWindow(1 + ((analogReadmV(this->windowsizein, 0, 5000) * (EF_WINDOW_MAX - 1)) / 5000));
 	this->threshold = analogReadmV(this->thresholdin, 0, 5000) / 2;
 	this->scale = analogReadmV(this->scalein, 0, 5000) / 2;
 }
 
+void EFLooper::setControlRate(int period)
+{
+	this->period = (period < 1) ? 1 : (period > EF_CONTROL_RATE_MAX) ? EF_CONTROL_RATE_MAX : period;
+
+	/* The coefficients are per update, so they change with the period */
+	this->attack = smoothing(this->attackTime, this->period);
+	this->release = smoothing(this->releaseTime, this->period);
+}
+
+void EFLooper::setAttack(int attack)
+{
+	this->attackTime = attack;
+	this->attack = smoothing(attack, this->period);
+}
+
+void EFLooper::setRelease(int release)
+{
+	this->releaseTime = release;
+	this->release = smoothing(release, this->period);
+}
+
+int32_t EFLooper::smoothing(int time, int period)
+{
+	/* A one pole coefficient that gets about two thirds of the way there in time milliseconds */
+	time = (time < 0) ? 0 : (time > EF_SMOOTHING_MAX) ? EF_SMOOTHING_MAX : time;
+
+	return (65536 * period) / (time + period);
+}
+
+void EFLooper::resizeWindow(int windowsize)
+{
+	windowsize = (windowsize < 1) ? 1 : (windowsize > EF_WINDOW_MAX) ? EF_WINDOW_MAX : windowsize;
+
+	/* Only the samples between the old and new sizes move in or out of the sum */
+	for (int i = this->windowsize; i < windowsize; i++)
+	{
+		this->windowSum += this->window[(this->windowHead - i) & (EF_WINDOW_MAX - 1)];
+	}
+
+	for (int i = windowsize; i < this->windowsize; i++)
+	{
+		this->windowSum -= this->window[(this->windowHead - i) & (EF_WINDOW_MAX - 1)];
+	}
+
+	this->windowsize = windowsize;
+}
+
+void EFLooper::push(int16_t sample)
+{
+	uint16_t rectified = (sample < 0) ? -sample : sample;
+
+	this->windowHead = (this->windowHead + 1) & (EF_WINDOW_MAX - 1);
+
+	/* Whatever falls off the back of the window comes out of the sum */
+	this->windowSum += rectified;
+	this->windowSum -= this->window[(this->windowHead - this->windowsize) & (EF_WINDOW_MAX - 1)];
+	this->window[this->windowHead] = rectified;
+}
+
 void EFLooper::timer(unsigned long t)
 {
 	if (t % 100 == 0)
 	{
 		/* Only read the knobs every 100ms */
-		this->windowsize = analogReadmV(this->windowsizein, 0, 5000) / 10;
+		this->resizeWindow(1 + ((analogReadmV(this->windowsizein, 0, 5000) * (EF_WINDOW_MAX - 1)) / 5000));
 		this->threshold = analogReadmV(this->thresholdin, 0, 5000) / 2;
 		this->scale = analogReadmV(this->scalein, 0, 5000) / 2;	
-		
-		/* Figure out the loop length */
-		
-		/* Figure out the start and stop point */
-			
 	}
-	
-	/* Accumulate as many samples as are in the window, abs and average them and that's our output */	
-	unsigned long a = 0;
-	
-	for (int i = 0; i < this->windowsize; i++)
+
+	/* 
+		Live input is every conversion since the last tick, around 0V in the middle of the ADC. 
+		They're uncalibrated, which moves 0V by a few counts at most. Without the scanner 
+		there's just the one reading a tick.
+	*/
+	if ((this->input != ANALOG_IN_NONE) && AnalogScanner::isRunning())
 	{
-		int b = this->signalData->getNextSample();
-		a += (b > 0) ? b : b * -1;
-	}
-	
-	/* Scale, convert to a 12-bit value and clip at 5000 */
-	a = (a < this->threshold) ? 0 : a;
+		uint16_t block[ANALOG_STREAM_SIZE];
+		int count = AnalogScanner::readStream(this->input, &this->inputPosition, block, ANALOG_STREAM_SIZE);
 
-	short int c = (a * this->scale) / (windowsize * 100);
+		for (int i = 0; i < count; i++) this->push((block[i] - 2048) << 4);
+	}
+	else if (this->input != ANALOG_IN_NONE)
+	{
+		this->push((analogRead(this->input) - 2048) << 4);
+	}
 
-	c = (c > 5000) ? 5000 : c;
-		
-	this->output->outputCV(c);
+	if (t % this->period == 0)
+	{
+		this->update();
+	}
 	
-	if (this->signalData->isReadyForRefresh())
+	if ((this->signalData != NULL) && this->signalData->isReadyForRefresh())
 	{
 		this->signalData->refresh();
 	}
 }
 
+void EFLooper::update()
+{
+	/* A file gives up as many samples as played since the last update, however many that works out to */
+	if (this->signalData != NULL)
+	{
+		int16_t block[64];
+
+		this->owed += this->rate * this->period;
+		int samples = this->owed / 1000;
+		this->owed -= samples * 1000;
+
+		while (samples > 0)
+		{
+			int count = (samples > 64) ? 64 : samples;
+
+			this->signalData->getNextSamples(block, count);
+
+			for (int i = 0; i < count; i++) this->push(block[i]);
+
+			samples -= count;
+		}
+	}
+
+	/* Average, gate, scale and clip at 5000 */
+	int32_t average = this->windowSum / this->windowsize;
+	int32_t target = (average < this->threshold) ? 0 : (average * this->scale) / 100;
+
+	target = (target > 5000) ? 5000 : target;
+
+	/* The level is in 16.16 mV so slow releases don't stall short of zero */
+	int32_t coefficient = ((target << 16) > this->level) ? this->attack : this->release;
+
+	this->level += ((int64_t)((target << 16) - this->level) * coefficient) >> 16;
+
+	this->output->outputCV(this->level >> 16);
+}
+
 Looper::Looper(PinAudioOut pin, LoopPath loops[], unsigned int loopcount, SampleRateInterrupt sri)
 {
 	/* Load the file(s) */
-	for (int i = 0; i < loopcount; i++)
+	for (unsigned int i = 0; i < loopcount; i++)
 	{
-		this->signalData.push_back(StreamingSignalData::fromSDFile("loops", loops[i].subfoldername, loops[i].filename, true));
+		this->signalData.push_back(StreamingSignalData::fromSDFile("loops", loops[i].subfoldername, loops[i].filename, true, loops[i].buffers, loops[i].buffersize, loops[i].cachesize, loops[i].channel));
+		this->pitchcontrols.push_back(loops[i].pitchcontrol);
 	}
 
 	this->muted = false;	
@@ -338,131 +547,112 @@ Looper::Looper(PinAudioOut pin, LoopPath loops[], unsigned int loopcount, Sample
 	this->loop2index = 1;
 	this->glitchmode_stream = 0;
 	this->mixmode = MIXMODE_NONE;
-			
-	this->initializeTimer(pin, sri);
-}
-
-void Looper::initializeTimer(PinAudioOut pin, SampleRateInterrupt sri)
-{
-	/* The event handler needs static references to these devices */
-	if (pin == DUE_DAC0) AudioDevice::device0 = this;
-	if (pin == DUE_DAC1) AudioDevice::device1 = this;
-
-	/* Make sure the dac is zeroed and on */
-	analogWriteResolution(12);
-  	analogWrite(pin, 0);
-
 	this->pin = pin;
-	this->channel = (pin == DUE_DAC0) ? 1 : 2;
-	this->dac = (pin == DUE_DAC0) ? 0 : 1;
-
-	int tc_id = (pin == DUE_DAC0) ? ID_TC4 : ID_TC5;
-	IRQn_Type tc_irq = (pin == DUE_DAC0) ? TC4_IRQn : TC5_IRQn;
-
-  	pmc_set_writeprotect(false);
-  	pmc_enable_periph_clk(tc_id);
-
-  	TC_Configure(TC1, this->channel, TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC | TC_CMR_TCCLKS_TIMER_CLOCK2);
-  	TC_SetRC(TC1, this->channel, sri);
-  	TC_Start(TC1, this->channel);
-
-  	/* enable timer interrupts */
-  	TC1->TC_CHANNEL[this->channel].TC_IER = TC_IER_CPCS;
-  	TC1->TC_CHANNEL[this->channel].TC_IDR = ~TC_IER_CPCS;  
-
-  	NVIC_EnableIRQ(tc_irq);	
+			
+	this->startOutput(pin, sri);
 }
 
-void Looper::timer_handler()
+void Looper::render(uint16_t* block, int samples)
 {
-	if (!this->muted)
+	/* A muted looper just holds the DAC where it was */
+	if (this->muted)
 	{
-		int32_t outputval = 0;
-		
-	 	dacc_set_channel_selection(DACC_INTERFACE, this->dac);
-		if (this->loopcount == 1)
-		{
-			outputval = this->signalData[0]->getNextSample();
-		}
-		else
+		for (int i = 0; i < samples; i++) block[i] = this->lastSample;
+		return;
+	}
+	
+	if (samples <= 0) return;
+	
+	int16_t a[AUDIO_BLOCK_SIZE];
+	int16_t b[AUDIO_BLOCK_SIZE];
+	uint16_t mask = (this->bitcontrol != ANALOG_IN_NONE) ? this->bitDepthMask : 0xFFFF;
+	
+	if (this->loopcount == 1)
+	{
+		this->signalData[0]->getNextSamples(a, samples);
+		mixSingle(block, a, samples, mask);
+	}
+	else
+	{
+		/* Mix the two according to the current mix mode */
+		switch (this->mixmode)
 		{
-			/* Mix the two according to the current mix mode */
-			if (this->mixmode == MIXMODE_TOGGLE || this->mixmode == MIXMODE_CV)
-			{
-				outputval = this->signalData[loop1index]->getNextSample();			
-			}
-			else if (this->mixmode == MIXMODE_AND)
-			{
-				outputval = this->signalData[loop1index]->getNextSample() & this->signalData[loop2index]->getNextSample();
-			}
-			else if (this->mixmode == MIXMODE_XOR)
-			{
-				outputval = this->signalData[loop1index]->getNextSample() ^ this->signalData[loop2index]->getNextSample();
-			}
-			else if (this->mixmode == MIXMODE_BLEND)
+			case MIXMODE_TOGGLE:
+			case MIXMODE_CV:
+				this->signalData[loop1index]->getNextSamples(a, samples);
+				mixSingle(block, a, samples, mask);
+				break;
+
+			case MIXMODE_AND:
+				this->signalData[loop1index]->getNextSamples(a, samples);
+				this->signalData[loop2index]->getNextSamples(b, samples);
+				mixAnd(block, a, b, samples, mask);
+				break;
+
+			case MIXMODE_XOR:
+				this->signalData[loop1index]->getNextSamples(a, samples);
+				this->signalData[loop2index]->getNextSamples(b, samples);
+				mixXor(block, a, b, samples, mask);
+				break;
+
+			case MIXMODE_BLEND:
 			{
 				/* Our gain lookup table converts linear values to a kinda equal power curve */
-				int16_t sample1 = this->signalData[loop1index]->getNextSample();
-				int16_t sample2 = this->signalData[loop2index]->getNextSample();
-
-				int16_t val1 = (sample1 * this->loop1gain) / 1024;
-				int16_t val2 = (sample2 * this->loop2gain) / 1024;
-
-				/* Sum and dither */
-				outputval = (val1 + val2) ^ Entropy::getBit();				
-			}
-			else if (this->mixmode == MIXMODE_GLITCH)
-			{
-				int sample1 = this->signalData[loop1index]->getNextSample();
-				int sample2 = this->signalData[loop2index]->getNextSample();
-				
-				/* Toggle from one stream to the other if the samples are equal */
-				this->glitchmode_stream = this->glitchmode_stream ^ (sample1 == sample2);
-				
-				if (!this->nexttriggerstate) this->nexttriggerstate = (sample1 == sample2);
+				uint32_t dither[AUDIO_BLOCK_SIZE / 32] = { 0 };
 				
-				outputval = (this->glitchmode_stream) ? sample2 : sample1;
-			}
-			else if (this->mixmode == MIXMODE_RING)
-			{
-				long val1 = this->signalData[loop1index]->getNextSample() * this->signalData[loop2index]->getNextSample();
+				for (int i = 0; i < samples; i++) dither[i >> 5] |= (uint32_t)Entropy::getBit() << (i & 31);
 				
-				outputval = val1 >> 16;
+				this->signalData[loop1index]->getNextSamples(a, samples);
+				this->signalData[loop2index]->getNextSamples(b, samples);
+				mixBlend(block, a, b, samples, this->loop1gain, this->loop2gain, dither, mask);
+				break;
 			}
+			
+			case MIXMODE_GLITCH:
+				this->signalData[loop1index]->getNextSamples(a, samples);
+				this->signalData[loop2index]->getNextSamples(b, samples);
+				mixGlitch(block, a, b, samples, &this->glitchmode_stream, &this->nexttriggerstate, mask);
+				break;
+
+			case MIXMODE_RING:
+				this->signalData[loop1index]->getNextSamples(a, samples);
+				this->signalData[loop2index]->getNextSamples(b, samples);
+				mixRing(block, a, b, samples, mask);
+				break;
+			
+			default:
+				/* Nothing selected is silence */
+				for (int i = 0; i < samples; i++) block[i] = mixToDAC(0, mask);
+				break;
 		}
-		
-		/* Convert to unsigned range */
-		outputval = outputval + 0x7FFF;
-
-
-		/* Saturate at 16 bits */
-		outputval = (outputval > 0xFFFF) ? 0xFFFF : (outputval < 0) ? 0 : outputval;
-
-		/* Bit crushing */
-		if (this->bitcontrol != ANALOG_IN_NONE)
-		{
-			outputval = outputval & this->bitDepthMask;
-		}
-					
-		/* For now, we're doing all audio as 12 bit unsigned, so we have to do the conversion before writing the register */
-		uint32_t dacval = outputval >> 4;
-		
-		dacc_write_conversion_data(DACC_INTERFACE, dacval);
 	}
+	
+	this->lastSample = block[samples - 1];
 }
 
 void Looper::timer(unsigned long t)
 {	
 	/* Every millisecond, check if it's ready to get more data loaded */
-	if (this->signalData[loop1index]->isReadyForRefresh())
-	{
-		this->signalData[loop1index]->refresh();
-	}
+	this->refreshLoop(loop1index);
 		
 	/* Check the other one too */
-	if (loopcount > 1 && this->signalData[loop2index]->isReadyForRefresh())
+	if (loopcount > 1)
 	{
-		this->signalData[loop2index]->refresh();
+		this->refreshLoop(loop2index);
+	}
+
+	/* Every 10ms, read the pitch of each loop as V/oct around the speed it was recorded at */
+	if (t % 10 == 0)
+	{
+		for (unsigned int i = 0; i < this->loopcount; i++)
+		{
+			if (this->pitchcontrols[i] == ANALOG_IN_NONE) continue;
+
+			int value = analogRead(this->pitchcontrols[i]);
+			value = (value < 0) ? 0 : (value > 4000) ? 4000 : value;
+
+			this->signalData[i]->setSpeed(((uint64_t)CVFREQUENCY[value] << 16) / CVFREQUENCY[PITCH_CONTROL_UNITY]);
+		}
 	}
 		
 
@@ -473,7 +663,7 @@ void Looper::timer(unsigned long t)
 		{
 			this->reversed = true;
 
-			for(int i = 0; i < this->loopcount; i++)
+			for (unsigned int i = 0; i < this->loopcount; i++)
 			{
 				this->signalData[i]->reverse();
 			}
@@ -593,7 +783,7 @@ void Looper::timer(unsigned long t)
 		if (controlval < (CONTROL_CHANGE_THRESHOLD * 2) || controlval > (this->laststartval + CONTROL_CHANGE_THRESHOLD) || controlval < (this->laststartval - CONTROL_CHANGE_THRESHOLD))
 		{
 			/* Update all of our samples with that info */
-			for (int i = 0; i < this->signalData.size(); i++)
+			for (unsigned int i = 0; i < this->signalData.size(); i++)
 			{
 				this->signalData[i]->setStartFactor(controlval);
 			}
@@ -613,7 +803,7 @@ void Looper::timer(unsigned long t)
 		if (controlval > (this->lastlenval + CONTROL_CHANGE_THRESHOLD) || controlval < (this->lastlenval - CONTROL_CHANGE_THRESHOLD))
 		{
 			/* Update all of our samples with that info */
-			for (int i = 0; i < this->signalData.size(); i++)
+			for (unsigned int i = 0; i < this->signalData.size(); i++)
 			{
 				this->signalData[i]->setEndFactor(controlval);
 			}
@@ -633,7 +823,7 @@ void Looper::timer(unsigned long t)
 		if (controlval > (this->lastfinelenval + CONTROL_CHANGE_THRESHOLD) || controlval < (this->lastfinelenval - CONTROL_CHANGE_THRESHOLD))
 		{
 			/* Update all of our samples with that info */
-			for (int i = 0; i < this->signalData.size(); i++)
+			for (unsigned int i = 0; i < this->signalData.size(); i++)
 			{
 				this->signalData[i]->setFineEndFactor(controlval);
 			}
@@ -703,6 +893,35 @@ void Looper::timer(unsigned long t)
 	}		
 }
 
+void Looper::refreshLoop(unsigned int index)
+{
+	/* A loop playing faster empties its ring faster, so it gets a refresh for each time the recorded rate goes into its speed */
+	StreamingSignalData* loop = this->signalData[index];
+	uint32_t refreshes = (loop->getSpeed() + STREAM_SPEED_UNITY - 1) >> 16;
+
+	for (uint32_t i = 0; (i < refreshes) && loop->isReadyForRefresh(); i++)
+	{
+		loop->refresh();
+	}
+}
+
+void Looper::setPitchControl(PinAnalogIn pitchcontrol)
+{
+	/* Sets every loop that doesn't have a pitch control of its own */
+	for (unsigned int i = 0; i < this->loopcount; i++)
+	{
+		if (this->pitchcontrols[i] == ANALOG_IN_NONE) this->pitchcontrols[i] = pitchcontrol;
+	}
+}
+
+void Looper::setInterpolation(StreamInterpolation interpolation)
+{
+	for (unsigned int i = 0; i < this->signalData.size(); i++)
+	{
+		this->signalData[i]->setInterpolation(interpolation);
+	}
+}
+
 void Looper::setDensityInput(PinAnalogIn density)
 {
 	this->density = density;
@@ -767,3 +986,222 @@ void Looper::setTriggerOut(PinDigitalOut triggerout)
 {
 	this->triggerout = triggerout;
 }
+
+SlicePlayer* SlicePlayer::create(PinAudioOut pin, char* subfoldername, char* filename, Slice slices[], unsigned int slicecount, SampleRateInterrupt sri, int buffers, int buffersize, StreamChannel channel)
+{
+	return new SlicePlayer(pin, subfoldername, filename, slices, slicecount, sri, buffers, buffersize, channel);
+}
+
+SlicePlayer* SlicePlayer::create(aJsonObject* data)
+{
+	static const char subFolderNodeName[] = "subfolder";
+	static const char filenameNodeName[] = "filename";
+	static const char slicesNodeName[] = "slices";
+	static const char startNodeName[] = "start";
+	static const char lengthNodeName[] = "length";
+	static const char triggerNodeName[] = "trigger";
+	static const char buffersNodeName[] = "buffers";
+	static const char buffersizeNodeName[] = "buffersize";
+	static const char channelNodeName[] = "channel";
+
+	char* subfolder = getStringFromJSON(data, subFolderNodeName);
+	char* filename = getStringFromJSON(data, filenameNodeName);
+	SampleRateInterrupt sri = getSampleRateFromJSON(data);
+	PinAudioOut output = getAudioOutputFromJSON(data);
+	StreamChannel channel = channelFromName(getStringFromJSON(data, channelNodeName));
+	int buffers = getIntFromJSON(data, buffersNodeName, SLICE_BUFFER_COUNT, 2, STREAM_BUFFER_COUNT_MAX);
+	int buffersize = getIntFromJSON(data, buffersizeNodeName, SLICE_BUFFER_SIZE, STREAM_BUFFER_MIN, STREAM_BUFFER_MAX);
+
+	aJsonObject* slicesNode = aJson.getObjectItem(data, slicesNodeName);
+	int slicecount = (slicesNode != NULL) ? aJson.getArraySize(slicesNode) : 0;
+
+	if (slicecount == 0)
+	{
+		static const char nodeError[] = "SlicePlayer defined with no slices";
+		Serial.println(String(nodeError));
+	}
+
+	Slice slices[(slicecount > 0) ? slicecount : 1];
+
+	for (int i = 0; i < slicecount; i++)
+	{
+		aJsonObject* sliceNode = aJson.getArrayItem(slicesNode, i);
+
+		/* Offsets are in samples, and a length of 0 plays to the end of the file */
+		slices[i].start = getIntFromJSON(sliceNode, startNodeName, 0, 0, 0x7FFFFFFF);
+		slices[i].length = getIntFromJSON(sliceNode, lengthNodeName, 0, 0, 0x7FFFFFFF);
+		slices[i].trigger = getDigitalInputFromJSON(sliceNode, triggerNodeName);
+	}
+
+	return new SlicePlayer(output, subfolder, filename, slices, slicecount, sri, buffers, buffersize, channel);
+}
+
+SlicePlayer::SlicePlayer(PinAudioOut pin, char* subfoldername, char* filename, Slice slices[], unsigned int slicecount, SampleRateInterrupt sri, int buffers, int buffersize, StreamChannel channel)
+{
+	/* Every voice streams the same file from wherever its slice starts, and they all share the card through the scheduler */
+	for (int i = 0; i < SLICE_VOICES; i++)
+	{
+		this->voices[i].stream = StreamingSignalData::fromSDFile("loops", subfoldername, filename, true, buffers, buffersize, 0, channel);
+		this->voices[i].slice = -1;
+		this->voices[i].trigger = -1;
+		this->voices[i].remaining = 0;
+		this->voices[i].started = 0;
+
+		this->scheduler.add(this->voices[i].stream);
+	}
+
+	StreamingSignalData* stream = this->voices[0].stream;
+	uint32_t samplecount = stream->getSampleCount();
+
+	for (unsigned int i = 0; i < slicecount; i++)
+	{
+		Slice slice = slices[i];
+
+		/* A slice that can't be played keeps its place, so the ones after it keep their numbers */
+		if (slice.start >= samplecount)
+		{
+			Serial.println("Slice " + String(i) + " starts past the end of the file, skipping");
+
+			slice.length = 0;
+			slice.trigger = DIGITAL_IN_NONE;
+
+			this->slices.push_back(slice);
+			this->heads.push_back(NULL);
+			this->bounce.push_back(false);
+
+			continue;
+		}
+
+		if ((slice.length == 0) || (slice.start + slice.length > samplecount))
+		{
+			slice.length = samplecount - slice.start;
+		}
+
+		/* The first buffer of every slice is kept in memory so a trigger never waits on the card */
+		int16_t* head = new int16_t[stream->getBufferSize()];
+		stream->readHead(slice.start, head);
+
+		this->slices.push_back(slice);
+		this->heads.push_back(head);
+		this->bounce.push_back(false);
+	}
+
+	this->startOutput(pin, sri);
+}
+
+void SlicePlayer::timer(unsigned long t)
+{
+	/* Each slice starts on the rising edge of its trigger */
+	for (unsigned int i = 0; i < this->slices.size(); i++)
+	{
+		if (this->slices[i].trigger == DIGITAL_IN_NONE) continue;
+
+		bool high = digitalRead(this->slices[i].trigger);
+
+		if (high && !this->bounce[i])
+		{
+			this->trigger(i, t);
+		}
+
+		this->bounce[i] = high;
+	}
+
+	/* Every millisecond, whichever voice is closest to running out gets more data loaded */
+	this->scheduler.service();
+}
+
+void SlicePlayer::trigger(int slice, unsigned long t)
+{
+	int voice = -1;
+
+	if (this->slices[slice].length == 0) return;
+
+	/* A slice that's still playing is restarted on its own voice */
+	for (int i = 0; (i < SLICE_VOICES) && (voice < 0); i++)
+	{
+		bool playing = (this->voices[i].remaining > 0) || (this->voices[i].trigger >= 0);
+
+		if (playing && (this->voices[i].slice == slice)) voice = i;
+	}
+
+	/* Otherwise take a free voice */
+	for (int i = 0; (i < SLICE_VOICES) && (voice < 0); i++)
+	{
+		if ((this->voices[i].remaining == 0) && (this->voices[i].trigger < 0)) voice = i;
+	}
+
+	/* Or steal the one that has been playing the longest */
+	if (voice < 0)
+	{
+		voice = 0;
+
+		for (int i = 1; i < SLICE_VOICES; i++)
+		{
+			if (this->voices[i].started < this->voices[voice].started) voice = i;
+		}
+	}
+
+	SliceVoice* v = &this->voices[voice];
+
+	/* 
+		The seek and the trigger have to land together. Otherwise the audio interrupt 
+		could pick up the new slice's samples and play them out with the old slice's length.
+		The seek only copies the slice's first buffer, so interrupts aren't held off for long.
+	*/
+	noInterrupts();
+
+	/* A voice that is playing crossfades into the new slice, an idle one just starts */
+	v->stream->seek(this->slices[slice].start, this->heads[slice], v->remaining > 0);
+	v->slice = slice;
+	v->started = t;
+
+	/* The audio interrupt picks this up at the start of its next block */
+	v->trigger = slice;
+
+	interrupts();
+}
+
+void SlicePlayer::render(uint16_t* block, int samples)
+{
+	int32_t mix[AUDIO_BLOCK_SIZE];
+	int16_t v[AUDIO_BLOCK_SIZE];
+
+	memset(mix, 0, samples * sizeof(mix[0]));
+
+	for (int i = 0; i < SLICE_VOICES; i++)
+	{
+		SliceVoice* voice = &this->voices[i];
+		int trigger = voice->trigger;
+
+		if (trigger >= 0)
+		{
+			voice->remaining = this->slices[trigger].length;
+			voice->trigger = -1;
+		}
+
+		uint32_t remaining = voice->remaining;
+
+		if (remaining == 0) continue;
+
+		int count = (remaining < (uint32_t)samples) ? remaining : samples;
+
+		voice->stream->getNextSamples(v, count);
+
+		/* Ramp down over the last few samples so a slice cut in the middle of a sound doesn't click */
+		for (int j = 0; j < count; j++)
+		{
+			uint32_t left = remaining - j;
+			int32_t sample = (left < (uint32_t)STREAM_CROSSFADE) ? (v[j] * (int32_t)left) / STREAM_CROSSFADE : v[j];
+
+			mix[j] += sample;
+		}
+
+		voice->remaining = remaining - count;
+	}
+
+	/* Voices play at full level like a Looper's, and saturate rather than wrap if they add up to more */
+	for (int i = 0; i < samples; i++)
+	{
+		block[i] = mixToDAC(mix[i], 0xFFFF);
+	}
+}
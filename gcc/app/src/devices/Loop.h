@@ -29,18 +29,15 @@
 
 namespace nw2s 
 {
-	typedef int SampleRateInterrupt;
-	
-	static const SampleRateInterrupt SR_10000 = 1050; 
-	static const SampleRateInterrupt SR_12000 = 875; 
-	static const SampleRateInterrupt SR_24000 = 437;   // Close enough 
-	static const SampleRateInterrupt SR_48000 = 219;   // Closer... 
-	static const SampleRateInterrupt SR_44100 = 238;   // Really close!  
-	
 	struct LoopPath
 	{
 		char* subfoldername;
 		char* filename;
+		int buffers;
+		int buffersize;
+		int cachesize;
+		PinAnalogIn pitchcontrol;
+		StreamChannel channel;
 	};
 	
 	enum MixMode
@@ -67,14 +64,43 @@ namespace nw2s
 		SYNC_CONTINUOUS,
 		SYNC_PAUSE
 	};
+
+	/* A slice is a run of samples in one loop file, played once through when its trigger goes high */
+	struct Slice
+	{
+		uint32_t start;
+		uint32_t length;
+		PinDigitalIn trigger;
+	};
+
+	/* Four voices share the card, so each gets a deeper ring of smaller buffers than a Looper */
+	static const int SLICE_VOICES = 4;
+	static const int SLICE_BUFFER_COUNT = 8;
+	static const int SLICE_BUFFER_SIZE = 256;
 	
+	struct SliceVoice
+	{
+		StreamingSignalData* stream;
+		volatile int slice;
+		volatile int trigger;
+		volatile uint32_t remaining;
+		uint32_t started;
+	};
+	
+	/* The envelope follower remembers this many rectified samples, so resizing its window never rereads anything */
+	static const int EF_WINDOW_MAX = 1024;
+	static const int EF_CONTROL_RATE_MAX = 100;
+	static const int EF_SMOOTHING_MAX = 10000;
+
 	class Looper;
 	class ClockedLooper;
 	class EFLooper;
+	class SlicePlayer;
 	class BeatDevice;
 }
 
 SampleRateInterrupt sampleRateFromName(char* name);
+StreamChannel channelFromName(char* name);
 
 class nw2s::Looper : public AudioDevice, public nw2s::TimeBasedDevice
 {
@@ -95,8 +121,10 @@ class nw2s::Looper : public AudioDevice, public nw2s::TimeBasedDevice
 		void setResetTrigger(PinDigitalIn resettrigger);
 		void setMixMode(MixMode mixmode);
 		void setSyncMode(SyncMode syncMode);
+		void setPitchControl(PinAnalogIn pitchcontrol);
+		void setInterpolation(StreamInterpolation interpolation);
 		virtual void timer(unsigned long t);
-		virtual void timer_handler();
+		virtual void render(uint16_t* block, int samples);
 		
 	protected:
 		PinDigitalIn glitchTrigger = DIGITAL_IN_NONE;
@@ -142,33 +170,86 @@ class nw2s::Looper : public AudioDevice, public nw2s::TimeBasedDevice
 		ReverseMode reverseMode = REVERSE_TRIGGER;
 		PinAudioOut pin;
 		std::vector<StreamingSignalData*> signalData;
-		int channel;
-		int dac;
+		std::vector<PinAnalogIn> pitchcontrols;
+		uint16_t lastSample = 0;
+
+		void refreshLoop(unsigned int index);
 
 		Looper(PinAudioOut pin, LoopPath loops[], unsigned int loopcount,  SampleRateInterrupt sri);	
-		
-		void initializeTimer(PinAudioOut pin, SampleRateInterrupt sri);	
 };
 
 class nw2s::EFLooper : public nw2s::TimeBasedDevice
 {
 	public:
-		static EFLooper* create(PinAnalogOut pin, PinAnalogIn windowsize, PinAnalogIn scale, PinAnalogIn threshold, char* subfoldername, char* filename);
+		static EFLooper* create(PinAnalogOut pin, PinAnalogIn windowsize, PinAnalogIn scale, PinAnalogIn threshold, const char* subfoldername, const char* filename, SampleRateInterrupt sri = SR_24000);
+		static EFLooper* create(PinAnalogOut pin, PinAnalogIn windowsize, PinAnalogIn scale, PinAnalogIn threshold, PinAnalogIn input);
 		static EFLooper* create(aJsonObject* data);
 		virtual void timer(unsigned long t);
+		void setControlRate(int period);
+		void setAttack(int attack);
+		void setRelease(int release);
 			
 	private:
+		/* The host test checks the running window against summing it out */
+		friend class EFLooperTest;
+
 		AnalogOut* output;
 		PinAnalogIn thresholdin;
 		PinAnalogIn scalein;
 		PinAnalogIn windowsizein;
+		PinAnalogIn input;
+		uint32_t inputPosition;
 		StreamingSignalData* signalData;
 		
 		int threshold;
 		int scale;
 		int windowsize;
 
-		EFLooper(PinAnalogOut pin, PinAnalogIn windowsize, PinAnalogIn scale, PinAnalogIn threshold, char* subfoldername, char* filename);	
+		/* 
+			A running sum of the last windowsize rectified samples. The ring always holds 
+			the last EF_WINDOW_MAX of them, so each new sample is one add and one subtract.
+		*/
+		uint16_t window[EF_WINDOW_MAX];
+		uint32_t windowHead;
+		uint32_t windowSum;
+
+		/* A file is read at its own sample rate, in thousandths of a sample per millisecond */
+		uint32_t rate;
+		uint32_t owed;
+		int period;
+
+		/* The output follows the window with one pole smoothing, attack going up and release coming down */
+		int attackTime;
+		int releaseTime;
+		int32_t attack;
+		int32_t release;
+		int32_t level;
+
+		EFLooper(PinAnalogOut pin, PinAnalogIn windowsize, PinAnalogIn scale, PinAnalogIn threshold, PinAnalogIn input, const char* subfoldername, const char* filename, SampleRateInterrupt sri);	
+
+		void resizeWindow(int windowsize);
+		void push(int16_t sample);
+		void update();
+		static int32_t smoothing(int time, int period);
+};
+
+class nw2s::SlicePlayer : public AudioDevice, public nw2s::TimeBasedDevice
+{
+	public:
+		static SlicePlayer* create(PinAudioOut pin, char* subfoldername, char* filename, Slice slices[], unsigned int slicecount, SampleRateInterrupt sri, int buffers = SLICE_BUFFER_COUNT, int buffersize = SLICE_BUFFER_SIZE, StreamChannel channel = CHANNEL_MIX);
+		static SlicePlayer* create(aJsonObject* data);
+		virtual void timer(unsigned long t);
+		virtual void render(uint16_t* block, int samples);
+
+	private:
+		std::vector<Slice> slices;
+		std::vector<int16_t*> heads;
+		std::vector<bool> bounce;
+		SliceVoice voices[SLICE_VOICES];
+		StreamScheduler scheduler;
+
+		SlicePlayer(PinAudioOut pin, char* subfoldername, char* filename, Slice slices[], unsigned int slicecount, SampleRateInterrupt sri, int buffers, int buffersize, StreamChannel channel);
+		void trigger(int slice, unsigned long t);
 };
 
 class nw2s::ClockedLooper : public nw2s::Looper, public nw2s::BeatDevice
@@ -108,45 +108,13 @@ Oscillator::Oscillator(PinAudioOut pinout)
 	this->pinout = pinout;
 }
 
-void Oscillator::timer_start()
+void Oscillator::render(uint16_t* block, int samples)
 {
-	/* The event handler needs static references to these devices */
-	if (pinout == DUE_DAC0) AudioDevice::device0 = this;
-	if (pinout == DUE_DAC1) AudioDevice::device1 = this;
-
-	/* Make sure the dac is zeroed and on */
-	analogWriteResolution(12);
-  	analogWrite(pinout, 0);
-
-	this->channel = (pinout == DUE_DAC0) ? 1 : 2;
-	this->dac = (pinout == DUE_DAC0) ? 0 : 1;
-
-	int tc_id = (pinout == DUE_DAC0) ? ID_TC4 : ID_TC5;
-	IRQn_Type tc_irq = (pinout == DUE_DAC0) ? TC4_IRQn : TC5_IRQn;
-
-  	pmc_set_writeprotect(false);
-  	pmc_enable_periph_clk(tc_id);
-
-  	TC_Configure(TC1, this->channel, TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC | TC_CMR_TCCLKS_TIMER_CLOCK2);
-  	TC_SetRC(TC1, this->channel, 1050); // sets 10Khz interrupt rate
-  	TC_Start(TC1, this->channel);
-
-  	/* enable timer interrupts */
-  	TC1->TC_CHANNEL[this->channel].TC_IER = TC_IER_CPCS;
-  	TC1->TC_CHANNEL[this->channel].TC_IDR = ~TC_IER_CPCS;  
-
-  	NVIC_EnableIRQ(tc_irq);
-}
-
-void Oscillator::timer_handler()
-{
-	/* Get the sample and dither it */
-	int sample = this->getSample() ^ random(0, 1);
-
- 	dacc_set_channel_selection(DACC_INTERFACE, this->dac);
-	dacc_write_conversion_data(DACC_INTERFACE, sample);
-
-	this->nextSample();			
+	for (int i = 0; i < samples; i++)
+	{
+		block[i] = this->getSample();
+		this->nextSample();
+	}
 }
 
 VCSamplingFrequencyOscillator::VCSamplingFrequencyOscillator(PinAudioOut pinout, PinAnalogIn pinin) : Oscillator(pinout)
@@ -158,7 +126,6 @@ VCSamplingFrequencyOscillator::VCSamplingFrequencyOscillator(PinAudioOut pinout,
 	this->interruptrate = 1050;
 	this->nextinterruptrate = 1050;
 		
-	short unsigned int w[600];	
 	unsigned int source[600];
 	
 	/* Initialize 1:1 array */
@@ -178,27 +145,29 @@ VCSamplingFrequencyOscillator::VCSamplingFrequencyOscillator(PinAudioOut pinout,
 	this->wave6 = decimate(source, 600, 100, 15);	
 	this->wave7 = decimate(source, 600, 100, 5);
 		
-	this->timer_start();
+	/* The pitch comes from the sample rate, so let the stream run as fast as it can */
+	this->startOutput(pinout, SR_48000);
+	this->setSampleRate(this->interruptrate);
 }
 
 SignalData* VCSamplingFrequencyOscillator::decimate(unsigned int* source, int size, int sourcescale, int targetsize)
 {
 	/* NOTE: targetsize must be a factor of size!!!! */
-	int factor = size / targetsize;
-	unsigned short int destination[targetsize];
-	
-	for (int i = 0; i < targetsize; i++)
-	{
-		long accumulator = 0;
-		int j = i * factor;
-		
-		for (int offset = 0; offset < factor; offset++)
-		{
-			accumulator += source[j + offset];
-		}
-		
-		destination[i] = accumulator / (factor * sourcescale);
-	}
+	// int factor = size / targetsize;
+	// unsigned short int destination[targetsize];
+	// 
+	// for (int i = 0; i < targetsize; i++)
+	// {
+	// 	long accumulator = 0;
+	// 	int j = i * factor;
+	// 	
+	// 	for (int offset = 0; offset < factor; offset++)
+	// 	{
+	// 		accumulator += source[j + offset];
+	// 	}
+	// 	
+	// 	destination[i] = accumulator / (factor * sourcescale);
+	// }
 	
 	//TODO: load from SD instead
 	return NULL;
@@ -219,7 +188,7 @@ void VCSamplingFrequencyOscillator::nextSample()
 		this->interruptrate = this->nextinterruptrate;
 		this->decimationlevel = this->nextdecimationlevel;
 		
-	  	TC_SetRC(TC1, this->channel, this->nextinterruptrate); // sets 10Khz interrupt rate	
+		this->setSampleRate(this->nextinterruptrate);
 	}
 	
 	if (this->decimationlevel == 0)
@@ -324,7 +293,7 @@ VCO::VCO(PinAudioOut pinout, PinAnalogIn pinin) : Oscillator(pinout)
 	this->sample = 0;
 	this->samplespercycle = 1000000UL / this->frequency; // 10kHz sample rate
 
-	this->timer_start();
+	this->startOutput(pinout, SR_10000);
 }
 
 void VCO::timer(unsigned long t)
@@ -390,10 +359,6 @@ int ByteBeat::nextVCOSample()
 {
 	if (this->phaseindex == 0)
 	{
-		int tp1 = analogReadmV(this->param1);
-		int tp2 = analogReadmV(this->param2);
-		int tp3 = analogReadmV(this->param3);
-
 		/* Really, these should be set by the input parameters, but they are very sensitive to specific values */
 		unsigned int p1 = 2000;
 		unsigned int p2 = 200;
@@ -423,7 +388,7 @@ int ByteBeat::nextVCOSample()
 				
 			case 2:
 				/* From: http://yehar.com/blog/?p=2554 */
-				this->currentvalue = t >> 4 | t * t * (t >> 6 & 8 ^ 8) * (t >> 11 ^ t / 3 >> 12) / (7 + (t >> 10 & t >> 14 & 3));
+				this->currentvalue = t >> 4 | t * t * (((t >> 6) & 8) ^ 8) * ((t >> 11) ^ ((t / 3) >> 12)) / (7 + ((t >> 10) & (t >> 14) & 3));
 				break;
 				
 			default:
@@ -47,11 +47,8 @@ class nw2s::Oscillator : public AudioDevice
 		
 	protected:
 		PinAudioOut pinout;
-		int channel;
-		int dac;
 		
-		void timer_start();
-		virtual void timer_handler();
+		virtual void render(uint16_t* block, int samples);
 		virtual int getSample() = 0;
 		virtual void nextSample() = 0;
 		
@@ -20,7 +20,7 @@
 
 #include "RatchetDivider.h"
 #include "IO.h"
-#include <aJSON/aJson.h>
+#include <aJSON/aJSON.h>
 #include "JSONUtil.h"
 #include "Entropy.h"
 
@@ -82,6 +82,8 @@ RatchetLimit RatchetDivider::getLimitFromString(char* value)
 	{
 		return RATCHET_LIMIT_POWEROF2;
 	}
+
+	return RATCHET_LIMIT_OFF;
 }
 
 RatchetDivider::RatchetDivider(RatchetLimit limit, PinAnalogIn divisorInput, PinAnalogIn densityInput, PinDigitalOut output)
@@ -606,8 +606,6 @@ CVNoteSequencer::CVNoteSequencer(NoteSequenceData* notes, NoteName key, Scale sc
 
 void CVNoteSequencer::timer(unsigned long t)
 {			
-	int period_t = t - this->last_note_t;
-
 	/* Only check the analog input every 50ms */
 	if (t % 50 == 0)
 	{
@@ -619,7 +617,6 @@ void CVNoteSequencer::timer(unsigned long t)
 		
 		this->sequence_index = noteindex;
 		this->last_note_t = t;
-		period_t = 0;
 
 		int currentindex = (this->randomize_seq) ? random(this->notes->size()) : this->sequence_index;
 
@@ -717,7 +714,7 @@ MorphingNoteSequencer::MorphingNoteSequencer(NoteSequenceData* notes, NoteName k
 	this->resetPin = resetPin;
 	this->notesOriginal = new NoteSequenceData(this->notes->size());
 	
-	for (int i = 0; i < this->notes->size(); i++)
+	for (unsigned int i = 0; i < this->notes->size(); i++)
 	{
 		(*this->notesOriginal)[i] = (*this->notes)[i];
 	}
@@ -736,7 +733,7 @@ void MorphingNoteSequencer::reset()
 	
 	if (digitalRead(this->resetPin))
 	{
-		for (int i = 0; i < this->notes->size(); i++)
+		for (unsigned int i = 0; i < this->notes->size(); i++)
 		{
 			(*this->notes)[i] = (*this->notesOriginal)[i];
 		}
@@ -85,42 +85,42 @@ RandomLoopingShiftRegister* RandomLoopingShiftRegister::create(aJsonObject* data
 	
 	if (trigger1 != DIGITAL_OUT_NONE)
 	{
-		reg->setTriggerOut(0, trigger1);
+		reg->setTriggerOut(1, trigger1);
 	}
 
 	if (trigger2 != DIGITAL_OUT_NONE)
 	{
-		reg->setTriggerOut(1, trigger2);
+		reg->setTriggerOut(2, trigger2);
 	}
 
 	if (trigger3 != DIGITAL_OUT_NONE)
 	{
-		reg->setTriggerOut(2, trigger3);
+		reg->setTriggerOut(3, trigger3);
 	}
 
 	if (trigger4 != DIGITAL_OUT_NONE)
 	{
-		reg->setTriggerOut(3, trigger4);
+		reg->setTriggerOut(4, trigger4);
 	}
 
 	if (trigger5 != DIGITAL_OUT_NONE)
 	{
-		reg->setTriggerOut(4, trigger5);
+		reg->setTriggerOut(5, trigger5);
 	}
 
 	if (trigger6 != DIGITAL_OUT_NONE)
 	{
-		reg->setTriggerOut(5, trigger6);
+		reg->setTriggerOut(6, trigger6);
 	}
 
 	if (trigger7 != DIGITAL_OUT_NONE)
 	{
-		reg->setTriggerOut(6, trigger7);
+		reg->setTriggerOut(7, trigger7);
 	}
 
 	if (trigger8 != DIGITAL_OUT_NONE)
 	{
-		reg->setTriggerOut(7, trigger8);
+		reg->setTriggerOut(8, trigger8);
 	}
 
 	if (logicalAndOutput1 != DIGITAL_OUT_NONE)
@@ -362,7 +362,7 @@ void RandomLoopingShiftRegister::calculate()
 	{
 		bool val = false;
 		
-		for (int i = 0; i < this->or_trigger_terms.size(); i++) val = val || this->shiftregister[this->or_trigger_terms[i]];
+		for (unsigned int i = 0; i < this->or_trigger_terms.size(); i++) val = val || this->shiftregister[this->or_trigger_terms[i]];
 		
 		this->next_or_trigger = val;
 	}
@@ -372,7 +372,7 @@ void RandomLoopingShiftRegister::calculate()
 	{
 		bool val = true;
 		
-		for (int i = 0; i < this->and_trigger_terms.size(); i++) val = val && this->shiftregister[this->and_trigger_terms[i]];
+		for (unsigned int i = 0; i < this->and_trigger_terms.size(); i++) val = val && this->shiftregister[this->and_trigger_terms[i]];
 		
 		this->next_and_trigger = val;
 	}
@@ -382,7 +382,7 @@ void RandomLoopingShiftRegister::calculate()
 	{
 		bool val = false;
 		
-		for (int i = 0; i < this->or_gate_terms.size(); i++) val = val || this->shiftregister[this->or_gate_terms[i]];
+		for (unsigned int i = 0; i < this->or_gate_terms.size(); i++) val = val || this->shiftregister[this->or_gate_terms[i]];
 
 		this->next_or_gate = val;
 	}
@@ -392,7 +392,7 @@ void RandomLoopingShiftRegister::calculate()
 	{
 		bool val = true;
 		
-		for (int i = 0; i < this->and_gate_terms.size(); i++) val = val && this->shiftregister[this->and_gate_terms[i]];
+		for (unsigned int i = 0; i < this->and_gate_terms.size(); i++) val = val && this->shiftregister[this->and_gate_terms[i]];
 
 		this->next_and_gate = val;
 	}	
@@ -478,7 +478,7 @@ int RandomLoopingShiftRegister::getCVfromShiftRegister()
 	
 	for (int i = 0; i < 12; i++)
 	{
-		if (i < this->shiftregister.size())
+		if ((unsigned int)i < this->shiftregister.size())
 		{
 			val = val << 1;
 			val |= this->shiftregister[i];
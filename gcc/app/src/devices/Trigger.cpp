@@ -21,7 +21,7 @@
 
 #include "Trigger.h"
 #include "IO.h"
-#include <aJSON/aJson.h>
+#include <aJSON/aJSON.h>
 #include "JSONUtil.h"
 
 using namespace nw2s;
@@ -61,6 +61,14 @@ void Trigger::reset()
 	digitalWrite(this->output, HIGH);
 }
 
+bool Trigger::edge()
+{
+	/* Turning on is all a trigger does, so it can happen right in the beat interrupt */
+	this->reset();
+	
+	return true;
+}
+
 void Trigger::timer(unsigned long t)
 {	
 	/* If the state is low, nothing else to do */
@@ -72,13 +80,27 @@ void Trigger::timer(unsigned long t)
 	}
 	else
 	{
-		if ((this->state == HIGH) && (t - this->t_start > TRIGGER_TIME))
+		/* The beat interrupt can turn us back on, so don't let it in between the test and the write */
+		noInterrupts();
+		
+		if ((this->state == HIGH) && (this->t_start != 0) && (t - this->t_start > TRIGGER_TIME))
 		{
 			this->state = LOW;
 			digitalWrite(this->output, LOW);
 		}	
+		
+		interrupts();
 	}	
 }
 
 
 
+
+unsigned long Trigger::nextWake(unsigned long t)
+{
+	/* Nothing to do until the clock resets us, and the clock already knows when that is */
+	if (this->state == LOW) return t + TIMER_WHEEL_MAX_DELAY;
+	
+	/* Otherwise we just need to turn off on time */
+	return (this->t_start == 0) ? t + 1 : this->t_start + TRIGGER_TIME + 1;
+}
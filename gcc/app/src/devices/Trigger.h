@@ -23,7 +23,7 @@
 
 #include "IO.h"
 #include "Clock.h"
-#include <aJSON/aJson.h>
+#include <aJSON/aJSON.h>
 
 namespace nw2s
 {		
@@ -39,7 +39,9 @@ class nw2s::Trigger : public nw2s::BeatDevice
 		static Trigger* create(aJsonObject* data);
 
 		virtual void timer(unsigned long t);
+		virtual unsigned long nextWake(unsigned long t);
 		virtual void reset();
+		virtual bool edge();
 
 	private:
 		volatile int state;
@@ -67,7 +67,6 @@ uint32_t USBMidiDevice::Init(uint32_t parent, uint32_t port, uint32_t lowspeed)
 	uint32_t	rcode = 0;
 	UsbDevice	*p = NULL;
 	EpInfo		*oldep_ptr = NULL;
-	uint32_t 	adkproto = -1;
 	uint32_t	num_of_conf = 0;
 
 	/* Get memory address of USB device address pool */
@@ -310,7 +309,7 @@ void USBMidiDevice::parseConfigDescr(uint32_t addr, uint32_t conf)
 				{
 					/* bulk */
 					uint32_t index;
-					uint32_t pipe;
+					uint32_t pipe = 0;
 
 					if (isMidi)
 					{
@@ -555,7 +554,7 @@ void USBMidiCCController::addControlPin(uint32_t controller, PinAnalogOut output
 	outputs.push_back(outconfig);
 }
 
-void USBMidiCCController::timer(uint32_t t)
+void USBMidiCCController::timer(unsigned long t)
 {
 	
 }
@@ -587,7 +586,6 @@ USBMonophonicMidiController* USBMonophonicMidiController::create(aJsonObject* da
 	const char pressureNodeName[] = "pressure";
 	const char aftertouchNodeName[] = "aftertouch";
 	const char triggerOnNodeName[] = "triggerOn";
-	const char triggerOffNodeName[] = "triggerOff";
 	
 	PinDigitalOut gate = getDigitalOutputFromJSON(data, gateNodeName);
 	PinDigitalOut triggerOn = getDigitalOutputFromJSON(data, triggerOnNodeName);
@@ -621,7 +619,7 @@ USBMonophonicMidiController::USBMonophonicMidiController(PinDigitalOut gatePin,
 	this->triggerOff = (triggerOff != DIGITAL_OUT_NONE) ? Gate::create(triggerOff, 30) : NULL;
 }
 
-void USBMonophonicMidiController::timer(uint32_t t)
+void USBMonophonicMidiController::timer(unsigned long t)
 {
 	if (this->triggerOn != NULL) this->triggerOn->timer(t);	
 	if (this->triggerOff != NULL) this->triggerOff->timer(t);
@@ -717,13 +715,11 @@ USBSplitMonoMidiController* USBSplitMonoMidiController::create(aJsonObject* data
 	const char velocityNodeName1[] = "velocity1";
 	const char pressureNodeName1[] = "pressure1";
 	const char triggerOnNodeName1[] = "triggerOn1";
-	const char triggerOffNodeName1[] = "triggerOff1";
 	const char gateNodeName2[] = "gate2";
 	const char pitchNodeName2[] = "pitch2";
 	const char velocityNodeName2[] = "velocity2";
 	const char pressureNodeName2[] = "pressure2";
 	const char triggerOnNodeName2[] = "triggerOn2";
-	const char triggerOffNodeName2[] = "triggerOff2";
 	const char aftertouchNodeName[] = "aftertouch";
 	const char noteNodeName[] = "splitNote";
 	
@@ -769,7 +765,7 @@ USBSplitMonoMidiController::USBSplitMonoMidiController(PinDigitalOut gatePin1, P
 	this->splitNote = splitNote;
 }
 
-void USBSplitMonoMidiController::timer(uint32_t t)
+void USBSplitMonoMidiController::timer(unsigned long t)
 {
 	if (this->triggerOn1 != NULL) this->triggerOn1->timer(t);	
 	if (this->triggerOff1 != NULL) this->triggerOff1->timer(t);
@@ -935,6 +931,8 @@ USBPolyphonicMidiController* USBPolyphonicMidiController::create(PinAnalogOut af
 
 USBPolyphonicMidiController* USBPolyphonicMidiController::create(aJsonObject* data)
 {
+	/* Not configurable from a program file yet */
+	return NULL;
 }
 
 USBPolyphonicMidiController::USBPolyphonicMidiController(PinAnalogOut afterTouchPin) : USBMidiCCController()
@@ -1059,7 +1057,8 @@ USBMidiApeggiator* USBMidiApeggiator::create(PinDigitalOut gatePin, PinDigitalOu
 
 USBMidiApeggiator* USBMidiApeggiator::create(aJsonObject* data)
 {
-
+	/* Not configurable from a program file yet */
+	return NULL;
 }
 
 
@@ -1107,7 +1106,7 @@ void USBMidiApeggiator::onNoteOff(uint32_t channel, uint32_t note, uint32_t velo
 	}
 }
 
-void USBMidiApeggiator::timer(uint32_t t)
+void USBMidiApeggiator::timer(unsigned long t)
 {
 	if (this->trigger != NULL) this->trigger->timer(t);
 	
@@ -32,7 +32,7 @@
 #include "Usb.h"
 #include "EventManager.h"
 #include "confdescparser.h"
-#include "aJSON/aJson.h"
+#include "aJSON/aJSON.h"
 #include "IO.h"
 #include "Gate.h"
 #include "Clock.h"
@@ -68,21 +68,21 @@ namespace nw2s
 		CC_RANGE_BIPOLAR
 	};
 	
-	typedef struct ControlOutput
+	struct ControlOutput
 	{
 		uint32_t controller;
 		AnalogOut* output;
 		CCRange range;
 	};
 	
-	typedef struct TriggerOutput
+	struct TriggerOutput
 	{
 		uint32_t note;
 		AnalogOut* velocity;
 		PinDigitalOut output;
 	};
 		
-	typedef struct Voice
+	struct Voice
 	{
 		bool allocated = false;
 		PinDigitalOut gate = DIGITAL_OUT_NONE;
@@ -209,7 +209,7 @@ class nw2s::USBMidiCCController : public nw2s::USBMidiController, public nw2s::T
 		static USBMidiCCController* create();
 		static USBMidiCCController* create(aJsonObject* data);
 		void addControlPin(uint32_t controller, PinAnalogOut output, CCRange range);
-		virtual void timer(uint32_t t);
+		virtual void timer(unsigned long t);
 
 	protected:
 		
@@ -230,7 +230,7 @@ class nw2s::USBMonophonicMidiController : public nw2s::USBMidiCCController
 		static USBMonophonicMidiController* create(PinDigitalOut gatePin, PinDigitalOut triggerOn, PinDigitalOut triggerOff, PinAnalogOut pitchPin, PinAnalogOut velocityPin, PinAnalogOut pressurePin, PinAnalogOut afterTouchOut);
 		static USBMonophonicMidiController* create(aJsonObject* data);
 
-		void timer(uint32_t t);
+		void timer(unsigned long t);
 			
 		//TODO: limit to key
 		
@@ -268,7 +268,7 @@ class nw2s::USBSplitMonoMidiController : public nw2s::USBMidiCCController
 		static USBSplitMonoMidiController* create(PinDigitalOut gatePin1, PinDigitalOut triggerOn1, PinDigitalOut triggerOff1, PinAnalogOut pitchPin1, PinAnalogOut velocityPin1, PinAnalogOut pressurePin1, PinDigitalOut gatePin2, PinDigitalOut triggerOn2, PinDigitalOut triggerOff2, PinAnalogOut pitchPin2, PinAnalogOut velocityPin2, PinAnalogOut pressurePin2, PinAnalogOut afterTouchOut, uint32_t splitNote);
 		static USBSplitMonoMidiController* create(aJsonObject* data);
 
-		void timer(uint32_t t);
+		void timer(unsigned long t);
 			
 	protected:
 		
@@ -313,7 +313,7 @@ class nw2s::USBPolyphonicMidiController : public nw2s::USBMidiCCController
 		static USBPolyphonicMidiController* create(PinAnalogOut afterTouchOut);
 		static USBPolyphonicMidiController* create(aJsonObject* data);
 
-		void timer(uint32_t);		
+		void timer(unsigned long);		
 		void addVoice(PinDigitalOut gatePin, PinDigitalOut triggerOn, PinDigitalOut triggerOff, PinAnalogOut pitchPin, PinAnalogOut velocityPin, PinAnalogOut pressureOut);
 		
 	protected:
@@ -369,7 +369,7 @@ class nw2s::USBMidiApeggiator : public nw2s::USBMidiCCController, public nw2s::B
 		
 		void setClockInput();
 
-		virtual void timer(uint32_t t);
+		virtual void timer(unsigned long t);
 		virtual void reset();
 
 		virtual void onNoteOn(uint32_t channel, uint32_t note, uint32_t velocity);
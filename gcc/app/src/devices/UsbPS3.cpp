@@ -484,7 +484,7 @@ UsbPS3CV::UsbPS3CV(bool bipolar)
 	this->aAccY = AnalogOut::create(DUE_SPI_4822_07);
 }
 
-void UsbPS3CV::timer(uint32_t t)
+void UsbPS3CV::timer(unsigned long t)
 {
 	iterationcount = (iterationcount + 1) % 25;
 	
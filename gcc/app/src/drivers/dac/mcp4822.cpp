@@ -66,6 +66,17 @@ int MCP4822::getCmdWrd(int dac, int value) {
 // Set the output value of the given dac channel
 // ----------------------------------------------------------------------------
 void MCP4822::setValue(int dac, int value) {
+    write(dac, value);
+    latch();
+}
+
+// ----------------------------------------------------------------------------
+// MCP4822::write
+//
+// Load the input register of the given dac channel without latching it, so
+// several channels (or chips sharing LDAC) can change together on latch()
+// ----------------------------------------------------------------------------
+void MCP4822::write(int dac, int value) {
     int cmdWrd;
     uint8_t byte0;
     uint8_t byte1;
@@ -80,15 +91,16 @@ void MCP4822::setValue(int dac, int value) {
     SPI.transfer(byte1);
     // Disable SPI communications
     digitalWrite(cs,HIGH);
-    // Latch value
+}
+
+// ----------------------------------------------------------------------------
+// MCP4822::latch
+//
+// Pulse LDAC to move the input registers to the outputs
+// ----------------------------------------------------------------------------
+void MCP4822::latch() {
     digitalWrite(ldac,LOW);
     digitalWrite(ldac,HIGH);
-
-	// Serial.println("-------");
-	// Serial.println("cs  " + String(cs));
-	// Serial.println("dac " + String(dac));
-	// Serial.println("val " + String(value));
-
 }
 
 // ---------------------------------------------------------------------------
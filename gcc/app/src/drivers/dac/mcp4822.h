@@ -31,6 +31,8 @@ public:
     void setValue_A(int value);
     void setValue_B(int value);
     void setValue_AB(int value_A, int value_B);
+    void write(int dac, int value);
+    void latch();
     void setGain2X(int dac);
     void setGain2X_A();
     void setGain2X_B();
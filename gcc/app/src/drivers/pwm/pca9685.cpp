@@ -16,7 +16,17 @@
 */
 #include "pwm/pca9685.h"
 
-PCA9685::PCA9685() {}
+PCA9685::PCA9685() 
+{
+	for (int i = 0; i < PCA9685_LED_COUNT; i++)
+	{
+		ledOn[i] = 0;
+		ledOff[i] = 0;
+	}
+
+	dirty = 0;
+	nextRefresh = 0;
+}
 
 void PCA9685::begin(int i2cAddress, int dim) 
 {
@@ -53,12 +63,95 @@ void PCA9685::setLEDOff(int ledNumber) {
 
 void PCA9685::setLEDDimmed(int ledNumber, int amount) 
 {		
-	writeLED(ledNumber, 0, 0 + ((amount * 10) / this->dim));
+	stageLED(ledNumber, 0, 0 + ((amount * 10) / this->dim));
+}
+
+void PCA9685::stageLED(int ledNumber, word LED_ON, word LED_OFF) 
+{
+	if (ledNumber < 0 || ledNumber >= PCA9685_LED_COUNT) return;
+
+	// The beat interrupt stages LEDs too, so the shadow registers and dirty mask only change with interrupts off
+	noInterrupts();
+
+	if (ledOn[ledNumber] != LED_ON || ledOff[ledNumber] != LED_OFF)
+	{
+		ledOn[ledNumber] = LED_ON;
+		ledOff[ledNumber] = LED_OFF;
+		dirty |= 1 << ledNumber;
+	}
+
+	interrupts();
+}
+
+void PCA9685::update(unsigned long t) 
+{
+	// The first change after a quiet spell goes straight out, the ones after it wait their turn
+	if ((long)(t - nextRefresh) < 0) return;
+
+	if (dirty)
+	{
+		flush();
+		nextRefresh = t + PCA9685_REFRESH_MS;
+	}
+	else
+	{
+		// Keep up while quiet so the difference never gets far enough to change sign
+		nextRefresh = t;
+	}
+}
+
+void PCA9685::flush() 
+{
+	word on[PCA9685_LED_COUNT];
+	word off[PCA9685_LED_COUNT];
+
+	// Take the changed LEDs in one go, anything staged while we're on the bus waits for the next update()
+	noInterrupts();
+
+	uint16_t pending = dirty;
+	dirty = 0;
+
+	for (int i = 0; i < PCA9685_LED_COUNT; i++)
+	{
+		on[i] = ledOn[i];
+		off[i] = ledOff[i];
+	}
+
+	interrupts();
+
+	int led = 0;
+
+	// Each run of changed LEDs goes out as one auto-increment burst
+	while (pending)
+	{
+		while (!(pending & (1 << led))) led++;
+
+		Wire1.beginTransmission(_i2cAddress);
+		Wire1.write(PCA9685_LED0 + 4*led);
+
+		for (int count = 0; (count < PCA9685_LEDS_PER_WRITE) && (led < PCA9685_LED_COUNT) && (pending & (1 << led)); count++, led++)
+		{
+			Wire1.write(lowByte(on[led]));
+			Wire1.write(highByte(on[led]));
+			Wire1.write(lowByte(off[led]));
+			Wire1.write(highByte(off[led]));
+
+			pending &= ~(1 << led);
+		}
+
+		Wire1.endTransmission();
+	}
 }
 
 void PCA9685::writeLED(int ledNumber, word LED_ON, word LED_OFF) {	// LED_ON and LED_OFF are 12bit values (0-4095); ledNumber is 0-15
 	if (ledNumber >=0 && ledNumber <= 15)	{
 		
+		noInterrupts();
+		ledOn[ledNumber] = LED_ON;
+		ledOff[ledNumber] = LED_OFF;
+		dirty &= ~(1 << ledNumber);
+		interrupts();
+
 		Wire1.beginTransmission(_i2cAddress);
 		Wire1.write(PCA9685_LED0 + 4*ledNumber);
 
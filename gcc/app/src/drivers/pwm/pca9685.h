@@ -37,6 +37,14 @@
 
 #define PCA9685_I2C_BASE_ADDRESS B1000000
 
+#define PCA9685_LED_COUNT 16
+
+// Staged LED changes go out at most this often
+#define PCA9685_REFRESH_MS 20
+
+// Wire buffers 32 bytes, so one auto-increment burst is the register and up to 7 LEDs
+#define PCA9685_LEDS_PER_WRITE 7
+
 class PCA9685
 {
   public:
@@ -51,8 +59,18 @@ class PCA9685
 	void setLEDOff(int ledNumber);
 	void setLEDDimmed(int ledNumber, int amount);
 	void writeLED(int ledNumber, word outputStart, word outputEnd);
+
+	// Staged writes only touch the shadow registers, update() sends the changed ones
+	void stageLED(int ledNumber, word outputStart, word outputEnd);
+	void update(unsigned long t);
+	void flush();
 	
   private:
+	word ledOn[PCA9685_LED_COUNT];
+	word ledOff[PCA9685_LED_COUNT];
+	volatile uint16_t dirty;
+	unsigned long nextRefresh;
+
 	void writeRegister(int regaddress, byte val);
 	word readRegister(int regAddress);
 	// Our actual i2c address:
@@ -106,11 +106,14 @@ uint8_t Sd2Card::cardCommand(uint8_t cmd, uint32_t arg) {
   // end read if in partialBlockRead mode
   readEnd();
 
+  // end read if in multiple block read mode
+  if (inMultiBlock_ && cmd != CMD12) readStop();
+
   // select card
   chipSelectLow();
 
-  // wait up to 300 ms if busy
-  waitNotBusy(300);
+  // wait up to 300 ms if busy - a card streaming blocks is never busy
+  if (cmd != CMD12) waitNotBusy(300);
 
   // send command
   spiSend(cmd | 0x40);
@@ -124,6 +127,9 @@ uint8_t Sd2Card::cardCommand(uint8_t cmd, uint32_t arg) {
   if (cmd == CMD8) crc = 0X87;  // correct crc for CMD8 with arg 0X1AA
   spiSend(crc);
 
+  // skip stuff byte for stop read
+  if (cmd == CMD12) spiRec();
+
   // wait for response
   for (uint8_t i = 0; ((status_ = spiRec()) & 0X80) && i != 0XFF; i++)
     ;
@@ -225,7 +231,7 @@ uint8_t Sd2Card::eraseSingleBlockEnable(void) {
  * can be determined by calling errorCode() and errorData().
  */
 uint8_t Sd2Card::init(uint8_t sckRateID, uint8_t chipSelectPin) {
-  errorCode_ = inBlock_ = partialBlockRead_ = type_ = 0;
+  errorCode_ = inBlock_ = inMultiBlock_ = partialBlockRead_ = type_ = 0;
   chipSelectPin_ = chipSelectPin;
   // 16-bit init start time allows over a minute
   uint16_t t0 = (uint16_t)millis();
@@ -347,6 +353,53 @@ uint8_t Sd2Card::readBlock(uint32_t block, uint8_t* dst) {
   return readData(block, 0, 512, dst);
 }
 //------------------------------------------------------------------------------
+/**
+ * Read consecutive 512 byte blocks from an SD card.
+ *
+ * The card is left streaming with READ_MULTIPLE_BLOCK after the last block,
+ * so a following call that starts where this one ended costs no command
+ * overhead. Any other command, or readStop(), ends the stream. The chip
+ * select is released between blocks so other SPI devices can share the bus.
+ *
+ * \param[in] block Logical block of the first block to be read.
+ * \param[out] dst Pointer to the location that will receive the data.
+ * \param[in] count Number of blocks to read.
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readBlocks(uint32_t block, uint8_t* dst, uint16_t count) {
+  if (!inMultiBlock_ || block != multiBlock_) {
+    uint32_t address = block;
+    // use address if not SDHC card
+    if (type() != SD_CARD_TYPE_SDHC) address <<= 9;
+    if (cardCommand(CMD18, address)) {
+      error(SD_CARD_ERROR_CMD18);
+      goto fail;
+    }
+    chipSelectHigh();
+    inMultiBlock_ = 1;
+    multiBlock_ = block;
+  }
+  for (uint16_t n = 0; n < count; n++) {
+    chipSelectLow();
+    if (!waitStartBlock()) {
+      readStop();
+      return false;
+    }
+    for (uint16_t i = 0; i < 512; i++) dst[i] = spiRec();
+    spiRec();  // get first crc byte
+    spiRec();  // get second crc byte
+    chipSelectHigh();
+    multiBlock_++;
+    dst += 512;
+  }
+  return true;
+
+ fail:
+  chipSelectHigh();
+  return false;
+}
+//------------------------------------------------------------------------------
 /**
  * Read part of a 512 byte block from an SD card.
  *
@@ -449,6 +502,28 @@ void Sd2Card::readEnd(void) {
   }
 }
 //------------------------------------------------------------------------------
+/** End a read multiple blocks sequence.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readStop(void) {
+  if (!inMultiBlock_) return true;
+  inMultiBlock_ = 0;
+  if (cardCommand(CMD12, 0)) {
+    error(SD_CARD_ERROR_CMD12);
+    goto fail;
+  }
+  // the card may hold the line busy briefly after stopping
+  waitNotBusy(300);
+  chipSelectHigh();
+  return true;
+
+ fail:
+  chipSelectHigh();
+  return false;
+}
+//------------------------------------------------------------------------------
 /** read CID or CSR register */
 uint8_t Sd2Card::readRegister(uint8_t cmd, void* buf) {
   uint8_t* dst = reinterpret_cast<uint8_t*>(buf);
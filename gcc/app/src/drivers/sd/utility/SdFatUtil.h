@@ -37,6 +37,10 @@
 //------------------------------------------------------------------------------
 /** Return the number of bytes currently free in RAM. */
 static UNUSEDOK int FreeRam(void) {
+#ifdef NW2S_HOST
+  // there is no heap boundary to measure on the host
+  return 0;
+#else
   extern int  __bss_end;
   extern int* __brkval;
   int free_memory;
@@ -50,6 +54,7 @@ static UNUSEDOK int FreeRam(void) {
                   - reinterpret_cast<int>(__brkval);
   }
   return free_memory;
+#endif
 }
 #ifdef __AVR__
 //------------------------------------------------------------------------------
@@ -21,6 +21,10 @@ e-mail   :  support@circuitsathome.com
 #include "Usb.h"
 #include <stdio.h>
 
+#ifdef NW2S_HOST
+#include "HostHAL.h"
+#endif
+
 static uint32_t usb_error = 0;
 static uint32_t usb_task_state = USB_DETACHED_SUBSTATE_INITIALIZE;
 
@@ -302,6 +306,16 @@ uint32_t USBHost::ctrlReq(uint32_t addr, uint32_t ep, uint8_t bmReqType, uint8_t
 	EpInfo *pep = NULL;
 	uint32_t nak_limit = 0;
 
+#ifdef NW2S_HOST
+	// Simulated devices don't enumerate, they take transfers at whatever address the driver was given
+	uint32_t hostcode = 0;
+
+	if (nw2s::HostHAL::get()->usbIn(addr, ep, data, nbytesptr, &hostcode))
+	{
+		return hostcode;
+	}
+#endif
+
 	uint32_t rcode = setPipeAddress(addr, ep, &pep, nak_limit);
 
 	if (rcode)
@@ -376,6 +390,16 @@ uint32_t USBHost::outTransfer(uint32_t addr, uint32_t ep, uint32_t nbytes, uint8
 	EpInfo *pep = NULL;
 	uint32_t nak_limit = 0;
 
+#ifdef NW2S_HOST
+	// Simulated devices don't enumerate, they take transfers at whatever address the driver was given
+	uint32_t hostcode = 0;
+
+	if (nw2s::HostHAL::get()->usbOut(addr, ep, data, nbytes, &hostcode))
+	{
+		return hostcode;
+	}
+#endif
+
 	uint32_t rcode = setPipeAddress(addr, ep, &pep, nak_limit);
 
 	if (rcode)
@@ -0,0 +1,188 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <b.h>
+#include <EventManager.h>
+#include <IO.h>
+#include <AnalogScanner.h>
+
+using namespace nw2s;
+
+/*
+
+	This sketch measures each analog input against a reference and stores the result in
+	/config/inputs.b on the SD card, where b::configure() picks it up on every boot.
+
+	Tune the outputs first (testAnalogOutputs), since output 1 is used as the reference. Then
+	turn every input pot completely clockwise and patch output 1 through multiples into as many
+	of the inputs as you can.
+
+	Open the console and press the D0 button. Output 1 goes to the high reference and
+	the inputs are measured. Press D0 again to measure the low reference. The scale and
+	offset of every input that followed both references are written to the card.
+	Inputs that didn't move (nothing patched) keep whatever calibration they had, so you
+	can repatch and run it again to get the rest.
+
+*/
+
+#define REFERENCE_HIGH 4000
+#define REFERENCE_LOW -4000
+#define CALIBRATION_SAMPLES 64
+#define CALIBRATION_MIN_SPAN 1000
+
+enum CalibrationStep
+{
+	CALIBRATE_HIGH,
+	CALIBRATE_LOW,
+	CALIBRATE_DONE,
+};
+
+AnalogOut* reference;
+CalibrationStep step = CALIBRATE_HIGH;
+int32_t measured[2][12];
+
+bool checkToggle = false;
+long nextToggleTime = 0;
+
+/* The raw ADC value an ideal input would read at this voltage */
+int idealRaw(int mv)
+{
+	int best = 0;
+
+	for (int i = 1; i < 4096; i++)
+	{
+		if (abs(ANALOG_INPUT_TRANSLATION[i] - mv) < abs(ANALOG_INPUT_TRANSLATION[best] - mv)) best = i;
+	}
+
+	return best;
+}
+
+void measure(int32_t* values)
+{
+	/* Let the reference and the input filters settle before averaging a few snapshots */
+	delay(250);
+
+	for (int i = 0; i < 12; i++) values[i] = 0;
+
+	for (int j = 0; j < CALIBRATION_SAMPLES; j++)
+	{
+		for (int i = 0; i < 12; i++) values[i] += AnalogScanner::read(INDEX_ANALOG_IN[i + 1]);
+
+		delay(2);
+	}
+
+	for (int i = 0; i < 12; i++) values[i] = (values[i] + (CALIBRATION_SAMPLES / 2)) / CALIBRATION_SAMPLES;
+}
+
+void calibrate()
+{
+	/* Both ends are worked out on the inverted value, the same way analogRead() applies them */
+	int32_t idealHigh = 4095 - idealRaw(REFERENCE_HIGH);
+	int32_t idealLow = 4095 - idealRaw(REFERENCE_LOW);
+	int calibrated = 0;
+
+	for (int i = 0; i < 12; i++)
+	{
+		int32_t high = 4095 - measured[CALIBRATE_HIGH][i];
+		int32_t low = 4095 - measured[CALIBRATE_LOW][i];
+
+		if (abs(high - low) < CALIBRATION_MIN_SPAN)
+		{
+			Serial.println("Input " + String(i + 1) + ": not patched, keeping " + String(b::inputScale[i]) + "/" + String(b::inputOffset[i]));
+			continue;
+		}
+
+		int32_t scale = ((idealHigh - idealLow) * 1000 + ((high - low) / 2)) / (high - low);
+		int32_t offset = idealLow - ((low * scale) / 1000);
+
+		b::inputScale[i] = scale;
+		b::inputOffset[i] = offset;
+		calibrated++;
+
+		Serial.println("Input " + String(i + 1) + ": " + String(high) + "/" + String(low) + " scale " + String(scale) + " offset " + String(offset));
+	}
+
+	if (calibrated == 0)
+	{
+		Serial.println("Nothing was patched to output 1, calibration not saved.");
+		return;
+	}
+
+	b::inputSoftTune = true;
+	b::saveInputCalibration();
+	IOUtils::compileInputTune();
+}
+
+void setup()
+{
+	Serial.begin(19200);
+	Serial.println("Starting...");
+
+	EventManager::initialize();
+
+	reference = AnalogOut::create(DUE_SPI_4822_00);
+	reference->outputCV(REFERENCE_HIGH);
+
+	Serial.println("Patch output 1 to the inputs, turn their pots clockwise and press D0.");
+}
+
+void loop()
+{
+	long t = millis();
+
+	if (t > nextToggleTime)
+	{
+		if (!checkToggle && digitalRead(DUE_IN_D0))
+		{
+			/* Stop the bounce */
+			nextToggleTime = t + 100;
+			checkToggle = true;
+
+			if (step == CALIBRATE_HIGH)
+			{
+				measure(measured[CALIBRATE_HIGH]);
+				reference->outputCV(REFERENCE_LOW);
+				step = CALIBRATE_LOW;
+
+				Serial.println("High reference measured, press D0 again for the low reference.");
+			}
+			else if (step == CALIBRATE_LOW)
+			{
+				measure(measured[CALIBRATE_LOW]);
+				calibrate();
+				step = CALIBRATE_DONE;
+
+				/* Show the calibrated inputs so they can be checked against the reference */
+				for (int i = 0; i < 12; i++) Serial.print(String(analogReadmV(INDEX_ANALOG_IN[i + 1])) + "\t");
+				Serial.println("");
+			}
+		}
+
+		/* Reset the toggle trigger if it's off */
+		if (checkToggle && !digitalRead(DUE_IN_D0))
+		{
+			/* Stop the bounce */
+			nextToggleTime = t + 100;
+			checkToggle = false;
+		}
+	}
+
+	EventManager::loop();
+}
@@ -20,6 +20,7 @@
 
 #include <EventManager.h>
 #include <IO.h>
+#include <AnalogScanner.h>
 
 using namespace nw2s;
 
@@ -120,7 +121,8 @@ void loop()
 		for (int i = 0; i < 12; i++)
 		{
 			int sum = 0;
-			int val = ::analogRead(inputs[i]);
+			/* The ADC is scanning by now, so read its snapshot rather than stop it for a conversion */
+			int val = AnalogScanner::read(inputs[i]);
 			
 			average[i][ptr] = val;
 			
@@ -53,7 +53,6 @@ void loop()
 {	
 	unsigned long zeros = 0;
 	unsigned long ones = 0;
-	unsigned long t = micros();
 	
 	/* Limit the frequency of these tests to make it readable */
 	if (millis() % 100 == 0)
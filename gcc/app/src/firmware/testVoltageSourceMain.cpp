@@ -21,6 +21,7 @@
 #include <b.h>
 #include <EventManager.h>
 #include <Clock.h>
+#include <AnalogScanner.h>
 
 using namespace nw2s;
 
@@ -75,9 +76,8 @@ void loop()
 	if (t % 100 == 0)
 	{
 		/* Read two analog inputs. We'll use these for coarse and fine */
-		int cv1 = ::analogRead(DUE_IN_A00);
-		delay(5);
-		int cv2 = ::analogRead(DUE_IN_A01);
+		int cv1 = AnalogScanner::read(DUE_IN_A00);
+		int cv2 = AnalogScanner::read(DUE_IN_A01);
 	
 		int cv0 = ((cv1 << 1) & 0xFC0) | (cv2 >> 4);
 	
@@ -0,0 +1,420 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+
+	Host stand-in for the Arduino SAM core. It exposes the subset of Arduino.h, the
+	variant and libsam that the framework uses and routes everything to HostHAL.
+	It shares the include guard with the real Arduino.h so that core sources such as
+	Print.cpp and WString.cpp can be compiled unchanged with -include.
+
+*/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#ifndef NW2S_HOST
+#define NW2S_HOST 1
+#endif
+
+/* Same family define the SAM headers provide */
+#define _SAM3XA_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __cplusplus
+
+/* The Arduino min/max/abs/round macros break the standard library, so pull it in first */
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+#include <list>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#endif
+
+#include <avr/pgmspace.h>
+
+/* pgmspace.h assumes a 32 bit long */
+#undef pgm_read_dword
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+#include "binary.h"
+#include "itoa.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+enum BitOrder {
+	LSBFIRST = 0,
+	MSBFIRST = 1
+};
+
+#define CHANGE 2
+#define FALLING 3
+#define RISING 4
+
+#ifdef abs
+#undef abs
+#endif
+
+#ifndef min
+#define min(a,b) ((a)<(b)?(a):(b))
+#endif
+
+#ifndef max
+#define max(a,b) ((a)>(b)?(a):(b))
+#endif
+
+#define abs(x) ((x)>0?(x):-(x))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define radians(deg) ((deg)*DEG_TO_RAD)
+#define degrees(rad) ((rad)*RAD_TO_DEG)
+#define sq(x) ((x)*(x))
+
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) (bitvalue ? bitSet(value, bit) : bitClear(value, bit))
+#define bit(b) (1UL << (b))
+
+typedef unsigned int word;
+typedef unsigned int uint;
+typedef uint8_t boolean;
+typedef uint8_t byte;
+
+/* Arduino Due variant */
+#define PINS_COUNT (79u)
+#define VARIANT_MCK 84000000
+
+static const uint8_t A0  = 54;
+static const uint8_t A1  = 55;
+static const uint8_t A2  = 56;
+static const uint8_t A3  = 57;
+static const uint8_t A4  = 58;
+static const uint8_t A5  = 59;
+static const uint8_t A6  = 60;
+static const uint8_t A7  = 61;
+static const uint8_t A8  = 62;
+static const uint8_t A9  = 63;
+static const uint8_t A10 = 64;
+static const uint8_t A11 = 65;
+static const uint8_t DAC0 = 66;
+static const uint8_t DAC1 = 67;
+
+static const uint8_t SS   = 10;
+static const uint8_t MOSI = 75;
+static const uint8_t MISO = 74;
+static const uint8_t SCK  = 76;
+
+extern uint32_t SystemCoreClock;
+
+/* wiring */
+/* unsigned long rather than uint32_t so that timestamps never wrap on a 64 bit host */
+extern unsigned long millis(void);
+extern unsigned long micros(void);
+extern void delay(uint32_t dwMs);
+extern void delayMicroseconds(uint32_t dwUs);
+extern void yield(void);
+
+extern void pinMode(uint32_t dwPin, uint32_t dwMode);
+extern void digitalWrite(uint32_t dwPin, uint32_t dwVal);
+extern int digitalRead(uint32_t ulPin);
+
+extern uint32_t analogRead(uint32_t ulPin);
+extern void analogReadResolution(int res);
+extern void analogWrite(uint32_t ulPin, uint32_t ulValue);
+extern void analogWriteResolution(int res);
+
+extern void attachInterrupt(uint32_t pin, void (*callback)(void), uint32_t mode);
+extern void detachInterrupt(uint32_t pin);
+
+extern void __enable_irq(void);
+extern void __disable_irq(void);
+
+#define interrupts() __enable_irq()
+#define noInterrupts() __disable_irq()
+
+/* sketch */
+extern void setup(void);
+extern void loop(void);
+
+/* libsam peripheral IDs and interrupts, only the ones the framework touches */
+#define ID_TC0 27
+#define ID_TC1 28
+#define ID_TC2 29
+#define ID_TC3 30
+#define ID_TC4 31
+#define ID_TC5 32
+#define ID_TC6 33
+#define ID_TC7 34
+#define ID_TC8 35
+#define ID_ADC 37
+#define ID_DACC 38
+
+typedef enum IRQn
+{
+	TC0_IRQn = 27,
+	TC1_IRQn = 28,
+	TC2_IRQn = 29,
+	TC3_IRQn = 30,
+	TC4_IRQn = 31,
+	TC5_IRQn = 32,
+	TC6_IRQn = 33,
+	TC7_IRQn = 34,
+	TC8_IRQn = 35,
+	ADC_IRQn = 37,
+	DACC_IRQn = 38
+}
+IRQn_Type;
+
+extern void NVIC_EnableIRQ(IRQn_Type IRQn);
+extern void NVIC_DisableIRQ(IRQn_Type IRQn);
+extern void NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+extern void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+
+extern uint32_t pmc_enable_periph_clk(uint32_t ul_id);
+extern uint32_t pmc_disable_periph_clk(uint32_t ul_id);
+extern void pmc_set_writeprotect(uint32_t ul_enable);
+
+/* Timer/counter - registers are plain memory, the HAL is told about them in TC_Start and NVIC_EnableIRQ */
+typedef struct
+{
+	volatile uint32_t TC_CCR;
+	volatile uint32_t TC_CMR;
+	volatile uint32_t TC_SMMR;
+	volatile uint32_t Reserved1[1];
+	volatile uint32_t TC_CV;
+	volatile uint32_t TC_RA;
+	volatile uint32_t TC_RB;
+	volatile uint32_t TC_RC;
+	volatile uint32_t TC_SR;
+	volatile uint32_t TC_IER;
+	volatile uint32_t TC_IDR;
+	volatile uint32_t TC_IMR;
+	volatile uint32_t Reserved2[4];
+}
+TcChannel;
+
+typedef struct
+{
+	TcChannel TC_CHANNEL[3];
+	volatile uint32_t TC_BCR;
+	volatile uint32_t TC_BMR;
+}
+Tc;
+
+extern Tc HOST_TC[3];
+
+#define TC0 (&HOST_TC[0])
+#define TC1 (&HOST_TC[1])
+#define TC2 (&HOST_TC[2])
+
+#define TC_CMR_TCCLKS_TIMER_CLOCK1 (0x0u << 0)
+#define TC_CMR_TCCLKS_TIMER_CLOCK2 (0x1u << 0)
+#define TC_CMR_TCCLKS_TIMER_CLOCK3 (0x2u << 0)
+#define TC_CMR_TCCLKS_TIMER_CLOCK4 (0x3u << 0)
+#define TC_CMR_TCCLKS_TIMER_CLOCK5 (0x4u << 0)
+#define TC_CMR_TCCLKS_Msk (0x7u << 0)
+#define TC_CMR_WAVE (0x1u << 15)
+#define TC_CMR_WAVSEL_UP (0x0u << 13)
+#define TC_CMR_WAVSEL_UP_RC (0x2u << 13)
+#define TC_CMR_ACPA_CLEAR (0x2u << 16)
+#define TC_CMR_ACPC_SET (0x1u << 18)
+#define TC_IER_CPCS (0x1u << 4)
+#define TC_IDR_CPCS (0x1u << 4)
+#define TC_SR_CPCS (0x1u << 4)
+
+extern void TC_Configure(Tc *pTc, uint32_t dwChannel, uint32_t dwMode);
+extern void TC_Start(Tc *pTc, uint32_t dwChannel);
+extern void TC_Stop(Tc *pTc, uint32_t dwChannel);
+extern void TC_SetRA(Tc *pTc, uint32_t dwChannel, uint32_t dwValue);
+extern void TC_SetRB(Tc *pTc, uint32_t dwChannel, uint32_t dwValue);
+extern void TC_SetRC(Tc *pTc, uint32_t dwChannel, uint32_t dwValue);
+extern uint32_t TC_GetStatus(Tc *pTc, uint32_t dwChannel);
+
+void TC0_Handler(void);
+void TC1_Handler(void);
+void TC2_Handler(void);
+void TC3_Handler(void);
+void TC4_Handler(void);
+void TC5_Handler(void);
+void TC6_Handler(void);
+void TC7_Handler(void);
+void TC8_Handler(void);
+void ADC_Handler(void);
+void DACC_Handler(void);
+
+/* DAC controller and its PDC channel. The pointer registers are wide enough for a host address. */
+typedef struct
+{
+	volatile uint32_t DACC_CR;
+	volatile uint32_t DACC_MR;
+	volatile uint32_t DACC_CHER;
+	volatile uint32_t DACC_CHDR;
+	volatile uint32_t DACC_CDR;
+	volatile uint32_t DACC_IER;
+	volatile uint32_t DACC_IDR;
+	volatile uint32_t DACC_ISR;
+	volatile uintptr_t DACC_TPR;
+	volatile uint32_t DACC_TCR;
+	volatile uintptr_t DACC_TNPR;
+	volatile uint32_t DACC_TNCR;
+	volatile uint32_t DACC_PTCR;
+}
+Dacc;
+
+extern Dacc HOST_DACC;
+
+#define DACC (&HOST_DACC)
+#define DACC_INTERFACE DACC
+
+#define DACC_MR_TRGEN_EN (0x1u << 0)
+#define DACC_MR_TRGSEL_Pos 1
+#define DACC_MR_TRGSEL_Msk (0x7u << DACC_MR_TRGSEL_Pos)
+#define DACC_MR_TRGSEL(value) ((DACC_MR_TRGSEL_Msk & ((value) << DACC_MR_TRGSEL_Pos)))
+#define DACC_MR_WORD_HALF (0x0u << 4)
+#define DACC_MR_REFRESH_Msk (0xffu << 8)
+#define DACC_MR_USER_SEL_Msk (0x3u << 16)
+#define DACC_MR_TAG_EN (0x1u << 20)
+#define DACC_MR_STARTUP_Msk (0x3fu << 24)
+#define DACC_CHER_CH0 (0x1u << 0)
+#define DACC_CHER_CH1 (0x1u << 1)
+#define DACC_IER_ENDTX (0x1u << 2)
+#define DACC_PTCR_TXTEN (0x1u << 8)
+#define DACC_PTCR_TXTDIS (0x1u << 9)
+
+extern void dacc_set_channel_selection(Dacc *p_dacc, uint32_t ul_channel);
+extern void dacc_write_conversion_data(Dacc *p_dacc, uint32_t ul_data);
+
+/* ADC and its PDC channel. Only free running sequences through the PDC are simulated. */
+typedef struct
+{
+	volatile uint32_t ADC_CR;
+	volatile uint32_t ADC_MR;
+	volatile uint32_t ADC_SEQR1;
+	volatile uint32_t ADC_SEQR2;
+	volatile uint32_t ADC_CHER;
+	volatile uint32_t ADC_CHDR;
+	volatile uint32_t ADC_CHSR;
+	volatile uint32_t ADC_LCDR;
+	volatile uint32_t ADC_IER;
+	volatile uint32_t ADC_IDR;
+	volatile uint32_t ADC_IMR;
+	volatile uint32_t ADC_ISR;
+	volatile uint32_t ADC_EMR;
+	volatile uint32_t ADC_CDR[16];
+	volatile uintptr_t ADC_RPR;
+	volatile uint32_t ADC_RCR;
+	volatile uintptr_t ADC_RNPR;
+	volatile uint32_t ADC_RNCR;
+	volatile uint32_t ADC_PTCR;
+}
+Adc;
+
+extern Adc HOST_ADC;
+
+#define ADC (&HOST_ADC)
+
+#define ADC_CR_SWRST (0x1u << 0)
+#define ADC_CR_START (0x1u << 1)
+#define ADC_MR_TRGEN_DIS (0x0u << 0)
+#define ADC_MR_LOWRES_BITS_12 (0x0u << 4)
+#define ADC_MR_FREERUN_ON (0x1u << 7)
+#define ADC_MR_PRESCAL_Pos 8
+#define ADC_MR_PRESCAL_Msk (0xffu << ADC_MR_PRESCAL_Pos)
+#define ADC_MR_PRESCAL(value) ((ADC_MR_PRESCAL_Msk & ((value) << ADC_MR_PRESCAL_Pos)))
+#define ADC_MR_STARTUP_SUT64 (0x4u << 16)
+#define ADC_MR_SETTLING_AST3 (0x0u << 20)
+#define ADC_MR_TRACKTIM_Pos 24
+#define ADC_MR_TRACKTIM_Msk (0xfu << ADC_MR_TRACKTIM_Pos)
+#define ADC_MR_TRACKTIM(value) ((ADC_MR_TRACKTIM_Msk & ((value) << ADC_MR_TRACKTIM_Pos)))
+#define ADC_MR_TRANSFER(value) ((0x3u << 28) & ((value) << 28))
+#define ADC_EMR_TAG (0x1u << 24)
+#define ADC_LCDR_LDATA_Msk (0xfffu << 0)
+#define ADC_LCDR_CHNB_Pos 12
+#define ADC_IER_ENDRX (0x1u << 27)
+#define ADC_IDR_ENDRX (0x1u << 27)
+#define ADC_PTCR_RXTEN (0x1u << 0)
+#define ADC_PTCR_RXTDIS (0x1u << 1)
+
+#ifdef __cplusplus
+}
+
+#include "WCharacter.h"
+#include "WString.h"
+#include "WMath.h"
+#include "Stream.h"
+
+/* Serial goes to stdout and comes from stdin */
+class HostSerial : public Stream
+{
+	public:
+		void begin(unsigned long baud);
+		void end();
+		virtual int available(void);
+		virtual int peek(void);
+		virtual int read(void);
+		virtual void flush(void);
+		virtual size_t write(uint8_t c);
+		using Print::write;
+		operator bool() { return true; }
+
+	private:
+		int peeked = -1;
+		bool eof = false;
+};
+
+extern HostSerial Serial;
+
+extern void serialEventRun(void);
+
+/* USB descriptor structures and CDC request codes */
+#include "USB/USBCore.h"
+
+#endif
+
+#include "uotghs_host.h"
+
+#endif
@@ -0,0 +1,676 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "Wire.h"
+#include "Reset.h"
+#include "HostHAL.h"
+#include "HostSdCard.h"
+#include <poll.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace nw2s;
+
+uint32_t SystemCoreClock = VARIANT_MCK;
+
+Tc HOST_TC[3];
+Dacc HOST_DACC;
+Adc HOST_ADC;
+
+HostSerial Serial;
+SPIClass SPI;
+TwoWire Wire(0);
+TwoWire Wire1(1);
+
+/* Default handlers, the framework overrides the ones it uses (see util/Timers.cpp) */
+#define HOST_DEFAULT_HANDLER(name) extern "C" void name(void) __attribute__((weak)); extern "C" void name(void) {}
+
+HOST_DEFAULT_HANDLER(TC0_Handler)
+HOST_DEFAULT_HANDLER(TC1_Handler)
+HOST_DEFAULT_HANDLER(TC2_Handler)
+HOST_DEFAULT_HANDLER(TC3_Handler)
+HOST_DEFAULT_HANDLER(TC4_Handler)
+HOST_DEFAULT_HANDLER(TC5_Handler)
+HOST_DEFAULT_HANDLER(TC6_Handler)
+HOST_DEFAULT_HANDLER(TC7_Handler)
+HOST_DEFAULT_HANDLER(TC8_Handler)
+HOST_DEFAULT_HANDLER(ADC_Handler)
+HOST_DEFAULT_HANDLER(DACC_Handler)
+
+static HostInterruptHandler const TC_HANDLERS[HOST_TIMER_CHANNELS] = { TC0_Handler, TC1_Handler, TC2_Handler, TC3_Handler, TC4_Handler, TC5_Handler, TC6_Handler, TC7_Handler, TC8_Handler };
+
+/* MCK divisors for TIMER_CLOCK1 - TIMER_CLOCK4. TIMER_CLOCK5 is the 32kHz slow clock */
+static const uint32_t TC_CLOCK_DIVISORS[5] = { 2, 8, 32, 128, 2563 };
+
+static bool tcStarted[HOST_TIMER_CHANNELS];
+static bool tcIrqEnabled[HOST_TIMER_CHANNELS];
+static bool daccIrqEnabled = false;
+static bool adcIrqEnabled = false;
+static uint32_t adcNextChannel = 0;
+
+/* Which of A0 - A11 is wired to each ADC channel, as in the Due's variant.cpp */
+static const int ADC_CHANNEL_INPUTS[16] = { 7, 6, 5, 4, 3, 2, 1, 0, -1, -1, 8, 9, 10, 11, -1, -1 };
+
+/* One DACC conversion on a TIOA edge, fed by the PDC the same way the peripheral would be */
+static void hostDaccTrigger()
+{
+	Dacc* dacc = &HOST_DACC;
+
+	if (!(dacc->DACC_PTCR & DACC_PTCR_TXTEN) || (dacc->DACC_TCR == 0)) return;
+
+	uint16_t data = *(uint16_t*)dacc->DACC_TPR;
+	uint32_t channel = (dacc->DACC_MR & DACC_MR_TAG_EN) ? ((data >> 12) & 0x3) : ((dacc->DACC_MR & DACC_MR_USER_SEL_Msk) >> 16);
+
+	dacc->DACC_TPR += sizeof(uint16_t);
+	dacc->DACC_TCR--;
+	dacc->DACC_CDR = data;
+	HostHAL::get()->dacWrite(channel, data & 0x0FFF);
+
+	if (dacc->DACC_TCR == 0)
+	{
+		/* Roll over to the next buffer, then ENDTX stays up until the handler queues another one */
+		dacc->DACC_TPR = dacc->DACC_TNPR;
+		dacc->DACC_TCR = dacc->DACC_TNCR;
+		dacc->DACC_TNCR = 0;
+
+		if (daccIrqEnabled && (dacc->DACC_IER & DACC_IER_ENDTX)) DACC_Handler();
+	}
+}
+
+/* One conversion of the next enabled channel in a free running sequence, moved into memory by the PDC */
+static void hostAdcConvert()
+{
+	Adc* adc = &HOST_ADC;
+	uint32_t enabled = adc->ADC_CHER & 0xFFFF;
+
+	if (enabled == 0) return;
+
+	while (!(enabled & (1 << adcNextChannel))) adcNextChannel = (adcNextChannel + 1) % 16;
+
+	uint32_t channel = adcNextChannel;
+	int input = ADC_CHANNEL_INPUTS[channel];
+	uint32_t value = (input >= 0) ? HostHAL::get()->analogConvert(input) : 0;
+
+	adcNextChannel = (adcNextChannel + 1) % 16;
+	adc->ADC_CDR[channel] = value;
+	adc->ADC_LCDR = value | ((adc->ADC_EMR & ADC_EMR_TAG) ? (channel << ADC_LCDR_CHNB_Pos) : 0);
+
+	if (!(adc->ADC_PTCR & ADC_PTCR_RXTEN) || (adc->ADC_RCR == 0)) return;
+
+	*(uint16_t*)adc->ADC_RPR = adc->ADC_LCDR;
+	adc->ADC_RPR += sizeof(uint16_t);
+	adc->ADC_RCR--;
+
+	if (adc->ADC_RCR == 0)
+	{
+		/* Roll over to the next buffer, then ENDRX stays up until the handler queues another one */
+		adc->ADC_RPR = adc->ADC_RNPR;
+		adc->ADC_RCR = adc->ADC_RNCR;
+		adc->ADC_RNCR = 0;
+
+		if (adcIrqEnabled && (adc->ADC_IER & ADC_IER_ENDRX)) ADC_Handler();
+	}
+}
+
+/* Free running, a conversion takes 20 ADC clocks plus the tracking time, at MCK / ((PRESCAL + 1) * 2) */
+static void hostAdcUpdate()
+{
+	HostHAL* hal = HostHAL::get();
+	Adc* adc = &HOST_ADC;
+
+	if (adcIrqEnabled && (adc->ADC_MR & ADC_MR_FREERUN_ON))
+	{
+		uint32_t prescal = (adc->ADC_MR & ADC_MR_PRESCAL_Msk) >> ADC_MR_PRESCAL_Pos;
+		uint32_t tracktim = (adc->ADC_MR & ADC_MR_TRACKTIM_Msk) >> ADC_MR_TRACKTIM_Pos;
+
+		hal->timerAttach(HOST_TIMER_ADC, hostAdcConvert);
+		hal->timerStart(HOST_TIMER_ADC, (tracktim + 1 + 20) * (prescal + 1) * 2);
+	}
+	else
+	{
+		hal->timerStop(HOST_TIMER_ADC);
+	}
+}
+
+/* TIOA on TC0 channels 0 - 2 can trigger the DACC instead of interrupting */
+static bool hostTimerTriggersDacc(uint32_t id)
+{
+	return (id < 3) && (HOST_DACC.DACC_MR & DACC_MR_TRGEN_EN) && (((HOST_DACC.DACC_MR & DACC_MR_TRGSEL_Msk) >> DACC_MR_TRGSEL_Pos) == id + 1);
+}
+
+static void hostTimerUpdate(uint32_t id)
+{
+	HostHAL* hal = HostHAL::get();
+	TcChannel* channel = &HOST_TC[id / 3].TC_CHANNEL[id % 3];
+
+	uint32_t divisor = TC_CLOCK_DIVISORS[(channel->TC_CMR & TC_CMR_TCCLKS_Msk) % 5];
+	bool enabled = tcStarted[id] && tcIrqEnabled[id] && (channel->TC_IER & TC_IER_CPCS) && (channel->TC_RC > 0);
+
+	if (tcStarted[id] && (channel->TC_RC > 0) && hostTimerTriggersDacc(id))
+	{
+		hal->timerAttach(id, hostDaccTrigger);
+		hal->timerStart(id, channel->TC_RC * divisor);
+	}
+	else if (enabled)
+	{
+		hal->timerAttach(id, TC_HANDLERS[id]);
+		hal->timerStart(id, channel->TC_RC * divisor);
+	}
+	else
+	{
+		hal->timerStop(id);
+	}
+}
+
+static uint32_t hostTimerId(Tc* pTc, uint32_t dwChannel)
+{
+	return ((pTc - HOST_TC) * 3) + (dwChannel % 3);
+}
+
+
+/* TIME */
+
+unsigned long millis(void)
+{
+	return HostHAL::get()->micros() / 1000;
+}
+
+unsigned long micros(void)
+{
+	return HostHAL::get()->micros();
+}
+
+void delay(uint32_t dwMs)
+{
+	HostHAL::get()->delayMicroseconds(dwMs * 1000);
+}
+
+void delayMicroseconds(uint32_t dwUs)
+{
+	HostHAL::get()->delayMicroseconds(dwUs);
+}
+
+void yield(void)
+{
+	HostHAL::get()->service();
+}
+
+
+/* GPIO */
+
+void pinMode(uint32_t dwPin, uint32_t dwMode)
+{
+	HostHAL::get()->pinMode(dwPin, dwMode);
+}
+
+void digitalWrite(uint32_t dwPin, uint32_t dwVal)
+{
+	HostHAL::get()->digitalWrite(dwPin, dwVal);
+}
+
+int digitalRead(uint32_t ulPin)
+{
+	return HostHAL::get()->digitalRead(ulPin);
+}
+
+void attachInterrupt(uint32_t pin, void (*callback)(void), uint32_t mode)
+{
+	HostHAL::get()->attachInterrupt(pin, callback, mode);
+}
+
+void detachInterrupt(uint32_t pin)
+{
+	HostHAL::get()->attachInterrupt(pin, NULL, 0);
+}
+
+/* Interrupts are only ever delivered from HostHAL::service(), so there's nothing to mask */
+void __enable_irq(void)
+{
+}
+
+void __disable_irq(void)
+{
+}
+
+
+/* ANALOG */
+
+static int readResolution = 10;
+static int writeResolution = 8;
+
+uint32_t analogRead(uint32_t ulPin)
+{
+	/* Same as the SAM core - channel numbers are accepted as well as pin numbers */
+	if (ulPin < A0) ulPin += A0;
+
+	uint32_t value = HostHAL::get()->analogRead(ulPin - A0);
+
+	return (readResolution >= 12) ? value << (readResolution - 12) : value >> (12 - readResolution);
+}
+
+void analogReadResolution(int res)
+{
+	readResolution = res;
+}
+
+void analogWrite(uint32_t ulPin, uint32_t ulValue)
+{
+	uint32_t value = (writeResolution >= 12) ? ulValue >> (writeResolution - 12) : ulValue << (12 - writeResolution);
+
+	if ((ulPin == DAC0) || (ulPin == DAC1))
+	{
+		HostHAL::get()->dacWrite(ulPin - DAC0, value);
+	}
+	else
+	{
+		HostHAL::get()->digitalWrite(ulPin, ulValue > 0);
+	}
+}
+
+void analogWriteResolution(int res)
+{
+	writeResolution = res;
+}
+
+
+/* LIBSAM */
+
+void NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+	if ((IRQn >= TC0_IRQn) && (IRQn <= TC8_IRQn))
+	{
+		tcIrqEnabled[IRQn - TC0_IRQn] = true;
+		hostTimerUpdate(IRQn - TC0_IRQn);
+	}
+	else if (IRQn == DACC_IRQn)
+	{
+		daccIrqEnabled = true;
+	}
+	else if (IRQn == ADC_IRQn)
+	{
+		adcIrqEnabled = true;
+		hostAdcUpdate();
+	}
+}
+
+void NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+	if ((IRQn >= TC0_IRQn) && (IRQn <= TC8_IRQn))
+	{
+		tcIrqEnabled[IRQn - TC0_IRQn] = false;
+		hostTimerUpdate(IRQn - TC0_IRQn);
+	}
+	else if (IRQn == DACC_IRQn)
+	{
+		daccIrqEnabled = false;
+	}
+	else if (IRQn == ADC_IRQn)
+	{
+		adcIrqEnabled = false;
+		hostAdcUpdate();
+	}
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn)
+{
+}
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority)
+{
+}
+
+uint32_t pmc_enable_periph_clk(uint32_t ul_id)
+{
+	return 0;
+}
+
+uint32_t pmc_disable_periph_clk(uint32_t ul_id)
+{
+	return 0;
+}
+
+void pmc_set_writeprotect(uint32_t ul_enable)
+{
+}
+
+void TC_Configure(Tc *pTc, uint32_t dwChannel, uint32_t dwMode)
+{
+	TcChannel* channel = &pTc->TC_CHANNEL[dwChannel];
+
+	channel->TC_CMR = dwMode;
+	channel->TC_IER = 0;
+	channel->TC_IDR = 0xFFFFFFFF;
+
+	tcStarted[hostTimerId(pTc, dwChannel)] = false;
+	hostTimerUpdate(hostTimerId(pTc, dwChannel));
+}
+
+void TC_Start(Tc *pTc, uint32_t dwChannel)
+{
+	tcStarted[hostTimerId(pTc, dwChannel)] = true;
+	hostTimerUpdate(hostTimerId(pTc, dwChannel));
+}
+
+void TC_Stop(Tc *pTc, uint32_t dwChannel)
+{
+	tcStarted[hostTimerId(pTc, dwChannel)] = false;
+	hostTimerUpdate(hostTimerId(pTc, dwChannel));
+}
+
+void TC_SetRA(Tc *pTc, uint32_t dwChannel, uint32_t dwValue)
+{
+	pTc->TC_CHANNEL[dwChannel].TC_RA = dwValue;
+}
+
+void TC_SetRB(Tc *pTc, uint32_t dwChannel, uint32_t dwValue)
+{
+	pTc->TC_CHANNEL[dwChannel].TC_RB = dwValue;
+}
+
+void TC_SetRC(Tc *pTc, uint32_t dwChannel, uint32_t dwValue)
+{
+	pTc->TC_CHANNEL[dwChannel].TC_RC = dwValue;
+	hostTimerUpdate(hostTimerId(pTc, dwChannel));
+}
+
+uint32_t TC_GetStatus(Tc *pTc, uint32_t dwChannel)
+{
+	return TC_SR_CPCS;
+}
+
+static uint32_t daccChannel = 0;
+
+void dacc_set_channel_selection(Dacc *p_dacc, uint32_t ul_channel)
+{
+	daccChannel = ul_channel;
+}
+
+void dacc_write_conversion_data(Dacc *p_dacc, uint32_t ul_data)
+{
+	p_dacc->DACC_CDR = ul_data;
+	HostHAL::get()->dacWrite(daccChannel, ul_data);
+}
+
+
+/* USB HOST - VBUS is never present */
+
+void UHD_SetStack(void (*pf_isr)(void))
+{
+}
+
+void UHD_Init(void)
+{
+}
+
+void UHD_BusReset(void)
+{
+}
+
+uhd_vbus_state_t UHD_GetVBUSState(void)
+{
+	return UHD_STATE_NO_VBUS;
+}
+
+uint32_t UHD_Pipe0_Alloc(uint32_t ul_add, uint32_t ul_ep_size)
+{
+	return 1;
+}
+
+uint32_t UHD_Pipe_Alloc(uint32_t ul_dev_addr, uint32_t ul_dev_ep, uint32_t ul_type, uint32_t ul_dir, uint32_t ul_maxsize, uint32_t ul_interval, uint32_t ul_nb_bank)
+{
+	return 0;
+}
+
+void UHD_Pipe_Free(uint32_t ul_pipe)
+{
+}
+
+uint32_t UHD_Pipe_Read(uint32_t ul_pipe, uint32_t ul_size, uint8_t* data)
+{
+	return 0;
+}
+
+void UHD_Pipe_Write(uint32_t ul_pipe, uint32_t ul_size, uint8_t* data)
+{
+}
+
+void UHD_Pipe_Send(uint32_t ul_pipe, uint32_t ul_token_type)
+{
+}
+
+uint32_t UHD_Pipe_Is_Transfer_Complete(uint32_t ul_pipe, uint32_t ul_token_type)
+{
+	return 0;
+}
+
+uint32_t uhd_host_pipe_byte_count(uint32_t ul_pipe)
+{
+	return 0;
+}
+
+
+/* RESET - the host equivalent of erase and reset is to quit */
+
+void initiateReset(int ms)
+{
+}
+
+void tickReset()
+{
+	Serial.println("Reset requested, exiting.");
+	exit(0);
+}
+
+void cancelReset()
+{
+}
+
+
+/* SPI */
+
+byte SPIClass::transfer(byte _channel, uint8_t _data, SPITransferMode _mode)
+{
+	return HostHAL::get()->spiTransfer(_data);
+}
+
+
+/* I2C */
+
+TwoWire::TwoWire(uint8_t bus)
+{
+	this->bus = bus;
+	this->rxBufferIndex = 0;
+	this->rxBufferLength = 0;
+	this->txAddress = 0;
+	this->txBufferLength = 0;
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+	this->txAddress = address;
+	this->txBufferLength = 0;
+}
+
+void TwoWire::beginTransmission(int address)
+{
+	this->beginTransmission((uint8_t)address);
+}
+
+uint8_t TwoWire::endTransmission(void)
+{
+	return this->endTransmission((uint8_t)true);
+}
+
+uint8_t TwoWire::endTransmission(uint8_t sendStop)
+{
+	uint8_t status = HostHAL::get()->i2cWrite(this->bus, this->txAddress, this->txBuffer, this->txBufferLength);
+	this->txBufferLength = 0;
+
+	return status;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop)
+{
+	if (quantity > BUFFER_LENGTH) quantity = BUFFER_LENGTH;
+
+	this->rxBufferIndex = 0;
+	this->rxBufferLength = HostHAL::get()->i2cRead(this->bus, address, this->rxBuffer, quantity);
+
+	return this->rxBufferLength;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+	return this->requestFrom(address, quantity, (uint8_t)true);
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity)
+{
+	return this->requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)true);
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity, int sendStop)
+{
+	return this->requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)sendStop);
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+	if (this->txBufferLength >= BUFFER_LENGTH) return 0;
+
+	this->txBuffer[this->txBufferLength++] = data;
+
+	return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity)
+{
+	for (size_t i = 0; i < quantity; i++)
+	{
+		if (!this->write(data[i])) return i;
+	}
+
+	return quantity;
+}
+
+int TwoWire::available(void)
+{
+	return this->rxBufferLength - this->rxBufferIndex;
+}
+
+int TwoWire::read(void)
+{
+	return (this->rxBufferIndex < this->rxBufferLength) ? this->rxBuffer[this->rxBufferIndex++] : -1;
+}
+
+int TwoWire::peek(void)
+{
+	return (this->rxBufferIndex < this->rxBufferLength) ? this->rxBuffer[this->rxBufferIndex] : -1;
+}
+
+
+/* SERIAL */
+
+void HostSerial::begin(unsigned long baud)
+{
+	setvbuf(stdout, NULL, _IOLBF, 0);
+}
+
+void HostSerial::end()
+{
+}
+
+int HostSerial::available(void)
+{
+	if (this->peeked >= 0) return 1;
+	if (this->eof) return 0;
+
+	struct pollfd fd = { STDIN_FILENO, POLLIN, 0 };
+
+	return ((poll(&fd, 1, 0) > 0) && (fd.revents & POLLIN)) ? 1 : 0;
+}
+
+int HostSerial::peek(void)
+{
+	if ((this->peeked < 0) && this->available())
+	{
+		unsigned char c;
+		this->peeked = (::read(STDIN_FILENO, &c, 1) == 1) ? c : -1;
+
+		/* A closed stdin keeps polling readable, so stop looking once it's gone */
+		if (this->peeked < 0) this->eof = true;
+	}
+
+	return this->peeked;
+}
+
+int HostSerial::read(void)
+{
+	int c = this->peek();
+	this->peeked = -1;
+
+	return c;
+}
+
+void HostSerial::flush(void)
+{
+	fflush(stdout);
+}
+
+size_t HostSerial::write(uint8_t c)
+{
+	return (fputc(c, stdout) == EOF) ? 0 : 1;
+}
+
+void serialEvent() __attribute__((weak));
+
+void serialEventRun(void)
+{
+	if (serialEvent && Serial.available()) serialEvent();
+}
+
+
+int main(int argc, char** argv)
+{
+	HostHAL::get();
+
+	/* The card sits on the same chip select as on the b */
+	const char* image = getenv("NW2S_SD_IMAGE");
+
+	if ((image != NULL) && (HostSdCard::attach(10, image) == NULL))
+	{
+		fprintf(stderr, "Could not open SD image %s\n", image);
+	}
+
+	setup();
+
+	for (;;)
+	{
+		HostHAL::get()->service();
+
+		loop();
+
+		serialEventRun();
+	}
+
+	return 0;
+}
@@ -0,0 +1,422 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "HostHAL.h"
+#include <string.h>
+#include <time.h>
+
+using namespace nw2s;
+
+/* Everything is kept in master clock cycles so the timer/counters don't drift */
+static const uint64_t HOST_MCK = 84000000ULL;
+static const uint64_t HOST_CYCLES_PER_US = HOST_MCK / 1000000ULL;
+
+/* Same values as wiring_constants.h and WInterrupts.h */
+static const uint32_t HOST_INPUT_PULLUP = 2;
+static const uint32_t HOST_CHANGE = 2;
+static const uint32_t HOST_FALLING = 3;
+static const uint32_t HOST_RISING = 4;
+
+HostHAL* HostHAL::current = NULL;
+
+HostHAL* HostHAL::get()
+{
+	if (current == NULL)
+	{
+		current = new SimulatedHAL();
+	}
+
+	return current;
+}
+
+void HostHAL::install(HostHAL* hal)
+{
+	current = hal;
+}
+
+static uint64_t wallclockNanos()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+SimulatedHAL::SimulatedHAL()
+{
+	this->manualTime = false;
+	this->now = 0;
+	this->epoch = wallclockNanos();
+	this->spiSelected = HOST_SPI_CS_NONE;
+	this->servicing = false;
+
+	memset(this->pinModes, 0, sizeof(this->pinModes));
+	memset(this->pinValues, 0, sizeof(this->pinValues));
+	memset(this->pinHandlers, 0, sizeof(this->pinHandlers));
+	memset(this->pinHandlerModes, 0, sizeof(this->pinHandlerModes));
+	memset(this->adcValues, 0, sizeof(this->adcValues));
+	memset(this->dacValues, 0, sizeof(this->dacValues));
+	memset(this->spiDevices, 0, sizeof(this->spiDevices));
+	memset(this->i2cDevices, 0, sizeof(this->i2cDevices));
+	memset(this->usbDevices, 0, sizeof(this->usbDevices));
+	memset(this->timerHandlers, 0, sizeof(this->timerHandlers));
+	memset(this->timerPeriods, 0, sizeof(this->timerPeriods));
+	memset(this->timerNext, 0, sizeof(this->timerNext));
+
+	/* Inputs are inverted on the b, so the resting ADC value is mid scale */
+	for (int i = 0; i < HOST_ADC_CHANNELS; i++) this->adcValues[i] = 2048;
+
+	this->resetStats();
+}
+
+void SimulatedHAL::resetStats()
+{
+	memset(&this->stats, 0, sizeof(this->stats));
+}
+
+uint64_t SimulatedHAL::cycles()
+{
+	if (!this->manualTime)
+	{
+		this->now = ((wallclockNanos() - this->epoch) * HOST_CYCLES_PER_US) / 1000ULL;
+	}
+
+	return this->now;
+}
+
+void SimulatedHAL::setManualTime(bool manual)
+{
+	/* Carry on from wherever the clock is now */
+	this->cycles();
+
+	this->manualTime = manual;
+	this->epoch = wallclockNanos() - ((this->now * 1000ULL) / HOST_CYCLES_PER_US);
+}
+
+void SimulatedHAL::advance(uint32_t us)
+{
+	if (this->manualTime)
+	{
+		uint64_t target = this->now + ((uint64_t)us * HOST_CYCLES_PER_US);
+
+		/* Walk the clock forward one timer interrupt at a time so ISRs see the right time */
+		while (true)
+		{
+			uint64_t next = target;
+
+			for (int i = 0; i < HOST_TIMER_CHANNELS; i++)
+			{
+				if ((this->timerPeriods[i] > 0) && (this->timerNext[i] < next)) next = this->timerNext[i];
+			}
+
+			this->now = (next > this->now) ? next : this->now;
+			this->service();
+
+			if (this->now >= target) break;
+		}
+	}
+	else
+	{
+		this->delayMicroseconds(us);
+	}
+}
+
+uint64_t SimulatedHAL::micros()
+{
+	return this->cycles() / HOST_CYCLES_PER_US;
+}
+
+void SimulatedHAL::delayMicroseconds(uint32_t us)
+{
+	if (this->manualTime)
+	{
+		this->advance(us);
+		return;
+	}
+
+	uint64_t target = this->cycles() + ((uint64_t)us * HOST_CYCLES_PER_US);
+
+	while (this->cycles() < target)
+	{
+		this->service();
+
+		/* Yield the CPU for short spins only - longer waits just sleep in 100uS steps */
+		uint64_t remaining = ((target - this->now) * 1000ULL) / HOST_CYCLES_PER_US;
+		struct timespec ts = { 0, (long)((remaining > 100000ULL) ? 100000ULL : remaining) };
+		nanosleep(&ts, NULL);
+	}
+
+	this->service();
+}
+
+void SimulatedHAL::pinMode(uint32_t pin, uint32_t mode)
+{
+	if (pin >= HOST_PIN_COUNT) return;
+
+	this->pinModes[pin] = mode;
+
+	if (mode == HOST_INPUT_PULLUP) this->pinValues[pin] = 1;
+}
+
+void SimulatedHAL::digitalWrite(uint32_t pin, uint32_t value)
+{
+	if (pin >= HOST_PIN_COUNT) return;
+
+	this->stats.digitalWrites++;
+
+	uint8_t level = value ? 1 : 0;
+	uint8_t previous = this->pinValues[pin];
+	this->pinValues[pin] = level;
+
+	/* Chip selects are active low */
+	if ((this->spiDevices[pin] != NULL) && (previous != level))
+	{
+		if (level == 0)
+		{
+			this->spiSelected = pin;
+			this->stats.spiTransactions++;
+			this->spiDevices[pin]->select();
+		}
+		else
+		{
+			if (this->spiSelected == (int)pin) this->spiSelected = HOST_SPI_CS_NONE;
+			this->spiDevices[pin]->deselect();
+		}
+	}
+}
+
+int SimulatedHAL::digitalRead(uint32_t pin)
+{
+	if (pin >= HOST_PIN_COUNT) return 0;
+
+	this->stats.digitalReads++;
+
+	return this->pinValues[pin];
+}
+
+void SimulatedHAL::attachInterrupt(uint32_t pin, HostInterruptHandler handler, uint32_t mode)
+{
+	if (pin >= HOST_PIN_COUNT) return;
+
+	this->pinHandlers[pin] = handler;
+	this->pinHandlerModes[pin] = mode;
+}
+
+void SimulatedHAL::setDigitalInput(uint32_t pin, int value)
+{
+	if (pin >= HOST_PIN_COUNT) return;
+
+	uint8_t level = value ? 1 : 0;
+	uint8_t previous = this->pinValues[pin];
+	this->pinValues[pin] = level;
+
+	HostInterruptHandler handler = this->pinHandlers[pin];
+
+	if ((handler == NULL) || (previous == level)) return;
+
+	uint8_t mode = this->pinHandlerModes[pin];
+
+	if ((mode == HOST_CHANGE) || ((mode == HOST_RISING) && level) || ((mode == HOST_FALLING) && !level))
+	{
+		handler();
+	}
+}
+
+int SimulatedHAL::getDigitalOutput(uint32_t pin)
+{
+	return (pin < HOST_PIN_COUNT) ? this->pinValues[pin] : 0;
+}
+
+uint32_t SimulatedHAL::analogRead(uint32_t channel)
+{
+	this->stats.analogReads++;
+
+	return (channel < HOST_ADC_CHANNELS) ? this->adcValues[channel] : 0;
+}
+
+uint32_t SimulatedHAL::analogConvert(uint32_t channel)
+{
+	this->stats.adcConversions++;
+
+	return (channel < HOST_ADC_CHANNELS) ? this->adcValues[channel] : 0;
+}
+
+void SimulatedHAL::setAnalogInput(uint32_t channel, uint32_t value)
+{
+	if (channel < HOST_ADC_CHANNELS) this->adcValues[channel] = value & 0x0FFF;
+}
+
+void SimulatedHAL::dacWrite(uint32_t channel, uint32_t value)
+{
+	this->stats.dacWrites++;
+
+	if (channel < HOST_DAC_CHANNELS) this->dacValues[channel] = value & 0x0FFF;
+}
+
+uint32_t SimulatedHAL::getDacValue(uint32_t channel)
+{
+	return (channel < HOST_DAC_CHANNELS) ? this->dacValues[channel] : 0;
+}
+
+void SimulatedHAL::attachSpiDevice(int cspin, HostSpiDevice* device)
+{
+	if ((cspin >= 0) && (cspin < HOST_PIN_COUNT)) this->spiDevices[cspin] = device;
+}
+
+uint8_t SimulatedHAL::spiTransfer(uint8_t data)
+{
+	this->stats.spiBytes++;
+
+	if (this->spiSelected == HOST_SPI_CS_NONE) return 0xFF;
+
+	return this->spiDevices[this->spiSelected]->transfer(data);
+}
+
+void SimulatedHAL::attachI2cDevice(uint8_t bus, uint8_t address, HostI2cDevice* device)
+{
+	if ((bus < 2) && (address < 128)) this->i2cDevices[bus][address] = device;
+}
+
+uint8_t SimulatedHAL::i2cWrite(uint8_t bus, uint8_t address, const uint8_t* data, size_t length)
+{
+	this->stats.i2cTransactions++;
+	this->stats.i2cBytes += length + 1;
+
+	HostI2cDevice* device = ((bus < 2) && (address < 128)) ? this->i2cDevices[bus][address] : NULL;
+
+	/* Same return codes as TwoWire::endTransmission() - 2 is a NACK on the address */
+	if (device == NULL) return 2;
+
+	return device->write(data, length) ? 0 : 3;
+}
+
+size_t SimulatedHAL::i2cRead(uint8_t bus, uint8_t address, uint8_t* data, size_t length)
+{
+	this->stats.i2cTransactions++;
+	this->stats.i2cBytes += 1;
+
+	HostI2cDevice* device = ((bus < 2) && (address < 128)) ? this->i2cDevices[bus][address] : NULL;
+
+	if (device == NULL) return 0;
+
+	size_t count = device->read(data, length);
+	this->stats.i2cBytes += count;
+
+	return count;
+}
+
+void SimulatedHAL::attachUsbDevice(uint8_t address, HostUsbDevice* device)
+{
+	/* Address 0 is where devices sit while they enumerate, it never has a class driver */
+	if ((address > 0) && (address < HOST_USB_ADDRESSES)) this->usbDevices[address] = device;
+}
+
+bool SimulatedHAL::usbOut(uint32_t address, uint32_t ep, const uint8_t* data, uint32_t length, uint32_t* rcode)
+{
+	HostUsbDevice* device = (address < HOST_USB_ADDRESSES) ? this->usbDevices[address] : NULL;
+
+	if (device == NULL) return false;
+
+	this->stats.usbTransfers++;
+	this->stats.usbBytes += length;
+
+	*rcode = device->out(ep, data, length);
+
+	return true;
+}
+
+bool SimulatedHAL::usbIn(uint32_t address, uint32_t ep, uint8_t* data, uint32_t* length, uint32_t* rcode)
+{
+	HostUsbDevice* device = (address < HOST_USB_ADDRESSES) ? this->usbDevices[address] : NULL;
+
+	if (device == NULL) return false;
+
+	uint32_t space = *length;
+
+	*rcode = device->in(ep, data, length);
+
+	/* A device can't hand back more than it was given room for */
+	if (*length > space) *length = space;
+
+	this->stats.usbTransfers++;
+	this->stats.usbBytes += *length;
+
+	return true;
+}
+
+void SimulatedHAL::timerAttach(uint32_t channel, HostInterruptHandler handler)
+{
+	if (channel < HOST_TIMER_CHANNELS) this->timerHandlers[channel] = handler;
+}
+
+void SimulatedHAL::timerStart(uint32_t channel, uint32_t period)
+{
+	if (channel >= HOST_TIMER_CHANNELS) return;
+
+	/* Changing RC on a running channel keeps the current phase */
+	if (this->timerPeriods[channel] == 0)
+	{
+		this->timerNext[channel] = this->cycles() + period;
+	}
+
+	this->timerPeriods[channel] = period;
+}
+
+void SimulatedHAL::timerStop(uint32_t channel)
+{
+	if (channel < HOST_TIMER_CHANNELS) this->timerPeriods[channel] = 0;
+}
+
+void SimulatedHAL::service()
+{
+	/* Interrupts don't nest on the host */
+	if (this->servicing) return;
+
+	this->servicing = true;
+
+	uint64_t t = this->cycles();
+	bool fired = true;
+
+	/* Deliver every interrupt that came due, oldest first, like the NVIC would have */
+	while (fired)
+	{
+		fired = false;
+		int channel = -1;
+
+		for (int i = 0; i < HOST_TIMER_CHANNELS; i++)
+		{
+			if ((this->timerPeriods[i] > 0) && (this->timerNext[i] <= t))
+			{
+				if ((channel < 0) || (this->timerNext[i] < this->timerNext[channel])) channel = i;
+			}
+		}
+
+		if (channel >= 0)
+		{
+			this->timerNext[channel] += this->timerPeriods[channel];
+			this->stats.timerInterrupts++;
+			fired = true;
+
+			if (this->timerHandlers[channel] != NULL) this->timerHandlers[channel]();
+		}
+	}
+
+	this->servicing = false;
+}
@@ -0,0 +1,222 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+
+	The host HAL is what the Arduino/SAM API in hal/host/Arduino.h talks to when the
+	framework is compiled as a Linux process with 'make host'. HostHAL is the pluggable
+	interface; SimulatedHAL is the default backend which keeps pin, ADC, DAC, SPI, I2C,
+	USB and timer/counter state in memory so that firmware can run and be measured without
+	a Due attached. Replace it with HostHAL::install() before setup() is called if you
+	need a different behavior.
+
+*/
+
+#ifndef HostHAL_h
+#define HostHAL_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HOST_PIN_COUNT 79
+#define HOST_ADC_CHANNELS 12
+#define HOST_DAC_CHANNELS 2
+#define HOST_TIMER_CHANNELS 10
+#define HOST_TIMER_ADC 9
+#define HOST_SPI_CS_NONE -1
+#define HOST_USB_ADDRESSES 128
+
+namespace nw2s
+{
+	class HostHAL;
+	class HostSpiDevice;
+	class HostI2cDevice;
+	class HostUsbDevice;
+	class SimulatedHAL;
+
+	typedef void (*HostInterruptHandler)(void);
+
+	typedef struct
+	{
+		uint32_t digitalWrites;
+		uint32_t digitalReads;
+		uint32_t analogReads;
+		uint32_t dacWrites;
+		uint32_t spiBytes;
+		uint32_t spiTransactions;
+		uint32_t i2cBytes;
+		uint32_t i2cTransactions;
+		uint32_t usbTransfers;
+		uint32_t usbBytes;
+		uint32_t timerInterrupts;
+		uint32_t adcConversions;
+	}
+	HostStats;
+}
+
+/* A peripheral sitting on the SPI bus behind a chip select pin */
+class nw2s::HostSpiDevice
+{
+	public:
+		virtual ~HostSpiDevice() {}
+		virtual void select() {}
+		virtual void deselect() {}
+		virtual uint8_t transfer(uint8_t data) = 0;
+};
+
+/* A peripheral sitting on one of the I2C buses at a 7 bit address */
+class nw2s::HostI2cDevice
+{
+	public:
+		virtual ~HostI2cDevice() {}
+		virtual bool write(const uint8_t* data, size_t length) = 0;
+		virtual size_t read(uint8_t* data, size_t length) = 0;
+};
+
+/*
+	A peripheral on the USB host port at a device address. Nothing enumerates on the host, so a
+	class driver that has been handed the address talks to it straight away. Both calls return
+	the USB host stack's codes - 0 for success and 1 for a NAK. in() is given the space in
+	*length and sets it to what was received.
+*/
+class nw2s::HostUsbDevice
+{
+	public:
+		virtual ~HostUsbDevice() {}
+		virtual uint32_t out(uint32_t ep, const uint8_t* data, uint32_t length) = 0;
+		virtual uint32_t in(uint32_t ep, uint8_t* data, uint32_t* length) = 0;
+};
+
+class nw2s::HostHAL
+{
+	public:
+		static HostHAL* get();
+		static void install(HostHAL* hal);
+
+		virtual ~HostHAL() {}
+
+		/* Time in microseconds since startup. delayMicroseconds() must service timers while it waits. */
+		virtual uint64_t micros() = 0;
+		virtual void delayMicroseconds(uint32_t us) = 0;
+
+		virtual void pinMode(uint32_t pin, uint32_t mode) = 0;
+		virtual void digitalWrite(uint32_t pin, uint32_t value) = 0;
+		virtual int digitalRead(uint32_t pin) = 0;
+		virtual void attachInterrupt(uint32_t pin, HostInterruptHandler handler, uint32_t mode) = 0;
+
+		/* ADC channels are 0 - 11 for A0 - A11, DAC channels are 0 - 1. analogRead() is a blocking read, analogConvert() one made by the sequencer. */
+		virtual uint32_t analogRead(uint32_t channel) = 0;
+		virtual uint32_t analogConvert(uint32_t channel) { return this->analogRead(channel); }
+		virtual void dacWrite(uint32_t channel, uint32_t value) = 0;
+
+		virtual uint8_t spiTransfer(uint8_t data) = 0;
+		virtual uint8_t i2cWrite(uint8_t bus, uint8_t address, const uint8_t* data, size_t length) = 0;
+		virtual size_t i2cRead(uint8_t bus, uint8_t address, uint8_t* data, size_t length) = 0;
+
+		/* Bulk transfers from the USB host stack. They return false if there's no device at the address, and the stack carries on as if the bus were empty. */
+		virtual bool usbOut(uint32_t address, uint32_t ep, const uint8_t* data, uint32_t length, uint32_t* rcode) = 0;
+		virtual bool usbIn(uint32_t address, uint32_t ep, uint8_t* data, uint32_t* length, uint32_t* rcode) = 0;
+
+		/* Timer channels are numbered as the TCn_Handler they fire, period is in 84MHz master clock cycles. HOST_TIMER_ADC paces the ADC sequencer. */
+		virtual void timerAttach(uint32_t channel, HostInterruptHandler handler) = 0;
+		virtual void timerStart(uint32_t channel, uint32_t period) = 0;
+		virtual void timerStop(uint32_t channel) = 0;
+
+		/* Called from the host main loop to deliver any pending timer interrupts */
+		virtual void service() = 0;
+
+	private:
+		static HostHAL* current;
+};
+
+class nw2s::SimulatedHAL : public HostHAL
+{
+	public:
+		SimulatedHAL();
+
+		/* In manual time the clock only moves on delay() or advance(), which makes runs repeatable */
+		void setManualTime(bool manual);
+		void advance(uint32_t us);
+
+		void setDigitalInput(uint32_t pin, int value);
+		void setAnalogInput(uint32_t channel, uint32_t value);
+		uint32_t getDacValue(uint32_t channel);
+		int getDigitalOutput(uint32_t pin);
+
+		void attachSpiDevice(int cspin, HostSpiDevice* device);
+		void attachI2cDevice(uint8_t bus, uint8_t address, HostI2cDevice* device);
+		void attachUsbDevice(uint8_t address, HostUsbDevice* device);
+
+		HostStats stats;
+		void resetStats();
+
+		virtual uint64_t micros();
+		virtual void delayMicroseconds(uint32_t us);
+
+		virtual void pinMode(uint32_t pin, uint32_t mode);
+		virtual void digitalWrite(uint32_t pin, uint32_t value);
+		virtual int digitalRead(uint32_t pin);
+		virtual void attachInterrupt(uint32_t pin, HostInterruptHandler handler, uint32_t mode);
+
+		virtual uint32_t analogRead(uint32_t channel);
+		virtual uint32_t analogConvert(uint32_t channel);
+		virtual void dacWrite(uint32_t channel, uint32_t value);
+
+		virtual uint8_t spiTransfer(uint8_t data);
+		virtual uint8_t i2cWrite(uint8_t bus, uint8_t address, const uint8_t* data, size_t length);
+		virtual size_t i2cRead(uint8_t bus, uint8_t address, uint8_t* data, size_t length);
+		virtual bool usbOut(uint32_t address, uint32_t ep, const uint8_t* data, uint32_t length, uint32_t* rcode);
+		virtual bool usbIn(uint32_t address, uint32_t ep, uint8_t* data, uint32_t* length, uint32_t* rcode);
+
+		virtual void timerAttach(uint32_t channel, HostInterruptHandler handler);
+		virtual void timerStart(uint32_t channel, uint32_t period);
+		virtual void timerStop(uint32_t channel);
+
+		virtual void service();
+
+	private:
+		bool manualTime;
+		uint64_t now;
+		uint64_t epoch;
+
+		uint8_t pinModes[HOST_PIN_COUNT];
+		uint8_t pinValues[HOST_PIN_COUNT];
+		HostInterruptHandler pinHandlers[HOST_PIN_COUNT];
+		uint8_t pinHandlerModes[HOST_PIN_COUNT];
+
+		uint32_t adcValues[HOST_ADC_CHANNELS];
+		uint32_t dacValues[HOST_DAC_CHANNELS];
+
+		HostSpiDevice* spiDevices[HOST_PIN_COUNT];
+		int spiSelected;
+
+		HostI2cDevice* i2cDevices[2][128];
+
+		HostUsbDevice* usbDevices[HOST_USB_ADDRESSES];
+
+		HostInterruptHandler timerHandlers[HOST_TIMER_CHANNELS];
+		uint32_t timerPeriods[HOST_TIMER_CHANNELS];
+		uint64_t timerNext[HOST_TIMER_CHANNELS];
+		bool servicing;
+
+		uint64_t cycles();
+};
+
+#endif
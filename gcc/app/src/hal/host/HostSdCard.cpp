@@ -0,0 +1,363 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "HostSdCard.h"
+#include <string.h>
+
+using namespace nw2s;
+
+/* Same values as SdInfo.h */
+static const uint8_t SD_CMD0 = 0;
+static const uint8_t SD_CMD8 = 8;
+static const uint8_t SD_CMD9 = 9;
+static const uint8_t SD_CMD10 = 10;
+static const uint8_t SD_CMD12 = 12;
+static const uint8_t SD_CMD13 = 13;
+static const uint8_t SD_CMD17 = 17;
+static const uint8_t SD_CMD18 = 18;
+static const uint8_t SD_CMD24 = 24;
+static const uint8_t SD_CMD55 = 55;
+static const uint8_t SD_CMD58 = 58;
+static const uint8_t SD_ACMD41 = 41;
+
+static const uint8_t SD_R1_READY = 0x00;
+static const uint8_t SD_R1_IDLE = 0x01;
+static const uint8_t SD_R1_ILLEGAL = 0x04;
+static const uint8_t SD_R1_ADDRESS = 0x40;
+static const uint8_t SD_DATA_START = 0xFE;
+static const uint8_t SD_DATA_ACCEPTED = 0x05;
+
+HostSdCard* HostSdCard::attach(int cspin, const char* imagepath)
+{
+	FILE* image = fopen(imagepath, "r+b");
+
+	if (image == NULL) image = fopen(imagepath, "rb");
+	if (image == NULL) return NULL;
+
+	HostSdCard* card = new HostSdCard(image);
+
+	SimulatedHAL* hal = (SimulatedHAL*)HostHAL::get();
+	hal->attachSpiDevice(cspin, card);
+
+	return card;
+}
+
+HostSdCard::HostSdCard(FILE* image)
+{
+	this->image = image;
+
+	fseek(image, 0, SEEK_END);
+	this->blocks = ftell(image) / HOST_SD_BLOCK_SIZE;
+
+	this->accessTime = 0;
+	this->spikeEvery = 0;
+	this->spikeTime = 0;
+
+	this->outputHead = 0;
+	this->outputLength = 0;
+	this->commandLength = 0;
+	this->appCommand = false;
+	this->streaming = false;
+	this->streamBlock = 0;
+	this->writing = false;
+	this->writeLength = 0;
+	this->writeBlock = 0;
+
+	this->resetStats();
+}
+
+HostSdCard::~HostSdCard()
+{
+	fclose(this->image);
+}
+
+void HostSdCard::resetStats()
+{
+	memset(&this->stats, 0, sizeof(this->stats));
+}
+
+void HostSdCard::setAccessTime(uint32_t us)
+{
+	this->accessTime = us;
+}
+
+void HostSdCard::setLatencySpikes(uint32_t every, uint32_t us)
+{
+	this->spikeEvery = every;
+	this->spikeTime = us;
+}
+
+void HostSdCard::select()
+{
+	this->commandLength = 0;
+}
+
+void HostSdCard::deselect()
+{
+	/* A block that was being clocked out is lost, but a CMD18 carries on with the next one */
+	this->outputLength = 0;
+	this->commandLength = 0;
+}
+
+uint8_t HostSdCard::transfer(uint8_t data)
+{
+	if (this->writing)
+	{
+		this->receive(data);
+	}
+	else if ((this->commandLength > 0) || ((data & 0xC0) == 0x40))
+	{
+		this->command[this->commandLength++] = data;
+
+		if (this->commandLength == 6)
+		{
+			this->commandLength = 0;
+			this->execute();
+		}
+	}
+
+	/* The next block of a multiple block read starts as soon as the last one is gone */
+	if ((this->outputLength == 0) && this->streaming)
+	{
+		this->streaming = this->queueBlock(this->streamBlock++);
+	}
+
+	if (this->outputLength == 0) return 0xFF;
+
+	this->outputLength--;
+
+	return this->output[this->outputHead++];
+}
+
+void HostSdCard::send(uint8_t data)
+{
+	/* Start over at the front once everything queued has been clocked out */
+	if (this->outputLength == 0) this->outputHead = 0;
+
+	if (this->outputHead + this->outputLength < HOST_SD_OUTPUT_SIZE)
+	{
+		this->output[this->outputHead + this->outputLength++] = data;
+	}
+}
+
+void HostSdCard::send(const uint8_t* data, int length)
+{
+	for (int i = 0; i < length; i++) send(data[i]);
+}
+
+void HostSdCard::respond(uint8_t r1)
+{
+	/* One byte of Ncr before the response */
+	send(0xFF);
+	send(r1);
+}
+
+bool HostSdCard::queueBlock(uint32_t block)
+{
+	if (block >= this->blocks) return false;
+
+	uint8_t data[HOST_SD_BLOCK_SIZE];
+
+	fseek(this->image, (long)block * HOST_SD_BLOCK_SIZE, SEEK_SET);
+	if (fread(data, 1, HOST_SD_BLOCK_SIZE, this->image) != HOST_SD_BLOCK_SIZE) return false;
+
+	/* The wait for the start token is where a slow card hurts, and interrupts keep running through it */
+	uint32_t wait = this->accessTime;
+
+	if ((this->spikeEvery > 0) && (((this->stats.blocksRead + 1) % this->spikeEvery) == 0))
+	{
+		wait += this->spikeTime;
+		this->stats.latencySpikes++;
+	}
+
+	if (wait > 0) HostHAL::get()->delayMicroseconds(wait);
+
+	/* Access time, start token, the data and a CRC nobody checks */
+	send(0xFF);
+	send(SD_DATA_START);
+	send(data, HOST_SD_BLOCK_SIZE);
+	send(0xFF);
+	send(0xFF);
+
+	this->stats.blocksRead++;
+	this->stats.dataBytes += HOST_SD_BLOCK_SIZE;
+
+	return true;
+}
+
+void HostSdCard::execute()
+{
+	uint8_t cmd = this->command[0] & 0x3F;
+	uint32_t arg = ((uint32_t)this->command[1] << 24) | ((uint32_t)this->command[2] << 16) | ((uint32_t)this->command[3] << 8) | this->command[4];
+	bool app = this->appCommand;
+
+	this->appCommand = false;
+	this->stats.commands[cmd]++;
+
+	/* Any command other than the stop ends a multiple block read, but nothing else should be sent during one */
+	if (this->streaming || (cmd == SD_CMD12))
+	{
+		this->streaming = false;
+		this->outputLength = 0;
+	}
+
+	if (app && (cmd == SD_ACMD41))
+	{
+		respond(SD_R1_READY);
+		return;
+	}
+
+	switch (cmd)
+	{
+		case SD_CMD0:
+			respond(SD_R1_IDLE);
+			break;
+
+		case SD_CMD8:
+			/* R7 echoes the voltage and check pattern */
+			respond(SD_R1_IDLE);
+			send(0x00);
+			send(0x00);
+			send(arg >> 8);
+			send(arg);
+			break;
+
+		case SD_CMD55:
+			this->appCommand = true;
+			respond(SD_R1_IDLE);
+			break;
+
+		case SD_CMD58:
+			/* Powered up and high capacity */
+			respond(SD_R1_READY);
+			send(0xC0);
+			send(0xFF);
+			send(0x80);
+			send(0x00);
+			break;
+
+		case SD_CMD9:
+		{
+			/* CSD version 2, C_SIZE is in 512KB units */
+			uint32_t csize = (this->blocks >> 10) - 1;
+			uint8_t csd[16] = { 0x40, 0x0E, 0x00, 0x32, 0x5B, 0x59, 0x00, (uint8_t)((csize >> 16) & 0x3F), (uint8_t)(csize >> 8), (uint8_t)csize, 0x7F, 0x80, 0x0A, 0x40, 0x00, 0x01 };
+
+			respond(SD_R1_READY);
+			send(0xFF);
+			send(SD_DATA_START);
+			send(csd, 16);
+			send(0xFF);
+			send(0xFF);
+			break;
+		}
+
+		case SD_CMD10:
+		{
+			uint8_t cid[16] = { 0 };
+
+			respond(SD_R1_READY);
+			send(0xFF);
+			send(SD_DATA_START);
+			send(cid, 16);
+			send(0xFF);
+			send(0xFF);
+			break;
+		}
+
+		case SD_CMD12:
+			/* Stuff byte, then R1 */
+			send(0xFF);
+			send(SD_R1_READY);
+			break;
+
+		case SD_CMD13:
+			respond(SD_R1_READY);
+			send(0x00);
+			break;
+
+		case SD_CMD17:
+			if (arg >= this->blocks)
+			{
+				respond(SD_R1_ADDRESS);
+				break;
+			}
+
+			respond(SD_R1_READY);
+			queueBlock(arg);
+			break;
+
+		case SD_CMD18:
+			if (arg >= this->blocks)
+			{
+				respond(SD_R1_ADDRESS);
+				break;
+			}
+
+			respond(SD_R1_READY);
+			this->streaming = true;
+			this->streamBlock = arg;
+			break;
+
+		case SD_CMD24:
+			if (arg >= this->blocks)
+			{
+				respond(SD_R1_ADDRESS);
+				break;
+			}
+
+			respond(SD_R1_READY);
+			this->writing = true;
+			this->writeLength = -1;
+			this->writeBlock = arg;
+			break;
+
+		default:
+			respond(SD_R1_ILLEGAL);
+			break;
+	}
+}
+
+void HostSdCard::receive(uint8_t data)
+{
+	/* Wait for the start token */
+	if (this->writeLength < 0)
+	{
+		if (data == SD_DATA_START) this->writeLength = 0;
+		return;
+	}
+
+	this->writeBuffer[this->writeLength++] = data;
+
+	if (this->writeLength == HOST_SD_BLOCK_SIZE + 2)
+	{
+		fseek(this->image, (long)this->writeBlock * HOST_SD_BLOCK_SIZE, SEEK_SET);
+		fwrite(this->writeBuffer, 1, HOST_SD_BLOCK_SIZE, this->image);
+		fflush(this->image);
+
+		this->stats.blocksWritten++;
+		this->stats.dataBytes += HOST_SD_BLOCK_SIZE;
+
+		/* The data response comes on the byte after the CRC, then one busy byte while it programs */
+		this->writing = false;
+		send(0xFF);
+		send(SD_DATA_ACCEPTED);
+		send(0x00);
+	}
+}
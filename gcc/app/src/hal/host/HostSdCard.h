@@ -0,0 +1,110 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+
+	A card in SPI mode backed by a raw disk image, so that firmware can read its
+	programs and loops under 'make host'. It answers the commands Sd2Card uses and
+	counts them, along with the data moved, so that SD traffic can be measured.
+	It always reports itself as SDHC, so every address is a block number.
+
+*/
+
+#ifndef HostSdCard_h
+#define HostSdCard_h
+
+#include "HostHAL.h"
+#include <stdio.h>
+
+#define HOST_SD_BLOCK_SIZE 512
+#define HOST_SD_COMMANDS 64
+
+/* Room for a data block with its gap, token and CRC, plus a response */
+#define HOST_SD_OUTPUT_SIZE (HOST_SD_BLOCK_SIZE + 32)
+
+namespace nw2s
+{
+	class HostSdCard;
+
+	typedef struct
+	{
+		uint32_t commands[HOST_SD_COMMANDS];
+		uint32_t blocksRead;
+		uint32_t blocksWritten;
+		uint32_t dataBytes;
+		uint32_t latencySpikes;
+	}
+	HostSdStats;
+}
+
+class nw2s::HostSdCard : public nw2s::HostSpiDevice
+{
+	public:
+		/* Attaches a card to the chip select if the image can be opened */
+		static HostSdCard* attach(int cspin, const char* imagepath);
+
+		HostSdCard(FILE* image);
+		virtual ~HostSdCard();
+
+		virtual void select();
+		virtual void deselect();
+		virtual uint8_t transfer(uint8_t data);
+
+		HostSdStats stats;
+		void resetStats();
+
+		/* Time the card takes to find each block, with every nth one taking much longer */
+		void setAccessTime(uint32_t us);
+		void setLatencySpikes(uint32_t every, uint32_t us);
+
+	private:
+		FILE* image;
+		uint32_t blocks;
+
+		uint32_t accessTime;
+		uint32_t spikeEvery;
+		uint32_t spikeTime;
+
+		uint8_t output[HOST_SD_OUTPUT_SIZE];
+		int outputHead;
+		int outputLength;
+		uint8_t command[6];
+		int commandLength;
+		bool appCommand;
+
+		/* CMD18 keeps sending blocks until CMD12 */
+		bool streaming;
+		uint32_t streamBlock;
+
+		/* CMD24 waits for a start token and then 512 bytes and a CRC */
+		bool writing;
+		int writeLength;
+		uint32_t writeBlock;
+		uint8_t writeBuffer[HOST_SD_BLOCK_SIZE + 2];
+
+		void execute();
+		void send(uint8_t data);
+		void send(const uint8_t* data, int length);
+		void respond(uint8_t r1);
+		bool queueBlock(uint32_t block);
+		void receive(uint8_t data);
+};
+
+#endif
@@ -0,0 +1,62 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Host stand-in for the SAM SPI library. Chip selects are plain GPIO, so the HAL routes each byte to whichever device has its CS low. */
+
+#ifndef _SPI_H_INCLUDED
+#define _SPI_H_INCLUDED
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0x02
+#define SPI_MODE1 0x00
+#define SPI_MODE2 0x03
+#define SPI_MODE3 0x01
+
+#define BOARD_SPI_DEFAULT_SS 78
+
+enum SPITransferMode {
+	SPI_CONTINUE,
+	SPI_LAST
+};
+
+class SPIClass 
+{
+	public:
+		byte transfer(uint8_t _data, SPITransferMode _mode = SPI_LAST) { return transfer(BOARD_SPI_DEFAULT_SS, _data, _mode); }
+		byte transfer(byte _channel, uint8_t _data, SPITransferMode _mode = SPI_LAST);
+
+		void begin(void) {}
+		void end(void) {}
+		void begin(uint8_t _pin) {}
+		void end(uint8_t _pin) {}
+
+		void setBitOrder(uint8_t _pin, BitOrder) {}
+		void setDataMode(uint8_t _pin, uint8_t) {}
+		void setClockDivider(uint8_t _pin, uint8_t) {}
+
+		void setBitOrder(BitOrder _order) { setBitOrder(BOARD_SPI_DEFAULT_SS, _order); };
+		void setDataMode(uint8_t _mode) { setDataMode(BOARD_SPI_DEFAULT_SS, _mode); };
+		void setClockDivider(uint8_t _div) { setClockDivider(BOARD_SPI_DEFAULT_SS, _div); };
+};
+
+extern SPIClass SPI;
+
+#endif
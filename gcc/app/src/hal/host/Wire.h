@@ -0,0 +1,75 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Host stand-in for the SAM Wire library. Master mode only - transmissions are handed to the HAL whole on endTransmission(). */
+
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include "Arduino.h"
+#include "Stream.h"
+
+#define BUFFER_LENGTH 32
+
+class TwoWire : public Stream 
+{
+	public:
+		TwoWire(uint8_t bus);
+		void begin() {}
+		void begin(uint8_t) {}
+		void begin(int) {}
+		void setClock(uint32_t) {}
+		void beginTransmission(uint8_t);
+		void beginTransmission(int);
+		uint8_t endTransmission(void);
+		uint8_t endTransmission(uint8_t);
+		uint8_t requestFrom(uint8_t, uint8_t);
+		uint8_t requestFrom(uint8_t, uint8_t, uint8_t);
+		uint8_t requestFrom(int, int);
+		uint8_t requestFrom(int, int, int);
+		virtual size_t write(uint8_t);
+		virtual size_t write(const uint8_t *, size_t);
+		virtual int available(void);
+		virtual int read(void);
+		virtual int peek(void);
+		virtual void flush(void) {}
+
+		inline size_t write(unsigned long n) { return write((uint8_t)n); }
+		inline size_t write(long n) { return write((uint8_t)n); }
+		inline size_t write(unsigned int n) { return write((uint8_t)n); }
+		inline size_t write(int n) { return write((uint8_t)n); }
+		using Print::write;
+
+	private:
+		uint8_t bus;
+
+		uint8_t rxBuffer[BUFFER_LENGTH];
+		uint8_t rxBufferIndex;
+		uint8_t rxBufferLength;
+
+		uint8_t txAddress;
+		uint8_t txBuffer[BUFFER_LENGTH];
+		uint8_t txBufferLength;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif
@@ -0,0 +1,92 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+
+	Host stand-in for libsam's USB_host.h and the uhd_* register macros used by
+	drivers/usbhost/Usb.cpp. The simulated controller never sees VBUS, so the USB
+	host stack compiles and runs but no device ever enumerates.
+
+*/
+
+#ifndef UOTGHS_HOST_H_INCLUDED
+#define UOTGHS_HOST_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_ENDPOINTS	10
+
+#define UOTGHS_HSTPIPCFG_PBK_1_BANK (0x0u << 2)
+#define UOTGHS_HSTPIPCFG_PBK_2_BANK (0x1u << 2)
+#define UOTGHS_HSTPIPCFG_PTOKEN_SETUP (0x0u << 8)
+#define UOTGHS_HSTPIPCFG_PTOKEN_IN (0x1u << 8)
+#define UOTGHS_HSTPIPCFG_PTOKEN_OUT (0x2u << 8)
+#define UOTGHS_HSTPIPCFG_PTYPE_CTRL (0x0u << 12)
+#define UOTGHS_HSTPIPCFG_PTYPE_ISO (0x1u << 12)
+#define UOTGHS_HSTPIPCFG_PTYPE_BLK (0x2u << 12)
+#define UOTGHS_HSTPIPCFG_PTYPE_INTRPT (0x3u << 12)
+
+#define tokSETUP		UOTGHS_HSTPIPCFG_PTOKEN_SETUP
+#define tokIN			UOTGHS_HSTPIPCFG_PTOKEN_IN
+#define tokOUT			UOTGHS_HSTPIPCFG_PTOKEN_OUT
+#define tokINHS			UOTGHS_HSTPIPCFG_PTOKEN_IN
+#define tokOUTHS		UOTGHS_HSTPIPCFG_PTOKEN_OUT
+
+typedef enum {
+	UHD_STATE_NO_VBUS = 0,
+	UHD_STATE_DISCONNECTED = 1,
+	UHD_STATE_CONNECTED = 2,
+	UHD_STATE_ERROR = 3,
+} uhd_vbus_state_t;
+
+extern void UHD_SetStack(void (*pf_isr)(void));
+extern void UHD_Init(void);
+extern void UHD_BusReset(void);
+extern uhd_vbus_state_t UHD_GetVBUSState(void);
+extern uint32_t UHD_Pipe0_Alloc(uint32_t ul_add, uint32_t ul_ep_size);
+extern uint32_t UHD_Pipe_Alloc(uint32_t ul_dev_addr, uint32_t ul_dev_ep, uint32_t ul_type, uint32_t ul_dir, uint32_t ul_maxsize, uint32_t ul_interval, uint32_t ul_nb_bank);
+extern void UHD_Pipe_Free(uint32_t ul_pipe);
+extern uint32_t UHD_Pipe_Read(uint32_t ul_pipe, uint32_t ul_size, uint8_t* data);
+extern void UHD_Pipe_Write(uint32_t ul_pipe, uint32_t ul_size, uint8_t* data);
+extern void UHD_Pipe_Send(uint32_t ul_pipe, uint32_t ul_token_type);
+extern uint32_t UHD_Pipe_Is_Transfer_Complete(uint32_t ul_pipe, uint32_t ul_token_type);
+
+extern uint32_t uhd_host_pipe_byte_count(uint32_t ul_pipe);
+
+#define uhd_configure_address(p, addr)
+#define uhd_configure_pipe_token(p, token)
+#define uhd_freeze_pipe(p)
+#define uhd_byte_count(p)						uhd_host_pipe_byte_count(p)
+#define Is_uhd_nak_received(p)					(0)
+#define uhd_ack_nak_received(p)
+#define Is_uhd_reset_sent()						(1)
+#define uhd_ack_reset_sent()
+#define uhd_enable_sof()
+#define Is_uhd_sof()							(1)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
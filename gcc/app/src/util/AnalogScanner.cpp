@@ -0,0 +1,185 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "AnalogScanner.h"
+#include <Arduino.h>
+
+using namespace nw2s;
+
+/* Which input is on each ADC channel, the reverse of INDEX_DUE_ADC_CHANNEL */
+static const int8_t ADC_CHANNEL_INPUT[16] = { 7, 6, 5, 4, 3, 2, 1, 0, -1, -1, 8, 9, 10, 11, -1, -1 };
+
+volatile bool AnalogScanner::running = false;
+uint16_t AnalogScanner::scan[2][ANALOG_SCAN_CHANNELS * ANALOG_SCAN_OVERSAMPLE];
+int AnalogScanner::scanNext = 0;
+int32_t AnalogScanner::filtered[ANALOG_SCAN_CHANNELS];
+uint8_t AnalogScanner::filters[ANALOG_SCAN_CHANNELS];
+uint16_t AnalogScanner::snapshots[2][ANALOG_SCAN_CHANNELS];
+volatile int AnalogScanner::current = 0;
+volatile uint32_t AnalogScanner::snapshotCount = 0;
+uint16_t* volatile AnalogScanner::streams[ANALOG_SCAN_CHANNELS];
+volatile uint32_t AnalogScanner::streamHeads[ANALOG_SCAN_CHANNELS];
+
+
+void AnalogScanner::begin()
+{
+	if (AnalogScanner::running) return;
+
+	/* Start from a single conversion of each input so nothing has to climb up from zero */
+	for (int i = 0; i < ANALOG_SCAN_CHANNELS; i++)
+	{
+		uint16_t value = ::analogRead(INDEX_DUE_INPUT[i]);
+
+		AnalogScanner::filtered[i] = value << 4;
+		AnalogScanner::filters[i] = ANALOG_SCAN_FILTER;
+		AnalogScanner::snapshots[0][i] = value;
+		AnalogScanner::snapshots[1][i] = value;
+	}
+
+	uint32_t channels = 0;
+
+	for (int i = 0; i < ANALOG_SCAN_CHANNELS; i++) channels |= 1 << INDEX_DUE_ADC_CHANNEL[i];
+
+	/* A 6MHz ADC clock makes a conversion about 4uS, so a snapshot comes around every 770uS */
+	pmc_enable_periph_clk(ID_ADC);
+	ADC->ADC_CR = ADC_CR_SWRST;
+	ADC->ADC_MR = ADC_MR_TRGEN_DIS | ADC_MR_LOWRES_BITS_12 | ADC_MR_FREERUN_ON | ADC_MR_PRESCAL(6) | ADC_MR_STARTUP_SUT64 | ADC_MR_SETTLING_AST3 | ADC_MR_TRACKTIM(3) | ADC_MR_TRANSFER(1);
+	ADC->ADC_EMR = ADC_EMR_TAG;
+	ADC->ADC_CHDR = 0xFFFF;
+	ADC->ADC_CHER = channels;
+
+	ADC->ADC_RPR = (uintptr_t)AnalogScanner::scan[0];
+	ADC->ADC_RCR = ANALOG_SCAN_CHANNELS * ANALOG_SCAN_OVERSAMPLE;
+	ADC->ADC_RNPR = (uintptr_t)AnalogScanner::scan[1];
+	ADC->ADC_RNCR = ANALOG_SCAN_CHANNELS * ANALOG_SCAN_OVERSAMPLE;
+	AnalogScanner::scanNext = 0;
+
+	ADC->ADC_IDR = 0xFFFFFFFF;
+	ADC->ADC_IER = ADC_IER_ENDRX;
+	NVIC_EnableIRQ(ADC_IRQn);
+	ADC->ADC_PTCR = ADC_PTCR_RXTEN;
+	ADC->ADC_CR = ADC_CR_START;
+
+	AnalogScanner::running = true;
+}
+
+bool AnalogScanner::isRunning()
+{
+	return AnalogScanner::running;
+}
+
+void AnalogScanner::block_handler()
+{
+	/* The buffer that just filled is ours until it's queued up again */
+	uint16_t* block = AnalogScanner::scan[AnalogScanner::scanNext];
+	uint32_t sums[ANALOG_SCAN_CHANNELS] = { 0 };
+
+	/* Every sample is tagged with its channel, so a dropped conversion can't shift the others */
+	for (int i = 0; i < ANALOG_SCAN_CHANNELS * ANALOG_SCAN_OVERSAMPLE; i++)
+	{
+		int input = ADC_CHANNEL_INPUT[block[i] >> ADC_LCDR_CHNB_Pos];
+
+		if (input < 0) continue;
+
+		uint16_t value = block[i] & ADC_LCDR_LDATA_Msk;
+
+		sums[input] += value;
+
+		if (AnalogScanner::streams[input] != NULL)
+		{
+			AnalogScanner::streams[input][AnalogScanner::streamHeads[input] & (ANALOG_STREAM_SIZE - 1)] = value;
+			AnalogScanner::streamHeads[input]++;
+		}
+	}
+
+	ADC->ADC_RNPR = (uintptr_t)block;
+	ADC->ADC_RNCR = ANALOG_SCAN_CHANNELS * ANALOG_SCAN_OVERSAMPLE;
+	AnalogScanner::scanNext ^= 1;
+
+	/* Filter into the snapshot nobody is reading, then swap */
+	uint16_t* snapshot = AnalogScanner::snapshots[AnalogScanner::current ^ 1];
+
+	for (int i = 0; i < ANALOG_SCAN_CHANNELS; i++)
+	{
+		int32_t average = (sums[i] << 4) / ANALOG_SCAN_OVERSAMPLE;
+
+		AnalogScanner::filtered[i] += (average - AnalogScanner::filtered[i]) >> AnalogScanner::filters[i];
+		snapshot[i] = (AnalogScanner::filtered[i] + 8) >> 4;
+	}
+
+	AnalogScanner::current ^= 1;
+	AnalogScanner::snapshotCount++;
+}
+
+int AnalogScanner::read(int input)
+{
+	if ((input < 0) || (input >= ANALOG_SCAN_CHANNELS)) return 0;
+
+	return AnalogScanner::snapshots[AnalogScanner::current][input];
+}
+
+void AnalogScanner::setFilter(int input, int shift)
+{
+	if ((input < 0) || (input >= ANALOG_SCAN_CHANNELS)) return;
+
+	AnalogScanner::filters[input] = (shift < 0) ? 0 : (shift > ANALOG_SCAN_FILTER_MAX) ? ANALOG_SCAN_FILTER_MAX : shift;
+}
+
+uint32_t AnalogScanner::getSnapshotCount()
+{
+	return AnalogScanner::snapshotCount;
+}
+
+void AnalogScanner::stream(int input)
+{
+	if ((input < 0) || (input >= ANALOG_SCAN_CHANNELS) || (AnalogScanner::streams[input] != NULL)) return;
+
+	uint16_t* ring = new uint16_t[ANALOG_STREAM_SIZE];
+
+	memset(ring, 0, ANALOG_STREAM_SIZE * sizeof(uint16_t));
+
+	/* The handler starts filling it as soon as it's there */
+	AnalogScanner::streams[input] = ring;
+}
+
+int AnalogScanner::readStream(int input, uint32_t* position, uint16_t* target, int samples)
+{
+	if ((input < 0) || (input >= ANALOG_SCAN_CHANNELS) || (AnalogScanner::streams[input] == NULL)) return 0;
+
+	const uint16_t* ring = AnalogScanner::streams[input];
+	uint32_t head = AnalogScanner::streamHeads[input];
+
+	/* A reader that fell behind skips ahead, leaving room for a scan to land while it copies */
+	if (head - *position > (uint32_t)(ANALOG_STREAM_SIZE - ANALOG_SCAN_OVERSAMPLE))
+	{
+		*position = head - (ANALOG_STREAM_SIZE - ANALOG_SCAN_OVERSAMPLE);
+	}
+
+	int count = ((head - *position) < (uint32_t)samples) ? head - *position : samples;
+
+	for (int i = 0; i < count; i++)
+	{
+		target[i] = ring[(*position + i) & (ANALOG_STREAM_SIZE - 1)];
+	}
+
+	*position += count;
+
+	return count;
+}
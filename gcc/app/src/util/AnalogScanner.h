@@ -0,0 +1,89 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef AnalogScanner_h
+#define AnalogScanner_h
+
+#include "IO.h"
+
+namespace nw2s
+{
+	static const int ANALOG_SCAN_CHANNELS = 12;
+
+	/* Passes over all of the inputs that are averaged into each snapshot */
+	static const int ANALOG_SCAN_OVERSAMPLE = 16;
+
+	/* Each snapshot moves an input 1/2^n of the way to its new value. 0 is no filtering. */
+	static const int ANALOG_SCAN_FILTER = 2;
+	static const int ANALOG_SCAN_FILTER_MAX = 8;
+
+	/* An input that's streamed keeps its last this many conversions, about 12mS of them */
+	static const int ANALOG_STREAM_SIZE = 256;
+
+	class AnalogScanner;
+}
+
+/*
+
+	The ADC free runs over all 12 inputs and the PDC drains each pass into one of a pair
+	of scan buffers. When a buffer fills, ADC_Handler averages its passes, runs each input
+	through a one pole filter and publishes the result as the other half of a double 
+	buffered snapshot. Reading an input is then an array read that never waits on the ADC.
+
+	An input can also be streamed, for following audio rather than reading CV. Then every
+	conversion of it, about 20k a second, goes into a ring that readers pick up from at
+	their own pace.
+
+	Once the scanner is running, nothing else may call ::analogRead(), which reprograms
+	the ADC for a single conversion.
+
+*/
+
+class nw2s::AnalogScanner
+{
+	public:
+		static void begin();
+		static bool isRunning();
+		static void block_handler();
+
+		/* The latest filtered value for an input, uninverted like ::analogRead() */
+		static int read(int input);
+		static void setFilter(int input, int shift);
+		static uint32_t getSnapshotCount();
+
+		/* Starts keeping every conversion of an input. readStream() copies out the ones since position and moves it on. */
+		static void stream(int input);
+		static int readStream(int input, uint32_t* position, uint16_t* target, int samples);
+
+	private:
+		static volatile bool running;
+		static uint16_t scan[2][ANALOG_SCAN_CHANNELS * ANALOG_SCAN_OVERSAMPLE];
+		static int scanNext;
+		static int32_t filtered[ANALOG_SCAN_CHANNELS];
+		static uint8_t filters[ANALOG_SCAN_CHANNELS];
+		static uint16_t snapshots[2][ANALOG_SCAN_CHANNELS];
+		static volatile int current;
+		static volatile uint32_t snapshotCount;
+		static uint16_t* volatile streams[ANALOG_SCAN_CHANNELS];
+		static volatile uint32_t streamHeads[ANALOG_SCAN_CHANNELS];
+};
+
+
+#endif
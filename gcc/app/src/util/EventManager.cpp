@@ -21,6 +21,7 @@
 #include "b.h"
 #include "EventManager.h"
 #include "IO.h"
+#include "SignalData.h"
 #include <Arduino.h>
 #include <Reset.h>
 #include <usbhost/Usb.h>
@@ -30,6 +31,8 @@ using namespace nw2s;
 
 volatile unsigned long EventManager::t = 0UL;
 vector<TimeBasedDevice *> EventManager::timedevices;
+TimerWheel EventManager::timerWheel;
+vector<TimeBasedDevice *> EventManager::duedevices;
 UsbBasedDevice* EventManager::usbDevice = NULL;
 USBHost EventManager::usbHost;
 
@@ -37,6 +40,11 @@ USBHost EventManager::usbHost;
 String inputString = "";         
 bool stringComplete = false;
 
+unsigned long TimeBasedDevice::nextWake(unsigned long t)
+{
+	return t + 1;
+}
+
 void UsbBasedDevice::task()
 {
 	this->pUsb->Task();
@@ -55,14 +63,30 @@ void EventManager::loop()
 	/* fire events if the clock has changed. */
 	unsigned long current_time = millis();
 	
+	/* CV outputs written by any device this pass are latched together at the end */
+	AnalogOut::beginFrame();
+
 	if (t != current_time)
 	{ 		
 		t = current_time;
 				
-		for (int i = 0; i < EventManager::timedevices.size(); i++)
+		for (unsigned int i = 0; i < EventManager::timedevices.size(); i++)
 		{
 			EventManager::timedevices[i]->timer(EventManager::t);	
 		}
+		
+		/* Scheduled devices only run when they said they would */
+		EventManager::timerWheel.advance(EventManager::t, EventManager::duedevices);
+		
+		for (unsigned int i = 0; i < EventManager::duedevices.size(); i++)
+		{
+			TimeBasedDevice* device = EventManager::duedevices[i];
+			
+			device->timer(EventManager::t);
+			EventManager::timerWheel.add(device, device->nextWake(EventManager::t));
+		}
+		
+		EventManager::duedevices.clear();
 	}
 	
 	if (usbDevice != NULL)
@@ -70,6 +94,11 @@ void EventManager::loop()
 		usbDevice->task();
 	}
 
+	AnalogOut::endFrame();
+
+	/* The output LEDs catch up in the background, never from the CV path */
+	if (IOUtils::enableLED) AnalogOut::ledDriver.update(current_time);
+
 	if (stringComplete)
 	{
 		if (inputString == "ERASEANDRESET")
@@ -88,6 +117,11 @@ void EventManager::loop()
 			Serial.println("Received command: " + inputString);
 			b::debugMode = false;
 		}
+		else if (inputString == "STREAMS")
+		{
+			Serial.println("Received command: " + inputString);
+			StreamingSignalData::printStats();
+		}
 		else
 		{
 			Serial.println("Unknown command: " + inputString);
@@ -103,6 +137,12 @@ void EventManager::registerDevice(TimeBasedDevice* device)
 	timedevices.push_back(device);
 }
 
+void EventManager::scheduleDevice(TimeBasedDevice* device)
+{
+	/* Scheduled devices start on the next tick and tell us when they want to run after that */
+	timerWheel.add(device, t + 1);
+}
+
 void EventManager::registerUsbDevice(UsbBasedDevice* device)
 {
 	EventManager::usbDevice = device;
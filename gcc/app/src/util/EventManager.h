@@ -24,6 +24,7 @@
 #include <iterator>
 #include <vector>
 #include <usbhost/Usb.h>
+#include "TimerWheel.h"
 
 using namespace std;
 
@@ -38,6 +39,10 @@ class nw2s::TimeBasedDevice
 {
 	public:
 		virtual void timer(unsigned long t) = 0;
+		
+		/* Called after timer(t) on scheduled devices to find out when they next need to run. */
+		/* The default is every millisecond, override it if you know better. */
+		virtual unsigned long nextWake(unsigned long t);
 };
 
 class nw2s::UsbBasedDevice
@@ -54,6 +59,7 @@ class nw2s::EventManager
 	public:
 		static void initialize();
  		static void registerDevice(TimeBasedDevice* device);
+		static void scheduleDevice(TimeBasedDevice* device);
 		static void registerUsbDevice(UsbBasedDevice* usbDevice);
 		static void loop();
 		static unsigned long getT();
@@ -62,6 +68,8 @@ class nw2s::EventManager
 	private:
 		static volatile unsigned long t;
 		static vector<TimeBasedDevice*> timedevices;		
+		static TimerWheel timerWheel;
+		static vector<TimeBasedDevice*> duedevices;
 
 		//TODO: This is too specific - need to encapsulate only USB device
 		static UsbBasedDevice* usbDevice;
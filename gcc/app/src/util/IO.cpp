@@ -25,6 +25,7 @@
 #include "pwm/pca9685.h"
 #include <dac/mcp4822.h>
 #include "IO.h"
+#include "AnalogScanner.h"
 
 using namespace nw2s;
 
@@ -34,6 +35,18 @@ int limitRange(int val, int min, int max)
 	return (val < min) ? min : (val > max) ? max : val;
 }
 
+/* Calibrated raw value is (raw * gain + bias) >> 16 - the identity until compileInputTune() says otherwise */
+static int32_t inputGain[12] = { 65536, 65536, 65536, 65536, 65536, 65536, 65536, 65536, 65536, 65536, 65536, 65536 };
+static int32_t inputBias[12] = { 32768, 32768, 32768, 32768, 32768, 32768, 32768, 32768, 32768, 32768, 32768, 32768 };
+
+static inline int calibratedRead(int input)
+{
+	/* Get the Raw value, from the latest scan if the ADC is free running */
+	int32_t raw = AnalogScanner::isRunning() ? AnalogScanner::read(input) : ::analogRead(INDEX_DUE_INPUT[input]);
+
+	return limitRange(((raw * inputGain[input]) + inputBias[input]) >> 16, 0, 4095);
+}
+
 int nw2s::analogRead(int input)
 {
 	if (input == ANALOG_IN_NONE)
@@ -41,16 +54,8 @@ int nw2s::analogRead(int input)
 		return 0;
 	}
 	
-	/* Get the Raw value */
-	int32_t val = 4095 - ::analogRead(INDEX_DUE_INPUT[input]);
-	
-	// if (!b::inputSoftTune)
-	// {
-		return limitRange(val, 0, 4095);
-	// }
-	
-	/* Adjust the offset and gain */
-	//return limitRange(((val * b::inputScale[input]) / 1000) + b::inputOffset[input], 0, 4095);
+	/* Inputs are inverted */
+	return 4095 - calibratedRead(input);
 }
 
 int nw2s::analogReadmV(int input)
@@ -60,14 +65,8 @@ int nw2s::analogReadmV(int input)
 		return 0;
 	}
 
-	/* Get the value from ADC, inverted */
-	int val = ::analogRead(input);
-
-	/* Make sure we're 0 - 4095 */
-	int normalval = (val > 4095) ? 4095 : ((val < 0) ? 0 : val);
-	
-	/* Convert to voltage */
-	return ANALOG_INPUT_TRANSLATION[normalval];
+	/* Convert to voltage, the table takes care of the inversion */
+	return ANALOG_INPUT_TRANSLATION[calibratedRead(input)];
 }
 
 int nw2s::analogReadmV(int input, int min, int max)
@@ -86,6 +85,12 @@ AnalogOut* AnalogOut::create(PinAnalogOut out)
 }
 
 PCA9685 AnalogOut::ledDriver;
+AnalogOut* AnalogOut::outputs[16] = { NULL };
+volatile int16_t AnalogOut::frameValues[16];
+int16_t AnalogOut::latchedValues[16] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+volatile uint16_t AnalogOut::frameDirty = 0;
+volatile int AnalogOut::frameDepth = 0;
+volatile bool AnalogOut::flushing = false;
 
 AnalogOut::AnalogOut(PinAnalogOut pin)
 {
@@ -110,6 +115,104 @@ AnalogOut::AnalogOut(PinAnalogOut pin)
 	//this->spidac.setGain1X(this->spidac_index);						
 	//this->spidac.setGain1X(this->spidac_index);						
 	this->spidac.setGain2X_AB();						
+
+	AnalogOut::outputs[pin] = this;
+	AnalogOut::latchedValues[pin] = -1;
+}
+
+int32_t AnalogOut::tuneBase[16][21];
+int16_t AnalogOut::tuneSlope[16][21];
+
+void AnalogOut::compileSoftTune()
+{
+	/* Each 1V range starts at its corner's offset (x1000) and moves toward the next corner by a fixed step per mV */
+	for (int pin = 0; pin < 16; pin++)
+	{
+		for (int i = 0; i < 21; i++)
+		{
+			AnalogOut::tuneBase[pin][i] = b::outputOffset[pin][i] * TUNE_SCALE_FACTOR;
+			AnalogOut::tuneSlope[pin][i] = (i < 20) ? b::outputOffset[pin][i + 1] - b::outputOffset[pin][i] : 0;
+		}
+	}
+}
+
+void AnalogOut::beginFrame()
+{
+	AnalogOut::frameDepth++;
+}
+
+void AnalogOut::endFrame()
+{
+	if (AnalogOut::frameDepth > 0) AnalogOut::frameDepth--;
+
+	if (AnalogOut::frameDepth == 0) AnalogOut::flush();
+}
+
+void AnalogOut::stage(int dacval)
+{
+	/* The beat interrupt stages values too, so the dirty mask only changes with interrupts off */
+	noInterrupts();
+
+	AnalogOut::frameValues[this->pin] = dacval;
+
+	/* Nothing goes over the bus for a channel that already holds this value */
+	if (dacval != AnalogOut::latchedValues[this->pin])
+	{
+		AnalogOut::frameDirty |= 1 << this->pin;
+	}
+	else
+	{
+		AnalogOut::frameDirty &= ~(1 << this->pin);
+	}
+
+	interrupts();
+
+	if (AnalogOut::frameDepth == 0) AnalogOut::flush();
+}
+
+void AnalogOut::flush()
+{
+	/* An interrupt that stages something while we're on the bus leaves it for the loop below */
+	if (AnalogOut::flushing) return;
+
+	AnalogOut::flushing = true;
+
+	while (AnalogOut::frameDirty != 0)
+	{
+		int16_t values[16];
+
+		noInterrupts();
+
+		uint16_t dirty = AnalogOut::frameDirty;
+		AnalogOut::frameDirty = 0;
+
+		for (int i = 0; i < 16; i++)
+		{
+			if (dirty & (1 << i))
+			{
+				values[i] = AnalogOut::frameValues[i];
+				AnalogOut::latchedValues[i] = values[i];
+			}
+		}
+
+		interrupts();
+
+		AnalogOut* last = NULL;
+
+		/* Load every dirty input register, then one pulse on the shared LDAC moves them all at once */
+		for (int i = 0; i < 16; i++)
+		{
+			if (dirty & (1 << i))
+			{
+				last = AnalogOut::outputs[i];
+				last->spidac.write(last->spidac_index, values[i]);
+			}
+		}
+
+		last->spidac.latch();
+	}
+
+	AnalogOut::flushing = false;
 }
 
 void AnalogOut::outputCV(int cv)
@@ -136,144 +239,17 @@ void AnalogOut::outputCV(int cv, bool softTune)
 	{
 		//TODO: Make this work for any voltage range - high or low
 
-		int8_t rangeIndex = -1;
-		int bottomRange = 0;
+		/* Find the 1V range we're in and interpolate between its two tune corners */
+		int clamped = (cv < -10000) ? -10000 : (cv > 10000) ? 10000 : cv;
+		int rangeIndex = (clamped + 10000) / 1000;
+		int position = (clamped + 10000) - (rangeIndex * 1000);
+		int offset = (AnalogOut::tuneBase[this->pin][rangeIndex] + (AnalogOut::tuneSlope[this->pin][rangeIndex] * position)) / TUNE_SCALE_FACTOR;
 
-		/* Find out what range we're in */
-		if (cv < -10000) cv = -10000;
-		if (cv > 10000) cv = 10000;
-		
-		if ((cv - -10000) * (-9001 - cv) >= 0)
-		{
-			rangeIndex = 0;
-			bottomRange = -10000;
-		}
-		else if ((cv - -9000) * (-8001 - cv) >= 0)
-		{
-			rangeIndex = 1;
-			bottomRange = -9000;
-		}
-		else if ((cv - -8000) * (-7001 - cv) >= 0)
-		{
-			rangeIndex = 2;
-			bottomRange = -8000;
-		}
-		else if ((cv - -7000) * (-6001 - cv) >= 0)
-		{
-			rangeIndex = 3;
-			bottomRange = -7000;
-		}
-		else if ((cv - -6000) * (-5001 - cv) >= 0)
-		{
-			rangeIndex = 4;
-			bottomRange = -6000;
-		}
-		else if ((cv - -5000) * (-4001 - cv) >= 0)
-		{
-			rangeIndex = 5;
-			bottomRange = -5000;
-		}
-		else if ((cv - -4000) * (-3001 - cv) >= 0)
-		{
-			rangeIndex = 6;
-			bottomRange = -4000;
-		}
-		else if ((cv - -3000) * (-2001 - cv) >= 0)
-		{
-			rangeIndex = 7;
-			bottomRange = -3000;
-		}
-		else if ((cv - -2000) * (-1001 - cv) >= 0)
-		{
-			rangeIndex = 8;
-			bottomRange = -2000;
-		}
-		else if ((cv - -1000) * (-1 - cv) >= 0)
-		{
-			rangeIndex = 9;
-			bottomRange = -1000;
-		}
-		else if ((cv - 0) * (999 - cv) >= 0)
-		{
-			rangeIndex = 10;
-			bottomRange = 0;
-		}
-		else if ((cv - 1000) * (1999 - cv) >= 0)
-		{
-			rangeIndex = 11;
-			bottomRange = 1000;
-		}
-		else if ((cv - 2000) * (2999 - cv) >= 0)
-		{
-			rangeIndex = 12;
-			bottomRange = 2000;
-		}
-		else if ((cv - 3000) * (3999 - cv) >= 0)
-		{
-			rangeIndex = 13;
-			bottomRange = 3000;
-		}
-		else if ((cv - 4000) * (4999 - cv) >= 0)
-		{
-			rangeIndex = 14;
-			bottomRange = 4000;
-		}
-		else if ((cv - 5000) * (5999 - cv) >= 0)
-		{
-			rangeIndex = 15;
-			bottomRange = 5000;
-		}
-		else if ((cv - 6000) * (6999 - cv) >= 0)
-		{
-			bottomRange = 6000;
-			rangeIndex = 16;
-		}
-		else if ((cv - 7000) * (7999 - cv) >= 0)
-		{
-			bottomRange = 7000;
-			rangeIndex = 17;
-		}
-		else if ((cv - 8000) * (8999 - cv) >= 0)
-		{
-			rangeIndex = 18;
-			bottomRange = 8000;
-		}
-		else if ((cv - 9000) * (9999 - cv) >= 0)
-		{
-			rangeIndex = 19;
-			bottomRange = 9000;
-		}
-		else if (cv == 10000)
-		{
-			rangeIndex = 20;
-		}
-		
-		/* Perform a linear interpolation of the two tune corners with the output voltage */
-		/* Not really a reasonable way to do this without about 5 FLOPs. Sorry folks! */
-		if (rangeIndex != 20)
-		{	
-			float alpha = (cv - bottomRange) / 1000.0;
-			float offset = ((1.0 - alpha) * b::outputOffset[this->pin][rangeIndex]) + (alpha * b::outputOffset[this->pin][rangeIndex + 1]);
-			cv = cv_old + (int)offset;
-
-			Serial.println(this->pin);
-
-			if (this->pin == 0)
-			{
-				Serial.println("---------------------------------");
-				Serial.println("alpha " + String((int)(alpha * 1000)));
-				Serial.println("bottomRange " + String(bottomRange));
-				Serial.println("start " + String(b::outputOffset[this->pin][rangeIndex]));
-				Serial.println("end " + String(b::outputOffset[this->pin][rangeIndex + 1]));
-			}
-		}
-		else
-		{
-			Serial.println("...");
-			cv = cv_old + b::outputOffset[this->pin][rangeIndex];
-		}
+		cv = cv_old + offset;
 
-		// cv = ((cv * b::outputScale[this->pin]) / TUNE_SCALE_FACTOR) + b::outputOffset[this->pin];
+#ifdef SOFTTUNE_TRACE
+		Serial.println("softTune " + String(this->pin) + " range " + String(rangeIndex) + " position " + String(position) + " offset " + String(offset));
+#endif
 	}
 
 	int dacval = b::cvGainMode ?
@@ -289,7 +265,7 @@ void AnalogOut::outputCV(int cv, bool softTune)
 	/* Make sure the values are in a 12bit unsigned range */
 	dacval = (dacval < 0) ? 0 : (dacval > 4095) ? 4095 : dacval;
 	
-	this->spidac.setValue(this->spidac_index, dacval);
+	this->stage(dacval);
 
 	if (b::debugMode) Serial.println("outputCV: " + String(dacval) + " " + String(cv) + " " + String(cv_old) + " " + (softTune ? "true" : "false"));
 
@@ -306,7 +282,7 @@ void AnalogOut::outputRaw(int x)
 	/* Make sure the values are in a 12bit unsigned range */
 	int dacval = (x < 0) ? 0 : (x > 4095) ? 4095 : x;
 	
-	this->spidac.setValue(this->spidac_index, dacval);
+	this->stage(dacval);
 
 	if (IOUtils::enableLED)
 	{
@@ -365,6 +341,10 @@ void IOUtils::setupPins()
 	Serial.println("analog read resolution: 12");
 	analogReadResolution(12);
 
+	/* From here on the ADC scans every input in the background */
+	Serial.println("analog input scanning");
+	AnalogScanner::begin();
+
 	/* Setup the I2C bus and LED driver */
 	Wire1.begin();
 	AnalogOut::ledDriver.begin(B000000, b::dimming);
@@ -406,6 +386,30 @@ void IOUtils::setupPins()
 
 }
 
+void IOUtils::compileInputTune()
+{
+	/* 
+
+	   Calibration is stored the way b::inputScale/inputOffset were always meant to be applied,
+	   on the inverted value: val' = (val * scale / 1000) + offset where val = 4095 - raw.
+	   
+	   Folding the inversion in gives raw' = raw * scale / 1000 + 4095 - (4095 * scale / 1000) - offset,
+	   which is kept as a 16.16 gain and bias so a calibrated read is one multiply-add.
+
+	*/
+	for (int i = 0; i < 12; i++)
+	{
+		int64_t scale = b::inputSoftTune ? b::inputScale[i] : 1000;
+		int64_t offset = b::inputSoftTune ? b::inputOffset[i] : 0;
+
+		int64_t bias = (4095 * (1000 - scale) - (offset * 1000)) * 65536;
+
+		/* Round both to nearest so the only error left is the final rounding */
+		inputGain[i] = ((scale << 16) + 500) / 1000;
+		inputBias[i] = ((bias + ((bias < 0) ? -500 : 500)) / 1000) + 32768;
+	}
+}
+
 void* IOUtils::clockinstance = NULL;
 bool IOUtils::enableLED = false;
 
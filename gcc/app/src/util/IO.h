@@ -76,6 +76,9 @@ namespace nw2s
 	};
 
 	static const uint32_t INDEX_DUE_INPUT[12] = { A0, A1, A2, A3, A4, A5, A6, A7, A8, A9, A10, A11 };
+
+	/* The SAM3X ADC channel behind each of A0 - A11 */
+	static const uint32_t INDEX_DUE_ADC_CHANNEL[12] = { 7, 6, 5, 4, 3, 2, 1, 0, 10, 11, 12, 13 };
 	
 	enum PinAnalogOut
 	{
@@ -4256,10 +4259,30 @@ class nw2s::AnalogOut
 		void outputCV(int v);
 		void outputCV(int v, bool softTune);
 		void outputRaw(int x);
+
+		/* Inside a frame, outputs are only staged and all change together on one LDAC pulse at endFrame(). */
+		/* The clock's beat interrupt stages outputs too - if it lands inside a frame they go out with it. */
+		static void beginFrame();
+		static void endFrame();
+
+		/* Rebuilds the soft tune interpolation from b::outputOffset, call it whenever those change */
+		static void compileSoftTune();
 		
 	private:
+		static AnalogOut* outputs[16];
+		static volatile int16_t frameValues[16];
+		static int16_t latchedValues[16];
+		static volatile uint16_t frameDirty;
+		static volatile int frameDepth;
+		static volatile bool flushing;
+		static void flush();
+
+		static int32_t tuneBase[16][21];
+		static int16_t tuneSlope[16][21];
+
 		PinAnalogOut pin;
 		AnalogOut(PinAnalogOut out);
+		void stage(int dacval);
 
 		MCP4822 spidac;
 		uint8_t spidac_index;
@@ -4275,6 +4298,9 @@ class nw2s::IOUtils
 		static bool enableLED;
 		static void displayBeat(int beat, void* clockinstance);
 		static void setupPins();
+
+		/* Rebuilds the per-input calibration from b::inputScale/inputOffset, call it whenever those change */
+		static void compileInputTune();
 };
 
 #endif
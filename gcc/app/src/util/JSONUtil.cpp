@@ -204,6 +204,36 @@ int nw2s::getDivisionFromJSON(aJsonObject* data)
 	return clockDivisionFromName(divisionNode->valuestring);
 }
 
+int nw2s::getSwingFromJSON(aJsonObject* data)
+{
+	aJsonObject* swingNode = aJson.getObjectItem(data, "swing");
+
+	/* Swing is optional, so don't complain when it's not there */
+	if (swingNode == NULL) return SWING_STRAIGHT;
+
+	static const char info[] = "Swing: ";
+	Serial.println(String(info) + String(swingNode->valueint));
+
+	return swingNode->valueint;
+}
+
+int nw2s::getSwingDivisionFromJSON(aJsonObject* data)
+{
+	aJsonObject* divisionNode = aJson.getObjectItem(data, "swingDivision");
+
+	if (divisionNode == NULL)
+	{
+		static const char nodeError[] = "Missing swing division. Assume sixteenth note";
+		Serial.println(String(nodeError));
+		return DIV_SIXTEENTH;
+	}
+
+	static const char info[] = "Swing Division: ";
+	Serial.println(String(info) + String(divisionNode->valuestring));
+
+	return clockDivisionFromName(divisionNode->valuestring);
+}
+
 SampleRateInterrupt nw2s::getSampleRateFromJSON(aJsonObject* data)
 {
 	aJsonObject* samplerateNode = aJson.getObjectItem(data, "samplerate");
@@ -239,7 +269,7 @@ NoteSequenceData* nw2s::getNotesFromJSON(aJsonObject* data, const char* nodeName
 		return NULL;
 	}
 
-	NoteSequenceData* notes = noteSequenceFromJSON(notesNode);	
+	return noteSequenceFromJSON(notesNode);
 }
 
 std::vector<int>* nw2s::getIntCollectionFromJSON(aJsonObject* data, const char* nodeName)
@@ -47,6 +47,8 @@ namespace nw2s
 	NoteName getRootFromJSON(aJsonObject* data);
 	Scale getScaleFromJSON(aJsonObject* data);
 	int getDivisionFromJSON(aJsonObject* data);
+	int getSwingFromJSON(aJsonObject* data);
+	int getSwingDivisionFromJSON(aJsonObject* data);
 	NoteSequenceData* getNotesFromJSON(aJsonObject* data);
 	NoteSequenceData* getNotesFromJSON(aJsonObject* data, const char* nodeName);
 	int getTempoFromJSON(aJsonObject* data);
@@ -0,0 +1,86 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Mix.h"
+
+using namespace nw2s;
+
+void nw2s::mixSingle(uint16_t* block, const int16_t* a, int samples, uint16_t mask)
+{
+	for (int i = 0; i < samples; i++)
+	{
+		block[i] = mixToDAC(a[i], mask);
+	}
+}
+
+void nw2s::mixAnd(uint16_t* block, const int16_t* a, const int16_t* b, int samples, uint16_t mask)
+{
+	for (int i = 0; i < samples; i++)
+	{
+		block[i] = mixToDAC(a[i] & b[i], mask);
+	}
+}
+
+void nw2s::mixXor(uint16_t* block, const int16_t* a, const int16_t* b, int samples, uint16_t mask)
+{
+	for (int i = 0; i < samples; i++)
+	{
+		block[i] = mixToDAC(a[i] ^ b[i], mask);
+	}
+}
+
+void nw2s::mixRing(uint16_t* block, const int16_t* a, const int16_t* b, int samples, uint16_t mask)
+{
+	for (int i = 0; i < samples; i++)
+	{
+		block[i] = mixToDAC(((int32_t)a[i] * b[i]) >> 16, mask);
+	}
+}
+
+void nw2s::mixBlend(uint16_t* block, const int16_t* a, const int16_t* b, int samples, uint16_t gain1, uint16_t gain2, const uint32_t* dither, uint16_t mask)
+{
+	for (int i = 0; i < samples; i++)
+	{
+		/* Shifting rounds down, which is what the unsigned divide by 1024 always did to negative samples */
+		int16_t val1 = ((int32_t)a[i] * gain1) >> 10;
+		int16_t val2 = ((int32_t)b[i] * gain2) >> 10;
+		
+		block[i] = mixToDAC((val1 + val2) ^ ((dither[i >> 5] >> (i & 31)) & 1), mask);
+	}
+}
+
+void nw2s::mixGlitch(uint16_t* block, const int16_t* a, const int16_t* b, int samples, bool* stream, bool* trigger, uint16_t mask)
+{
+	bool current = *stream;
+	bool triggered = *trigger;
+	
+	for (int i = 0; i < samples; i++)
+	{
+		bool equal = (a[i] == b[i]);
+		
+		current = current ^ equal;
+		triggered = triggered || equal;
+		
+		block[i] = mixToDAC(current ? b[i] : a[i], mask);
+	}
+	
+	*stream = current;
+	*trigger = triggered;
+}
@@ -0,0 +1,66 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef Mix_h
+#define Mix_h
+
+#include <Arduino.h>
+
+/* 
+	The Cortex-M3 has USAT but none of the M4 packed SIMD instructions. On the Due 
+	it comes from CMSIS via Arduino.h; everywhere else use a plain C version.
+*/
+#ifndef __USAT
+#define __USAT(value, bits) nw2s::usat((int32_t)(value), (bits))
+#endif
+
+namespace nw2s
+{
+	/*
+		Block kernels for the Looper mix modes. Each one consumes samples from one or two
+		streams and writes 12 bit unsigned DAC values, bit for bit what the Looper used to
+		produce one sample at a time. The mask is the bit crusher, 0xFFFF for none.
+	*/
+	void mixSingle(uint16_t* block, const int16_t* a, int samples, uint16_t mask);
+	void mixAnd(uint16_t* block, const int16_t* a, const int16_t* b, int samples, uint16_t mask);
+	void mixXor(uint16_t* block, const int16_t* a, const int16_t* b, int samples, uint16_t mask);
+	void mixRing(uint16_t* block, const int16_t* a, const int16_t* b, int samples, uint16_t mask);
+	
+	/* Gains are out of 1024. Bit n of the dither words is xor'ed into sample n. */
+	void mixBlend(uint16_t* block, const int16_t* a, const int16_t* b, int samples, uint16_t gain1, uint16_t gain2, const uint32_t* dither, uint16_t mask);
+	
+	/* Switches streams whenever they agree, and sets trigger the first time they do */
+	void mixGlitch(uint16_t* block, const int16_t* a, const int16_t* b, int samples, bool* stream, bool* trigger, uint16_t mask);
+
+	inline uint32_t usat(int32_t value, uint32_t bits)
+	{
+		int32_t max = (1L << bits) - 1;
+		
+		return (value < 0) ? 0 : (value > max) ? max : value;
+	}
+	
+	/* Signed sample to offset binary, saturated, crushed and cut down to 12 bits */
+	inline uint16_t mixToDAC(int32_t value, uint16_t mask)
+	{
+		return (__USAT(value + 0x7FFF, 16) & mask) >> 4;
+	}
+}
+
+#endif
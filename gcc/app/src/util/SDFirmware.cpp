@@ -48,6 +48,9 @@ void nw2s::initializeFirmware()
 {
 	aJsonObject* program = openProgram("DEFAULT.B");
 	
+	/* openProgram has already said why */
+	if (program == NULL) return;
+
 	/* See if it's a loader */
 	aJsonObject* loaderNode = aJson.getObjectItem(program, "loader"); 
 
@@ -67,7 +70,7 @@ void nw2s::initializeFirmware()
 			delay(1);
 		}
 		
-		char filename[7];
+		char filename[16];
 		sprintf(filename, "PROG%02d.B", val1 / 312);
 		
 		Serial.print("Opening ");
@@ -79,7 +82,7 @@ void nw2s::initializeFirmware()
 	loadProgram(program);
 }
 
-aJsonObject* nw2s::openProgram(char* filename)
+aJsonObject* nw2s::openProgram(const char* filename)
 {
 	SdFile root;
 	SdFile programsDir;
@@ -113,7 +116,7 @@ aJsonObject* nw2s::openProgram(char* filename)
 	char programData[fileSize + 1];
 
 	programFile.read(programData, fileSize);
-	programData[fileSize] == '\0';
+	programData[fileSize] = '\0';
 		
 	aJsonObject* program = aJson.parse(programData);
 
@@ -162,27 +165,35 @@ void nw2s::loadProgram(aJsonObject* program)
 		if (strcmp(clockTypeNode->valuestring, "FixedClock") == 0)
 		{
 			clockDevice = FixedClock::create(clockNode);
-			EventManager::registerDevice(clockDevice);
+			EventManager::scheduleDevice(clockDevice);
 		}		
 		else if (strcmp(clockTypeNode->valuestring, "VariableClock") == 0)
 		{
 			clockDevice = VariableClock::create(clockNode);
-			EventManager::registerDevice(clockDevice);
+			EventManager::scheduleDevice(clockDevice);
 		}		
 		else if (strcmp(clockTypeNode->valuestring, "RandomTempoClock") == 0)
 		{
 			clockDevice = RandomTempoClock::create(clockNode);
-			EventManager::registerDevice(clockDevice);
+			EventManager::scheduleDevice(clockDevice);
 		}		
 		else if (strcmp(clockTypeNode->valuestring, "TapTempoClock") == 0)
 		{
 			clockDevice = TapTempoClock::create(clockNode);
-			EventManager::registerDevice(clockDevice);
+			EventManager::scheduleDevice(clockDevice);
 		}
 		else if (strcmp(clockTypeNode->valuestring, "PassthruClock") == 0)
 		{
 			clockDevice = PassthruClock::create(clockNode);
-			EventManager::registerDevice(clockDevice);
+			EventManager::scheduleDevice(clockDevice);
+		}
+		
+		/* Swing on the clock applies to every device that doesn't set its own */
+		int swing = getSwingFromJSON(clockNode);
+		
+		if ((clockDevice != NULL) && (swing > SWING_STRAIGHT))
+		{
+			clockDevice->setSwing(getSwingDivisionFromJSON(clockNode), swing);
 		}
 	}
 	
@@ -217,7 +228,7 @@ void nw2s::loadProgram(aJsonObject* program)
 			if ((clockDevice != NULL) && (getDigitalInputFromJSON(deviceNode, "externalClock") == DIGITAL_IN_NONE))
 			{
 				GameOfLife* grid = GameOfLife::create(deviceNode);
-				clockDevice->registerDevice(grid);
+				clockDevice->registerDevice(grid, deviceNode);
 				EventManager::registerUsbDevice(grid);
 			}
 			else
@@ -236,7 +247,7 @@ void nw2s::loadProgram(aJsonObject* program)
 			if ((clockDevice != NULL) && (getDigitalInputFromJSON(deviceNode, "externalClock") == DIGITAL_IN_NONE))
 			{
 				GridOto* grid = GridOto::create(deviceNode);
-				clockDevice->registerDevice(grid);
+				clockDevice->registerDevice(grid, deviceNode);
 				EventManager::registerUsbDevice(grid);
 			}
 			else
@@ -255,7 +266,7 @@ void nw2s::loadProgram(aJsonObject* program)
 			if ((clockDevice != NULL) && (getDigitalInputFromJSON(deviceNode, "externalClock") == DIGITAL_IN_NONE))
 			{
 				GridNoteSequencer* grid = GridNoteSequencer::create(deviceNode);
-				clockDevice->registerDevice(grid);
+				clockDevice->registerDevice(grid, deviceNode);
 				EventManager::registerUsbDevice(grid);
 			}
 			else
@@ -274,7 +285,7 @@ void nw2s::loadProgram(aJsonObject* program)
 			if ((clockDevice != NULL) && (getDigitalInputFromJSON(deviceNode, "externalClock") == DIGITAL_IN_NONE))
 			{
 				GridTriggerController* grid = GridTriggerController::create(deviceNode);
-				clockDevice->registerDevice(grid);
+				clockDevice->registerDevice(grid, deviceNode);
 				EventManager::registerUsbDevice(grid);
 			}
 			else
@@ -291,7 +302,7 @@ void nw2s::loadProgram(aJsonObject* program)
 		{
 			if (clockDevice != NULL)
 			{
-				clockDevice->registerDevice(CVSequencer::create(deviceNode));
+				clockDevice->registerDevice(CVSequencer::create(deviceNode), deviceNode);
 			}
 			else
 			{
@@ -303,7 +314,7 @@ void nw2s::loadProgram(aJsonObject* program)
 		{
 			if (clockDevice != NULL)
 			{
-				clockDevice->registerDevice(DrumTriggerSequencer::create(deviceNode));
+				clockDevice->registerDevice(DrumTriggerSequencer::create(deviceNode), deviceNode);
 			}
 			else
 			{
@@ -319,11 +330,15 @@ void nw2s::loadProgram(aJsonObject* program)
 		{
 			EventManager::registerDevice(Looper::create(deviceNode));
 		}
+		else if (strcmp(typeNode->valuestring, "SlicePlayer") == 0)
+		{
+			EventManager::registerDevice(SlicePlayer::create(deviceNode));
+		}
 		else if (strcmp(typeNode->valuestring, "MorphingNoteSequencer") == 0)
 		{
 			if (clockDevice != NULL)
 			{
-				clockDevice->registerDevice(MorphingNoteSequencer::create(deviceNode));
+				clockDevice->registerDevice(MorphingNoteSequencer::create(deviceNode), deviceNode);
 			}
 			else
 			{
@@ -335,7 +350,7 @@ void nw2s::loadProgram(aJsonObject* program)
 		{
 			if (clockDevice != NULL)
 			{
-				clockDevice->registerDevice(NoteSequencer::create(deviceNode));
+				clockDevice->registerDevice(NoteSequencer::create(deviceNode), deviceNode);
 			}
 			else
 			{
@@ -347,7 +362,7 @@ void nw2s::loadProgram(aJsonObject* program)
 		{
 			if (clockDevice != NULL)
 			{
-				clockDevice->registerDevice(ProbabilityDrumTriggerSequencer::create(deviceNode));
+				clockDevice->registerDevice(ProbabilityDrumTriggerSequencer::create(deviceNode), deviceNode);
 			}
 			else
 			{
@@ -359,7 +374,7 @@ void nw2s::loadProgram(aJsonObject* program)
 		{
 			if (clockDevice != NULL)
 			{
-				clockDevice->registerDevice(ProbabilityTriggerSequencer::create(deviceNode));
+				clockDevice->registerDevice(ProbabilityTriggerSequencer::create(deviceNode), deviceNode);
 			}
 			else
 			{
@@ -371,7 +386,7 @@ void nw2s::loadProgram(aJsonObject* program)
 		{
 			if (clockDevice != NULL)
 			{
-				clockDevice->registerDevice(RandomLoopingShiftRegister::create(deviceNode));
+				clockDevice->registerDevice(RandomLoopingShiftRegister::create(deviceNode), deviceNode);
 			}
 			else
 			{
@@ -387,7 +402,7 @@ void nw2s::loadProgram(aJsonObject* program)
 		{
 			if (clockDevice != NULL)
 			{
-				clockDevice->registerDevice(TriggerSequencer::create(deviceNode));
+				clockDevice->registerDevice(TriggerSequencer::create(deviceNode), deviceNode);
 			}
 			else
 			{
@@ -399,7 +414,7 @@ void nw2s::loadProgram(aJsonObject* program)
 		{
 			if (clockDevice != NULL)
 			{
-				clockDevice->registerDevice(Trigger::create(deviceNode));
+				clockDevice->registerDevice(Trigger::create(deviceNode), deviceNode);
 			}
 			else
 			{
@@ -438,8 +453,11 @@ void nw2s::loadProgram(aJsonObject* program)
 			{
 				USBMidiApeggiator* controller = USBMidiApeggiator::create(deviceNode);
 
-				EventManager::registerUsbDevice(controller);
-				clockDevice->registerDevice(controller);
+				if (controller != NULL)
+				{
+					EventManager::registerUsbDevice(controller);
+					clockDevice->registerDevice(controller);
+				}
 			}
 			else
 			{
@@ -451,7 +469,9 @@ void nw2s::loadProgram(aJsonObject* program)
 		}
 		else if (strcmp(typeNode->valuestring, "USBPolyphonicMidiController") == 0)
 		{
-			EventManager::registerDevice(USBPolyphonicMidiController::create(deviceNode));
+			USBPolyphonicMidiController* controller = USBPolyphonicMidiController::create(deviceNode);
+
+			if (controller != NULL) EventManager::registerDevice(controller);
 		}
 		else if (strcmp(typeNode->valuestring, "USBMidiTriggers") == 0)
 		{
@@ -26,7 +26,7 @@
 namespace nw2s
 {
 	void initializeFirmware();
-	aJsonObject* openProgram(char* fileName);
+	aJsonObject* openProgram(const char* fileName);
 	void loadProgram(aJsonObject* program);
 }
 
@@ -58,13 +58,12 @@ SignalData* SignalData::fromSDFile(char *filepath)
 		/* Allocate as much space as we have reported by file size */
 	 	short int *data = new int16_t[filewords];
 
-		for (int i = 0; i < filewords; i++)
+		/* The words are little endian like the Due, so they can be read in as they are, a chunk at a time */
+		for (int i = 0; i < filewords * 2; i += 16384)
 		{
-			/* Read two bytes and make a word, little endian */
-			unsigned char d0 = file.read();
-			unsigned char d1 = file.read();
+			int chunk = (filewords * 2) - i;
 			
-			data[i] = (d1 << 8) | d0;
+			file.read(&((uint8_t*)data)[i], (chunk > 16384) ? 16384 : chunk);
 		}
 
 		file.close();
@@ -75,6 +74,8 @@ SignalData* SignalData::fromSDFile(char *filepath)
 	{
 		Serial.println("error opening file");
 	} 
+
+	return NULL;
 }
 
 SignalData::SignalData(short int *data, long size)
@@ -94,14 +95,27 @@ short int SignalData::getSample(long sample)
 }
 
 
-StreamingSignalData* StreamingSignalData::fromSDFile(char* foldername, char* subfoldername, char *filename, bool loop)
+std::vector<StreamingSignalData*> StreamingSignalData::streams;
+uint32_t StreamingSignalData::cacheBudget = STREAM_CACHE_BUDGET;
+
+StreamingSignalData* StreamingSignalData::fromSDFile(const char* foldername, const char* subfoldername, const char* filename, bool loop, int buffers, int buffersize, uint32_t cachesize, StreamChannel channel)
 {	
-	return new StreamingSignalData(foldername, subfoldername, filename, loop);
+	return new StreamingSignalData(foldername, subfoldername, filename, loop, buffers, buffersize, cachesize, channel);
 }
 
-StreamingSignalData::StreamingSignalData(char* foldername, char* subfoldername, char *filename, bool loop)
+StreamingSignalData::StreamingSignalData(const char* foldername, const char* subfoldername, const char* filename, bool loop, int buffers, int buffersize, uint32_t cachesize, StreamChannel channel)
 {
 	this->reversed = false;
+	this->available = false;
+
+	/* Buffers are a whole number of SD blocks so they can be read straight off the card */
+	buffersize = (buffersize < STREAM_BUFFER_MIN) ? STREAM_BUFFER_MIN : (buffersize > STREAM_BUFFER_MAX) ? STREAM_BUFFER_MAX : buffersize;
+
+	this->bufferSize = buffersize - (buffersize % STREAM_BUFFER_MIN);
+	this->bufferCount = (buffers < 2) ? 2 : (buffers > STREAM_BUFFER_COUNT_MAX) ? STREAM_BUFFER_COUNT_MAX : buffers;
+	this->subEndIndex = this->bufferSize;
+
+	streams.push_back(this);
 	
 	SdFile root;
 	SdFile samplesDir;
@@ -127,21 +141,58 @@ StreamingSignalData::StreamingSignalData(char* foldername, char* subfoldername,
 	    Serial.println("Error opening file. Are you sure it's there?");
 	    return;
 	}
+
+	WaveFormat format;
+
+	if (!parseWave(&this->file, &format))
+	{
+	    Serial.println(String(filename) + ": not a PCM WAV file that can be played");
+	    return;
+	}
+
+	/* Anything but 16 bit mono is converted once, and what gets streamed is the converted copy */
+	if (((format.channels != 1) || (format.bits != 16)) && !this->transcode(&subDir, filename, &format, channel))
+	{
+	    Serial.println(String(filename) + ": could not be converted");
+	    return;
+	}
+
+	this->dataStart = format.dataStart;
+	this->dataSize = format.dataSize & ~1;
+	this->fileSeek(0);
 			
 	this->loop = loop;
 	this->reversed = false;
-	this->available = file.fileSize() > 0;
-	this->sampleCount = file.fileSize() / 2;
+	this->available = this->dataSize > 0;
+
+	uint32_t lastBlock;
+	this->contiguous = this->file.contiguousRange(&this->firstBlock, &lastBlock);
+
+	this->sampleCount = this->dataSize / 2;
 	this->endIndex = this->sampleCount - 1;
-	this->size[0] = 0;
-	this->size[1] = 0;
+	this->cacheEnd = this->endIndex;
+
+	if (this->available && this->loadCache(cachesize))
+	{
+		Serial.println(String(filename) + ": cached, " + String(this->sampleCount * 2) + " bytes, " + String(cacheBudget) + " of " + String(STREAM_CACHE_BUDGET) + " bytes of cache left");
+		return;
+	}
+
+	Serial.println(String(filename) + ": streamed, " + String(this->bufferCount) + " x " + String(this->bufferSize) + " sample buffers, " + String(cacheBudget) + " of " + String(STREAM_CACHE_BUDGET) + " bytes of cache left");
 
-	this->writebufferindex = 0;
-	this->readbufferindex = 1;
+	this->buffers = new int16_t[this->bufferCount * this->bufferSize];
+	this->resetCache = new int16_t[this->bufferSize];
+	this->seekBuffer = new int16_t[this->bufferSize];
 
-	this->refresh();
+	memset(this->buffers, 0, this->bufferCount * this->bufferSize * sizeof(int16_t));
+	memset(this->resetCache, 0, this->bufferSize * sizeof(int16_t));
+
+	/* Start out with the whole ring full */
+	while (this->available && this->isReadyForRefresh())
+	{
+		this->refresh();
+	}
 	
-	this->readbufferindex = 0;
 	this->nextsampleindex = 0;
 }
 
@@ -150,9 +201,85 @@ bool StreamingSignalData::isAvailable()
 	return available;
 }
 
+bool StreamingSignalData::isCached()
+{
+	return this->cache != NULL;
+}
+
 bool StreamingSignalData::isReadyForRefresh()
 {
-	return this->readbufferindex != this->writebufferindex;
+	if (this->cache != NULL) return false;
+
+	/* While a seek waits to be picked up, the ring is left alone */
+	if (this->seekState == SEEK_REQUESTED) return true;
+	if (this->seekState == SEEK_READY) return false;
+
+	return (this->head - this->tail) < (uint32_t)this->bufferCount;
+}
+
+uint32_t StreamingSignalData::getUnderruns()
+{
+	return this->underruns;
+}
+
+uint32_t StreamingSignalData::getRefreshCount()
+{
+	return this->refreshCount;
+}
+
+uint32_t StreamingSignalData::getRefreshAverage()
+{
+	return (this->refreshCount > 0) ? (uint32_t)(this->refreshTime / this->refreshCount) : 0;
+}
+
+uint32_t StreamingSignalData::getRefreshPeak()
+{
+	return this->refreshPeak;
+}
+
+uint32_t StreamingSignalData::getQueued()
+{
+	/* A seek waiting on the card has nothing to play yet */
+	if ((this->cache != NULL) || (this->seekState == SEEK_READY)) return this->bufferCount;
+	if (this->seekState == SEEK_REQUESTED) return 0;
+
+	return this->head - this->tail;
+}
+
+int StreamingSignalData::getBufferSize()
+{
+	return this->bufferSize;
+}
+
+int StreamingSignalData::getBufferCount()
+{
+	return this->bufferCount;
+}
+
+uint32_t StreamingSignalData::getSampleCount()
+{
+	return this->sampleCount;
+}
+
+void StreamingSignalData::printStats()
+{
+	for (unsigned int i = 0; i < streams.size(); i++)
+	{
+		StreamingSignalData* stream = streams[i];
+
+		if (stream->cache != NULL)
+		{
+			Serial.println("stream " + String(i) + ": cached, " + String(stream->sampleCount) + " samples");
+			continue;
+		}
+
+		Serial.println("stream " + String(i) + ": " + String(stream->bufferCount) + " x " + String(stream->bufferSize) + " samples, " + String(stream->head - stream->tail) + " queued, " + String(stream->underruns) + " underruns");
+
+		if (stream->refreshCount > 0)
+		{
+			Serial.println("stream " + String(i) + ": " + String(stream->getRefreshCount()) + " refreshes, " + String(stream->getRefreshAverage()) + "uS average, " + String(stream->getRefreshPeak()) + "uS peak");
+		}
+	}
 }
 
 void StreamingSignalData::setStartFactor(uint16_t startfactor)
@@ -181,7 +308,10 @@ void StreamingSignalData::setFineEndFactor(uint16_t fineEndFactor)
 
 void StreamingSignalData::calculateEndpoints()
 {
-	uint32_t newStartIndex = ((this->sampleCount - STREAM_BUFFER_SIZE) * this->startFactor) / 4095;
+	/* A loop shorter than a buffer has nowhere to move its start to */
+	uint32_t bufferSize = this->bufferSize;
+	uint64_t startRange = (this->sampleCount > bufferSize) ? this->sampleCount - bufferSize : 0;
+	uint32_t newStartIndex = (startRange * this->startFactor) / 4095;
 	
 	if (newStartIndex != this->startIndex)
 	{
@@ -190,12 +320,26 @@ void StreamingSignalData::calculateEndpoints()
 	}
 	
 	uint32_t looplength = ((this->sampleCount * this->endFactor) / 4095) + this->fineEndFactor; 
-	this->endIndex = this->startIndex + STREAM_BUFFER_SIZE + looplength;
+	this->endIndex = this->startIndex + bufferSize + looplength;
 	this->endIndex = (this->endIndex >= this->sampleCount) ? this->sampleCount - 1 : this->endIndex;
 
-	this->subEndIndex = (looplength < STREAM_BUFFER_SIZE) ? looplength : STREAM_BUFFER_SIZE;
+	this->subEndIndex = (looplength < bufferSize) ? looplength : bufferSize;
+
+	if (this->cache != NULL)
+	{
+		/* A short loop just plays its first few samples, like it does when streaming */
+		this->cacheEnd = (looplength < bufferSize) ? this->startIndex + looplength : this->endIndex;
+		this->cacheEnd = (this->cacheEnd >= this->sampleCount) ? this->sampleCount - 1 : this->cacheEnd;
+
+		if ((this->position < this->startIndex) || (this->position > this->cacheEnd))
+		{
+			this->reset();
+		}
+
+		return;
+	}
 
-	if ((this->startIndex > ((this->file.curPosition() / 2) + STREAM_BUFFER_SIZE)) || (this->endIndex < ((this->file.curPosition() / 2) - STREAM_BUFFER_SIZE)))
+	if ((this->startIndex > ((this->filePosition() / 2) + bufferSize)) || ((this->endIndex + bufferSize) < (this->filePosition() / 2)))
 	{
 		this->reset();
 	}	
@@ -204,118 +348,664 @@ void StreamingSignalData::calculateEndpoints()
 void StreamingSignalData::refresh()
 {
 	/* Make sure we don't get interrupted accidentally */
-	if (refreshing) return;
+	if (refreshing || (this->cache != NULL)) return;
 	this->refreshing = true;
 
-	unsigned char d[READ_BUFFER_SIZE];
-	int dsize = 0;
+	uint32_t started = micros();
 
 	/* If we're not looping and have reached eof, then stop */
-	if (!this->loop && (this->file.curPosition() >= this->file.fileSize() - 1))
+	if (!this->loop && (this->filePosition() >= this->dataSize - 1))
 	{
 		Serial.println("ERROR reading loop file");
 		this->available = false;
+		this->refreshing = false;
 		return;
 	}
 	
-	/* If we're reading from a different buffer, fill up the write buffer */
-	if (this->readbufferindex != this->writebufferindex)
+	if (this->seekState == SEEK_REQUESTED)
 	{
-		/* Fill the current write buffer up as much as possible */		
+		/* A seek is read into the spare buffer, and the ring waits until the audio interrupt has crossfaded over to it */
 		if (this->available)
 		{
-			/* If we're reversed, seek to a point earlier in the file */
-			if (reversed)
+			this->fileSeek(this->seekTarget * 2);
+			this->readBuffer(this->seekBuffer);
+			this->reverseStart = -1;
+
+			if (this->refreshCache && (this->seekTarget == this->startIndex))
 			{
-				/* If we're closer to the beginning than what we need to read, just skip to the end */
-				if ((this->file.curPosition() - this->startIndex) < (READ_BUFFER_SIZE * 2))
-				{
-					this->file.seekSet(this->endIndex - READ_BUFFER_SIZE - 2);
-				}
-				else
-				{
-					this->file.seekSet(this->file.curPosition() - (READ_BUFFER_SIZE * 2));
-				}
+				memcpy(this->resetCache, this->seekBuffer, this->bufferSize * sizeof(int16_t));
+				this->refreshCache = false;
 			}
-			
+		}
+
+		this->seekState = SEEK_READY;
+	}
+	else if (this->isReadyForRefresh())
+	{
+		/* If there's a free slot in the ring, fill it */
+		int16_t* target = this->slot(this->head);
+
+		if (this->available)
+		{
+			/* A reset played out of the cache leaves the file to be moved to just past it */
+			if (this->resumePosition >= 0)
+			{
+				this->fileSeek(this->resumePosition);
+				this->resumePosition = -1;
+				this->reverseStart = -1;
+			}
+
 			/* If we're past where we should be, move to the start */
-			if (file.curPosition() > (this->endIndex * 2))
+			if (!reversed && (this->filePosition() > (this->endIndex * 2)))
 			{
-				file.seekSet(this->startIndex * 2);
+				this->fileSeek(this->startIndex * 2);
 			}
 			
-			/* Read up to the buffer size number of bytes */
-			dsize = this->file.read(d, READ_BUFFER_SIZE);
-			this->available = dsize > -1;
+			/* The start of the loop is what a reset plays first */
+			bool head = !reversed && (this->filePosition() == this->startIndex * 2);
 
-			/* If we're looping and didn't get enough bytes, rewind and start over */
-			while (loop && available && dsize < READ_BUFFER_SIZE)
+			if (reversed)
 			{
-				this->file.seekSet(this->startIndex * 2);
-				dsize += this->file.read(&(d[dsize]), READ_BUFFER_SIZE - dsize);
+				this->readBufferReversed(target);
 			}
-			
-			/* Convert from signed little endian */
-			for (int i = 0; i < dsize; i += 2)
+			else
 			{
-				/* Read two bytes and make a word */
-				unsigned char d0 = d[i];
-				unsigned short int d1 = d[i + 1];
-	
-				int16_t value = (d1 << 8) | d0;
-				
-				this->buffer[writebufferindex][i / 2] = value;
-				
-				/* if the cache is dirty, fill it up with what we're reading now. */
-				if (this->refreshCache)
-				{
-					this->resetCache[i / 2] = value;
-				}
+				this->readBuffer(target);
+				this->reverseStart = -1;
 			}
 			
-			if (this->refreshCache)
+			/* if the cache is dirty and this was the start, keep a copy of it */
+			if (this->refreshCache && head)
 			{
+				memcpy(this->resetCache, target, this->bufferSize * sizeof(int16_t));
 				this->refreshCache = false;
 			}
 		}
 	
-		this->bufferindex[writebufferindex] = this->buffercount++;
-		this->size[writebufferindex] = dsize / 2;	
-		this->writebufferindex = !this->writebufferindex;
+		/* Publish the slot only once it's full */
+		this->head = this->head + 1;
+	}
+	else
+	{
+		this->refreshing = false;
+		return;
 	}
+
+	/* Only refreshes that read something are timed */
+	uint32_t elapsed = micros() - started;
+
+	this->refreshCount++;
+	this->refreshTime += elapsed;
+	this->refreshPeak = (elapsed > this->refreshPeak) ? elapsed : this->refreshPeak;
 	
 	this->refreshing = false;
 }
 
-int16_t StreamingSignalData::getNextSample()
+void StreamingSignalData::readBuffer(int16_t* target)
+{
+	/* The samples are little endian like the Due, so they can be read straight into the buffer */
+	uint8_t* d = (uint8_t*)target;
+	int readsize = this->bufferSize * 2;
+	int dsize = 0;
+	uint32_t position = this->filePosition();
+
+	if (this->contiguous && (position + readsize <= this->dataSize))
+	{
+		/* A whole buffer is on the card in one run, so skip the FAT layer */
+		this->available = this->readBlocks(this->dataStart + position, d, readsize);
+		dsize = this->available ? readsize : 0;
+
+		this->fileSeek(position + dsize);
+	}
+	else
+	{
+		/* Read up to the buffer size number of bytes */
+		dsize = this->readData(d, readsize);
+		this->available = dsize > -1;
+
+		/* If we're looping and didn't get enough bytes, rewind and start over */
+		while (loop && available && dsize < readsize)
+		{
+			this->fileSeek(this->startIndex * 2);
+
+			int more = this->readData(&(d[dsize]), readsize - dsize);
+
+			if (more <= 0) break;
+
+			dsize += more;
+		}
+	}
+
+	/* Don't play whatever was left in the buffer past the end of a short read */
+	if (dsize < readsize)
+	{
+		memset(&d[(dsize > 0) ? dsize : 0], 0, readsize - ((dsize > 0) ? dsize : 0));
+	}
+}
+
+void StreamingSignalData::readBufferReversed(int16_t* target)
+{
+	uint8_t* d = (uint8_t*)target;
+	int32_t readsize = this->bufferSize * 2;
+	int32_t start = this->startIndex * 2;
+	int32_t end = (this->endIndex + 1) * 2;
+	int32_t previous = (this->reverseStart >= 0) ? this->reverseStart : (int32_t)this->filePosition() - readsize;
+
+	end = (end > (int32_t)this->dataSize) ? this->dataSize : end;
+
+	/* The buffer before the last one is read forward and played from its far end */
+	if ((previous - readsize >= start) || (end - start < readsize))
+	{
+		this->fileSeek((previous - readsize >= start) ? previous - readsize : start);
+		this->readBuffer(target);
+		this->reverseStart = -1;
+
+		return;
+	}
+
+	/* What's left before the loop start goes at the top of the buffer, and the end of the loop fills in under it */
+	int32_t remaining = (previous > start) ? previous - start : 0;
+	int32_t tail = readsize - remaining;
+
+	this->fileSeek(end - tail);
+	int dsize = this->readData(d, tail);
+
+	this->fileSeek(start);
+	int more = (remaining > 0) ? this->readData(&d[tail], remaining) : 0;
+
+	this->available = (dsize > -1) && (more > -1);
+	this->reverseStart = end - tail;
+
+	if ((dsize < tail) || (more < remaining))
+	{
+		memset(d, 0, readsize);
+	}
+}
+
+static uint16_t littleEndian16(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static uint32_t littleEndian32(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool StreamingSignalData::parseWave(SdFile* file, WaveFormat* format)
+{
+	uint8_t header[12];
+
+	format->channels = 1;
+	format->bits = 16;
+	format->dataStart = 0;
+	format->dataSize = file->fileSize();
+
+	/* Anything that isn't RIFF/WAVE is taken to be raw samples, like it always was */
+	file->seekSet(0);
+
+	if ((file->read(header, 12) != 12) || (memcmp(header, "RIFF", 4) != 0) || (memcmp(&header[8], "WAVE", 4) != 0))
+	{
+		file->seekSet(0);
+		return true;
+	}
+
+	bool found = false;
+	uint8_t chunk[8];
+
+	/* Walk the chunks until the samples turn up, keeping the format on the way */
+	while (file->read(chunk, 8) == 8)
+	{
+		uint32_t size = littleEndian32(&chunk[4]);
+		uint32_t next = file->curPosition() + size + (size & 1);
+
+		if (memcmp(chunk, "fmt ", 4) == 0)
+		{
+			uint8_t fmt[40];
+
+			memset(fmt, 0, sizeof(fmt));
+			file->read(fmt, (size > sizeof(fmt)) ? sizeof(fmt) : size);
+
+			uint16_t tag = littleEndian16(&fmt[0]);
+
+			format->channels = littleEndian16(&fmt[2]);
+			format->bits = littleEndian16(&fmt[14]);
+
+			/* WAVE_FORMAT_EXTENSIBLE keeps the real format tag at the front of its sub format GUID */
+			if ((tag == 0xFFFE) && (size >= 26)) tag = littleEndian16(&fmt[24]);
+
+			if ((tag != 1) || (format->channels < 1) || (format->channels > 2)) return false;
+			if ((format->bits != 8) && (format->bits != 16) && (format->bits != 24)) return false;
+
+			found = true;
+		}
+		else if (memcmp(chunk, "data", 4) == 0)
+		{
+			if (!found) return false;
+
+			/* A file that was cut short has less data than its header says */
+			format->dataStart = file->curPosition();
+			format->dataSize = (size < file->fileSize() - format->dataStart) ? size : file->fileSize() - format->dataStart;
+
+			return true;
+		}
+
+		if (!file->seekSet(next)) break;
+	}
+
+	return false;
+}
+
+/* The first block of a converted file says what it was made from, so a changed original is converted again */
+static const char TRANSCODE_MAGIC[8] = { 'n', 'w', '2', 's', 'P', 'C', 'M', 2 };
+static const uint32_t TRANSCODE_HEADER_SIZE = 512;
+static const int TRANSCODE_FRAMES = 512;
+
+struct TranscodeHeader
+{
+	char magic[8];
+	uint32_t sourceSize;
+	uint16_t sourceDate;
+	uint16_t sourceTime;
+	uint32_t sourceSum;
+	uint16_t channels;
+	uint16_t bits;
+	uint16_t channel;
+};
+
+static inline int32_t transcodeSample(const uint8_t* p, int bytes)
+{
+	/* 8 bit WAV is unsigned, and 24 bit keeps its top 16 bits */
+	if (bytes == 1) return ((int32_t)p[0] - 128) << 8;
+	if (bytes == 2) return (int16_t)(p[0] | (p[1] << 8));
+
+	return (int16_t)(p[1] | (p[2] << 8));
+}
+
+bool StreamingSignalData::transcode(SdFile* dir, const char* filename, WaveFormat* format, StreamChannel channel)
+{
+	/* The converted file sits next to the original, with the format in place of its extension: LOOP.WAV becomes LOOP.16M, .16L or .16R */
+	char name[13];
+	int length = 0;
+
+	while ((filename[length] != '\0') && (filename[length] != '.') && (length < 8))
+	{
+		name[length] = filename[length];
+		length++;
+	}
+
+	channel = (format->channels == 1) ? CHANNEL_MIX : channel;
+
+	name[length++] = '.';
+	name[length++] = '1';
+	name[length++] = '6';
+	name[length++] = (channel == CHANNEL_LEFT) ? 'L' : (channel == CHANNEL_RIGHT) ? 'R' : 'M';
+	name[length] = '\0';
+
+	int sampleBytes = format->bits / 8;
+	int frameBytes = sampleBytes * format->channels;
+	uint32_t frames = format->dataSize / frameBytes;
+
+	TranscodeHeader header;
+	uint8_t* in = new uint8_t[TRANSCODE_FRAMES * frameBytes];
+	int16_t* out = new int16_t[TRANSCODE_FRAMES];
+
+	/* The original's size and modification time say whether it has changed, and a sum of its first frames catches a copy that kept the old time */
+	dir_t entry;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRANSCODE_MAGIC, sizeof(header.magic));
+	header.sourceSize = this->file.fileSize();
+
+	if (this->file.dirEntry(&entry))
+	{
+		header.sourceDate = entry.lastWriteDate;
+		header.sourceTime = entry.lastWriteTime;
+	}
+
+	header.channels = format->channels;
+	header.bits = format->bits;
+	header.channel = channel;
+
+	this->file.seekSet(format->dataStart);
+	int summed = this->file.read(in, (format->dataSize < (uint32_t)(TRANSCODE_FRAMES * frameBytes)) ? format->dataSize : TRANSCODE_FRAMES * frameBytes);
+
+	for (int i = 0; i < summed; i++) header.sourceSum += in[i] * (i + 1);
+
+	SdFile converted;
+
+	if (converted.open(dir, name, O_READ))
+	{
+		TranscodeHeader existing;
+
+		if ((converted.fileSize() == TRANSCODE_HEADER_SIZE + (frames * 2)) && (converted.read(&existing, sizeof(existing)) == sizeof(existing)) && (memcmp(&existing, &header, sizeof(header)) == 0))
+		{
+			Serial.println(String(filename) + ": using " + String(name));
+
+			delete[] in;
+			delete[] out;
+
+			this->file.close();
+			this->file = converted;
+
+			format->dataStart = TRANSCODE_HEADER_SIZE;
+			format->dataSize = frames * 2;
+
+			return true;
+		}
+
+		converted.close();
+		SdFile::remove(dir, name);
+	}
+
+	Serial.println(String(filename) + ": converting " + String(format->bits) + " bit, " + String(format->channels) + " channel to " + String(name));
+
+	/* Contiguous so it can be streamed with multiple block reads */
+	bool written = converted.createContiguous(dir, name, TRANSCODE_HEADER_SIZE + (frames * 2));
+
+	if (written)
+	{
+		uint8_t block[TRANSCODE_HEADER_SIZE];
+
+		memset(block, 0, sizeof(block));
+		memcpy(block, &header, sizeof(header));
+
+		written = converted.write(block, sizeof(block)) == sizeof(block);
+	}
+
+	/* Stereo is mixed down, or one side is picked */
+	int first = (channel == CHANNEL_RIGHT) ? sampleBytes : 0;
+	bool mix = (format->channels == 2) && (channel == CHANNEL_MIX);
+
+	this->file.seekSet(format->dataStart);
+
+	for (uint32_t done = 0; written && (done < frames); done += TRANSCODE_FRAMES)
+	{
+		int count = ((frames - done) > TRANSCODE_FRAMES) ? TRANSCODE_FRAMES : frames - done;
+
+		if (this->file.read(in, count * frameBytes) != count * frameBytes)
+		{
+			written = false;
+			break;
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			const uint8_t* frame = &in[(i * frameBytes) + first];
+			int32_t sample = transcodeSample(frame, sampleBytes);
+
+			if (mix) sample = (sample + transcodeSample(frame + sampleBytes, sampleBytes)) >> 1;
+
+			out[i] = sample;
+		}
+
+		written = converted.write(out, count * 2) == (size_t)(count * 2);
+	}
+
+	delete[] in;
+	delete[] out;
+
+	written = converted.close() && written;
+
+	if (!written || !converted.open(dir, name, O_READ))
+	{
+		SdFile::remove(dir, name);
+		return false;
+	}
+
+	this->file.close();
+	this->file = converted;
+
+	format->dataStart = TRANSCODE_HEADER_SIZE;
+	format->dataSize = frames * 2;
+
+	return true;
+}
+
+int StreamingSignalData::readData(uint8_t* target, int bytes)
+{
+	/* Whatever comes after the samples, like the rest of a WAV file's chunks, isn't played */
+	uint32_t position = this->filePosition();
+	uint32_t left = (position < this->dataSize) ? this->dataSize - position : 0;
+
+	return this->file.read(target, ((uint32_t)bytes > left) ? left : bytes);
+}
+
+bool StreamingSignalData::readBlocks(uint32_t position, uint8_t* target, uint32_t bytes)
+{
+	uint32_t block = this->firstBlock + (position >> 9);
+	uint16_t offset = position & 511;
+	Sd2Card* card = this->file.volume()->sdCard();
+
+	if (offset == 0)
+	{
+		return card->readBlocks(block, target, bytes / 512);
+	}
+
+	/* 
+		An unaligned read straddles one more block. The last one is kept because 
+		it is the first one of the next refresh, which keeps the card streaming.
+	*/
+	uint16_t first = 512 - offset;
+	uint16_t middle = (bytes / 512) - 1;
+
+	if ((block != this->cachedBlock) && !card->readBlocks(block, this->blockCache, 1))
+	{
+		this->cachedBlock = 0xFFFFFFFF;
+		return false;
+	}
+
+	memcpy(target, &this->blockCache[offset], first);
+
+	if (((middle > 0) && !card->readBlocks(block + 1, target + first, middle)) || !card->readBlocks(block + 1 + middle, this->blockCache, 1))
+	{
+		this->cachedBlock = 0xFFFFFFFF;
+		return false;
+	}
+
+	this->cachedBlock = block + 1 + middle;
+
+	memcpy(target + first + (middle * 512), this->blockCache, offset);
+
+	return true;
+}
+
+bool StreamingSignalData::loadCache(uint32_t cachesize)
+{
+	uint32_t bytes = this->sampleCount * 2;
+
+	if ((bytes == 0) || (bytes > cachesize) || (bytes > cacheBudget)) return false;
+
+	int16_t* data = new int16_t[this->sampleCount];
+
+	if (data == NULL) return false;
+
+	/* The samples are little endian like the Due, so they can be read in as they are */
+	uint8_t* d = (uint8_t*)data;
+	uint32_t loaded = 0;
+
+	/* Whole blocks of a contiguous file come off the card in one multiple block read */
+	if (this->contiguous && (bytes >= 512))
+	{
+		loaded = bytes & ~511;
+
+		if (!this->readBlocks(this->dataStart, d, loaded))
+		{
+			delete[] data;
+			return false;
+		}
+
+		this->fileSeek(loaded);
+	}
+
+	/* Anything else goes through the file, in chunks that fit in its 16 bit count */
+	while (loaded < bytes)
+	{
+		uint16_t chunk = ((bytes - loaded) > 16384) ? 16384 : (bytes - loaded);
+
+		if (this->file.read(&d[loaded], chunk) != chunk)
+		{
+			delete[] data;
+			return false;
+		}
+
+		loaded += chunk;
+	}
+
+	cacheBudget -= bytes;
+	this->cache = data;
+	this->position = 0;
+
+	return true;
+}
+
+int16_t StreamingSignalData::getCachedSample()
+{
+	uint32_t index = this->position;
+	int16_t sample = this->cache[index];
+
+	if (!reversed)
+	{
+		this->position = (index >= this->cacheEnd) ? this->startIndex : index + 1;
+	}
+	else
+	{
+		this->position = (index <= this->startIndex) ? this->cacheEnd : index - 1;
+	}
+
+	return sample;
+}
+
+void StreamingSignalData::getCachedSamples(int16_t* block, int samples)
+{
+	uint32_t index = this->position;
+	int i = 0;
+
+	/* Reversed, the cache is walked down by index instead of being copied */
+	if (reversed)
+	{
+		while (i < samples)
+		{
+			if ((index < this->startIndex) || (index > this->cacheEnd)) index = this->cacheEnd;
+
+			int run = index - this->startIndex + 1;
+
+			if (run > samples - i) run = samples - i;
+
+			for (int j = 0; j < run; j++) block[i + j] = this->cache[index - j];
+
+			i += run;
+			index = (run > (int)(index - this->startIndex)) ? this->cacheEnd : index - run;
+		}
+
+		this->position = index;
+		return;
+	}
+
+	/* Forward playback is a straight copy up to the loop point */
+	while (i < samples)
+	{
+		if (index > this->cacheEnd) index = this->startIndex;
+
+		int run = this->cacheEnd - index + 1;
+
+		if (run > samples - i) run = samples - i;
+
+		memcpy(block + i, &this->cache[index], run * sizeof(block[0]));
+		index += run;
+		i += run;
+	}
+
+	this->position = (index > this->cacheEnd) ? this->startIndex : index;
+}
+
+void StreamingSignalData::nextBuffer()
+{
+	/* Move on if the next slot has been filled, otherwise play this one again */
+	if ((this->head - this->tail) > 1)
+	{
+		this->tail = this->tail + 1;
+	}
+	else
+	{
+		this->underruns++;
+	}
+}
+
+int16_t StreamingSignalData::getRawSample()
 {
 	if (!available)
 	{
 		return 0;
 	}
-	
+
+	/* A seek that's ready is picked up here so the switch happens between two samples */
+	if (this->seekState == SEEK_READY)
+	{
+		this->switchToSeek();
+	}
+
+	int16_t sample = (this->cache != NULL) ? this->getCachedSample() : this->getStreamedSample();
+
+	/* Fade from where we were to where we're going */
+	if (this->fadeIndex < STREAM_CROSSFADE)
+	{
+		sample = ((this->fadeOut[this->fadeIndex] * (STREAM_CROSSFADE - this->fadeIndex)) + (sample * this->fadeIndex)) / STREAM_CROSSFADE;
+		this->fadeIndex++;
+	}
+
+	return sample;
+}
+
+void StreamingSignalData::switchToSeek()
+{
+	/* Whatever would have played next is what fades out */
+	for (int i = 0; (i < STREAM_CROSSFADE) && this->seekFade; i++)
+	{
+		this->fadeOut[i] = (this->cache != NULL) ? this->getCachedSample() : this->getStreamedSample();
+	}
+
+	if (this->cache != NULL)
+	{
+		this->position = this->seekTarget;
+	}
+	else
+	{
+		/* The producer is waiting on us, so the ring is ours to restart from the seek buffer */
+		memcpy(this->slot(this->tail), this->seekBuffer, this->bufferSize * sizeof(int16_t));
+
+		this->head = this->tail + 1;
+		this->nextsampleindex = reversed ? this->bufferSize - 1 : 0;
+	}
+
+	this->fadeIndex = this->seekFade ? 0 : STREAM_CROSSFADE;
+	this->seekState = SEEK_IDLE;
+}
+
+int16_t StreamingSignalData::getStreamedSample()
+{
 	/* Get the next sample and hold on to it */
-	short int nextsample = this->buffer[readbufferindex][nextsampleindex];
+	short int nextsample = this->slot(this->tail)[nextsampleindex];
 
 	/* If the loop length is less than a full buffer and we're at the end, just keep looping */
-	if (!reversed && this->subEndIndex < STREAM_BUFFER_SIZE && this->nextsampleindex == this->subEndIndex)
+	if (!reversed && this->subEndIndex < this->bufferSize && this->nextsampleindex == this->subEndIndex)
 	{
 		this->nextsampleindex = 0;
 
 		return nextsample;
 	}
-	else if (reversed && this->subEndIndex < STREAM_BUFFER_SIZE && this->nextsampleindex == (STREAM_BUFFER_SIZE - this->subEndIndex))
+	else if (reversed && this->subEndIndex < this->bufferSize && this->nextsampleindex == (this->bufferSize - this->subEndIndex))
 	{
-		this->nextsampleindex = STREAM_BUFFER_SIZE - 1;
+		this->nextsampleindex = this->bufferSize - 1;
 
 		return nextsample;
 	}
 
 	/* If we're at the end of a buffer, move to the next */
-	if ((!reversed && (this->nextsampleindex == (STREAM_BUFFER_SIZE - 1))) || (reversed && (this->nextsampleindex == 0)))
+	if ((!reversed && (this->nextsampleindex == (this->bufferSize - 1))) || (reversed && (this->nextsampleindex == 0)))
 	{		
-		this->readbufferindex = !this->readbufferindex;
-		this->nextsampleindex = reversed ? STREAM_BUFFER_SIZE - 1 : 0;	
+		this->nextBuffer();
+		this->nextsampleindex = reversed ? this->bufferSize - 1 : 0;	
 	}
 	else
 	{
@@ -332,6 +1022,206 @@ int16_t StreamingSignalData::getNextSample()
 	return nextsample;
 }
 
+void StreamingSignalData::getRawSamples(int16_t* block, int samples)
+{
+	if (!available)
+	{
+		memset(block, 0, samples * sizeof(block[0]));
+		return;
+	}
+
+	/* Seeks and crossfades go a sample at a time */
+	if ((this->seekState == SEEK_READY) || (this->fadeIndex < STREAM_CROSSFADE))
+	{
+		for (int i = 0; i < samples; i++) block[i] = this->getRawSample();
+		return;
+	}
+
+	if (this->cache != NULL)
+	{
+		this->getCachedSamples(block, samples);
+		return;
+	}
+	
+	int i = 0;
+	
+	while (i < samples)
+	{
+		int index = this->nextsampleindex;
+		
+		/* Going forward, everything up to the loop point or the end of the buffer is a straight copy */
+		if (!reversed)
+		{
+			int stop = ((this->subEndIndex < this->bufferSize) && (index <= this->subEndIndex)) ? this->subEndIndex : this->bufferSize - 1;
+			int run = stop - index;
+			
+			if (run > samples - i) run = samples - i;
+			
+			if (run > 0)
+			{
+				memcpy(block + i, &this->slot(this->tail)[index], run * sizeof(block[0]));
+				this->nextsampleindex = index + run;
+				i += run;
+				
+				continue;
+			}
+		}
+		
+		else
+		{
+			/* Going backward it's the same run, walked down to the loop point or the start of the buffer */
+			int stop = ((this->subEndIndex < this->bufferSize) && (index >= (this->bufferSize - this->subEndIndex))) ? this->bufferSize - this->subEndIndex : 0;
+			int run = index - stop;
+			
+			if (run > samples - i) run = samples - i;
+			
+			if (run > 0)
+			{
+				const int16_t* source = this->slot(this->tail);
+				
+				for (int j = 0; j < run; j++) block[i + j] = source[index - j];
+				
+				this->nextsampleindex = index - run;
+				i += run;
+				
+				continue;
+			}
+		}
+		
+		/* Wrapping takes the long way round */
+		block[i++] = this->getRawSample();
+	}
+}
+
+int16_t StreamingSignalData::getNextSample()
+{
+	int16_t sample;
+
+	if (this->speed != STREAM_SPEED_UNITY)
+	{
+		this->resample(&sample, 1);
+		return sample;
+	}
+
+	sample = this->getRawSample();
+
+	this->history[0] = this->history[1];
+	this->history[1] = this->history[2];
+	this->history[2] = this->history[3];
+	this->history[3] = sample;
+
+	return sample;
+}
+
+void StreamingSignalData::getNextSamples(int16_t* block, int samples)
+{
+	if (this->speed == STREAM_SPEED_UNITY)
+	{
+		this->getRawSamples(block, samples);
+
+		/* Keep the history current so a change of speed doesn't start from stale samples */
+		for (int i = (samples > 4) ? samples - 4 : 0; i < samples; i++)
+		{
+			this->history[0] = this->history[1];
+			this->history[1] = this->history[2];
+			this->history[2] = this->history[3];
+			this->history[3] = block[i];
+		}
+
+		return;
+	}
+
+	for (int i = 0; i < samples; i += STREAM_RESAMPLE_BLOCK)
+	{
+		this->resample(block + i, (samples - i > STREAM_RESAMPLE_BLOCK) ? STREAM_RESAMPLE_BLOCK : samples - i);
+	}
+}
+
+static inline int16_t interpolateHermite(const int16_t* x, uint32_t t)
+{
+	/* 4 point, 3rd order Hermite through x[1] and x[2], with every coefficient doubled to stay in integers */
+	int32_t c1 = x[2] - x[0];
+	int32_t c2 = (2 * x[0]) - (5 * x[1]) + (4 * x[2]) - x[3];
+	int32_t c3 = (x[3] - x[0]) + (3 * (x[1] - x[2]));
+
+	int32_t y = (int32_t)(((int64_t)c3 * t) >> 16) + c2;
+	y = (int32_t)(((int64_t)y * t) >> 16) + c1;
+	y = x[1] + ((int32_t)(((int64_t)y * t) >> 16) >> 1);
+
+	return (y > 32767) ? 32767 : (y < -32768) ? -32768 : y;
+}
+
+void StreamingSignalData::resample(int16_t* block, int samples)
+{
+	uint32_t speed = this->speed;
+	uint32_t phase = this->phase;
+
+	/* Read everything this block will step over in one go, behind the samples we already have */
+	int needed = (phase + (speed * samples)) >> 16;
+	int16_t window[4 + (STREAM_RESAMPLE_BLOCK * (STREAM_SPEED_MAX >> 16))];
+
+	memcpy(window, this->history, sizeof(this->history));
+	this->getRawSamples(window + 4, needed);
+
+	const int16_t* x = window;
+
+	switch (this->interpolation)
+	{
+		case INTERPOLATION_NONE:
+			for (int i = 0; i < samples; i++)
+			{
+				block[i] = x[1];
+
+				phase += speed;
+				x += phase >> 16;
+				phase &= 0xFFFF;
+			}
+			break;
+
+		case INTERPOLATION_LINEAR:
+			for (int i = 0; i < samples; i++)
+			{
+				/* The fraction drops a bit so the product fits in 32 bits */
+				block[i] = x[1] + (((x[2] - x[1]) * (int32_t)(phase >> 1)) >> 15);
+
+				phase += speed;
+				x += phase >> 16;
+				phase &= 0xFFFF;
+			}
+			break;
+
+		case INTERPOLATION_HERMITE:
+			for (int i = 0; i < samples; i++)
+			{
+				block[i] = interpolateHermite(x, phase);
+
+				phase += speed;
+				x += phase >> 16;
+				phase &= 0xFFFF;
+			}
+			break;
+	}
+
+	memcpy(this->history, x, sizeof(this->history));
+	this->phase = phase;
+}
+
+void StreamingSignalData::setSpeed(uint32_t speed)
+{
+	/* A 16.16 ratio of the recorded rate */
+	this->speed = (speed < STREAM_SPEED_MIN) ? STREAM_SPEED_MIN : (speed > STREAM_SPEED_MAX) ? STREAM_SPEED_MAX : speed;
+}
+
+uint32_t StreamingSignalData::getSpeed()
+{
+	return this->speed;
+}
+
+void StreamingSignalData::setInterpolation(StreamInterpolation interpolation)
+{
+	this->interpolation = interpolation;
+}
+
 void StreamingSignalData::reverse()
 {
 	this->reversed = !this->reversed;
@@ -339,34 +1229,111 @@ void StreamingSignalData::reverse()
 
 void StreamingSignalData::reset()
 {
-	//TODO: crossfade with a few of the upcoming samples
-	
-	this->writebufferindex = !this->readbufferindex;
+	/* If the start moved and hasn't been read yet, it has to come off the card */
+	this->seek(this->startIndex, this->refreshCache ? NULL : this->resetCache, true);
+}
 
-	/* Seek to where we would be after loading the cache */
-	this->file.seekSet((this->startIndex + STREAM_BUFFER_SIZE) * 2);	
+void StreamingSignalData::seekRandom()
+{
+	/* We have to end up on an even word, and not on the last sample */
+	this->seek(Entropy::getValue(this->startIndex, (this->cache != NULL) ? this->cacheEnd : this->endIndex - 1), NULL, true);
+}
 
-	/* Copy what's in our cache into the readbuffer */
-	memcpy(buffer[writebufferindex], resetCache, STREAM_BUFFER_SIZE * sizeof(buffer[0][0]));
+void StreamingSignalData::seek(uint32_t sample, const int16_t* head, bool fade)
+{
+	if (!this->available) return;
 
-	/* Line up the new read/write buffers */
-	this->readbufferindex = this->writebufferindex;
-	this->writebufferindex = !this->readbufferindex;
-	this->nextsampleindex = 0;	
-	
-	/* And signal that we can start reading from the new position into the write buffer */
-	this->refresh();
+	/* Keep the interrupt from picking up a seek while we change it */
+	this->seekState = SEEK_IDLE;
+	this->seekTarget = sample;
+	this->seekFade = fade;
+
+	if (this->cache != NULL)
+	{
+		this->seekState = SEEK_READY;
+		return;
+	}
+
+	if (head == NULL)
+	{
+		this->resumePosition = -1;
+		this->seekState = SEEK_REQUESTED;
+		return;
+	}
+
+	/* The first buffer is already in memory, and the file picks up just past it */
+	memcpy(this->seekBuffer, head, this->bufferSize * sizeof(int16_t));
+
+	this->resumePosition = (sample + this->bufferSize) * 2;
+	this->seekState = SEEK_READY;
 }
 
-void StreamingSignalData::seekRandom()
+bool StreamingSignalData::readHead(uint32_t sample, int16_t* target)
 {
-	/* We have to end up on an even word, and not on the last sample */
-	this->file.seekSet(Entropy::getValue(this->startIndex, this->endIndex - 1) * 2);
-	
-	this->writebufferindex = !this->readbufferindex;
-	this->refresh();
+	if (!this->available) return false;
 
-	this->readbufferindex = this->writebufferindex;
-	this->nextsampleindex = 0;
+	if (this->cache != NULL)
+	{
+		uint32_t count = ((sample + this->bufferSize) > this->sampleCount) ? this->sampleCount - sample : this->bufferSize;
+
+		memset(target, 0, this->bufferSize * sizeof(int16_t));
+		memcpy(target, &this->cache[sample], count * sizeof(int16_t));
+
+		return true;
+	}
+
+	/* Reads one buffer ahead of time for seek(), leaving the file where it was */
+	uint32_t position = this->file.curPosition();
+
+	this->fileSeek(sample * 2);
+	this->readBuffer(target);
+	this->file.seekSet(position);
+
+	return this->available;
 }
 
+
+StreamScheduler::StreamScheduler(int burst)
+{
+	this->burst = (burst < 1) ? 1 : burst;
+}
+
+void StreamScheduler::add(StreamingSignalData* stream)
+{
+	this->streams.push_back(stream);
+}
+
+void StreamScheduler::service()
+{
+	/* One run per tick, plus one for every other stream that's about to run dry */
+	for (unsigned int visit = 0; visit < this->streams.size(); visit++)
+	{
+		StreamingSignalData* next = NULL;
+		uint32_t least = 0xFFFFFFFF;
+
+		/* Pick the stream closest to running dry */
+		for (unsigned int i = 0; i < this->streams.size(); i++)
+		{
+			if (!this->streams[i]->isReadyForRefresh()) continue;
+
+			uint32_t queued = this->streams[i]->getQueued();
+
+			if (queued < least)
+			{
+				least = queued;
+				next = this->streams[i];
+			}
+		}
+
+		if ((next == NULL) || ((visit > 0) && (least > 1))) return;
+
+		/* Unless it's about to run dry, wait until there's room for a whole run so the reads come back to back */
+		if ((least > 1) && ((next->getBufferCount() - least) < (uint32_t)this->burst)) return;
+
+		/* Then read the run while the card is already there */
+		for (int i = 0; (i < this->burst) && next->isReadyForRefresh(); i++)
+		{
+			next->refresh();
+		}
+	}
+}
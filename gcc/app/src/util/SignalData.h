@@ -23,14 +23,69 @@
 #define SignalData_h
 
 #include <sd/SD.h>
+#include <vector>
 
 namespace nw2s
 {		
 	class SignalData;
 	class StreamingSignalData;
+	class StreamScheduler;
 
+	/* Stream buffers are in samples, a multiple of one 512 byte SD block */
 	static const int STREAM_BUFFER_SIZE = 512;
-	static const int READ_BUFFER_SIZE = STREAM_BUFFER_SIZE * 2;
+	static const int STREAM_BUFFER_COUNT = 2;
+	static const int STREAM_BUFFER_MIN = 256;
+	static const int STREAM_BUFFER_MAX = 4096;
+	static const int STREAM_BUFFER_COUNT_MAX = 16;
+
+	/* Loops up to STREAM_CACHE_SIZE bytes are held in RAM, as long as they fit in what's left of the budget */
+	static const uint32_t STREAM_CACHE_SIZE = 16384;
+	static const uint32_t STREAM_CACHE_BUDGET = 32768;
+
+	/* Seeks crossfade from the old position to the new one over this many samples */
+	static const int STREAM_CROSSFADE = 64;
+
+	enum StreamSeekState
+	{
+		SEEK_IDLE,
+		SEEK_REQUESTED,
+		SEEK_READY
+	};
+
+	/* Playback speed is a 16.16 ratio, two octaves either way of the recorded pitch */
+	static const uint32_t STREAM_SPEED_UNITY = 0x10000;
+	static const uint32_t STREAM_SPEED_MIN = STREAM_SPEED_UNITY / 4;
+	static const uint32_t STREAM_SPEED_MAX = STREAM_SPEED_UNITY * 4;
+
+	/* Resampling works through the output this many samples at a time */
+	static const int STREAM_RESAMPLE_BLOCK = 32;
+
+	enum StreamInterpolation
+	{
+		INTERPOLATION_NONE,
+		INTERPOLATION_LINEAR,
+		INTERPOLATION_HERMITE
+	};
+
+	/* Which side of a stereo file is played */
+	enum StreamChannel
+	{
+		CHANNEL_MIX,
+		CHANNEL_LEFT,
+		CHANNEL_RIGHT
+	};
+
+	/* Where the samples are in a loop file and what they look like. Files without a RIFF header are raw 16 bit mono. */
+	struct WaveFormat
+	{
+		uint16_t channels;
+		uint16_t bits;
+		uint32_t dataStart;
+		uint32_t dataSize;
+	};
+
+	/* How many buffers the scheduler reads for one stream before it looks at the others */
+	static const int STREAM_SCHEDULER_BURST = 2;
 }
 
 class nw2s::SignalData
@@ -53,27 +108,86 @@ class nw2s::SignalData
 class nw2s::StreamingSignalData
 {
 	public:
-		static StreamingSignalData* fromSDFile(char *foldername, char* subfoldername, char *filename, bool loop = false);
+		static StreamingSignalData* fromSDFile(const char* foldername, const char* subfoldername, const char* filename, bool loop = false, int buffers = STREAM_BUFFER_COUNT, int buffersize = STREAM_BUFFER_SIZE, uint32_t cachesize = STREAM_CACHE_SIZE, StreamChannel channel = CHANNEL_MIX);
+		static void printStats();
 		int16_t getNextSample();
+		void getNextSamples(int16_t* block, int samples);
 		bool isAvailable();
+		bool isCached();
 		bool isReadyForRefresh();
 		void refresh();
 		void reset();
 		void seekRandom();
+		void seek(uint32_t sample, const int16_t* head, bool fade);
+		bool readHead(uint32_t sample, int16_t* target);
 		void reverse();
+		uint32_t getUnderruns();
+		uint32_t getQueued();
+		uint32_t getRefreshCount();
+		uint32_t getRefreshAverage();
+		uint32_t getRefreshPeak();
+		int getBufferSize();
+		int getBufferCount();
+		uint32_t getSampleCount();
+		void setSpeed(uint32_t speed);
+		uint32_t getSpeed();
+		void setInterpolation(StreamInterpolation interpolation);
 
 		void setStartFactor(uint16_t startfactor);
 		void setEndFactor(uint16_t lengthFactor);
 		void setFineEndFactor(uint16_t fineLengthFactor);
 		
 	private:
-		int16_t buffer[2][nw2s::STREAM_BUFFER_SIZE];
-		int16_t resetCache[nw2s::STREAM_BUFFER_SIZE];
+		static std::vector<StreamingSignalData*> streams;
+		static uint32_t cacheBudget;
+
+		/* A loop that was small enough is played straight out of RAM and never touches the card again */
+		int16_t* cache = NULL;
+		uint32_t cacheEnd = 0;
+		volatile uint32_t position = 0;
+
+		/* 
+			A single producer, single consumer ring of buffers. refresh() fills the slot 
+			at head and the audio interrupt plays the one at tail, so neither has to lock.
+			Only the producer moves head and only the consumer moves tail.
+		*/
+		int16_t* buffers = NULL;
+		int bufferCount;
+		int bufferSize;
+		volatile uint32_t head = 0;
+		volatile uint32_t tail = 0;
+		volatile uint32_t underruns = 0;
+
+		/* How long the refreshes that read a buffer took, for printStats() */
+		uint32_t refreshCount = 0;
+		uint64_t refreshTime = 0;
+		uint32_t refreshPeak = 0;
+
+		int16_t* resetCache = NULL;
+
+		/* 
+			Off unity speed, the loop is read at its own rate and resampled. phase is the 
+			fraction of the way from history[1] to history[2], the last four samples read.
+		*/
+		volatile uint32_t speed = STREAM_SPEED_UNITY;
+		uint32_t phase = 0;
+		int16_t history[4] = { 0, 0, 0, 0 };
+		StreamInterpolation interpolation = INTERPOLATION_LINEAR;
+
+		/* 
+			Seeks never wait on the card. A request is read into seekBuffer by refresh(),
+			then the audio interrupt switches over to it and crossfades.
+		*/
+		int16_t* seekBuffer = NULL;
+		volatile StreamSeekState seekState = SEEK_IDLE;
+		uint32_t seekTarget = 0;
+		int32_t resumePosition = -1;
+		int32_t reverseStart = -1;
+		bool seekFade = true;
+		int16_t fadeOut[STREAM_CROSSFADE];
+		int fadeIndex = STREAM_CROSSFADE;
 		bool refreshCache = true;
 		volatile bool refreshing = false;
-		volatile uint8_t readbufferindex;
-		volatile uint8_t writebufferindex;
-		int size[2];
 		uint64_t sampleCount = 0;
 		uint16_t startFactor = 0;
 		uint16_t endFactor = 4095;
@@ -84,15 +198,59 @@ class nw2s::StreamingSignalData
 		bool reversed;
 		SdFile file;
 
+		/* File positions are in bytes from the first sample, which is after the header in a WAV file */
+		uint32_t dataStart = 0;
+		uint32_t dataSize = 0;
+
+		/* Contiguous files are streamed straight from the card with multiple block reads */
+		bool contiguous = false;
+		uint32_t firstBlock = 0;
+		uint32_t cachedBlock = 0xFFFFFFFF;
+		uint8_t blockCache[512];
+
 		uint64_t endIndex = 0;
-		uint16_t subEndIndex = READ_BUFFER_SIZE;
+		uint16_t subEndIndex;
 		uint64_t startIndex = 0;
-		volatile uint32_t buffercount = 0;
-		volatile uint32_t bufferindex[2] = { 0, 0 };
 		
-		StreamingSignalData(char *foldername, char* subfoldername, char *filename, bool loop = false);
+		StreamingSignalData(const char* foldername, const char* subfoldername, const char* filename, bool loop, int buffers, int buffersize, uint32_t cachesize, StreamChannel channel);
+
+		static bool parseWave(SdFile* file, WaveFormat* format);
+		bool transcode(SdFile* dir, const char* filename, WaveFormat* format, StreamChannel channel);
 		
+		int16_t* slot(uint32_t index) { return this->buffers + ((index % this->bufferCount) * this->bufferSize); }
+		uint32_t filePosition() { return this->file.curPosition() - this->dataStart; }
+		void fileSeek(uint32_t position) { this->file.seekSet(this->dataStart + position); }
+		int readData(uint8_t* target, int bytes);
+		void nextBuffer();
+		void readBuffer(int16_t* target);
+		void readBufferReversed(int16_t* target);
+		void switchToSeek();
+		int16_t getRawSample();
+		void getRawSamples(int16_t* block, int samples);
+		void resample(int16_t* block, int samples);
+		int16_t getStreamedSample();
+		bool loadCache(uint32_t cachesize);
+		int16_t getCachedSample();
+		void getCachedSamples(int16_t* block, int samples);
 		void calculateEndpoints();
+		bool readBlocks(uint32_t position, uint8_t* target, uint32_t bytes);
+};
+
+/*
+	Several streams reading the same card. Each service() tops up the one closest to
+	running dry, a few buffers in a row, so the card keeps streaming from one place
+	instead of restarting a read for every stream on every tick.
+*/
+class nw2s::StreamScheduler
+{
+	public:
+		StreamScheduler(int burst = STREAM_SCHEDULER_BURST);
+		void add(StreamingSignalData* stream);
+		void service();
+
+	private:
+		std::vector<StreamingSignalData*> streams;
+		int burst;
 };
 
 #endif
@@ -0,0 +1,120 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "TimerWheel.h"
+
+using namespace std;
+using namespace nw2s;
+
+TimerWheel::TimerWheel()
+{
+	this->now = 0;
+	this->count = 0;
+}
+
+unsigned long TimerWheel::size()
+{
+	return this->count;
+}
+
+void TimerWheel::add(TimeBasedDevice* device, unsigned long wake)
+{
+	TimerWheelEntry entry = { device, wake };
+	
+	this->insert(entry);
+	this->count++;
+}
+
+void TimerWheel::insert(TimerWheelEntry entry)
+{
+	/* Compare as a signed difference so that millis() wrapping around doesn't matter */
+	long delay = (long)(entry.wake - this->now);
+	
+	if (delay < 0)
+	{
+		entry.wake = this->now;
+		delay = 0;
+	}
+	else if ((unsigned long)delay > TIMER_WHEEL_MAX_DELAY)
+	{
+		/* Park it as far out as we can and let it cascade back through */
+		entry.wake = this->now + TIMER_WHEEL_MAX_DELAY;
+		delay = TIMER_WHEEL_MAX_DELAY;
+	}
+
+	if (delay < TIMER_WHEEL_LEVEL0_SIZE)
+	{
+		this->level0[entry.wake & (TIMER_WHEEL_LEVEL0_SIZE - 1)].push_back(entry);
+		return;
+	}
+
+	for (int level = 0; level < TIMER_WHEEL_LEVELS - 1; level++)
+	{
+		int shift = TIMER_WHEEL_LEVEL0_BITS + ((level + 1) * TIMER_WHEEL_LEVELN_BITS);
+		
+		if ((level == TIMER_WHEEL_LEVELS - 2) || ((unsigned long)delay < (1UL << shift)))
+		{
+			int slot = (entry.wake >> (shift - TIMER_WHEEL_LEVELN_BITS)) & (TIMER_WHEEL_LEVELN_SIZE - 1);
+			this->levels[level][slot].push_back(entry);
+			return;
+		}
+	}
+}
+
+void TimerWheel::cascade(int level)
+{
+	int shift = TIMER_WHEEL_LEVEL0_BITS + (level * TIMER_WHEEL_LEVELN_BITS);
+	int slot = (this->now >> shift) & (TIMER_WHEEL_LEVELN_SIZE - 1);
+	
+	/* Everything in this slot is now close enough to go down at least one level */
+	vector<TimerWheelEntry> entries;
+	entries.swap(this->levels[level][slot]);
+	
+	/* The next level up has to come down first if it has also wrapped */
+	if ((slot == 0) && (level < TIMER_WHEEL_LEVELS - 2)) this->cascade(level + 1);
+	
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		this->insert(entries[i]);
+	}
+}
+
+void TimerWheel::advance(unsigned long t, vector<TimeBasedDevice*>& due)
+{
+	/* If the main loop was late, catch up one slot at a time */
+	while ((long)(t - this->now) >= 0)
+	{
+		int slot = this->now & (TIMER_WHEEL_LEVEL0_SIZE - 1);
+		
+		if (slot == 0) this->cascade(0);
+
+		vector<TimerWheelEntry>& entries = this->level0[slot];
+		
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			due.push_back(entries[i].device);
+		}
+		
+		this->count -= entries.size();
+		entries.clear();
+		
+		this->now++;
+	}
+}
@@ -0,0 +1,83 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+
+	A hierarchical timer wheel for devices that know when they next need to run.
+	The first level has one slot per millisecond for the next 256mS, and each of the
+	three levels above it has 64 slots that are 64 times coarser than the level below.
+	Anything further out than about 18 hours is parked in the last slot and cascaded
+	down again when it comes around. Advancing the wheel only touches the slots that
+	are passing, so idle devices cost nothing per tick no matter how many there are.
+
+*/
+
+#ifndef TimerWheel_h
+#define TimerWheel_h
+
+#include <iterator>
+#include <vector>
+
+#define TIMER_WHEEL_LEVEL0_BITS 8
+#define TIMER_WHEEL_LEVELN_BITS 6
+#define TIMER_WHEEL_LEVELS 4
+
+using namespace std;
+
+namespace nw2s
+{
+	class TimeBasedDevice;
+	class TimerWheel;
+
+	struct TimerWheelEntry
+	{
+		TimeBasedDevice* device;
+		unsigned long wake;
+	};
+	
+	static const int TIMER_WHEEL_LEVEL0_SIZE = 1 << TIMER_WHEEL_LEVEL0_BITS;
+	static const int TIMER_WHEEL_LEVELN_SIZE = 1 << TIMER_WHEEL_LEVELN_BITS;
+	static const unsigned long TIMER_WHEEL_MAX_DELAY = (1UL << (TIMER_WHEEL_LEVEL0_BITS + ((TIMER_WHEEL_LEVELS - 1) * TIMER_WHEEL_LEVELN_BITS))) - 1;
+}
+
+class nw2s::TimerWheel
+{
+	public:
+		TimerWheel();
+
+		/* Wake times in the past are run on the next tick */
+		void add(TimeBasedDevice* device, unsigned long wake);
+		
+		/* Moves the wheel up to and including t, appending every device that came due */
+		void advance(unsigned long t, vector<TimeBasedDevice*>& due);
+		
+		unsigned long size();
+
+	private:
+		unsigned long now;
+		unsigned long count;
+		vector<TimerWheelEntry> level0[TIMER_WHEEL_LEVEL0_SIZE];
+		vector<TimerWheelEntry> levels[TIMER_WHEEL_LEVELS - 1][TIMER_WHEEL_LEVELN_SIZE];
+		
+		void insert(TimerWheelEntry entry);
+		void cascade(int level);
+};
+
+#endif
@@ -19,20 +19,24 @@
 */
 
 #include <Arduino.h>
-#include "Audiodevice.h"
+#include "AudioDevice.h"
+#include "AnalogScanner.h"
+#include "Clock.h"
 
-void TC4_Handler()
+void DACC_Handler()
 {
-	// We need to get the status to clear it and allow the interrupt to fire again
-	TC_GetStatus(TC1, 1);
-
-	nw2s::AudioDevice::device0->timer_handler();
+	/* Writing the next buffer's count clears ENDTX */
+	nw2s::AudioDevice::block_handler();
 }
 
-void TC5_Handler()
+void ADC_Handler()
 {
-	// We need to get the status to clear it and allow the interrupt to fire again
-	TC_GetStatus(TC1, 2);
+	/* Writing the next buffer's count clears ENDRX */
+	nw2s::AnalogScanner::block_handler();
+}
 
-	nw2s::AudioDevice::device1->timer_handler();
+void TC3_Handler()
+{
+	/* Reading the status clears the compare */
+	nw2s::Clock::beat_handler();
 }
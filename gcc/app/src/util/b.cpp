@@ -55,8 +55,8 @@ int8_t b::outputOffset[16][21] = {
 	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
 	
 };
-// int16_t b::inputOffset[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-// int32_t b::inputScale[12] = { 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000 };
+int16_t b::inputOffset[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+int32_t b::inputScale[12] = { 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000 };
 
 SdFile b::root;
 Sd2Card b::card;
@@ -104,6 +104,9 @@ void b::configure()
 	SdFile configDir;
 	SdFile configFile;
 
+	/* Input calibration doesn't depend on sys.b being there */
+	b::loadInputCalibration();
+
 	/* Open the file '/config/sys.b' */
 
 	root = getSDRoot();
@@ -126,7 +129,7 @@ void b::configure()
 	char configData[fileSize + 1];
 
 	configFile.read(configData, fileSize);
-	configData[fileSize] == '\0';
+	configData[fileSize] = '\0';
 		
 	aJsonObject* config = aJson.parse(configData);
 
@@ -235,75 +238,120 @@ void b::configure()
 		{
 			Serial.println("Configuration requires 16 offset channels, skipping.");
 		}
+
+		AnalogOut::compileSoftTune();
 	}
 	else
 	{
 		Serial.println("Using default output tuning");
 	}
 	
+}
 
-	/* Input config */
-
-	// aJsonObject* inputNode = aJson.getObjectItem(configNode, "inputs");
-	//
-	// aJsonObject* inputTuneNode = aJson.getObjectItem(inputNode, "software-tune");
-	//
-	// if (inputTuneNode->valuebool)
-	// {
-	// 	b::inputSoftTune = true;
-	//
-	// 	aJsonObject* scaleNode = aJson.getObjectItem(inputNode, "scale");
-	//
-	// 	if (aJson.getArraySize(scaleNode) == 12)
-	// 	{
-	// 		Serial.print("Input Scale: { ");
-	//
-	// 		for (int i = 0; i < aJson.getArraySize(scaleNode); i++)
-	// 		{
-	// 			aJsonObject* valueNode = aJson.getArrayItem(scaleNode, i);
-	//
-	// 			b::inputScale[i] = valueNode->valueint;
-	//
-	// 			Serial.print(b::inputScale[i]);
-	// 			Serial.print(" ");
-	// 		}
-	//
-	// 		Serial.println("}");
-	// 	}
-	// 	else
-	// 	{
-	// 		Serial.println("Configuration requires 12 scale values, skipping.");
-	// 	}
-	//
-	// 	aJsonObject* offsetNode = aJson.getObjectItem(outputNode, "offset");
-	//
-	// 	if (aJson.getArraySize(offsetNode) == 12)
-	// 	{
-	// 		Serial.print("Input Offset: { ");
-	//
-	// 		for (int i = 0; i < aJson.getArraySize(offsetNode); i++)
-	// 		{
-	// 			aJsonObject* valueNode = aJson.getArrayItem(offsetNode, i);
-	//
-	// 			b::inputOffset[i] = valueNode->valueint;
-	//
-	// 			Serial.print(b::inputOffset[i]);
-	// 			Serial.print(" ");
-	// 		}
-	//
-	// 		Serial.println("}");
-	// 	}
-	// 	else
-	// 	{
-	// 		Serial.println("Configuration requires 12 offset values, skipping.");
-	// 	}
-	// }
-	// else
-	// {
-	// 	Serial.println("Using default output tuning");
-	// }
-	
-	
+bool b::loadInputCalibration()
+{
+	/* Reads /config/inputs.b as written by the calibrateInputs firmware */
+	SdFile root = getSDRoot();
+	SdFile configDir;
+	SdFile calibrationFile;
+
+	if (!configDir.open(root, "CONFIG", O_READ) || !calibrationFile.open(configDir, INPUT_CALIBRATION_FILE, O_READ))
+	{
+		Serial.println("No input calibration found, using default input tuning");
+		return false;
+	}
+
+	uint fileSize = calibrationFile.fileSize();
+	char calibrationData[fileSize + 1];
+
+	calibrationFile.read(calibrationData, fileSize);
+	calibrationData[fileSize] = '\0';
+	calibrationFile.close();
+
+	aJsonObject* calibration = aJson.parse(calibrationData);
+
+	if (calibration == NULL)
+	{
+		Serial.println("Input calibration not parsed successfully, using default input tuning");
+		return false;
+	}
+
+	aJsonObject* tuneNode = aJson.getObjectItem(calibration, "software-tune");
+	aJsonObject* scaleNode = aJson.getObjectItem(calibration, "scale");
+	aJsonObject* offsetNode = aJson.getObjectItem(calibration, "offset");
+
+	if ((scaleNode == NULL) || (offsetNode == NULL) || (aJson.getArraySize(scaleNode) != 12) || (aJson.getArraySize(offsetNode) != 12))
+	{
+		Serial.println("Input calibration requires 12 scale and 12 offset values, skipping.");
+		aJson.deleteItem(calibration);
+		return false;
+	}
+
+	Serial.print("Input Calibration: { ");
+
+	for (int i = 0; i < 12; i++)
+	{
+		b::inputScale[i] = aJson.getArrayItem(scaleNode, i)->valueint;
+		b::inputOffset[i] = aJson.getArrayItem(offsetNode, i)->valueint;
+
+		Serial.print(String(b::inputScale[i]) + "/" + String(b::inputOffset[i]) + " ");
+	}
+
+	Serial.println("}");
+
+	b::inputSoftTune = (tuneNode == NULL) || tuneNode->valuebool;
+	aJson.deleteItem(calibration);
+
+	IOUtils::compileInputTune();
+
+	return true;
 }
 
+bool b::saveInputCalibration()
+{
+	aJsonObject* calibration = aJson.createObject();
+	aJsonObject* scaleNode = aJson.createArray();
+	aJsonObject* offsetNode = aJson.createArray();
+
+	aJson.addItemToObject(calibration, "software-tune", aJson.createItem((char)b::inputSoftTune));
+
+	for (int i = 0; i < 12; i++)
+	{
+		aJson.addItemToArray(scaleNode, aJson.createItem((int)b::inputScale[i]));
+		aJson.addItemToArray(offsetNode, aJson.createItem((int)b::inputOffset[i]));
+	}
+
+	aJson.addItemToObject(calibration, "scale", scaleNode);
+	aJson.addItemToObject(calibration, "offset", offsetNode);
+
+	char calibrationData[512];
+	aJsonStringStream stringStream(NULL, calibrationData, sizeof(calibrationData));
+	aJson.print(calibration, &stringStream);
+	aJson.deleteItem(calibration);
+
+	SdFile root = getSDRoot();
+	SdFile configDir;
+	SdFile calibrationFile;
 
+	if (!configDir.open(root, "CONFIG", O_READ))
+	{
+		if (!configDir.makeDir(root, "CONFIG"))
+		{
+			Serial.println("Could not create config folder, input calibration not saved");
+			return false;
+		}
+	}
+
+	if (!calibrationFile.open(configDir, INPUT_CALIBRATION_FILE, O_CREAT | O_WRITE | O_TRUNC))
+	{
+		Serial.println("Could not open '/config/inputs.b' for writing, input calibration not saved");
+		return false;
+	}
+
+	calibrationFile.println(calibrationData);
+	calibrationFile.close();
+
+	Serial.println("Input calibration saved: " + String(calibrationData));
+
+	return true;
+}
@@ -26,6 +26,7 @@
 
 
 #define TUNE_SCALE_FACTOR 1000
+#define INPUT_CALIBRATION_FILE "INPUTS.B"
 
 namespace nw2s
 {
@@ -55,10 +56,14 @@ class nw2s::b
 		static bool outputSoftTune;
 		static bool inputSoftTune;
 		static int8_t outputOffset[16][21];
-		// static int16_t inputOffset[12];
-		// static int32_t inputScale[12];
+		static int16_t inputOffset[12];
+		static int32_t inputScale[12];
 		static int32_t dimming;
 		static void configure();
+
+		/* Input calibration lives in its own file so the calibration firmware can rewrite it */
+		static bool loadInputCalibration();
+		static bool saveInputCalibration();
 		
 		static SdFile getSDRoot();
 		
@@ -0,0 +1,230 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "HostTest.h"
+#include "EventManager.h"
+#include "IO.h"
+
+using namespace nw2s;
+
+/*
+
+	Traces the SPI bus to the CV DACs while a device moves all 16 outputs every 10mS and
+	another restages the values they already hold on every tick in between. Each MCP4822 is
+	modelled with its input registers loading when its chip select rises and its outputs
+	only following them on the shared LDAC pulse. Every step has to be one command word per
+	output and then a single pulse that moves all 16 at once, restaging has to put nothing
+	on the bus, and a write outside the event loop still has to go out straight away.
+
+*/
+
+#define FRAME_TEST_STEPS 100
+#define FRAME_TEST_PERIOD 10
+
+static uint16_t inputs[16];
+static uint16_t outputs[16];
+static uint32_t commands = 0;
+static uint32_t latches = 0;
+static uint32_t partialLatches = 0;
+static uint32_t outputChanges = 0;
+
+class TraceDac : public HostSpiDevice
+{
+	public:
+		TraceDac(int first)
+		{
+			this->first = first;
+			this->length = 0;
+		}
+
+		virtual void select()
+		{
+			this->length = 0;
+		}
+
+		virtual void deselect()
+		{
+			/* A command word is channel, gain and shutdown bits over 12 bits of value */
+			if (this->length != 2) return;
+
+			uint16_t word = (this->bytes[0] << 8) | this->bytes[1];
+
+			inputs[this->first + (word >> 15)] = word & 0x0FFF;
+			commands++;
+		}
+
+		virtual uint8_t transfer(uint8_t data)
+		{
+			if (this->length < 2) this->bytes[this->length] = data;
+			this->length++;
+
+			return 0;
+		}
+
+	private:
+		int first;
+		uint8_t bytes[2];
+		int length;
+};
+
+/* LDAC is active low, so it looks like a chip select going down */
+class TraceLatch : public HostSpiDevice
+{
+	public:
+		virtual void select()
+		{
+			int changed = 0;
+
+			for (int i = 0; i < 16; i++)
+			{
+				if (outputs[i] != inputs[i]) changed++;
+				outputs[i] = inputs[i];
+			}
+
+			latches++;
+			outputChanges += changed;
+
+			if ((changed > 0) && (changed < 16)) partialLatches++;
+		}
+
+		virtual uint8_t transfer(uint8_t data)
+		{
+			return 0;
+		}
+};
+
+static AnalogOut* outs[16];
+static int mV[16];
+
+class Stepper : public TimeBasedDevice
+{
+	public:
+		int steps;
+
+		Stepper()
+		{
+			this->steps = 0;
+		}
+
+		virtual void timer(unsigned long t)
+		{
+			if ((t % FRAME_TEST_PERIOD) != 0) return;
+
+			this->steps++;
+
+			for (int i = 0; i < 16; i++)
+			{
+				mV[i] = 100 + (((this->steps + i) % 10) * 500);
+				outs[i]->outputCV(mV[i], false);
+			}
+		}
+};
+
+class Restager : public TimeBasedDevice
+{
+	public:
+		virtual void timer(unsigned long t)
+		{
+			if ((t % FRAME_TEST_PERIOD) == 0) return;
+
+			for (int i = 0; i < 16; i++) outs[i]->outputCV(mV[i], false);
+		}
+};
+
+void setup()
+{
+	SimulatedHAL* hal = hostTestHAL();
+
+	/* Each DAC's chip select carries two outputs, the first DAC is on pin 9 */
+	for (int i = 0; i < 8; i++) hal->attachSpiDevice(9 - i, new TraceDac(i * 2));
+
+	hal->attachSpiDevice(DUE_SPI_LATCH, new TraceLatch());
+
+	EventManager::initialize();
+
+	for (int i = 0; i < 16; i++) outs[i] = AnalogOut::create(INDEX_ANALOG_OUT[i + 1]);
+
+	Stepper* stepper = new Stepper();
+
+	EventManager::registerDevice(stepper);
+	EventManager::registerDevice(new Restager());
+
+	hal->setManualTime(true);
+	hal->advance(0);
+
+	/* Outside the event loop a write goes out and latches on its own */
+	commands = 0;
+	latches = 0;
+	outs[3]->outputCV(1234, false);
+
+	HOST_CHECK(commands == 1);
+	HOST_CHECK(latches == 1);
+
+	/* And restaging what it already holds sends nothing */
+	outs[3]->outputCV(1234, false);
+
+	HOST_CHECK(commands == 1);
+	HOST_CHECK(latches == 1);
+
+	/* Start everything from 0V, which is what the restager holds them at until the first step */
+	for (int i = 0; i < 16; i++)
+	{
+		mV[i] = 0;
+		outs[i]->outputCV(0, false);
+	}
+
+	commands = 0;
+	latches = 0;
+	partialLatches = 0;
+	outputChanges = 0;
+	hal->resetStats();
+
+	while (stepper->steps < FRAME_TEST_STEPS)
+	{
+		EventManager::loop();
+		hal->advance(50);
+	}
+
+	/* Let the last step go out */
+	for (int i = 0; i < 4; i++)
+	{
+		EventManager::loop();
+		hal->advance(50);
+	}
+
+	/* One word per output per step, one pulse per step, and every pulse moves all 16 */
+	HOST_CHECK(commands == FRAME_TEST_STEPS * 16);
+	HOST_CHECK(latches == FRAME_TEST_STEPS);
+	HOST_CHECK(partialLatches == 0);
+	HOST_CHECK(outputChanges == FRAME_TEST_STEPS * 16);
+
+	/* Nothing else was on the bus */
+	HOST_CHECK(hal->stats.spiTransactions == commands + latches);
+
+	for (int i = 0; i < 16; i++) HOST_CHECK(outputs[i] == inputs[i]);
+
+	HOST_REPORT("%d steps: %lu SPI transactions, %lu bytes, %lu command words, %lu LDAC pulses, %lu partial", FRAME_TEST_STEPS, (unsigned long)hal->stats.spiTransactions, (unsigned long)hal->stats.spiBytes, (unsigned long)commands, (unsigned long)latches, (unsigned long)partialLatches);
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,222 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "HostTest.h"
+#include "AnalogScanner.h"
+#include "EventManager.h"
+#include "Clock.h"
+#include "RatchetDivider.h"
+#include "Sequence.h"
+#include "ShiftRegister.h"
+
+using namespace nw2s;
+
+/*
+
+	Runs the free running ADC scan and checks what comes out of the snapshots. First every
+	input is set to the number of the conversion about to happen, so each snapshot has to be
+	the average of exactly one scan buffer, with each input's share picked out by its tag.
+	Buffers have to follow on from each other with none dropped or repeated as the PDC swaps
+	between them. Then a conversion goes missing, which puts every later buffer out of step
+	with the channel order, and the tags still have to put each value with the right input.
+
+	Around all of that, the devices from the ratchet and cvSequence examples run for a second
+	before the scanner starts and for a second after, counting the blocking conversions they
+	wait on. Once the scanner is running there shouldn't be any.
+
+*/
+
+/* The ADC channel of each input, in the order a pass converts them */
+static const int ANALOG_TEST_CHANNEL[ANALOG_SCAN_CHANNELS] = { 7, 6, 5, 4, 3, 2, 1, 0, 10, 11, 12, 13 };
+
+#define ANALOG_TEST_PASS ANALOG_SCAN_CHANNELS
+#define ANALOG_TEST_BLOCK (ANALOG_SCAN_CHANNELS * ANALOG_SCAN_OVERSAMPLE)
+
+/* A conversion's number has to fit in 12 bits */
+#define ANALOG_TEST_BLOCKS ((4096 - ANALOG_TEST_BLOCK) / ANALOG_TEST_BLOCK)
+
+static int passPosition(int input)
+{
+	int position = 0;
+
+	for (int i = 0; i < ANALOG_SCAN_CHANNELS; i++)
+	{
+		if (ANALOG_TEST_CHANNEL[i] < ANALOG_TEST_CHANNEL[input]) position++;
+	}
+
+	return position;
+}
+
+#define ANALOG_TEST_EXAMPLE_MS 1000
+
+static void createExamples()
+{
+	/* As in ratchetMain */
+	TapTempoClock* tempoclock = TapTempoClock::create(DUE_IN_D0, DUE_IN_D1, 16);
+
+	tempoclock->registerDevice(Trigger::create(DUE_OUT_D00, DIV_QUARTER));
+	tempoclock->registerDevice(RatchetDivider::create(RATCHET_LIMIT_OFF, DUE_IN_A00, DUE_IN_A01, DUE_OUT_D01));
+	tempoclock->registerDevice(RatchetDivider::create(RATCHET_LIMIT_ODD, DUE_IN_A02, DUE_IN_A03, DUE_OUT_D02));
+	tempoclock->registerDevice(RatchetDivider::create(RATCHET_LIMIT_PRIMES, DUE_IN_A04, DUE_IN_A05, DUE_OUT_D04));
+
+	EventManager::registerDevice(tempoclock);
+
+	/* As in cvSequenceMain */
+	Clock* vclock = VariableClock::create(20, 240, DUE_IN_A00, 16);
+	RandomLoopingShiftRegister* shiftregister = RandomLoopingShiftRegister::create(16, DUE_IN_A01, DIV_SIXTEENTH);
+
+	shiftregister->setCVOut(DUE_SPI_4822_00);
+	shiftregister->setTriggerOut(1, DUE_OUT_D03);
+
+	vclock->registerDevice(shiftregister);
+
+	SequenceNote notelist[8] = { {1,1}, {1,3}, {1,5}, {1,1}, {2,1}, {2,3}, {2,5}, {2,1} };
+	NoteSequenceData* notes = new NoteSequenceData(notelist, notelist + 8);
+
+	EventManager::registerDevice(CVNoteSequencer::create(notes, C, Key::SCALE_MAJOR, DUE_SPI_4822_02, DUE_IN_A02));
+	EventManager::registerDevice(vclock);
+}
+
+/* The number of conversions the examples waited on for a second */
+static uint32_t runExamples()
+{
+	SimulatedHAL* hal = hostTestHAL();
+	uint32_t reads = hal->stats.analogReads;
+
+	for (int ms = 0; ms < ANALOG_TEST_EXAMPLE_MS; ms++)
+	{
+		hal->advance(1000);
+		EventManager::loop();
+	}
+
+	return hal->stats.analogReads - reads;
+}
+
+static void waitForSnapshot(bool ramp)
+{
+	SimulatedHAL* hal = hostTestHAL();
+	uint32_t snapshots = AnalogScanner::getSnapshotCount();
+
+	while (AnalogScanner::getSnapshotCount() == snapshots)
+	{
+		/* The next conversion reads the number of the ones before it */
+		if (ramp)
+		{
+			for (int i = 0; i < ANALOG_SCAN_CHANNELS; i++) hal->setAnalogInput(i, hal->stats.adcConversions);
+		}
+
+		hal->advance(1);
+	}
+}
+
+void setup()
+{
+	SimulatedHAL* hal = hostTestHAL();
+
+	hal->setManualTime(true);
+
+	/* Halfway up, so the clocks and dividers have something to do */
+	for (int i = 0; i < ANALOG_SCAN_CHANNELS; i++) hal->setAnalogInput(i, 2048);
+
+	createExamples();
+
+	uint32_t blockingReads = runExamples();
+
+	for (int i = 0; i < ANALOG_SCAN_CHANNELS; i++) hal->setAnalogInput(i, 0);
+
+	AnalogScanner::begin();
+
+	for (int i = 0; i < ANALOG_SCAN_CHANNELS; i++) AnalogScanner::setFilter(i, 0);
+
+	HOST_CHECK(AnalogScanner::isRunning());
+	HOST_CHECK(hal->stats.adcConversions == 0);
+
+	/* Each snapshot is one whole buffer. Input i was converted at the same place in every pass, so its average is the middle pass. */
+	int errors = 0;
+
+	for (int block = 0; block < ANALOG_TEST_BLOCKS; block++)
+	{
+		waitForSnapshot(true);
+
+		HOST_CHECK(AnalogScanner::getSnapshotCount() == (uint32_t)(block + 1));
+
+		for (int i = 0; i < ANALOG_SCAN_CHANNELS; i++)
+		{
+			int expected = (block * ANALOG_TEST_BLOCK) + ((ANALOG_TEST_PASS * (ANALOG_SCAN_OVERSAMPLE - 1)) / 2) + passPosition(i);
+
+			if (!HOST_CHECK(AnalogScanner::read(i) == expected)) errors++;
+		}
+	}
+
+	HOST_REPORT("%d consecutive buffers averaged, %d inputs out of place", ANALOG_TEST_BLOCKS, errors);
+
+	/* Now each input gets a value of its own */
+	for (int i = 0; i < ANALOG_SCAN_CHANNELS; i++) hal->setAnalogInput(i, 100 + (300 * i));
+
+	waitForSnapshot(false);
+	waitForSnapshot(false);
+
+	for (int i = 0; i < ANALOG_SCAN_CHANNELS; i++) HOST_CHECK(AnalogScanner::read(i) == 100 + (300 * i));
+
+	/* Lose a conversion, so every buffer from here on starts a channel later */
+	ADC->ADC_RPR += sizeof(uint16_t);
+	ADC->ADC_RCR--;
+
+	errors = 0;
+
+	for (int block = 0; block < 20; block++)
+	{
+		waitForSnapshot(false);
+
+		/* The one the conversion went missing from is short by a sample */
+		if (block == 0) continue;
+
+		for (int i = 0; i < ANALOG_SCAN_CHANNELS; i++)
+		{
+			if (!HOST_CHECK(AnalogScanner::read(i) == 100 + (300 * i))) errors++;
+		}
+	}
+
+	HOST_REPORT("a dropped conversion: %d inputs out of place in the next 19 snapshots", errors);
+
+	/* Filtered, an input moves a quarter of the way each snapshot */
+	AnalogScanner::setFilter(0, 2);
+	hal->setAnalogInput(0, 100 + 1024);
+	waitForSnapshot(false);
+
+	HOST_CHECK(AnalogScanner::read(0) == 100 + 256);
+
+	/* The same examples again, reading from the snapshots */
+	for (int i = 0; i < ANALOG_SCAN_CHANNELS; i++) hal->setAnalogInput(i, 2048);
+
+	uint32_t conversions = hal->stats.adcConversions;
+	uint32_t scannedReads = runExamples();
+
+	HOST_CHECK(blockingReads > 0);
+	HOST_CHECK(scannedReads == 0);
+
+	HOST_REPORT("ratchet and cvSequence examples, %d ms: %u blocking conversions before the scanner, %u after (%u in the background)", ANALOG_TEST_EXAMPLE_MS, blockingReads, scannedReads, hal->stats.adcConversions - conversions);
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
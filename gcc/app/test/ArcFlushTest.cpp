@@ -0,0 +1,247 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "BinaryArc.h"
+#include "EventManager.h"
+
+using namespace nw2s;
+
+/*
+
+	Runs BinaryArc on a 120bpm clock for ten seconds with all four encoders turning every
+	2mS, against a modelled arc on a mock USB endpoint, and reports the USB bytes/s it costs.
+	The event loop may never block, no tick may carry more than one ring map, and at the end
+	the rings have to show the current page.
+
+*/
+
+#define ARC_TEST_MS 10000
+#define ARC_TEST_ADDRESS 1
+#define ARC_TEST_CLOCK_MS 125
+
+class TraceArc : public HostUsbDevice
+{
+	public:
+		uint8_t rings[ARC_MAX_ENCODERS][ARC_MAX_LEDS];
+		uint32_t unknownCommands;
+		uint32_t mapsInOneTick;
+
+		/* What the arc was sent, the HAL's counts include the reads */
+		uint32_t bytes;
+		uint32_t transfers;
+
+		/* One input packet waiting for the next read */
+		uint8_t packet[64];
+		uint32_t packetLength;
+
+		TraceArc()
+		{
+			memset(this->rings, 0, sizeof(this->rings));
+			this->unknownCommands = 0;
+			this->mapsInOneTick = 0;
+			this->packetLength = 0;
+			this->lastMap = -1;
+			this->bytes = 0;
+			this->transfers = 0;
+		}
+
+		virtual uint32_t out(uint32_t ep, const uint8_t* data, uint32_t length)
+		{
+			this->bytes += length;
+			this->transfers++;
+
+			if ((data[0] == 0x90) && (length == 4))
+			{
+				this->rings[data[1]][data[2]] = data[3];
+			}
+			else if ((data[0] == 0x91) && (length == 3))
+			{
+				memset(this->rings[data[1]], data[2], ARC_MAX_LEDS);
+			}
+			else if ((data[0] == 0x92) && (length == ARC_RING_MAP_LENGTH))
+			{
+				long now = millis();
+
+				if (now == this->lastMap) this->mapsInOneTick++;
+				this->lastMap = now;
+
+				for (int i = 0; i < ARC_MAX_LEDS / 2; i++)
+				{
+					this->rings[data[1]][i * 2] = data[2 + i] >> 4;
+					this->rings[data[1]][(i * 2) + 1] = data[2 + i] & 0x0F;
+				}
+			}
+			else if ((data[0] == 0x93) && (length == 5))
+			{
+				int end = (data[3] < data[2]) ? data[3] + ARC_MAX_LEDS : data[3];
+
+				for (int led = data[2]; led <= end; led++) this->rings[data[1]][led % ARC_MAX_LEDS] = data[4];
+			}
+			else
+			{
+				this->unknownCommands++;
+			}
+
+			return 0;
+		}
+
+		virtual uint32_t in(uint32_t ep, uint8_t* data, uint32_t* length)
+		{
+			if (this->packetLength == 0)
+			{
+				*length = 0;
+				return 1;
+			}
+
+			memcpy(data, this->packet, this->packetLength);
+			*length = this->packetLength;
+			this->packetLength = 0;
+
+			return 0;
+		}
+
+	private:
+		long lastMap;
+};
+
+/* BinaryArc is only made through create(), so enumeration's results are set through the base class members */
+class ArcAccess : public USBArcController
+{
+	public:
+		static void connect(USBArcController* arc)
+		{
+			uint32_t USBArc::* address = &ArcAccess::bAddress;
+			bool USBArc::* ready = &ArcAccess::ready;
+
+			arc->*address = ARC_TEST_ADDRESS;
+			arc->*ready = true;
+		}
+
+		static uint8_t shows(USBArcController* arc, uint8_t ring, uint8_t led)
+		{
+			uint8_t USBArcController::* page = &ArcAccess::currentPage;
+			uint8_t value = arc->getValue(arc->*page, ring, led);
+
+			return (value > 15) ? 15 : value;
+		}
+};
+
+void setup()
+{
+	SimulatedHAL* hal = hostTestHAL();
+	TraceArc* device = new TraceArc();
+
+	EventManager::initialize();
+
+	BinaryArc* arc = BinaryArc::create(ARC_MAX_ENCODERS, false);
+
+	arc->setClockInput(DUE_IN_D0);
+	EventManager::registerDevice(arc);
+	EventManager::registerUsbDevice(arc);
+
+	hal->setManualTime(true);
+	hal->advance(0);
+
+	/* The stack's first task releases every class driver, get that out of the way before connecting */
+	EventManager::usbHost.Task();
+
+	hal->attachUsbDevice(ARC_TEST_ADDRESS, device);
+	ArcAccess::connect(arc);
+
+	for (int i = 0; i < 20; i++)
+	{
+		EventManager::loop();
+		hal->advance(1000);
+	}
+
+	device->bytes = 0;
+	device->transfers = 0;
+
+	uint64_t start = hal->micros();
+	uint64_t blocked = 0;
+
+	for (int ms = 0; ms < ARC_TEST_MS; ms++)
+	{
+		/* 120bpm sixteenths */
+		hal->setDigitalInput(DUE_IN_D0, (ms % ARC_TEST_CLOCK_MS) < 30);
+
+		/* Every 2mS each encoder reports a delta, after the FTDI status bytes */
+		if ((ms % 2) == 0)
+		{
+			device->packet[0] = 0x31;
+			device->packet[1] = 0x60;
+
+			for (int encoder = 0; encoder < ARC_MAX_ENCODERS; encoder++)
+			{
+				device->packet[2 + (encoder * 3)] = 0x50;
+				device->packet[3 + (encoder * 3)] = encoder;
+				device->packet[4 + (encoder * 3)] = (encoder < 2) ? 2 : (uint8_t)-2;
+			}
+
+			device->packetLength = 2 + (ARC_MAX_ENCODERS * 3);
+		}
+
+		/* Simulated time only moves inside the loop if something waits in delay() */
+		uint64_t before = hal->micros();
+		EventManager::loop();
+		blocked += hal->micros() - before;
+
+		hal->advance(1000);
+	}
+
+	double seconds = (hal->micros() - start) / 1e6;
+	uint32_t bytes = device->bytes;
+	uint32_t transfers = device->transfers;
+
+	/* Let the last changes out */
+	for (int i = 0; i < 10; i++)
+	{
+		EventManager::loop();
+		hal->advance(1000);
+	}
+
+	int mismatches = 0;
+
+	for (int ring = 0; ring < ARC_MAX_ENCODERS; ring++)
+	{
+		for (int led = 0; led < ARC_MAX_LEDS; led++)
+		{
+			if (device->rings[ring][led] != ArcAccess::shows(arc, ring, led)) mismatches++;
+		}
+	}
+
+	HOST_CHECK(blocked == 0);
+	HOST_CHECK(device->mapsInOneTick == 0);
+	HOST_CHECK(device->unknownCommands == 0);
+	HOST_CHECK(mismatches == 0);
+
+	/* Never more than a map and a handful of single commands a tick */
+	HOST_CHECK((bytes / seconds) < (ARC_RING_MAP_LENGTH * 1000));
+
+	HOST_REPORT("BinaryArc, 4 encoders every 2mS and a 120bpm clock: %.0f USB bytes/s, %.0f transfers/s, %.1f%% of loop time blocked", bytes / seconds, transfers / seconds, (100.0 * blocked) / (hal->micros() - start));
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,126 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "AudioDevice.h"
+
+using namespace nw2s;
+
+/*
+
+	Plays a ramp on each DAC, one at 48kHz and one at 24kHz, and reads the blocks back as
+	the PDC would see them. The fast ramp should come out untouched and the slow one should
+	be interpolated up to the stream rate, with no steps where one block meets the next.
+
+*/
+
+#define AUDIO_TEST_BLOCKS 200
+#define AUDIO_TEST_RAMP 8
+
+class RampDevice : public AudioDevice
+{
+	public:
+		uint16_t next;
+		long count;
+
+		RampDevice(PinAudioOut pin, SampleRateInterrupt sri)
+		{
+			this->next = 0;
+			this->count = 0;
+			this->startOutput(pin, sri);
+		}
+
+		virtual void render(uint16_t* block, int samples)
+		{
+			for (int i = 0; i < samples; i++)
+			{
+				block[i] = this->next;
+				this->next = (this->next + AUDIO_TEST_RAMP) & 0x0FFF;
+			}
+
+			this->count += samples;
+		}
+};
+
+void setup()
+{
+	hostTestHAL()->setManualTime(true);
+
+	RampDevice* fast = new RampDevice(DUE_DAC0, SR_48000);
+	RampDevice* slow = new RampDevice(DUE_DAC1, SR_24000);
+
+	int last[2] = { -1, -1 };
+	int steps[2] = { 0, 0 };
+
+	for (int b = 0; b < AUDIO_TEST_BLOCKS; b++)
+	{
+		/* The DACC interrupt renders into the buffer that just finished and queues it as the next one */
+		AudioDevice::block_handler();
+
+		uint16_t* block = (uint16_t*)DACC_INTERFACE->DACC_TNPR;
+		int length = DACC_INTERFACE->DACC_TNCR;
+
+		HOST_CHECK(length == AUDIO_BLOCK_SIZE * 2);
+
+		for (int i = 0; i < length; i++)
+		{
+			int channel = block[i] >> 12;
+			int value = block[i] & 0x0FFF;
+
+			/* Interleaved DAC0, DAC1 */
+			HOST_CHECK(channel == (i & 1));
+
+			/* The first block is still getting going */
+			if ((b > 0) && (value >= last[channel]))
+			{
+				int step = value - last[channel];
+
+				/* The fast ramp moves a whole step per sample. The slow one moves about half a step every */
+				/* sample, where a sample-and-hold would alternate between a whole step and none. */
+				if (channel == 0) HOST_CHECK(step == AUDIO_TEST_RAMP);
+				if (channel == 1) HOST_CHECK((step >= (AUDIO_TEST_RAMP / 2) - 1) && (step <= (AUDIO_TEST_RAMP / 2) + 1));
+
+				steps[channel]++;
+			}
+
+			last[channel] = value;
+		}
+	}
+
+	/* Both ramps only ever went up, apart from wrapping around. The slow one takes two or three */
+	/* interpolated samples to get from the top back to the bottom. */
+	int samples = (AUDIO_TEST_BLOCKS - 1) * AUDIO_BLOCK_SIZE;
+
+	HOST_CHECK(steps[0] >= samples - ((samples * AUDIO_TEST_RAMP) / 4096) - 2);
+	HOST_CHECK(steps[1] >= samples - ((3 * samples * AUDIO_TEST_RAMP) / 8192) - 2);
+
+	/* Each device rendered at its own rate */
+	HOST_CHECK(fast->count == AUDIO_TEST_BLOCKS * AUDIO_BLOCK_SIZE);
+	HOST_CHECK(abs(slow->count - ((fast->count * SR_48000) / SR_24000)) <= 1);
+
+	HOST_REPORT("%d blocks: %d rising steps on DAC0, %d on DAC1", AUDIO_TEST_BLOCKS, steps[0], steps[1]);
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
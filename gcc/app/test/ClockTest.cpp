@@ -0,0 +1,234 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "Clock.h"
+
+using namespace nw2s;
+
+/*
+
+	Runs a 300 BPM clock for ten thousand beats with the main loop only getting round once a
+	millisecond, with a device on every division, and checks every edge lands where the tick
+	grid says it should. The edges come from the beat timer's interrupt, so they should be
+	within a microsecond of exact rather than anywhere up to the next poll. Each reset() then
+	follows on the main loop, after the edge and before the next one.
+
+*/
+
+#define CLOCK_TEST_TEMPO 300
+#define CLOCK_TEST_BEATS 10000
+#define CLOCK_TEST_BEATS_PER_MEASURE 4
+
+class EdgeRecorder : public BeatDevice
+{
+	public:
+		unsigned long first;
+		unsigned long count;
+		unsigned long ticks;
+		unsigned long perMeasure;
+		unsigned long lastEdge;
+		unsigned long resets;
+		long maxError;
+		long maxLag;
+		double totalError;
+
+		EdgeRecorder(int clock_division)
+		{
+			this->clock_division = clock_division;
+			this->ticks = clockDivisionTicks(clock_division);
+			this->count = 0;
+			this->resets = 0;
+			this->maxError = 0;
+			this->maxLag = 0;
+			this->totalError = 0;
+
+			/* Divisions start over on every downbeat, so dotted ones get a short last step */
+			unsigned long measure = CLOCK_TEST_BEATS_PER_MEASURE * CLOCK_TICKS_PER_BEAT;
+			this->perMeasure = (measure + this->ticks - 1) / this->ticks;
+		}
+
+		/* Where the grid says an edge goes */
+		unsigned long expectedTick(unsigned long edge)
+		{
+			unsigned long measure = CLOCK_TEST_BEATS_PER_MEASURE * CLOCK_TICKS_PER_BEAT;
+
+			return ((edge / this->perMeasure) * measure) + ((edge % this->perMeasure) * this->ticks);
+		}
+
+		virtual void timer(unsigned long t) {}
+
+		virtual bool edge()
+		{
+			unsigned long now = micros();
+
+			if (this->count == 0) this->first = now;
+
+			unsigned long long period = 60000000ULL / CLOCK_TEST_TEMPO;
+			unsigned long expected = this->first + (unsigned long)(((this->expectedTick(this->count) * period) + (CLOCK_TICKS_PER_BEAT / 2)) / CLOCK_TICKS_PER_BEAT);
+			long error = (long)(now - expected);
+
+			if (error < 0) error = -error;
+			if (error > this->maxError) this->maxError = error;
+
+			this->totalError += error;
+			this->lastEdge = now;
+			this->count++;
+
+			return false;
+		}
+
+		virtual void reset()
+		{
+			long lag = (long)(micros() - this->lastEdge);
+
+			if (lag > this->maxLag) this->maxLag = lag;
+
+			this->resets++;
+		}
+};
+
+class TestClock : public FixedClock
+{
+	public:
+		TestClock(int tempo) : FixedClock(tempo, CLOCK_TEST_BEATS_PER_MEASURE) {}
+};
+
+class SwingRecorder : public BeatDevice
+{
+	public:
+		unsigned long edges[4];
+		int count;
+
+		SwingRecorder()
+		{
+			this->clock_division = DIV_EIGHTH;
+			this->count = 0;
+		}
+
+		virtual void timer(unsigned long t) {}
+
+		virtual void reset()
+		{
+			if (this->count < 4) this->edges[this->count] = micros();
+			this->count++;
+		}
+};
+
+/* A device's own "swing" wins over the clock's, even when it asks for straight */
+static void checkSwingOptOut()
+{
+	SimulatedHAL* hal = hostTestHAL();
+
+	/* 120 BPM eighths with a triplet shuffle on the clock */
+	TestClock* clock = new TestClock(120);
+	clock->setSwing(DIV_EIGHTH, 66);
+
+	char straightJson[] = "{ \"swing\": 50, \"swingDivision\": \"eighth\" }";
+	char emptyJson[] = "{ }";
+
+	SwingRecorder* straight = new SwingRecorder();
+	SwingRecorder* swung = new SwingRecorder();
+	clock->registerDevice(straight, aJson.parse(straightJson));
+	clock->registerDevice(swung, aJson.parse(emptyJson));
+
+	/* This clock doesn't own the beat timer, so it only fires as often as it's polled */
+	for (int i = 0; i < 1100; i++)
+	{
+		clock->timer(millis());
+		hal->advance(1000);
+	}
+
+	HOST_CHECK((straight->count >= 4) && (swung->count >= 4));
+
+	for (int i = 0; i < 4; i++)
+	{
+		long straightAt = (long)(straight->edges[i] - straight->edges[0]) / 1000;
+		long swungAt = (long)(swung->edges[i] - swung->edges[0]) / 1000;
+
+		/* Straight eighths at 0, 250, 500, 750ms. The swung ones push every second eighth to 330ms into the pair. */
+		HOST_CHECK(abs(straightAt - (i * 250)) <= 1);
+		HOST_CHECK(abs(swungAt - (((i / 2) * 500) + ((i & 1) ? 330 : 0))) <= 1);
+	}
+}
+
+void setup()
+{
+	SimulatedHAL* hal = hostTestHAL();
+
+	/* Divisions in thousandths of a beat round onto 48ths, so the triplets are exact */
+	HOST_CHECK(clockDivisionTicks(DIV_QUARTER_TRIPLET) == (CLOCK_TICKS_PER_BEAT * 2) / 3);
+	HOST_CHECK(clockDivisionTicks(DIV_EIGHTH_TRIPLET) == CLOCK_TICKS_PER_BEAT / 3);
+	HOST_CHECK(clockDivisionTicks(DIV_THIRTYSECOND_TRIPLET) == CLOCK_TICKS_PER_BEAT / 12);
+	HOST_CHECK(clockDivisionTicks(DIV_THIRTYSECOND_DOT) == (CLOCK_TICKS_PER_BEAT * 3) / 16);
+	HOST_CHECK(clockDivisionTicks(100) == 96);
+
+	EdgeRecorder* recorders[CLOCK_DIVISION_COUNT];
+
+	hal->setManualTime(true);
+
+	TestClock* clock = new TestClock(CLOCK_TEST_TEMPO);
+
+	for (int i = 0; i < CLOCK_DIVISION_COUNT; i++)
+	{
+		recorders[i] = new EdgeRecorder(CLOCK_DIVISIONS[i]);
+		clock->registerDevice(recorders[i]);
+	}
+
+	/* Start off the millisecond grid so a polled clock couldn't get lucky */
+	hal->advance(337);
+
+	unsigned long runTime = (CLOCK_TEST_BEATS * 60000UL) / CLOCK_TEST_TEMPO;
+
+	for (unsigned long i = 0; i < runTime; i++)
+	{
+		clock->timer(millis());
+		hal->advance(1000);
+	}
+
+	/* One more poll for the resets behind the last edges */
+	clock->timer(millis());
+
+	for (int i = 0; i < CLOCK_DIVISION_COUNT; i++)
+	{
+		EdgeRecorder* recorder = recorders[i];
+		unsigned long measures = CLOCK_TEST_BEATS / CLOCK_TEST_BEATS_PER_MEASURE;
+		unsigned long expected = measures * recorder->perMeasure;
+
+		HOST_CHECK(recorder->count >= expected);
+		HOST_CHECK(recorder->count <= expected + 1);
+		HOST_CHECK(recorder->maxError <= 1);
+
+		/* Every edge gets its reset on the next poll */
+		HOST_CHECK(recorder->resets == recorder->count);
+		HOST_CHECK(recorder->maxLag <= 1000);
+
+		HOST_REPORT("division %4d: %5lu edges, jitter mean %.2fus max %ldus, reset within %ldus", CLOCK_DIVISIONS[i], recorder->count, recorder->totalError / recorder->count, recorder->maxError, recorder->maxLag);
+	}
+
+	checkSwingOptOut();
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
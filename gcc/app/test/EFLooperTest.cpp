@@ -0,0 +1,156 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "HostFatImage.h"
+#include "Loop.h"
+
+using namespace nw2s;
+
+/*
+
+	Checks the envelope follower's running window against adding up the last windowsize
+	rectified samples from scratch, through window size changes in both directions. Then
+	times an output update following a loop held in RAM at 24kHz, against the old way of
+	reading and summing the whole window every update, at a few window sizes.
+
+*/
+
+#define EF_TEST_SAMPLES 8000
+#define EF_TEST_PUSHED 50000
+#define EF_TEST_UPDATES 200000
+
+static char subfolder[] = "EF";
+static char filename[] = "NOISE.RAW";
+
+namespace nw2s
+{
+
+class EFLooperTest
+{
+	public:
+		static void run()
+		{
+			std::vector<uint8_t> data;
+
+			srand(1);
+
+			for (int i = 0; i < EF_TEST_SAMPLES; i++)
+			{
+				int16_t sample = (rand() & 0xFFFF) - 32768;
+
+				data.push_back(sample & 0xFF);
+				data.push_back((sample >> 8) & 0xFF);
+			}
+
+			HostFatImage image;
+
+			image.addFile(subfolder, filename, data, false);
+			HOST_CHECK(image.attach() != NULL);
+
+			/* With the card in, so setting up doesn't wait for it to time out */
+			EventManager::initialize();
+
+			EFLooper* looper = EFLooper::create(INDEX_ANALOG_OUT[1], INDEX_ANALOG_IN[1], INDEX_ANALOG_IN[2], INDEX_ANALOG_IN[3], subfolder, filename, SR_24000);
+
+			HOST_CHECK(looper->signalData != NULL);
+			HOST_CHECK(looper->signalData->isCached());
+
+			checkWindow(looper);
+
+			const int sizes[3] = { 32, 256, EF_WINDOW_MAX };
+
+			for (int i = 0; i < 3; i++) benchmark(looper, sizes[i]);
+		}
+
+	private:
+		static uint32_t summed(EFLooper* looper)
+		{
+			uint32_t sum = 0;
+
+			for (int i = 0; i < looper->windowsize; i++) sum += looper->window[(looper->windowHead - i) & (EF_WINDOW_MAX - 1)];
+
+			return sum;
+		}
+
+		static void checkWindow(EFLooper* looper)
+		{
+			int mismatches = 0;
+
+			for (int i = 0; i < EF_TEST_PUSHED; i++)
+			{
+				/* Full scale both ways, including the one sample that doesn't fit a positive int16 */
+				looper->push((i % 997 == 0) ? -32768 : (rand() & 0xFFFF) - 32768);
+
+				if ((i % 1000) == 0) looper->resizeWindow(1 + (rand() % EF_WINDOW_MAX));
+				if (looper->windowSum != summed(looper)) mismatches++;
+			}
+
+			HOST_CHECK(mismatches == 0);
+			HOST_REPORT("running window: %d samples pushed, %d mismatches", EF_TEST_PUSHED, mismatches);
+		}
+
+		static void benchmark(EFLooper* looper, int windowsize)
+		{
+			looper->resizeWindow(windowsize);
+			looper->setControlRate(1);
+
+			volatile uint32_t sink = 0;
+			double start = hostTestNanos();
+
+			for (int i = 0; i < EF_TEST_UPDATES; i++) looper->update();
+
+			double runningNanos = (hostTestNanos() - start) / EF_TEST_UPDATES;
+
+			/* What each update used to cost - read the whole window again and add it up */
+			int16_t block[EF_WINDOW_MAX];
+
+			start = hostTestNanos();
+
+			for (int i = 0; i < EF_TEST_UPDATES / 10; i++)
+			{
+				uint32_t sum = 0;
+
+				looper->signalData->getNextSamples(block, windowsize);
+
+				for (int j = 0; j < windowsize; j++) sum += (block[j] < 0) ? -block[j] : block[j];
+
+				sink += sum / windowsize;
+			}
+
+			double summingNanos = (hostTestNanos() - start) / (EF_TEST_UPDATES / 10);
+
+			HOST_REPORT("window %4d, 24 samples per update: running sum %.0fns, summing the window %.0fns", windowsize, runningNanos, summingNanos);
+		}
+};
+
+}
+
+void setup()
+{
+	EFLooperTest::run();
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
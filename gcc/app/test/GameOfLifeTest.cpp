@@ -0,0 +1,418 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "GameOfLife.h"
+#include "EventManager.h"
+
+using namespace nw2s;
+
+/*
+
+	Checks the bitboard Game of Life against the per-cell rules it replaced. Every 3x3
+	neighbourhood with every centre level is stepped under every birth and survival
+	setting the CV inputs can make, packed 25 to a board so the tiles don't touch. Random
+	boards of several sizes cover the wrap at the edges, and long runs through
+	nextGeneration() check the grid page and the population gates as well. Then one 16x16
+	generation is timed both ways.
+
+*/
+
+#define LIFE_TEST_RULES 6561
+#define LIFE_TEST_TILES 25
+#define LIFE_TEST_TIMED_GENERATIONS 50000
+
+/* The rules exactly as they were before the bitboard, on an int per cell */
+class ReferenceLife
+{
+	public:
+		int cells[2][16][16];
+		int counts[16][16];
+		int generation;
+		int columns;
+		int rows;
+
+		int neighbours(int gen, int column, int row)
+		{
+			int count = 0;
+
+			for (int dc = -1; dc <= 1; dc++)
+			{
+				for (int dr = -1; dr <= 1; dr++)
+				{
+					if ((dc || dr) && this->cells[gen][(column + dc + this->columns) % this->columns][(row + dr + this->rows) % this->rows]) count++;
+				}
+			}
+
+			return count;
+		}
+
+		/* The counts don't depend on the rule, so a board is counted once and stepped under each rule */
+		void count()
+		{
+			for (int column = 0; column < this->columns; column++)
+			{
+				for (int row = 0; row < this->rows; row++) this->counts[column][row] = this->neighbours(this->generation, column, row);
+			}
+		}
+
+		int step(int minNew, int maxNew, int minSurvive, int maxSurvive)
+		{
+			this->count();
+
+			return this->apply(minNew, maxNew, minSurvive, maxSurvive);
+		}
+
+		int apply(int minNew, int maxNew, int minSurvive, int maxSurvive)
+		{
+			int next = (this->generation + 1) % 2;
+			int population = 0;
+
+			for (int column = 0; column < this->columns; column++)
+			{
+				for (int row = 0; row < this->rows; row++)
+				{
+					int count = this->counts[column][row];
+					int cell = this->cells[this->generation][column][row];
+
+					this->cells[next][column][row] = 0;
+
+					if ((count >= minSurvive) && (count <= maxSurvive) && cell)
+					{
+						this->cells[next][column][row] = constrain(cell - 1, 4, 15);
+					}
+					else if ((count >= minNew) && (count <= maxNew) && !cell)
+					{
+						this->cells[next][column][row] = 15;
+					}
+
+					if (this->cells[next][column][row]) population++;
+				}
+			}
+
+			this->generation = next;
+
+			return population;
+		}
+};
+
+namespace nw2s
+{
+
+class GameOfLifeTest
+{
+	public:
+		static void run()
+		{
+			SimulatedHAL* hal = hostTestHAL();
+			GameOfLife* game = GameOfLife::create(DEVICE_GRIDS, 16, 16, true);
+			ReferenceLife reference;
+
+			hal->setManualTime(true);
+			srand(1);
+
+			/* Every neighbourhood, centre level and rule */
+			long cases = 0;
+			long mismatches = 0;
+
+			resize(game, &reference, 15, 15);
+
+			/* Each board is loaded once and stepped from generation 0 under every rule */
+			for (int base = 0; base < 512 * 16; base += LIFE_TEST_TILES)
+			{
+				memset(reference.cells, 0, sizeof(reference.cells));
+				reference.generation = 0;
+
+				for (int tile = 0; (tile < LIFE_TEST_TILES) && (base + tile < 512 * 16); tile++)
+				{
+					int pattern = (base + tile) % 512;
+					int centre = (base + tile) / 512;
+					int x = (tile % 5) * 3;
+					int y = (tile / 5) * 3;
+
+					/* Bit 4 is the centre, which takes every level from 1 to 15 with 0 standing in for 15 */
+					for (int i = 0; i < 9; i++)
+					{
+						int level = (i == 4) ? (centre ? centre : 15) : 4 + (rand() % 12);
+
+						reference.cells[0][x + (i % 3)][y + (i / 3)] = ((pattern >> i) & 1) ? level : 0;
+					}
+
+					cases += LIFE_TEST_RULES;
+				}
+
+				load(game, &reference);
+				reference.count();
+
+				for (int rule = 0; rule < LIFE_TEST_RULES; rule++)
+				{
+					reference.generation = 0;
+					game->generation = 0;
+
+					mismatches += step(game, &reference, rule);
+				}
+			}
+
+			HOST_CHECK(mismatches == 0);
+			HOST_REPORT("neighbourhoods x centre levels x rules: %ld cases, %ld mismatched rows", cases, mismatches);
+
+			/* Random boards wrap at every edge */
+			long boards = 0;
+			mismatches = 0;
+
+			for (int columns = 8; columns <= 16; columns += 4)
+			{
+				for (int rows = 8; rows <= 16; rows += 4)
+				{
+					resize(game, &reference, columns, rows);
+
+					for (int rule = 0; rule < LIFE_TEST_RULES; rule += 7)
+					{
+						reference.generation = 0;
+
+						for (int column = 0; column < columns; column++)
+						{
+							for (int row = 0; row < rows; row++) reference.cells[0][column][row] = randomLevel(rule & 1, 15 + (rand() % 70));
+						}
+
+						load(game, &reference);
+						reference.count();
+						mismatches += step(game, &reference, rule);
+						boards++;
+					}
+				}
+			}
+
+			HOST_CHECK(mismatches == 0);
+			HOST_REPORT("random boards 8..16 x 8..16: %ld boards, %ld mismatched rows", boards, mismatches);
+
+			/* The whole generation with the standard rules, as the clock runs it */
+			long generations = 0;
+			long gateMismatches = 0;
+			mismatches = 0;
+
+			for (int columns = 8; columns <= 16; columns += 4)
+			{
+				for (int rows = 8; rows <= 16; rows += 4)
+				{
+					resize(game, &reference, columns, rows);
+
+					for (int run = 0; run < 10; run++)
+					{
+						reference.generation = 0;
+
+						for (int column = 0; column < columns; column++)
+						{
+							for (int row = 0; row < rows; row++) reference.cells[0][column][row] = randomLevel(false, 35);
+						}
+
+						load(game, &reference);
+
+						for (int i = 0; i < 200; i++)
+						{
+							int population = reference.step(3, 3, 2, 3);
+
+							game->nextGeneration();
+							generations++;
+
+							mismatches += compare(game, &reference);
+
+							for (int column = 0; column < columns; column++)
+							{
+								for (int row = 0; row < rows; row++)
+								{
+									if (game->cells[0][column][row] != reference.cells[reference.generation][column][row]) mismatches++;
+								}
+							}
+
+							if (hal->getDigitalOutput(INDEX_DIGITAL_OUT[1]) != ((population + game->populationThreshold) > (columns * rows))) gateMismatches++;
+							if (hal->getDigitalOutput(INDEX_DIGITAL_OUT[2]) != (population < game->populationThreshold)) gateMismatches++;
+						}
+					}
+				}
+			}
+
+			HOST_CHECK(mismatches == 0);
+			HOST_CHECK(gateMismatches == 0);
+			HOST_REPORT("nextGeneration(): %ld generations, %ld mismatches, %ld gate mismatches", generations, mismatches, gateMismatches);
+
+			/* One 16x16 generation with its population count, both ways */
+			resize(game, &reference, 16, 16);
+			reference.generation = 0;
+
+			for (int column = 0; column < 16; column++)
+			{
+				for (int row = 0; row < 16; row++) reference.cells[0][column][row] = randomLevel(false, 35);
+			}
+
+			load(game, &reference);
+
+			volatile int sink = 0;
+			double start = hostTestNanos();
+
+			for (int i = 0; i < LIFE_TEST_TIMED_GENERATIONS; i++)
+			{
+				sink += reference.step(3, 3, 2, 3);
+
+				/* Keep it from dying out */
+				if ((i & 255) == 0) reference.cells[reference.generation][i % 16][3] = 15;
+			}
+
+			double referenceNanos = (hostTestNanos() - start) / LIFE_TEST_TIMED_GENERATIONS;
+			uint16_t birth;
+			uint16_t survive;
+
+			start = hostTestNanos();
+
+			for (int i = 0; i < LIFE_TEST_TIMED_GENERATIONS; i++)
+			{
+				int next = (game->generation + 1) % 2;
+				int population = 0;
+
+				masks(3 + (3 * 9) + (2 * 81) + (3 * 729), &birth, &survive);
+				game->stepCells(game->generation, next, birth, survive);
+
+				for (int row = 0; row < 16; row++) population += __builtin_popcount(game->liveRow(next, row));
+
+				sink += population;
+				game->generation = next;
+
+				if ((i & 255) == 0) game->setCell(next, i % 16, 3, 15);
+			}
+
+			double bitboardNanos = (hostTestNanos() - start) / LIFE_TEST_TIMED_GENERATIONS;
+
+			HOST_REPORT("16x16 generation with population: per cell %.0fns, bitboard %.0fns", referenceNanos, bitboardNanos);
+		}
+
+	private:
+		/* A rule is minNew, maxNew, minSurvive and maxSurvive as four base 9 digits */
+		static void masks(int rule, uint16_t* birth, uint16_t* survive)
+		{
+			int minNew = rule % 9;
+			int maxNew = (rule / 9) % 9;
+			int minSurvive = (rule / 81) % 9;
+			int maxSurvive = rule / 729;
+
+			*birth = 0;
+			*survive = 0;
+
+			for (int count = 0; count <= 8; count++)
+			{
+				if ((count >= minNew) && (count <= maxNew)) *birth |= 1 << count;
+				if ((count >= minSurvive) && (count <= maxSurvive)) *survive |= 1 << count;
+			}
+		}
+
+		static int randomLevel(bool allLevels, int alive)
+		{
+			if ((rand() % 100) >= alive) return 0;
+
+			return allLevels ? 1 + (rand() % 15) : 4 + (rand() % 12);
+		}
+
+		static void resize(GameOfLife* game, ReferenceLife* reference, int columns, int rows)
+		{
+			game->columnCount = columns;
+			game->rowCount = rows;
+			game->columnMask = (LifeRow)~0 >> (LIFE_MAX_COLUMNS - columns);
+			game->populationThreshold = (columns * rows) / 16;
+
+			reference->columns = columns;
+			reference->rows = rows;
+		}
+
+		static void load(GameOfLife* game, ReferenceLife* reference)
+		{
+			memset(game->lifecells, 0, sizeof(game->lifecells));
+			game->generation = reference->generation;
+
+			for (int column = 0; column < reference->columns; column++)
+			{
+				for (int row = 0; row < reference->rows; row++) game->setCell(reference->generation, column, row, reference->cells[reference->generation][column][row]);
+			}
+		}
+
+		/* Rows that differ from the reference packed the same way, which also catches anything set off the edge of the board */
+		static long compare(GameOfLife* game, ReferenceLife* reference)
+		{
+			LifeRow expected[LIFE_LEVEL_BITS][LIFE_MAX_ROWS];
+			long mismatches = 0;
+
+			memset(expected, 0, sizeof(expected));
+
+			for (int column = 0; column < reference->columns; column++)
+			{
+				for (int row = 0; row < reference->rows; row++)
+				{
+					int level = reference->cells[reference->generation][column][row];
+
+					for (int bit = 0; bit < LIFE_LEVEL_BITS; bit++)
+					{
+						if ((level >> bit) & 1) expected[bit][row] |= (LifeRow)1 << column;
+					}
+				}
+			}
+
+			for (int bit = 0; bit < LIFE_LEVEL_BITS; bit++)
+			{
+				for (int row = 0; row < LIFE_MAX_ROWS; row++)
+				{
+					if (game->lifecells[game->generation][bit][row] != expected[bit][row]) mismatches++;
+				}
+			}
+
+			return mismatches;
+		}
+
+		/* Steps both boards under the rule, the reference already counted, and compares */
+		static long step(GameOfLife* game, ReferenceLife* reference, int rule)
+		{
+			uint16_t birth;
+			uint16_t survive;
+
+			masks(rule, &birth, &survive);
+
+			reference->apply(rule % 9, (rule / 9) % 9, (rule / 81) % 9, rule / 729);
+
+			int next = (game->generation + 1) % 2;
+
+			game->stepCells(game->generation, next, birth, survive);
+			game->generation = next;
+
+			return compare(game, reference);
+		}
+};
+
+}
+
+void setup()
+{
+	EventManager::initialize();
+
+	GameOfLifeTest::run();
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
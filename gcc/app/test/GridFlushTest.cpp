@@ -0,0 +1,220 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "HostGrid.h"
+#include "EventManager.h"
+
+using namespace nw2s;
+
+/*
+
+	Runs series and grids controllers against a modelled device on a mock USB endpoint and
+	counts the bytes each kind of redraw costs. Nothing may go out from setLED() or
+	clearLED() themselves, a tick flushes at most once, one or two changed cells go out as
+	single LED commands and anything more as frames for just the quadrants that changed.
+	After every step the device has to show exactly what's on the current page.
+
+*/
+
+#define GRID_TEST_STEPS 30
+
+static int quadrantCount(uint8_t columns, uint8_t rows)
+{
+	return ((columns > 8) ? 2 : 1) * ((rows > 8) ? 2 : 1);
+}
+
+static void run(const char* name, GridDevice type, uint8_t columns, uint8_t rows)
+{
+	SimulatedHAL* hal = hostTestHAL();
+	HostGridDevice* device = new HostGridDevice(type);
+	HostGridController* grid = new HostGridController(type, columns, rows);
+
+	hal->attachUsbDevice(HOST_GRID_ADDRESS, device);
+	grid->connect();
+
+	int frameLength = (type == DEVICE_SERIES) ? 9 : 11;
+	int cellLength = (type == DEVICE_SERIES) ? 2 : 3;
+	int mismatches = 0;
+
+	srand(1);
+
+	for (int column = 0; column < columns; column++)
+	{
+		for (int row = 0; row < rows; row++)
+		{
+			grid->fill(0, column, row, ((rand() % 3) == 0) ? 15 : 0);
+			grid->fill(1, column, row, (column == row) ? 15 : 0);
+		}
+	}
+
+	grid->settle(hal);
+	mismatches += grid->mismatches(device);
+
+	/* A generation drawn into the page and sent with one refresh */
+	hal->resetStats();
+
+	for (int step = 0; step < GRID_TEST_STEPS; step++)
+	{
+		for (int column = 0; column < columns; column++)
+		{
+			for (int row = 0; row < rows; row++)
+			{
+				if ((rand() % 4) == 0) grid->fill(0, column, row, grid->getValue(0, column, row) ? 0 : 15);
+			}
+		}
+
+		grid->refresh();
+		grid->settle(hal);
+		mismatches += grid->mismatches(device);
+	}
+
+	double refreshBytes = hal->stats.usbBytes / (double)GRID_TEST_STEPS;
+
+	HOST_CHECK(hal->stats.usbBytes <= (uint32_t)(GRID_TEST_STEPS * quadrantCount(columns, rows) * frameLength));
+
+	/* The same through setLED() and clearLED() one cell at a time */
+	hal->resetStats();
+
+	uint32_t bytesBeforeFlush = 0;
+	uint32_t setBytes = 0;
+
+	for (int step = 0; step < GRID_TEST_STEPS; step++)
+	{
+		for (int column = 0; column < columns; column++)
+		{
+			for (int row = 0; row < rows; row++)
+			{
+				if ((rand() % 4) != 0) continue;
+
+				if (grid->getValue(0, column, row))
+				{
+					grid->clear(0, column, row);
+				}
+				else
+				{
+					grid->set(0, column, row, 15);
+				}
+			}
+		}
+
+		bytesBeforeFlush += hal->stats.usbBytes;
+		hal->resetStats();
+
+		grid->settle(hal);
+		mismatches += grid->mismatches(device);
+
+		HOST_CHECK(hal->stats.usbBytes <= (uint32_t)(quadrantCount(columns, rows) * frameLength));
+
+		setBytes += hal->stats.usbBytes;
+		hal->resetStats();
+	}
+
+	HOST_CHECK(bytesBeforeFlush == 0);
+
+	/* A sequencer's beat moving along the bottom row is two single LED commands */
+	for (int column = 0; column < columns; column++) grid->clear(0, column, rows - 1);
+
+	grid->set(0, 0, rows - 1, 15);
+	grid->settle(hal);
+
+	hal->resetStats();
+
+	for (int step = 0; step < GRID_TEST_STEPS; step++)
+	{
+		grid->clear(0, step % columns, rows - 1);
+		grid->set(0, (step + 1) % columns, rows - 1, 15);
+		grid->settle(hal);
+		mismatches += grid->mismatches(device);
+	}
+
+	double beatBytes = hal->stats.usbBytes / (double)GRID_TEST_STEPS;
+
+	HOST_CHECK(hal->stats.usbBytes == (uint32_t)(GRID_TEST_STEPS * 2 * cellLength));
+
+	/* However many times it's marked in one tick, the device only gets one update */
+	grid->set(0, 0, 0, 15);
+	grid->set(0, 1, 0, 15);
+	grid->set(0, 2, 0, 15);
+	grid->settle(hal, 1);
+
+	hal->resetStats();
+
+	grid->clear(0, 0, 0);
+	grid->task();
+	grid->clear(0, 1, 0);
+	grid->task();
+	grid->clear(0, 2, 0);
+	grid->task();
+
+	HOST_CHECK(hal->stats.usbBytes == 0);
+
+	grid->settle(hal, 1);
+	mismatches += grid->mismatches(device);
+
+	/* Flipping pages only sends the quadrants that differ */
+	hal->resetStats();
+
+	for (int step = 0; step < GRID_TEST_STEPS; step++)
+	{
+		grid->page(1);
+		grid->settle(hal);
+		mismatches += grid->mismatches(device);
+
+		grid->page(0);
+		grid->settle(hal);
+		mismatches += grid->mismatches(device);
+	}
+
+	double flipBytes = hal->stats.usbBytes / (GRID_TEST_STEPS * 2.0);
+
+	HOST_CHECK(hal->stats.usbBytes <= (uint32_t)(GRID_TEST_STEPS * 2 * quadrantCount(columns, rows) * frameLength));
+
+	HOST_CHECK(mismatches == 0);
+	HOST_CHECK(device->unknownCommands == 0);
+
+	HOST_REPORT("%-9s USB bytes per generation + refreshGrid %5.1f, per generation via setLED %5.1f, per beat step %4.1f, per page flip %5.1f", name, refreshBytes, setBytes / (double)GRID_TEST_STEPS, beatBytes, flipBytes);
+
+	hal->attachUsbDevice(HOST_GRID_ADDRESS, NULL);
+}
+
+void setup()
+{
+	SimulatedHAL* hal = hostTestHAL();
+
+	EventManager::initialize();
+
+	hal->setManualTime(true);
+	hal->advance(0);
+
+	/* The stack's first task releases every class driver, get that out of the way before connecting */
+	EventManager::usbHost.Task();
+
+	run("grids128", DEVICE_GRIDS, 16, 8);
+	run("series64", DEVICE_SERIES, 8, 8);
+	run("series256", DEVICE_SERIES, 16, 16);
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
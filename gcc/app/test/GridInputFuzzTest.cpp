@@ -0,0 +1,163 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "HostGrid.h"
+#include "EventManager.h"
+
+using namespace nw2s;
+
+/*
+
+	Feeds each grid protocol a long stream of key presses and releases through the mock USB
+	endpoint, cut into reads of random length so packets get split anywhere, including
+	between the FTDI status bytes and the data on series and grids devices. The grids stream
+	also has id, size and query replies mixed in. Every key has to reach the controller once,
+	in order, and nothing else may be taken for a key.
+
+*/
+
+#define FUZZ_TEST_KEYS 20000
+
+static void run(const char* name, GridDevice type, uint32_t largestRead)
+{
+	SimulatedHAL* hal = hostTestHAL();
+	HostGridDevice* device = new HostGridDevice(type);
+	HostGridController* grid = new HostGridController(type, 16, 16);
+	std::vector<HostGridKey> sent;
+	bool down[16][16];
+
+	hal->attachUsbDevice(HOST_GRID_ADDRESS, device);
+	grid->connect();
+
+	memset(down, 0, sizeof(down));
+	device->largestRead = largestRead;
+
+	srand(7);
+
+	for (int i = 0; i < FUZZ_TEST_KEYS; i++)
+	{
+		/* Replies that aren't keys */
+		if ((type == DEVICE_GRIDS) && ((rand() % 10) == 0))
+		{
+			int reply = rand() % 3;
+
+			if (reply == 0)
+			{
+				device->input.push_back(0x01);
+				for (int j = 0; j < 32; j++) device->input.push_back('a' + (j % 26));
+			}
+			else if (reply == 1)
+			{
+				device->input.push_back(0x03);
+				device->input.push_back(16);
+				device->input.push_back(16);
+			}
+			else
+			{
+				device->input.push_back(0x00);
+				device->input.push_back(1);
+				device->input.push_back(1);
+			}
+		}
+
+		uint8_t column = rand() % 16;
+		uint8_t row = rand() % 16;
+		bool pressed = !down[column][row];
+
+		down[column][row] = pressed;
+
+		HostGridKey key = { column, row, pressed };
+		sent.push_back(key);
+
+		if (type == DEVICE_40H_TRELLIS)
+		{
+			device->input.push_back(pressed ? 0x01 : 0x00);
+			device->input.push_back((column << 4) | row);
+		}
+		else if (type == DEVICE_SERIES)
+		{
+			device->input.push_back(pressed ? 0x00 : 0x10);
+			device->input.push_back((column << 4) | row);
+		}
+		else
+		{
+			device->input.push_back(pressed ? 0x21 : 0x20);
+			device->input.push_back(column);
+			device->input.push_back(row);
+		}
+	}
+
+	int reads = 0;
+
+	while (device->inputPending())
+	{
+		grid->task();
+		reads++;
+	}
+
+	grid->settle(hal, 4);
+
+	/* Every key in order, and nothing but the keys */
+	size_t matched = 0;
+
+	while ((matched < grid->keys.size()) && (matched < sent.size()))
+	{
+		HostGridKey* got = &grid->keys[matched];
+
+		if ((got->column != sent[matched].column) || (got->row != sent[matched].row) || (got->pressed != sent[matched].pressed)) break;
+
+		matched++;
+	}
+
+	HOST_CHECK(grid->keys.size() == sent.size());
+	HOST_CHECK(matched == sent.size());
+
+	HOST_REPORT("%-6s reads of up to %2lu bytes: %d reads, %lu keys sent, %lu delivered, %lu in order", name, (unsigned long)largestRead, reads, (unsigned long)sent.size(), (unsigned long)grid->keys.size(), (unsigned long)matched);
+
+	hal->attachUsbDevice(HOST_GRID_ADDRESS, NULL);
+}
+
+void setup()
+{
+	SimulatedHAL* hal = hostTestHAL();
+
+	EventManager::initialize();
+
+	hal->setManualTime(true);
+	hal->advance(0);
+
+	/* The stack's first task releases every class driver, get that out of the way before connecting */
+	EventManager::usbHost.Task();
+
+	run("40h", DEVICE_40H_TRELLIS, 7);
+	run("40h", DEVICE_40H_TRELLIS, HOST_GRID_PACKET_SIZE);
+	run("series", DEVICE_SERIES, 7);
+	run("series", DEVICE_SERIES, HOST_GRID_PACKET_SIZE);
+	run("grids", DEVICE_GRIDS, 7);
+	run("grids", DEVICE_GRIDS, HOST_GRID_PACKET_SIZE);
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
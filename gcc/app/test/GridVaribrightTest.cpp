@@ -0,0 +1,233 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "HostGrid.h"
+#include "EventManager.h"
+
+using namespace nw2s;
+
+/*
+
+	Checks what a varibright grid is sent, byte for byte, against a modelled device on a
+	mock USB endpoint. One or two changed cells are 4 byte 0x18 level commands, a quadrant
+	that is only off and full on is an 11 byte 0x14 map, and only a quadrant with real levels
+	costs a 35 byte 0x1A map, never more than one of them per tick. Values above 15 show at
+	full brightness, a grid without the varibright flag never gets level commands, and a
+	change to all 256 cells at once still goes out.
+
+*/
+
+#define VARIBRIGHT_TEST_STEPS 30
+
+static SimulatedHAL* hal;
+
+/* Flushes one tick and returns the bytes it sent */
+static uint32_t tick(HostGridController* grid)
+{
+	hal->resetStats();
+	grid->settle(hal, 1);
+
+	return hal->stats.usbBytes;
+}
+
+void setup()
+{
+	hal = hostTestHAL();
+
+	EventManager::initialize();
+
+	hal->setManualTime(true);
+	hal->advance(0);
+
+	/* The stack's first task releases every class driver, get that out of the way before connecting */
+	EventManager::usbHost.Task();
+
+	HostGridDevice* device = new HostGridDevice(DEVICE_GRIDS, 15);
+	HostGridController* grid = new HostGridController(DEVICE_GRIDS, 16, 16, true);
+
+	hal->attachUsbDevice(HOST_GRID_ADDRESS, device);
+	grid->connect();
+	grid->settle(hal);
+
+	HOST_CHECK(grid->mismatches(device) == 0);
+
+	/* One cell at a level is one level command */
+	device->clear();
+	grid->set(0, 3, 4, 7);
+
+	HOST_CHECK(tick(grid) == 4);
+	HOST_CHECK(device->commands[0x18] == 1);
+	HOST_CHECK(device->leds[3][4] == 7);
+
+	/* Two cells are two */
+	device->clear();
+	grid->set(0, 3, 4, 9);
+	grid->set(0, 12, 13, 2);
+
+	HOST_CHECK(tick(grid) == 8);
+	HOST_CHECK(device->commands[0x18] == 2);
+
+	/* Off and full on only, in one quadrant, is a plain map */
+	device->clear();
+	grid->clear(0, 3, 4);
+	grid->set(0, 0, 0, 15);
+	grid->set(0, 1, 1, 15);
+	grid->set(0, 2, 2, 15);
+
+	HOST_CHECK(tick(grid) == 11);
+	HOST_CHECK(device->commands[0x14] == 1);
+	HOST_CHECK(device->commands[0x1A] == 0);
+
+	/* Levels in one quadrant need a level map */
+	device->clear();
+	grid->set(0, 8, 0, 5);
+	grid->set(0, 9, 1, 6);
+	grid->set(0, 10, 2, 7);
+
+	HOST_CHECK(tick(grid) == 35);
+	HOST_CHECK(device->commands[0x1A] == 1);
+
+	/* Levels in all four go out one map per tick */
+	device->clear();
+
+	for (int quadrant = 0; quadrant < 4; quadrant++)
+	{
+		for (int i = 0; i < 3; i++) grid->set(0, ((quadrant & 1) * 8) + i + 3, ((quadrant >> 1) * 8) + i, 3 + quadrant);
+	}
+
+	for (int i = 0; i < 4; i++) HOST_CHECK(tick(grid) == 35);
+
+	HOST_CHECK(tick(grid) == 0);
+	HOST_CHECK(device->commands[0x1A] == 4);
+	HOST_CHECK(device->levelMapsInOneTick == 0);
+	HOST_CHECK(grid->mismatches(device) == 0);
+
+	/* Anything brighter than 15 is full on rather than masked */
+	grid->set(0, 15, 15, 16);
+	tick(grid);
+
+	HOST_CHECK(device->leds[15][15] == 15);
+
+	/* Every cell changing at once still flushes */
+	for (int column = 0; column < 16; column++)
+	{
+		for (int row = 0; row < 16; row++) grid->fill(0, column, row, 1 + ((column + row) % 15));
+	}
+
+	grid->refresh();
+	grid->settle(hal);
+
+	HOST_CHECK(grid->mismatches(device) == 0);
+
+	/* A generation with fading levels, one cell at a time */
+	srand(3);
+	hal->resetStats();
+	device->clear();
+
+	for (int step = 0; step < VARIBRIGHT_TEST_STEPS; step++)
+	{
+		for (int column = 0; column < 16; column++)
+		{
+			for (int row = 0; row < 16; row++)
+			{
+				uint8_t value = grid->getValue(0, column, row);
+
+				if ((rand() % 4) != 0) continue;
+
+				if (value > 4)
+				{
+					grid->set(0, column, row, value - 1);
+				}
+				else if (value)
+				{
+					grid->clear(0, column, row);
+				}
+				else
+				{
+					grid->set(0, column, row, 15);
+				}
+			}
+		}
+
+		grid->settle(hal);
+
+		HOST_CHECK(grid->mismatches(device) == 0);
+	}
+
+	HOST_CHECK(device->levelMapsInOneTick == 0);
+	HOST_CHECK(device->unknownCommands == 0);
+
+	double generationBytes = hal->stats.usbBytes / (double)VARIBRIGHT_TEST_STEPS;
+
+	/* A beat step on the bottom row */
+	for (int column = 0; column < 16; column++) grid->clear(0, column, 15);
+
+	grid->set(0, 0, 15, 15);
+	grid->settle(hal);
+	hal->resetStats();
+
+	for (int step = 0; step < VARIBRIGHT_TEST_STEPS; step++)
+	{
+		grid->clear(0, step % 16, 15);
+		grid->set(0, (step + 1) % 16, 15, 15);
+		grid->settle(hal);
+	}
+
+	double beatBytes = hal->stats.usbBytes / (double)VARIBRIGHT_TEST_STEPS;
+
+	HOST_CHECK(hal->stats.usbBytes == VARIBRIGHT_TEST_STEPS * 2 * 4);
+	HOST_CHECK(grid->mismatches(device) == 0);
+
+	HOST_REPORT("varibright 16x16: USB bytes per faded generation via setLED %.1f, per beat step %.1f", generationBytes, beatBytes);
+
+	hal->attachUsbDevice(HOST_GRID_ADDRESS, NULL);
+
+	/* The same grid without the flag is only ever off and on */
+	HostGridDevice* plainDevice = new HostGridDevice(DEVICE_GRIDS, 1);
+	HostGridController* plain = new HostGridController(DEVICE_GRIDS, 16, 16, false);
+
+	hal->attachUsbDevice(HOST_GRID_ADDRESS, plainDevice);
+	plain->connect();
+	plain->settle(hal);
+
+	plain->set(0, 1, 1, 7);
+	plain->settle(hal);
+
+	for (int column = 0; column < 16; column++)
+	{
+		for (int row = 0; row < 16; row++) plain->fill(0, column, row, (column * row) % 16);
+	}
+
+	plain->refresh();
+	plain->settle(hal);
+
+	HOST_CHECK(plainDevice->commands[0x18] == 0);
+	HOST_CHECK(plainDevice->commands[0x1A] == 0);
+	HOST_CHECK(plainDevice->commands[0x11] == 1);
+	HOST_CHECK(plain->mismatches(plainDevice) == 0);
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,241 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/*
+
+	Builds a FAT16 card image for the tests that read loops off the SD card, so they
+	don't depend on a prepared image or on host tools to make one. Files go in
+	folders under LOOPS, the way the loopers look for them, and can be laid out in one
+	run of clusters or scattered so both of StreamingSignalData's read paths get used.
+
+*/
+
+#ifndef HostFatImage_h
+#define HostFatImage_h
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "HostSdCard.h"
+
+/* A 32MB superfloppy with 2KB clusters, which is just big enough to have to be FAT16 */
+#define HOST_FAT_SECTORS 65536
+#define HOST_FAT_CLUSTER_SECTORS 4
+#define HOST_FAT_FAT_SECTORS 64
+#define HOST_FAT_ROOT_ENTRIES 512
+
+/* 2013-01-01 */
+#define HOST_FAT_DEFAULT_DATE ((33 << 9) | (1 << 5) | 1)
+
+class HostFatImage
+{
+	public:
+		void addFile(const char* folder, const char* name, const std::vector<uint8_t>& data, bool fragmented = false)
+		{
+			HostFatFile file;
+
+			file.folder = folder;
+			file.name = name;
+			file.data = data;
+			file.fragmented = fragmented;
+
+			this->files.push_back(file);
+		}
+
+		/* Writes the image to a temporary file and puts a card with it on the chip select */
+		nw2s::HostSdCard* attach(int cspin = 10)
+		{
+			this->build();
+
+			FILE* image = tmpfile();
+
+			if ((image == NULL) || (fwrite(&this->image[0], 1, this->image.size(), image) != this->image.size())) return NULL;
+
+			nw2s::HostSdCard* card = new nw2s::HostSdCard(image);
+			((nw2s::SimulatedHAL*)nw2s::HostHAL::get())->attachSpiDevice(cspin, card);
+
+			return card;
+		}
+
+	private:
+		struct HostFatFile
+		{
+			std::string folder;
+			std::string name;
+			std::vector<uint8_t> data;
+			bool fragmented;
+		};
+
+		std::vector<HostFatFile> files;
+		std::vector<uint8_t> image;
+		std::vector<uint16_t> fat;
+		uint16_t nextCluster;
+
+		static const int CLUSTER_BYTES = HOST_FAT_CLUSTER_SECTORS * 512;
+		static const int ROOT_SECTOR = 1 + (2 * HOST_FAT_FAT_SECTORS);
+		static const int DATA_SECTOR = ROOT_SECTOR + ((HOST_FAT_ROOT_ENTRIES * 32) / 512);
+
+		uint8_t* cluster(uint16_t index)
+		{
+			return &this->image[(DATA_SECTOR + ((index - 2) * HOST_FAT_CLUSTER_SECTORS)) * 512];
+		}
+
+		/* Scattered files take every other cluster, working backwards */
+		std::vector<uint16_t> allocate(uint32_t bytes, bool fragmented)
+		{
+			int count = (bytes + CLUSTER_BYTES - 1) / CLUSTER_BYTES;
+			std::vector<uint16_t> chain;
+
+			if (count == 0) return chain;
+
+			for (int i = 0; i < count; i++)
+			{
+				chain.push_back(fragmented ? this->nextCluster + (2 * (count - 1 - i)) : this->nextCluster + i);
+			}
+
+			this->nextCluster += fragmented ? (2 * count) : count;
+
+			for (int i = 0; i < count; i++)
+			{
+				this->fat[chain[i]] = (i + 1 < count) ? chain[i + 1] : 0xFFFF;
+			}
+
+			return chain;
+		}
+
+		void write(const std::vector<uint16_t>& chain, const std::vector<uint8_t>& data)
+		{
+			for (size_t i = 0; i < chain.size(); i++)
+			{
+				size_t offset = i * CLUSTER_BYTES;
+				size_t length = (data.size() - offset < (size_t)CLUSTER_BYTES) ? data.size() - offset : CLUSTER_BYTES;
+
+				memcpy(this->cluster(chain[i]), &data[offset], length);
+			}
+		}
+
+		/* LOOP.WAV is stored as "LOOP    WAV" */
+		static void entry(uint8_t* target, const std::string& name, uint8_t attributes, uint16_t first, uint32_t size)
+		{
+			size_t dot = name.find('.');
+			std::string base = name.substr(0, dot);
+			std::string extension = (dot == std::string::npos) ? "" : name.substr(dot + 1);
+
+			memset(target, ' ', 11);
+			memcpy(target, base.c_str(), (base.size() > 8) ? 8 : base.size());
+			memcpy(target + 8, extension.c_str(), (extension.size() > 3) ? 3 : extension.size());
+			memset(target + 11, 0, 21);
+
+			target[11] = attributes;
+			target[24] = HOST_FAT_DEFAULT_DATE & 0xFF;
+			target[25] = HOST_FAT_DEFAULT_DATE >> 8;
+			target[26] = first & 0xFF;
+			target[27] = first >> 8;
+			target[28] = size & 0xFF;
+			target[29] = (size >> 8) & 0xFF;
+			target[30] = (size >> 16) & 0xFF;
+			target[31] = size >> 24;
+		}
+
+		void build()
+		{
+			this->image.assign(HOST_FAT_SECTORS * 512, 0);
+			this->fat.assign((HOST_FAT_FAT_SECTORS * 512) / 2, 0);
+			this->fat[0] = 0xFFF8;
+			this->fat[1] = 0xFFFF;
+			this->nextCluster = 2;
+
+			uint8_t* boot = &this->image[0];
+
+			boot[0] = 0xEB;
+			boot[1] = 0x3C;
+			boot[2] = 0x90;
+			memcpy(&boot[3], "NW2SHOST", 8);
+			boot[11] = 512 & 0xFF;
+			boot[12] = 512 >> 8;
+			boot[13] = HOST_FAT_CLUSTER_SECTORS;
+			boot[14] = 1;
+			boot[16] = 2;
+			boot[17] = HOST_FAT_ROOT_ENTRIES & 0xFF;
+			boot[18] = HOST_FAT_ROOT_ENTRIES >> 8;
+			boot[21] = 0xF8;
+			boot[22] = HOST_FAT_FAT_SECTORS;
+			boot[32] = HOST_FAT_SECTORS & 0xFF;
+			boot[33] = (HOST_FAT_SECTORS >> 8) & 0xFF;
+			boot[34] = HOST_FAT_SECTORS >> 16;
+			boot[38] = 0x29;
+			memcpy(&boot[43], "NW2S       FAT16   ", 19);
+			boot[510] = 0x55;
+			boot[511] = 0xAA;
+
+			/* Every folder fits in one cluster */
+			std::vector<std::string> folders;
+
+			for (size_t i = 0; i < this->files.size(); i++)
+			{
+				bool known = false;
+
+				for (size_t j = 0; j < folders.size(); j++) known = known || (folders[j] == this->files[i].folder);
+
+				if (!known) folders.push_back(this->files[i].folder);
+			}
+
+			uint16_t loops = this->allocate(CLUSTER_BYTES, false)[0];
+			std::vector<uint16_t> folderClusters;
+
+			entry(&this->image[ROOT_SECTOR * 512], "LOOPS", 0x10, loops, 0);
+			entry(this->cluster(loops), ".", 0x10, loops, 0);
+			entry(this->cluster(loops) + 32, "..", 0x10, 0, 0);
+
+			for (size_t i = 0; i < folders.size(); i++)
+			{
+				uint16_t folder = this->allocate(CLUSTER_BYTES, false)[0];
+
+				folderClusters.push_back(folder);
+				entry(this->cluster(loops) + (64 + (32 * i)), folders[i], 0x10, folder, 0);
+				entry(this->cluster(folder), ".", 0x10, folder, 0);
+				entry(this->cluster(folder) + 32, "..", 0x10, loops, 0);
+			}
+
+			std::vector<int> entries(folders.size(), 2);
+
+			for (size_t i = 0; i < this->files.size(); i++)
+			{
+				HostFatFile* file = &this->files[i];
+				size_t folder = 0;
+
+				while (folders[folder] != file->folder) folder++;
+
+				std::vector<uint16_t> chain = this->allocate(file->data.size(), file->fragmented);
+
+				this->write(chain, file->data);
+				entry(this->cluster(folderClusters[folder]) + (32 * entries[folder]++), file->name, 0x20, chain.empty() ? 0 : chain[0], file->data.size());
+			}
+
+			for (int i = 0; i < 2; i++)
+			{
+				memcpy(&this->image[(1 + (i * HOST_FAT_FAT_SECTORS)) * 512], &this->fat[0], this->fat.size() * 2);
+			}
+		}
+};
+
+#endif
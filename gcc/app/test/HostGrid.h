@@ -0,0 +1,305 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+/*
+
+	A monome on the simulated USB host port for the grid tests. HostGridDevice plays every
+	command it is sent into a model of the LEDs, so a test can check the device shows what
+	the controller thinks it shows, and feeds the controller whatever input it is given in
+	packets of random size. HostGridController is a USBGridController that skips
+	enumeration and keeps the keys it is handed.
+
+*/
+
+#ifndef HostGrid_h
+#define HostGrid_h
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "Grid.h"
+
+/* Where the tests put the grid, anything but 0 will do since nothing enumerates */
+#define HOST_GRID_ADDRESS 1
+
+/* FTDI based devices start every USB packet with two modem status bytes */
+#define HOST_GRID_PACKET_SIZE 64
+#define HOST_GRID_STATUS_LENGTH 2
+
+class HostGridDevice : public nw2s::HostUsbDevice
+{
+	public:
+		nw2s::GridDevice deviceType;
+
+		/* What each LED is showing [column][row], as a level on varibright grids and 0 or 1 otherwise */
+		uint8_t leds[16][16];
+
+		/* Full brightness for the on/off commands */
+		uint8_t onLevel;
+
+		uint32_t commands[256];
+		uint32_t unknownCommands;
+
+		/* Level maps are only safe one per tick */
+		uint32_t levelMapsInOneTick;
+
+		/* Bytes queued for the controller to read, and how large a read may be */
+		std::vector<uint8_t> input;
+		size_t inputPosition;
+		uint32_t largestRead;
+
+		HostGridDevice(nw2s::GridDevice deviceType, uint8_t onLevel = 1)
+		{
+			this->deviceType = deviceType;
+			this->onLevel = onLevel;
+			this->inputPosition = 0;
+			this->largestRead = HOST_GRID_PACKET_SIZE;
+			this->lastLevelMap = -1;
+
+			this->clear();
+		}
+
+		void clear()
+		{
+			memset(this->leds, 0, sizeof(this->leds));
+			memset(this->commands, 0, sizeof(this->commands));
+			this->unknownCommands = 0;
+			this->levelMapsInOneTick = 0;
+		}
+
+		bool isFtdi()
+		{
+			return (this->deviceType == nw2s::DEVICE_SERIES) || (this->deviceType == nw2s::DEVICE_GRIDS);
+		}
+
+		virtual uint32_t out(uint32_t ep, const uint8_t* data, uint32_t length)
+		{
+			if (length == 0) return 0;
+
+			this->commands[data[0]]++;
+
+			if (this->deviceType == nw2s::DEVICE_SERIES)
+			{
+				this->series(data, length);
+			}
+			else if (this->deviceType == nw2s::DEVICE_GRIDS)
+			{
+				this->grids(data, length);
+			}
+
+			return 0;
+		}
+
+		/* Hands over up to one packet of queued input, with the status bytes in front if the device has them */
+		virtual uint32_t in(uint32_t ep, uint8_t* data, uint32_t* length)
+		{
+			uint32_t space = (*length < HOST_GRID_PACKET_SIZE) ? *length : HOST_GRID_PACKET_SIZE;
+			uint32_t count = 0;
+
+			if (this->inputPosition >= this->input.size())
+			{
+				*length = 0;
+				return 1;
+			}
+
+			if (this->isFtdi())
+			{
+				data[count++] = 0x31;
+				data[count++] = 0x60;
+			}
+
+			uint32_t limit = (this->largestRead < space) ? this->largestRead : space;
+			uint32_t payload = rand() % ((limit - count) + 1);
+
+			while ((payload-- > 0) && (this->inputPosition < this->input.size())) data[count++] = this->input[this->inputPosition++];
+
+			*length = count;
+
+			return 0;
+		}
+
+		bool inputPending()
+		{
+			return this->inputPosition < this->input.size();
+		}
+
+	private:
+		long lastLevelMap;
+
+		void series(const uint8_t* data, uint32_t length)
+		{
+			if (((data[0] & 0xF0) == 0x80) && (length == 9))
+			{
+				/* LED_FRAME - quadrant in the command, one row per byte */
+				uint8_t quadrant = data[0] & 0x03;
+
+				for (int row = 0; row < 8; row++)
+				{
+					for (int column = 0; column < 8; column++) this->leds[((quadrant & 1) * 8) + column][((quadrant >> 1) * 8) + row] = (data[1 + row] >> column) & 1;
+				}
+			}
+			else if (((data[0] == 0x20) || (data[0] == 0x30)) && (length == 2))
+			{
+				this->leds[data[1] >> 4][data[1] & 0x0F] = (data[0] == 0x20) ? 1 : 0;
+			}
+			else
+			{
+				this->unknownCommands++;
+			}
+		}
+
+		void grids(const uint8_t* data, uint32_t length)
+		{
+			if ((data[0] == 0x14) && (length == 11))
+			{
+				for (int row = 0; row < 8; row++)
+				{
+					for (int column = 0; column < 8; column++) this->set(data[1] + column, data[2] + row, ((data[3 + row] >> column) & 1) * this->onLevel);
+				}
+			}
+			else if ((data[0] == 0x1A) && (length == 35))
+			{
+				long now = millis();
+
+				if (now == this->lastLevelMap) this->levelMapsInOneTick++;
+				this->lastLevelMap = now;
+
+				/* Two LEDs per byte, the left one in the high nibble */
+				for (int row = 0; row < 8; row++)
+				{
+					for (int column = 0; column < 8; column++) this->set(data[1] + column, data[2] + row, (data[3 + (row * 4) + (column / 2)] >> ((column % 2) ? 0 : 4)) & 0x0F);
+				}
+			}
+			else if (((data[0] == 0x10) || (data[0] == 0x11)) && (length == 3))
+			{
+				this->set(data[1], data[2], (data[0] == 0x11) ? this->onLevel : 0);
+			}
+			else if ((data[0] == 0x18) && (length == 4))
+			{
+				this->set(data[1], data[2], data[3] & 0x0F);
+			}
+			else
+			{
+				this->unknownCommands++;
+			}
+		}
+
+		void set(int column, int row, uint8_t level)
+		{
+			if ((column < 16) && (row < 16)) this->leds[column][row] = level;
+		}
+};
+
+typedef struct
+{
+	uint8_t column;
+	uint8_t row;
+	bool pressed;
+}
+HostGridKey;
+
+class HostGridController : public nw2s::USBGridController
+{
+	public:
+		std::vector<HostGridKey> keys;
+
+		HostGridController(nw2s::GridDevice deviceType, uint8_t columns, uint8_t rows, bool varibright = false) : USBGridController(deviceType, columns, rows)
+		{
+			this->varibright = varibright;
+			memset(this->cells, 0, sizeof(this->cells));
+		}
+
+		/* Takes the address and endpoints a real enumeration would have set up */
+		void connect()
+		{
+			this->bAddress = HOST_GRID_ADDRESS;
+			this->epInfo[epDataInIndex].maxPktSize = HOST_GRID_PACKET_SIZE;
+			this->epInfo[epDataOutIndex].maxPktSize = HOST_GRID_PACKET_SIZE;
+			this->ready = true;
+		}
+
+		/* Runs the controller for a few ticks so everything it has marked goes out */
+		void settle(nw2s::SimulatedHAL* hal, int ticks = 6)
+		{
+			for (int i = 0; i < ticks; i++)
+			{
+				hal->advance(1000);
+				this->task();
+			}
+		}
+
+		/* Cells on the current page that the device isn't showing at the level it should */
+		int mismatches(HostGridDevice* device)
+		{
+			int count = 0;
+
+			for (int column = 0; column < this->columnCount; column++)
+			{
+				for (int row = 0; row < this->rowCount; row++)
+				{
+					if (device->leds[column][row] != this->ledLevel(this->cells[this->currentPage][column][row])) count++;
+				}
+			}
+
+			return count;
+		}
+
+		void set(uint8_t page, uint8_t column, uint8_t row, uint8_t value)
+		{
+			this->setLED(page, column, row, value);
+		}
+
+		void clear(uint8_t page, uint8_t column, uint8_t row)
+		{
+			this->clearLED(page, column, row);
+		}
+
+		void page(uint8_t page)
+		{
+			this->switchPage(page);
+		}
+
+		/* Writes a page without marking anything, the way GameOfLife draws a generation before one refreshGrid() */
+		void fill(uint8_t page, uint8_t column, uint8_t row, uint8_t value)
+		{
+			this->cells[page][column][row] = value;
+		}
+
+		void refresh()
+		{
+			this->refreshGrid();
+		}
+
+		virtual void buttonPressed(uint8_t column, uint8_t row)
+		{
+			HostGridKey key = { column, row, true };
+			this->keys.push_back(key);
+		}
+
+		virtual void buttonReleased(uint8_t column, uint8_t row)
+		{
+			HostGridKey key = { column, row, false };
+			this->keys.push_back(key);
+		}
+};
+
+#endif
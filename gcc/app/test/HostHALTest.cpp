@@ -0,0 +1,131 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "HostTest.h"
+#include <string.h>
+
+using namespace nw2s;
+
+/*
+
+	Checks the simulated hardware the other host tests are built on - manual time, timer
+	interrupts, pin interrupts and the SPI and I2C device hooks.
+
+*/
+
+static int timerFires = 0;
+static uint64_t timerTimes[8];
+static int pinFires = 0;
+
+static void timerHandler()
+{
+	if (timerFires < 8) timerTimes[timerFires] = hostTestHAL()->micros();
+	timerFires++;
+}
+
+static void pinHandler()
+{
+	pinFires++;
+}
+
+class EchoSpiDevice : public HostSpiDevice
+{
+	public:
+		int selects = 0;
+		int bytes = 0;
+
+		virtual void select() { this->selects++; }
+		virtual uint8_t transfer(uint8_t data) { this->bytes++; return data ^ 0xFF; }
+};
+
+class RegisterI2cDevice : public HostI2cDevice
+{
+	public:
+		uint8_t registers[16];
+
+		virtual bool write(const uint8_t* data, size_t length)
+		{
+			for (size_t i = 1; i < length; i++) this->registers[(data[0] + i - 1) & 0x0F] = data[i];
+			return true;
+		}
+
+		virtual size_t read(uint8_t* data, size_t length)
+		{
+			memcpy(data, this->registers, (length > 16) ? 16 : length);
+			return (length > 16) ? 16 : length;
+		}
+};
+
+void setup()
+{
+	SimulatedHAL* hal = hostTestHAL();
+	hal->setManualTime(true);
+
+	/* Time only moves when it's told to */
+	uint64_t start = hal->micros();
+	HOST_CHECK(hal->micros() == start);
+	hal->advance(1500);
+	HOST_CHECK(hal->micros() == start + 1500);
+
+	/* A 1ms timer fires once per period, at the time it came due */
+	hal->timerAttach(0, timerHandler);
+	hal->timerStart(0, 84000);
+	uint64_t armed = hal->micros();
+	hal->advance(5000);
+	HOST_CHECK(timerFires == 5);
+	for (int i = 0; i < 5; i++) HOST_CHECK(timerTimes[i] == armed + ((i + 1) * 1000));
+	hal->timerStop(0);
+	hal->advance(5000);
+	HOST_CHECK(timerFires == 5);
+
+	/* Rising edge interrupts only see rising edges */
+	hal->attachInterrupt(22, pinHandler, 4);
+	hal->setDigitalInput(22, 1);
+	hal->setDigitalInput(22, 1);
+	hal->setDigitalInput(22, 0);
+	hal->setDigitalInput(22, 1);
+	HOST_CHECK(pinFires == 2);
+	HOST_CHECK(hal->digitalRead(22) == 1);
+
+	/* SPI only reaches the device while its chip select is low */
+	EchoSpiDevice spi;
+	hal->attachSpiDevice(10, &spi);
+	hal->digitalWrite(10, 1);
+	HOST_CHECK(hal->spiTransfer(0x12) == 0xFF);
+	hal->digitalWrite(10, 0);
+	HOST_CHECK(hal->spiTransfer(0x12) == 0xED);
+	hal->digitalWrite(10, 1);
+	HOST_CHECK((spi.selects == 1) && (spi.bytes == 1));
+
+	/* I2C writes go to whoever is at the address, anyone else is a NACK */
+	RegisterI2cDevice i2c;
+	memset(i2c.registers, 0, sizeof(i2c.registers));
+	hal->attachI2cDevice(1, 0x40, &i2c);
+	uint8_t message[] = { 2, 0xAA, 0xBB };
+	HOST_CHECK(hal->i2cWrite(1, 0x40, message, 3) == 0);
+	HOST_CHECK(hal->i2cWrite(1, 0x41, message, 3) == 2);
+	HOST_CHECK((i2c.registers[2] == 0xAA) && (i2c.registers[3] == 0xBB));
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
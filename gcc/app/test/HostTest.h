@@ -0,0 +1,78 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+
+	Helpers shared by the host tests. A test is built like a firmware - its setup() runs the
+	checks against the simulated hardware and then calls hostTestExit(), which ends the process
+	with a non-zero status if any HOST_CHECK failed. 'make host-test' builds and runs them all.
+
+	Measurements are printed as RESULT lines on stderr so they stand out from whatever the
+	framework prints on Serial.
+
+*/
+
+#ifndef HostTest_h
+#define HostTest_h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "HostHAL.h"
+
+static int hostTestFailures = 0;
+
+#define HOST_CHECK(condition) hostTestCheck((condition), #condition, __FILE__, __LINE__)
+#define HOST_REPORT(...) do { fprintf(stderr, "RESULT "); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); } while (0)
+
+static inline bool hostTestCheck(bool passed, const char* condition, const char* file, int line)
+{
+	if (!passed)
+	{
+		hostTestFailures++;
+
+		/* Only the first few, a broken check in a loop would bury everything else */
+		if (hostTestFailures <= 20) fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+	}
+
+	return passed;
+}
+
+static inline void hostTestExit()
+{
+	fprintf(stderr, (hostTestFailures > 0) ? "FAIL (%d checks failed)\n" : "PASS\n", hostTestFailures);
+	exit((hostTestFailures > 0) ? 1 : 0);
+}
+
+static inline nw2s::SimulatedHAL* hostTestHAL()
+{
+	return (nw2s::SimulatedHAL*)nw2s::HostHAL::get();
+}
+
+/* Wall clock time for benchmarks, simulated time comes from the HAL */
+static inline double hostTestNanos()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((double)ts.tv_sec * 1e9) + (double)ts.tv_nsec;
+}
+
+#endif
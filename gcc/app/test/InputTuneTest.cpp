@@ -0,0 +1,223 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "HostFatImage.h"
+#include "AnalogScanner.h"
+#include "IO.h"
+#include "b.h"
+
+using namespace nw2s;
+
+/*
+
+	Checks the 16.16 input calibration against the rational arithmetic it stands in for. With
+	val = 4095 - raw the calibrated value is val * scale / 1000 + offset, rounded to nearest and
+	limited to 12 bits. Every raw value is read on all 12 inputs, each with its own gain and
+	offset error, both sides of unity gain and both signs of offset. The fixed point path may
+	only disagree with the exact value by one code, and only where the exact value is close
+	enough to a half for the rounding of the gain and bias to tip it. Without soft tuning every input has to read its raw value.
+
+	Last, a calibration is saved to /config/inputs.b on an empty card, scribbled over, and
+	loaded back. Every input has to read the same at every raw value as it did before.
+
+*/
+
+#define INPUT_TUNE_SETS 4
+
+/* Half a 16.16 step of gain over 4095 codes plus half a step of bias, in thousandths of a code */
+#define INPUT_TUNE_SLACK 32
+
+static const int32_t scales[INPUT_TUNE_SETS][12] = {
+	{ 970, 975, 982, 990, 996, 1000, 1000, 1004, 1011, 1019, 1026, 1030 },
+	{ 1030, 1022, 1015, 1007, 1001, 999, 1000, 993, 987, 979, 974, 970 },
+	{ 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000 },
+	{ 333, 500, 667, 750, 900, 1100, 1250, 1333, 1500, 1750, 2000, 2500 },
+};
+
+static const int16_t offsets[INPUT_TUNE_SETS][12] = {
+	{ -40, 40, -23, 17, -5, 0, 3, -1, 29, -37, 11, -13 },
+	{ 40, -40, 0, 1, -2, 19, -19, 33, -8, 7, -31, 25 },
+	{ -40, -20, -10, -5, -2, -1, 1, 2, 5, 10, 20, 40 },
+	{ -300, 250, -120, 60, 0, -45, 90, -200, 150, 0, -75, 300 },
+};
+
+/* Round to nearest on the inverted value, halves away from zero */
+static int exactRead(int raw, int32_t scale, int16_t offset)
+{
+	int64_t n = ((int64_t)(4095 - raw) * scale) + ((int64_t)offset * 1000);
+	int64_t val = (n >= 0) ? (n + 500) / 1000 : -((-n + 500) / 1000);
+
+	return (val < 0) ? 0 : (val > 4095) ? 4095 : (int)val;
+}
+
+/* What the compiled gain and bias make of every raw value on every input */
+static void readAll(std::vector<int>& values)
+{
+	SimulatedHAL* hal = hostTestHAL();
+
+	values.clear();
+
+	for (int raw = 0; raw < 4096; raw++)
+	{
+		for (int i = 0; i < 12; i++) hal->setAnalogInput(i, raw);
+		for (int i = 0; i < 12; i++) values.push_back(nw2s::analogRead(INDEX_ANALOG_IN[i + 1]));
+	}
+}
+
+static void roundTrip()
+{
+	HostFatImage image;
+	image.attach(SD_CS);
+
+	/* Nothing there yet */
+	HOST_CHECK(!b::loadInputCalibration());
+
+	b::inputSoftTune = true;
+
+	for (int i = 0; i < 12; i++)
+	{
+		b::inputScale[i] = scales[INPUT_TUNE_SETS - 1][i];
+		b::inputOffset[i] = offsets[INPUT_TUNE_SETS - 1][i];
+	}
+
+	IOUtils::compileInputTune();
+
+	std::vector<int> saved;
+	readAll(saved);
+
+	HOST_CHECK(b::saveInputCalibration());
+
+	b::inputSoftTune = false;
+
+	for (int i = 0; i < 12; i++)
+	{
+		b::inputScale[i] = 1000;
+		b::inputOffset[i] = 0;
+	}
+
+	IOUtils::compileInputTune();
+
+	HOST_CHECK(b::loadInputCalibration());
+	HOST_CHECK(b::inputSoftTune);
+
+	int fields = 0;
+
+	for (int i = 0; i < 12; i++)
+	{
+		if (!HOST_CHECK((b::inputScale[i] == scales[INPUT_TUNE_SETS - 1][i]) && (b::inputOffset[i] == offsets[INPUT_TUNE_SETS - 1][i]))) fields++;
+	}
+
+	std::vector<int> loaded;
+	readAll(loaded);
+
+	int changed = 0;
+
+	for (unsigned int i = 0; i < saved.size(); i++)
+	{
+		if (saved[i] != loaded[i]) changed++;
+	}
+
+	HOST_CHECK(changed == 0);
+
+	HOST_REPORT("/config/inputs.b round trip: %d inputs with the wrong scale or offset, %d of %u reads changed", fields, changed, (unsigned int)saved.size());
+}
+
+void setup()
+{
+	SimulatedHAL* hal = hostTestHAL();
+
+	analogReadResolution(12);
+
+	/* The scanner isn't started, so every read goes straight to the converter */
+	HOST_CHECK(!AnalogScanner::isRunning());
+
+	/* Uncalibrated is the identity */
+	b::inputSoftTune = false;
+	IOUtils::compileInputTune();
+
+	int identity = 0;
+
+	for (int raw = 0; raw < 4096; raw++)
+	{
+		for (int i = 0; i < 12; i++) hal->setAnalogInput(i, raw);
+		for (int i = 0; i < 12; i++) if (nw2s::analogRead(INDEX_ANALOG_IN[i + 1]) != 4095 - raw) identity++;
+	}
+
+	HOST_CHECK(identity == 0);
+
+	b::inputSoftTune = true;
+
+	long reads = 0;
+	long differ = 0;
+	long worst = 0;
+
+	for (int set = 0; set < INPUT_TUNE_SETS; set++)
+	{
+		for (int i = 0; i < 12; i++)
+		{
+			b::inputScale[i] = scales[set][i];
+			b::inputOffset[i] = offsets[set][i];
+		}
+
+		IOUtils::compileInputTune();
+
+		for (int raw = 0; raw < 4096; raw++)
+		{
+			for (int i = 0; i < 12; i++) hal->setAnalogInput(i, raw);
+
+			for (int i = 0; i < 12; i++)
+			{
+				int value = nw2s::analogRead(INDEX_ANALOG_IN[i + 1]);
+				int exact = exactRead(raw, scales[set][i], offsets[set][i]);
+				int error = (value > exact) ? value - exact : exact - value;
+
+				reads++;
+
+				if (error == 0) continue;
+
+				differ++;
+				if (error > worst) worst = error;
+
+				/* Only a value close enough to a half can land on the other side of it */
+				int64_t n = ((int64_t)(4095 - raw) * scales[set][i]) + ((int64_t)offsets[set][i] * 1000);
+				int64_t remainder = ((n % 1000) + 1000) % 1000;
+
+				HOST_CHECK((remainder >= 500 - INPUT_TUNE_SLACK) && (remainder <= 500 + INPUT_TUNE_SLACK));
+			}
+		}
+	}
+
+	HOST_CHECK(worst <= 1);
+
+	HOST_REPORT("16.16 calibration vs exact rounding: %ld of %ld reads differ, worst %ld code", differ, reads, worst);
+
+	roundTrip();
+
+	b::inputSoftTune = false;
+	IOUtils::compileInputTune();
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,264 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <limits.h>
+#include "HostTest.h"
+#include "EventManager.h"
+#include "IO.h"
+#include "b.h"
+
+using namespace nw2s;
+
+/*
+
+	Traces the I2C bus to the PCA9685 output LED driver while all 16 outputs change every
+	10mS for a second. The CV path must never touch the bus, the LEDs may only be refreshed
+	once every PCA9685_REFRESH_MS in bursts of at most PCA9685_LEDS_PER_WRITE, and once the
+	last refresh is out the registers have to show the last values written. A second driver
+	is then run by hand across the point where millis() wraps to check that the rate cap
+	holds there too.
+
+*/
+
+#define LED_TEST_PERIOD 10
+#define LED_TEST_MS 1000
+
+/* Keeps MODE1 so init() sees the device, and the LED registers with auto-increment */
+class TracePca : public HostI2cDevice
+{
+	public:
+		uint8_t registers[256];
+		uint32_t ledWrites;
+		uint32_t refreshes;
+		long lastRefresh;
+		long shortestGap;
+
+		TracePca()
+		{
+			memset(this->registers, 0, sizeof(this->registers));
+			this->registers[PCA9685_MODE1] = 0x01;
+			this->pointer = 0;
+			this->ledWrites = 0;
+			this->refreshes = 0;
+			this->lastRefresh = -1;
+			this->shortestGap = LONG_MAX;
+		}
+
+		virtual bool write(const uint8_t* data, size_t length)
+		{
+			if (length == 0) return true;
+
+			this->pointer = data[0];
+
+			for (size_t i = 1; i < length; i++) this->registers[(uint8_t)(this->pointer++)] = data[i];
+
+			if ((data[0] >= PCA9685_LED0) && (length > 1))
+			{
+				long now = millis();
+
+				this->ledWrites++;
+
+				/* Bursts in the same millisecond are one refresh */
+				if (now != this->lastRefresh)
+				{
+					if ((this->lastRefresh >= 0) && (now - this->lastRefresh < this->shortestGap)) this->shortestGap = now - this->lastRefresh;
+
+					this->refreshes++;
+					this->lastRefresh = now;
+				}
+			}
+
+			return true;
+		}
+
+		virtual size_t read(uint8_t* data, size_t length)
+		{
+			for (size_t i = 0; i < length; i++) data[i] = this->registers[(uint8_t)(this->pointer + i)];
+
+			return length;
+		}
+
+		int ledOff(int led)
+		{
+			return this->registers[PCA9685_LED0 + (4 * led) + 2] | (this->registers[PCA9685_LED0 + (4 * led) + 3] << 8);
+		}
+
+	private:
+		uint8_t pointer;
+};
+
+static AnalogOut* outs[16];
+static uint32_t transactionsInCV = 0;
+
+static int stepCV(int step, int output)
+{
+	return (((step * (output + 1)) % 10) * 1000) - 5000;
+}
+
+/* What outputCV() asks the driver for */
+static int expectedLED(int cv)
+{
+	int dacval = b::cvGainMode ?
+		(4095 - ((cv + 10000) * 4000UL) / 20000) :
+		(4095 - ((cv +  5000) * 4000UL) / 10000);
+
+	dacval = (dacval < 0) ? 0 : (dacval > 4095) ? 4095 : dacval;
+
+	int ledval = (cv == 0) ? 0 : (dacval < 2000) ? 4000 - (dacval * 2) : (dacval - 2000) * 2;
+
+	return (ledval * 10) / b::dimming;
+}
+
+class Stepper : public TimeBasedDevice
+{
+	public:
+		int steps;
+		bool running;
+
+		Stepper()
+		{
+			this->steps = 0;
+			this->running = true;
+		}
+
+		virtual void timer(unsigned long t)
+		{
+			if (!this->running || ((t % LED_TEST_PERIOD) != 0)) return;
+
+			SimulatedHAL* hal = hostTestHAL();
+			uint32_t before = hal->stats.i2cTransactions;
+
+			this->steps++;
+
+			for (int i = 0; i < 16; i++) outs[i]->outputCV(stepCV(this->steps, i), false);
+
+			transactionsInCV += hal->stats.i2cTransactions - before;
+		}
+};
+
+void setup()
+{
+	SimulatedHAL* hal = hostTestHAL();
+	TracePca* pca = new TracePca();
+
+	hal->attachI2cDevice(1, PCA9685_I2C_BASE_ADDRESS, pca);
+
+	EventManager::initialize();
+
+	HOST_CHECK(IOUtils::enableLED);
+
+	for (int i = 0; i < 16; i++) outs[i] = AnalogOut::create(INDEX_ANALOG_OUT[i + 1]);
+
+	Stepper* stepper = new Stepper();
+
+	EventManager::registerDevice(stepper);
+
+	hal->setManualTime(true);
+	hal->advance(0);
+	hal->resetStats();
+
+	pca->refreshes = 0;
+	pca->lastRefresh = -1;
+	pca->shortestGap = LONG_MAX;
+
+	unsigned long start = millis();
+
+	while (millis() - start < LED_TEST_MS)
+	{
+		EventManager::loop();
+		hal->advance(50);
+	}
+
+	uint32_t bytes = hal->stats.i2cBytes;
+	uint32_t transactions = hal->stats.i2cTransactions;
+	uint32_t refreshes = pca->refreshes;
+
+	/* Let the last change out */
+	stepper->running = false;
+
+	for (int i = 0; i < 4 * PCA9685_REFRESH_MS; i++)
+	{
+		EventManager::loop();
+		hal->advance(250);
+	}
+
+	/* Nothing from the CV path, one refresh per period at most, each in as few bursts as the Wire buffer allows */
+	int burstsPerRefresh = (PCA9685_LED_COUNT + PCA9685_LEDS_PER_WRITE - 1) / PCA9685_LEDS_PER_WRITE;
+
+	HOST_CHECK(transactionsInCV == 0);
+	HOST_CHECK(pca->shortestGap >= PCA9685_REFRESH_MS);
+	HOST_CHECK(refreshes <= (LED_TEST_MS / PCA9685_REFRESH_MS) + 1);
+	HOST_CHECK(transactions <= refreshes * burstsPerRefresh);
+	HOST_CHECK(bytes <= refreshes * ((PCA9685_LED_COUNT * 4) + burstsPerRefresh));
+
+	for (int i = 0; i < 16; i++) HOST_CHECK(pca->ledOff(i) == expectedLED(stepCV(stepper->steps, i)));
+
+	/* Every change used to go out as its own 6 byte write */
+	HOST_REPORT("16 outputs every %dmS: %lu I2C bytes/s, %lu transactions/s, %lu refreshes/s (unbuffered: %d bytes/s, %d transactions/s)", LED_TEST_PERIOD, (unsigned long)(bytes * 1000UL / LED_TEST_MS), (unsigned long)(transactions * 1000UL / LED_TEST_MS), (unsigned long)(refreshes * 1000UL / LED_TEST_MS), 16 * 6 * (1000 / LED_TEST_PERIOD), 16 * (1000 / LED_TEST_PERIOD));
+
+	/* The rate cap across the millis() wrap */
+	TracePca* wrapped = new TracePca();
+	PCA9685 driver;
+
+	hal->attachI2cDevice(1, PCA9685_I2C_BASE_ADDRESS | 1, wrapped);
+	driver.begin(1);
+
+	unsigned long t = ULONG_MAX - 5;
+
+	/* The driver is updated from boot on, so bring it up to the wrap in steps it can follow */
+	for (int i = 1; i < 8; i++) driver.update((ULONG_MAX / 8) * i);
+
+	driver.update(t - 1);
+
+	HOST_CHECK(wrapped->ledWrites == 0);
+
+	driver.stageLED(0, 0, 100);
+	driver.update(t);
+
+	HOST_CHECK(wrapped->ledWrites == 1);
+
+	/* The next refresh is due after the wrap, nothing may go out before it */
+	driver.stageLED(0, 0, 200);
+
+	for (int i = 1; i < PCA9685_REFRESH_MS; i++) driver.update(t + i);
+
+	HOST_CHECK(wrapped->ledWrites == 1);
+
+	driver.update(t + PCA9685_REFRESH_MS);
+
+	HOST_CHECK(wrapped->ledWrites == 2);
+	HOST_CHECK(wrapped->ledOff(0) == 200);
+
+	/* And after a long quiet spell a change still goes straight out */
+	for (unsigned long i = 1; i <= 100000; i++) driver.update(t + PCA9685_REFRESH_MS + i);
+
+	driver.stageLED(0, 0, 300);
+	driver.update(t + PCA9685_REFRESH_MS + 100001);
+
+	HOST_CHECK(wrapped->ledWrites == 3);
+	HOST_CHECK(wrapped->ledOff(0) == 300);
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
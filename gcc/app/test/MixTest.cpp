@@ -0,0 +1,189 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "Mix.h"
+
+using namespace nw2s;
+
+/*
+
+	Checks each of the Looper's block mix kernels against the per-sample code they replaced,
+	on random samples with the int16 extremes and runs of equal samples mixed in, with and
+	without a bit crusher. Then times both.
+
+*/
+
+#define MIX_TEST_SAMPLES 4096
+#define MIX_TEST_BLOCK 64
+#define MIX_TEST_PASSES 200
+
+enum MixTestMode { MIX_SINGLE, MIX_AND, MIX_XOR, MIX_RING, MIX_BLEND, MIX_GLITCH, MIX_MODES };
+
+static const char* const MIX_MODE_NAMES[MIX_MODES] = { "single", "AND", "XOR", "RING", "BLEND", "GLITCH" };
+
+static int16_t a[MIX_TEST_SAMPLES];
+static int16_t b[MIX_TEST_SAMPLES];
+static uint32_t dither[MIX_TEST_SAMPLES / 32];
+static uint16_t expected[MIX_TEST_SAMPLES];
+static uint16_t actual[MIX_TEST_SAMPLES];
+
+static const unsigned int GAIN1 = 724;
+static const unsigned int GAIN2 = 300;
+
+/* The old Looper::nextSample(), one sample at a time */
+static uint16_t referenceSample(int mode, int i, bool* stream, bool* trigger, bool crush, uint16_t mask)
+{
+	int32_t outputval = 0;
+
+	if (mode == MIX_SINGLE)
+	{
+		outputval = a[i];
+	}
+	else if (mode == MIX_AND)
+	{
+		outputval = a[i] & b[i];
+	}
+	else if (mode == MIX_XOR)
+	{
+		outputval = a[i] ^ b[i];
+	}
+	else if (mode == MIX_BLEND)
+	{
+		int16_t sample1 = a[i];
+		int16_t sample2 = b[i];
+
+		int16_t val1 = (sample1 * GAIN1) / 1024;
+		int16_t val2 = (sample2 * GAIN2) / 1024;
+
+		outputval = (val1 + val2) ^ ((dither[i >> 5] >> (i & 31)) & 1);
+	}
+	else if (mode == MIX_GLITCH)
+	{
+		int sample1 = a[i];
+		int sample2 = b[i];
+
+		*stream = *stream ^ (sample1 == sample2);
+
+		if (!*trigger) *trigger = (sample1 == sample2);
+
+		outputval = (*stream) ? sample2 : sample1;
+	}
+	else if (mode == MIX_RING)
+	{
+		long val1 = a[i] * b[i];
+
+		outputval = val1 >> 16;
+	}
+
+	outputval = outputval + 0x7FFF;
+	outputval = (outputval > 0xFFFF) ? 0xFFFF : (outputval < 0) ? 0 : outputval;
+
+	if (crush) outputval = outputval & mask;
+
+	return outputval >> 4;
+}
+
+static void mixBlock(int mode, uint16_t* block, int offset, int samples, bool* stream, bool* trigger, uint16_t mask)
+{
+	switch (mode)
+	{
+		case MIX_SINGLE: mixSingle(block, a + offset, samples, mask); break;
+		case MIX_AND: mixAnd(block, a + offset, b + offset, samples, mask); break;
+		case MIX_XOR: mixXor(block, a + offset, b + offset, samples, mask); break;
+		case MIX_RING: mixRing(block, a + offset, b + offset, samples, mask); break;
+		case MIX_BLEND: mixBlend(block, a + offset, b + offset, samples, GAIN1, GAIN2, dither + (offset / 32), mask); break;
+		case MIX_GLITCH: mixGlitch(block, a + offset, b + offset, samples, stream, trigger, mask); break;
+	}
+}
+
+static int16_t randomSample()
+{
+	switch (random(8))
+	{
+		case 0: return -32768;
+		case 1: return 32767;
+		case 2: return random(-4, 4);
+		default: return random(-32768, 32768);
+	}
+}
+
+void setup()
+{
+	randomSeed(5);
+
+	for (int i = 0; i < MIX_TEST_SAMPLES; i++)
+	{
+		a[i] = randomSample();
+
+		/* Plenty of equal samples so GLITCH switches a lot */
+		b[i] = (random(4) == 0) ? a[i] : randomSample();
+	}
+
+	for (int i = 0; i < MIX_TEST_SAMPLES / 32; i++) dither[i] = (random(0x10000) << 16) | random(0x10000);
+
+	for (int mode = 0; mode < MIX_MODES; mode++)
+	{
+		for (int crush = 0; crush < 2; crush++)
+		{
+			uint16_t mask = crush ? 0xF800 : 0xFFFF;
+			bool refStream = false, refTrigger = false;
+			bool stream = false, trigger = false;
+			int mismatches = 0;
+
+			for (int i = 0; i < MIX_TEST_SAMPLES; i++) expected[i] = referenceSample(mode, i, &refStream, &refTrigger, crush, mask);
+			for (int i = 0; i < MIX_TEST_SAMPLES; i += MIX_TEST_BLOCK) mixBlock(mode, actual + i, i, MIX_TEST_BLOCK, &stream, &trigger, mask);
+
+			for (int i = 0; i < MIX_TEST_SAMPLES; i++) if (expected[i] != actual[i]) mismatches++;
+
+			HOST_CHECK(mismatches == 0);
+			HOST_CHECK((stream == refStream) && (trigger == refTrigger));
+		}
+
+		/* Time both on the same data */
+		bool stream = false, trigger = false;
+		double start = hostTestNanos();
+
+		for (int pass = 0; pass < MIX_TEST_PASSES; pass++)
+		{
+			for (int i = 0; i < MIX_TEST_SAMPLES; i++) expected[i] = referenceSample(mode, i, &stream, &trigger, false, 0xFFFF);
+		}
+
+		double referenceNanos = hostTestNanos() - start;
+		start = hostTestNanos();
+
+		for (int pass = 0; pass < MIX_TEST_PASSES; pass++)
+		{
+			for (int i = 0; i < MIX_TEST_SAMPLES; i += MIX_TEST_BLOCK) mixBlock(mode, actual + i, i, MIX_TEST_BLOCK, &stream, &trigger, 0xFFFF);
+		}
+
+		double blockNanos = hostTestNanos() - start;
+		double samples = (double)MIX_TEST_PASSES * MIX_TEST_SAMPLES;
+
+		HOST_REPORT("%-6s per sample %5.0f Msamples/s, block %5.0f Msamples/s", MIX_MODE_NAMES[mode], (samples * 1000) / referenceNanos, (samples * 1000) / blockNanos);
+	}
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,128 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "HostSdCard.h"
+#include "IO.h"
+#include <sd/SD.h>
+
+using namespace nw2s;
+
+/*
+
+	Reads runs of blocks through Sd2Card from a card whose every byte says which block
+	it came from, and counts the commands. A multiple block read has to cost one CMD18
+	and no CMD17s, a read that carries on from the last one no command at all, and
+	anything else has to close the stream with CMD12 before it starts.
+
+*/
+
+#define MULTI_BLOCK_IMAGE_BLOCKS 2048
+#define MULTI_BLOCK_RUN 32
+
+static uint8_t patternByte(uint32_t block, int offset)
+{
+	return (uint8_t)((block * 7) + offset);
+}
+
+static int checkBlocks(const uint8_t* data, uint32_t block, int count)
+{
+	int errors = 0;
+
+	for (int i = 0; i < count * 512; i++)
+	{
+		if (data[i] != patternByte(block + (i / 512), i % 512)) errors++;
+	}
+
+	return errors;
+}
+
+void setup()
+{
+	FILE* image = tmpfile();
+	uint8_t block[512];
+
+	for (uint32_t b = 0; b < MULTI_BLOCK_IMAGE_BLOCKS; b++)
+	{
+		for (int i = 0; i < 512; i++) block[i] = patternByte(b, i);
+
+		fwrite(block, 1, 512, image);
+	}
+
+	HostSdCard* card = new HostSdCard(image);
+	hostTestHAL()->attachSpiDevice(SD_CS, card);
+
+	Sd2Card sd;
+	static uint8_t data[MULTI_BLOCK_RUN * 512];
+
+	HOST_CHECK(sd.init(SPI_HALF_SPEED, SD_CS));
+
+	/* One command for the whole run */
+	card->resetStats();
+
+	HOST_CHECK(sd.readBlocks(100, data, MULTI_BLOCK_RUN));
+	HOST_CHECK(checkBlocks(data, 100, MULTI_BLOCK_RUN) == 0);
+	HOST_CHECK(card->stats.commands[18] == 1);
+	HOST_CHECK(card->stats.commands[17] == 0);
+	HOST_CHECK(card->stats.commands[12] == 0);
+
+	/* Carrying on from where it stopped doesn't need another */
+	HOST_CHECK(sd.readBlocks(100 + MULTI_BLOCK_RUN, data, MULTI_BLOCK_RUN));
+	HOST_CHECK(checkBlocks(data, 100 + MULTI_BLOCK_RUN, MULTI_BLOCK_RUN) == 0);
+	HOST_CHECK(card->stats.commands[18] == 1);
+	HOST_CHECK(card->stats.commands[17] == 0);
+
+	uint32_t streamedBlocks = card->stats.blocksRead;
+	uint32_t streamedCommands = 0;
+
+	for (int i = 0; i < HOST_SD_COMMANDS; i++) streamedCommands += card->stats.commands[i];
+
+	/* Jumping somewhere else stops the stream and starts a new one */
+	HOST_CHECK(sd.readBlocks(1000, data, 4));
+	HOST_CHECK(checkBlocks(data, 1000, 4) == 0);
+	HOST_CHECK(card->stats.commands[12] == 1);
+	HOST_CHECK(card->stats.commands[18] == 2);
+
+	/* So does any other command, and the single block read still works after it */
+	HOST_CHECK(sd.readBlock(7, data));
+	HOST_CHECK(checkBlocks(data, 7, 1) == 0);
+	HOST_CHECK(card->stats.commands[12] == 2);
+	HOST_CHECK(card->stats.commands[17] == 1);
+
+	/* The same run the old way costs a command per block */
+	card->resetStats();
+
+	for (int i = 0; i < MULTI_BLOCK_RUN * 2; i++)
+	{
+		HOST_CHECK(sd.readBlock(100 + i, data));
+		HOST_CHECK(checkBlocks(data, 100 + i, 1) == 0);
+	}
+
+	HOST_CHECK(card->stats.commands[17] == MULTI_BLOCK_RUN * 2);
+
+	HOST_REPORT("%d blocks: CMD18 %lu commands for %lu blocks, CMD17 %lu commands", MULTI_BLOCK_RUN * 2, (unsigned long)streamedCommands, (unsigned long)streamedBlocks, (unsigned long)card->stats.commands[17]);
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,124 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "HostFatImage.h"
+#include "SignalData.h"
+
+using namespace nw2s;
+
+/*
+
+	Plays a file forward and reversed, laid out in one run and scattered, and checks the
+	refresh timing the stream keeps for printStats(). Every refresh that read a buffer is
+	counted, and on a card that takes a fixed time per block the average can't be much
+	less than the blocks in a buffer take to arrive. The host time each refresh took is
+	reported alongside, which is what the endian and reverse work shows up in.
+
+*/
+
+#define REFRESH_TEST_SAMPLES 100000
+#define REFRESH_TEST_BUFFERS 4
+#define REFRESH_TEST_PLAYED 200
+#define REFRESH_TEST_ACCESS_US 100
+
+static char folder[] = "LOOPS";
+static char subfolder[] = "REFRESH";
+static char contiguousName[] = "CONTIG.RAW";
+static char fragmentedName[] = "FRAG.RAW";
+
+static void checkRefresh(HostSdCard* card, char* name, int buffersize, bool reversed)
+{
+	StreamingSignalData* stream = StreamingSignalData::fromSDFile(folder, subfolder, name, true, REFRESH_TEST_BUFFERS, buffersize, 0);
+
+	if (reversed) stream->reverse();
+
+	card->setAccessTime(REFRESH_TEST_ACCESS_US);
+
+	uint32_t before = stream->getRefreshCount();
+	uint32_t refreshes = 0;
+	double nanos = 0;
+
+	for (int i = 0; i < REFRESH_TEST_PLAYED; i++)
+	{
+		for (int j = 0; j < buffersize; j++) stream->getNextSample();
+
+		while (stream->isReadyForRefresh())
+		{
+			double start = hostTestNanos();
+			stream->refresh();
+			nanos += hostTestNanos() - start;
+
+			refreshes++;
+		}
+	}
+
+	card->setAccessTime(0);
+
+	/* A buffer is a whole number of blocks. A streaming card starts finding the next block */
+	/* as the last one goes out, so now and then a refresh finds one already waiting. */
+	uint32_t blocks = (buffersize * 2) / 512;
+
+	HOST_CHECK(stream->getRefreshCount() - before == refreshes);
+	HOST_CHECK(stream->getRefreshAverage() >= (blocks * REFRESH_TEST_ACCESS_US) - (REFRESH_TEST_ACCESS_US / 2));
+	HOST_CHECK(stream->getRefreshPeak() >= stream->getRefreshAverage());
+	HOST_CHECK(stream->getUnderruns() == 0);
+
+	HOST_REPORT("%s %s, %4d samples: %lu refreshes, card %luus average %luus peak, host %.0fns per refresh", name, reversed ? "reversed" : "forward ", buffersize, (unsigned long)refreshes, (unsigned long)stream->getRefreshAverage(), (unsigned long)stream->getRefreshPeak(), nanos / refreshes);
+}
+
+void setup()
+{
+	std::vector<uint8_t> data;
+
+	for (int i = 0; i < REFRESH_TEST_SAMPLES; i++)
+	{
+		data.push_back(i & 0xFF);
+		data.push_back((i >> 8) & 0xFF);
+	}
+
+	HostFatImage image;
+
+	image.addFile(subfolder, contiguousName, data, false);
+	image.addFile(subfolder, fragmentedName, data, true);
+
+	HostSdCard* card = image.attach();
+
+	HOST_CHECK(card != NULL);
+
+	hostTestHAL()->setManualTime(true);
+
+	const int sizes[3] = { 256, 512, 1024 };
+
+	for (int i = 0; i < 3; i++)
+	{
+		checkRefresh(card, contiguousName, sizes[i], false);
+		checkRefresh(card, contiguousName, sizes[i], true);
+		checkRefresh(card, fragmentedName, sizes[i], false);
+		checkRefresh(card, fragmentedName, sizes[i], true);
+	}
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
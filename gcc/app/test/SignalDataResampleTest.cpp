@@ -0,0 +1,278 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "HostTest.h"
+#include "HostFatImage.h"
+#include "SignalData.h"
+#include <math.h>
+
+using namespace nw2s;
+
+/*
+
+	Plays a ramp and a sine off the card at speeds either side of unity. On a ramp every
+	interpolation lands on the line through the samples, so what comes out can be checked
+	against where the read position should be, across resampling blocks, buffers and
+	single samples. On the sine, Hermite has to do better than linear, which has to do
+	better than nothing. The resampler runs a few samples behind the stream, because it
+	needs the ones either side of where it is.
+
+	Then renders a loop held in RAM a semitone up in each mode and reports samples per
+	second, so the card doesn't get into the timing.
+
+*/
+
+#define RESAMPLE_TEST_RAMP 8000
+#define RESAMPLE_TEST_STEP 4
+#define RESAMPLE_TEST_SINE 96000
+#define RESAMPLE_TEST_PERIOD 11.3
+#define RESAMPLE_TEST_CHUNK 100
+#define RESAMPLE_TEST_SHORT 4000
+#define RESAMPLE_TEST_RENDERED 4000000
+
+/* Four samples of history, one of which is the one being played */
+#define RESAMPLE_TEST_LATENCY 3
+
+static char folder[] = "LOOPS";
+static char subfolder[] = "PITCH";
+static char rampName[] = "RAMP.RAW";
+static char sineName[] = "SINE.RAW";
+static char shortName[] = "SHORT.RAW";
+
+static const uint32_t speeds[] = { 0x4000, 0x8000, 0xC000, 0x10F39, 0x18000, 0x20000, 0x40000 };
+static const char* interpolations[] = { "none", "linear", "hermite" };
+
+static void fill(StreamingSignalData* stream)
+{
+	while (stream->isReadyForRefresh()) stream->refresh();
+}
+
+static std::vector<uint8_t> samples(int count, double (*f)(int))
+{
+	std::vector<uint8_t> data;
+
+	for (int i = 0; i < count; i++)
+	{
+		int16_t sample = (int16_t)lround(f(i));
+
+		data.push_back(sample & 0xFF);
+		data.push_back((sample >> 8) & 0xFF);
+	}
+
+	return data;
+}
+
+static double ramp(int i)
+{
+	return i * RESAMPLE_TEST_STEP;
+}
+
+static double sine(int i)
+{
+	return 20000.0 * sin(2.0 * M_PI * i / RESAMPLE_TEST_PERIOD);
+}
+
+static int16_t next(StreamingSignalData* stream, int i)
+{
+	/* Mix single samples in with the blocks */
+	if ((i % 7) == 0) return stream->getNextSample();
+
+	int16_t sample;
+	stream->getNextSamples(&sample, 1);
+
+	return sample;
+}
+
+static void checkRamp(uint32_t speed, StreamInterpolation interpolation)
+{
+	StreamingSignalData* stream = StreamingSignalData::fromSDFile(folder, subfolder, rampName, true, 4, 512, 0);
+
+	stream->setSpeed(speed);
+	stream->setInterpolation(interpolation);
+
+	HOST_CHECK(stream->getSpeed() == speed);
+
+	/* Stay clear of the loop point */
+	int count = ((uint64_t)(RESAMPLE_TEST_RAMP - 100) << 16) / speed;
+	int16_t block[RESAMPLE_TEST_CHUNK];
+	int worst = 0;
+	int out = 0;
+
+	while (out < count)
+	{
+		int length = (count - out > RESAMPLE_TEST_CHUNK) ? RESAMPLE_TEST_CHUNK : count - out;
+
+		/* Every other pass goes a sample at a time */
+		if ((out / RESAMPLE_TEST_CHUNK) & 1)
+		{
+			for (int i = 0; i < length; i++) block[i] = next(stream, out + i);
+		}
+		else
+		{
+			stream->getNextSamples(block, length);
+		}
+
+		for (int i = 0; i < length; i++)
+		{
+			uint64_t position = (uint64_t)(out + i) * speed;
+			double expected = (interpolation == INTERPOLATION_NONE) ? (double)(position >> 16) : (double)position / 65536.0;
+
+			expected = (expected - RESAMPLE_TEST_LATENCY) * RESAMPLE_TEST_STEP;
+
+			/* The history starts out silent */
+			if (expected < RESAMPLE_TEST_STEP) continue;
+
+			int error = abs(block[i] - (int)lround(expected));
+			worst = (error > worst) ? error : worst;
+		}
+
+		out += length;
+		fill(stream);
+	}
+
+	HOST_CHECK(worst <= 1);
+	HOST_CHECK(stream->getUnderruns() == 0);
+
+	HOST_REPORT("ramp at %.4f, %s: %d samples, worst error %d", speed / 65536.0, interpolations[interpolation], count, worst);
+}
+
+static double checkSine(uint32_t speed, StreamInterpolation interpolation)
+{
+	StreamingSignalData* stream = StreamingSignalData::fromSDFile(folder, subfolder, sineName, true, 4, 512, 0);
+
+	stream->setSpeed(speed);
+	stream->setInterpolation(interpolation);
+
+	int count = ((uint64_t)(RESAMPLE_TEST_SINE - 100) << 16) / speed;
+	int16_t block[RESAMPLE_TEST_CHUNK];
+	double squares = 0;
+	int measured = 0;
+
+	for (int out = 0; out + RESAMPLE_TEST_CHUNK <= count; out += RESAMPLE_TEST_CHUNK)
+	{
+		stream->getNextSamples(block, RESAMPLE_TEST_CHUNK);
+
+		for (int i = 0; (i < RESAMPLE_TEST_CHUNK) && (out > 0); i++)
+		{
+			double position = ((double)(out + i) * speed / 65536.0) - RESAMPLE_TEST_LATENCY;
+			double error = block[i] - (20000.0 * sin(2.0 * M_PI * position / RESAMPLE_TEST_PERIOD));
+
+			squares += error * error;
+			measured++;
+		}
+
+		fill(stream);
+	}
+
+	double rms = sqrt(squares / measured);
+
+	HOST_REPORT("sine at %.4f, %s: %.2f rms error", speed / 65536.0, interpolations[interpolation], rms);
+
+	return rms;
+}
+
+static void benchmark(uint32_t speed, StreamInterpolation interpolation)
+{
+	StreamingSignalData* stream = StreamingSignalData::fromSDFile(folder, subfolder, shortName, true, 2, 512, STREAM_CACHE_SIZE);
+
+	HOST_CHECK(stream->isCached());
+
+	stream->setSpeed(speed);
+	stream->setInterpolation(interpolation);
+
+	/* The looper renders a block per DAC interrupt */
+	int16_t block[RESAMPLE_TEST_CHUNK];
+	volatile int16_t sink = 0;
+	double start = hostTestNanos();
+
+	for (int out = 0; out < RESAMPLE_TEST_RENDERED; out += RESAMPLE_TEST_CHUNK)
+	{
+		stream->getNextSamples(block, RESAMPLE_TEST_CHUNK);
+		sink += block[0];
+	}
+
+	double seconds = (hostTestNanos() - start) / 1e9;
+
+	HOST_REPORT("render at %.4f, %s: %.1fM samples/s", speed / 65536.0, interpolations[interpolation], RESAMPLE_TEST_RENDERED / seconds / 1e6);
+}
+
+void setup()
+{
+	HostFatImage image;
+
+	image.addFile(subfolder, rampName, samples(RESAMPLE_TEST_RAMP, ramp));
+	image.addFile(subfolder, sineName, samples(RESAMPLE_TEST_SINE, sine));
+	image.addFile(subfolder, shortName, samples(RESAMPLE_TEST_SHORT, sine));
+
+	HOST_CHECK(image.attach() != NULL);
+
+	for (unsigned int i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++)
+	{
+		checkRamp(speeds[i], INTERPOLATION_NONE);
+		checkRamp(speeds[i], INTERPOLATION_LINEAR);
+		checkRamp(speeds[i], INTERPOLATION_HERMITE);
+	}
+
+	/* Out of range speeds are held to two octaves */
+	StreamingSignalData* stream = StreamingSignalData::fromSDFile(folder, subfolder, rampName, true, 2, 512, 0);
+
+	stream->setSpeed(STREAM_SPEED_MAX * 2);
+	HOST_CHECK(stream->getSpeed() == STREAM_SPEED_MAX);
+
+	stream->setSpeed(1);
+	HOST_CHECK(stream->getSpeed() == STREAM_SPEED_MIN);
+
+	/* Going off unity speed picks up where the stream was */
+	stream->setSpeed(STREAM_SPEED_UNITY);
+
+	int16_t block[RESAMPLE_TEST_CHUNK];
+
+	stream->getNextSamples(block, RESAMPLE_TEST_CHUNK);
+	stream->setSpeed(STREAM_SPEED_UNITY * 2);
+
+	int16_t after = stream->getNextSample();
+
+	HOST_CHECK(abs(after - block[RESAMPLE_TEST_CHUNK - 1]) <= RESAMPLE_TEST_LATENCY * RESAMPLE_TEST_STEP);
+
+	for (unsigned int i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++)
+	{
+		double none = checkSine(speeds[i], INTERPOLATION_NONE);
+		double linear = checkSine(speeds[i], INTERPOLATION_LINEAR);
+		double hermite = checkSine(speeds[i], INTERPOLATION_HERMITE);
+
+		/* Whole number speeds land on the samples themselves */
+		if ((speeds[i] & 0xFFFF) == 0) continue;
+
+		HOST_CHECK(linear < none);
+		HOST_CHECK(hermite < linear);
+	}
+
+	/* Unity speed is a straight copy, for comparison */
+	benchmark(STREAM_SPEED_UNITY, INTERPOLATION_NONE);
+	benchmark(0x10F39, INTERPOLATION_NONE);
+	benchmark(0x10F39, INTERPOLATION_LINEAR);
+	benchmark(0x10F39, INTERPOLATION_HERMITE);
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
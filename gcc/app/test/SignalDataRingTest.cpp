@@ -0,0 +1,234 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "HostTest.h"
+#include "HostFatImage.h"
+#include "SignalData.h"
+
+using namespace nw2s;
+
+/*
+
+	Streams the same noise from a file laid out in one run of clusters and from one
+	that's scattered, through rings of different shapes. Every sample has to come out
+	in order across buffer boundaries and the loop point, the contiguous file has to
+	be read with multiple block reads, and a ring that isn't topped up has to count
+	its underruns instead of playing garbage.
+
+	Then plays each ring shape from an audio rate interrupt while the main loop tops
+	it up once a millisecond, with the card taking longer and longer over the odd
+	block, and reports the dropouts. A ring holds out as long as its queued buffers
+	last, so nothing shorter than that should be heard.
+
+*/
+
+#define RING_TEST_SAMPLES 150001
+#define RING_TEST_CHUNK 100
+
+/* 44.1kHz from the 84MHz master clock, with a slow card that every so often takes far longer */
+#define RING_STRESS_PERIOD 1905
+#define RING_STRESS_RATE (84000000 / RING_STRESS_PERIOD)
+#define RING_STRESS_SECONDS 5
+#define RING_STRESS_ACCESS_US 150
+#define RING_STRESS_SPIKE_EVERY 200
+#define RING_STRESS_CHANNEL 0
+
+static char folder[] = "LOOPS";
+static char subfolder[] = "RING";
+static char contiguousName[] = "CONTIG.RAW";
+static char fragmentedName[] = "FRAG.RAW";
+
+static std::vector<int16_t> noise;
+static StreamingSignalData* playing;
+
+static void fill(StreamingSignalData* stream)
+{
+	/* A one-shot stream that reached the end has nothing more to read */
+	while (stream->isAvailable() && stream->isReadyForRefresh()) stream->refresh();
+}
+
+static void checkRing(HostSdCard* card, char* name, int buffers, int buffersize, bool contiguous)
+{
+	card->resetStats();
+
+	StreamingSignalData* stream = StreamingSignalData::fromSDFile(folder, subfolder, name, true, buffers, buffersize, 0);
+
+	HOST_CHECK(stream->isAvailable());
+	HOST_CHECK(!stream->isCached());
+	HOST_CHECK(stream->getBufferCount() == buffers);
+	HOST_CHECK(stream->getBufferSize() == buffersize);
+	HOST_CHECK(stream->getSampleCount() == RING_TEST_SAMPLES - 1);
+
+	/* It starts out full */
+	HOST_CHECK(stream->getQueued() == (uint32_t)buffers);
+
+	/* Play the loop through more than once, topping up after every chunk */
+	uint32_t count = stream->getSampleCount();
+	int16_t block[RING_TEST_CHUNK];
+	int errors = 0;
+
+	for (uint32_t played = 0; played < (count * 2) + 1000; played += RING_TEST_CHUNK)
+	{
+		stream->getNextSamples(block, RING_TEST_CHUNK);
+
+		for (int i = 0; i < RING_TEST_CHUNK; i++)
+		{
+			if (block[i] != noise[(played + i) % count]) errors++;
+		}
+
+		fill(stream);
+	}
+
+	HOST_CHECK(errors == 0);
+	HOST_CHECK(stream->getUnderruns() == 0);
+
+	/* Only a contiguous file can be streamed with CMD18, which leaves single block reads for the folders and the loop point */
+	HOST_CHECK((card->stats.commands[18] > 0) == contiguous);
+	HOST_CHECK(contiguous ? (card->stats.commands[17] * 20 < card->stats.blocksRead) : (card->stats.commands[17] >= card->stats.blocksRead - 1));
+
+	/* Playing through the whole ring and then some without a refresh runs it dry */
+	for (int i = 0; i < (buffers + 1) * buffersize; i++) stream->getNextSample();
+
+	HOST_CHECK(stream->getUnderruns() > 0);
+
+	HOST_REPORT("%s, %d x %d: %d errors, %lu blocks read with %lu CMD17 and %lu CMD18", name, buffers, buffersize, errors, (unsigned long)card->stats.blocksRead, (unsigned long)card->stats.commands[17], (unsigned long)card->stats.commands[18]);
+}
+
+static void playInterrupt()
+{
+	playing->getNextSample();
+}
+
+/* Returns the underruns while the card has spikes of the given length */
+static uint32_t stressRing(HostSdCard* card, char* name, int buffers, int buffersize, uint32_t spike)
+{
+	SimulatedHAL* hal = hostTestHAL();
+
+	card->setAccessTime(RING_STRESS_ACCESS_US);
+	card->setLatencySpikes(RING_STRESS_SPIKE_EVERY, spike);
+	card->resetStats();
+
+	playing = StreamingSignalData::fromSDFile(folder, subfolder, name, true, buffers, buffersize, 0);
+
+	hal->timerAttach(RING_STRESS_CHANNEL, playInterrupt);
+	hal->timerStart(RING_STRESS_CHANNEL, RING_STRESS_PERIOD);
+
+	/* Like Looper::timer, anything that's ready gets read on the next tick */
+	for (int t = 0; t < RING_STRESS_SECONDS * 1000; t++)
+	{
+		fill(playing);
+		hal->advance(1000);
+	}
+
+	hal->timerStop(RING_STRESS_CHANNEL);
+	card->setAccessTime(0);
+	card->setLatencySpikes(0, 0);
+
+	/* Every spike has to have happened for the numbers to mean anything */
+	HOST_CHECK((spike == 0) || (card->stats.latencySpikes >= 3));
+
+	return playing->getUnderruns();
+}
+
+static void stressRings(HostSdCard* card)
+{
+	const int shapes[4][2] = { { 2, 512 }, { 4, 256 }, { 3, 768 }, { 8, 1024 } };
+	const uint32_t spikes[4] = { 0, 5000, 20000, 50000 };
+
+	hostTestHAL()->setManualTime(true);
+
+	for (int i = 0; i < 4; i++)
+	{
+		uint32_t underruns[4];
+		int buffers = shapes[i][0];
+		int buffersize = shapes[i][1];
+
+		/* What's queued behind the buffer that's playing */
+		uint32_t depth = ((buffers - 1) * buffersize * 1000000ULL) / RING_STRESS_RATE;
+
+		for (int j = 0; j < 4; j++)
+		{
+			underruns[j] = stressRing(card, contiguousName, buffers, buffersize, spikes[j]);
+
+			/* Allow for the tick the refresh waits for and the blocks either side of the spike */
+			if (spikes[j] + 2000 + (4 * RING_STRESS_ACCESS_US) < depth) HOST_CHECK(underruns[j] == 0);
+			if (spikes[j] > depth + 1000) HOST_CHECK(underruns[j] > 0);
+		}
+
+		HOST_REPORT("%d x %4d (%3lums queued): underruns with no spikes %lu, 5ms %lu, 20ms %lu, 50ms %lu", buffers, buffersize, (unsigned long)(depth / 1000), (unsigned long)underruns[0], (unsigned long)underruns[1], (unsigned long)underruns[2], (unsigned long)underruns[3]);
+	}
+}
+
+void setup()
+{
+	/* An odd number of bytes, so the last half sample is dropped */
+	std::vector<uint8_t> data;
+
+	srand(1);
+
+	for (int i = 0; i < RING_TEST_SAMPLES - 1; i++)
+	{
+		int16_t sample = (rand() & 0xFFFF) - 32768;
+
+		noise.push_back(sample);
+		data.push_back(sample & 0xFF);
+		data.push_back((sample >> 8) & 0xFF);
+	}
+
+	data.push_back(0x55);
+
+	HostFatImage image;
+
+	image.addFile(subfolder, contiguousName, data, false);
+	image.addFile(subfolder, fragmentedName, data, true);
+
+	HostSdCard* card = image.attach();
+
+	HOST_CHECK(card != NULL);
+
+	checkRing(card, contiguousName, 2, 512, true);
+	checkRing(card, fragmentedName, 2, 512, false);
+	checkRing(card, contiguousName, 4, 256, true);
+	checkRing(card, fragmentedName, 4, 256, false);
+	checkRing(card, contiguousName, 8, 1024, true);
+	checkRing(card, fragmentedName, 3, 768, false);
+
+	/* A one-shot stream stops at the end of the file and then plays silence */
+	StreamingSignalData* once = StreamingSignalData::fromSDFile(folder, subfolder, contiguousName, false, 2, 512, 0);
+
+	for (int i = 0; (i < RING_TEST_SAMPLES * 2) && once->isAvailable(); i += RING_TEST_CHUNK)
+	{
+		int16_t block[RING_TEST_CHUNK];
+
+		once->getNextSamples(block, RING_TEST_CHUNK);
+		fill(once);
+	}
+
+	HOST_CHECK(!once->isAvailable());
+	HOST_CHECK(once->getNextSample() == 0);
+
+	stressRings(card);
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,183 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "HostFatImage.h"
+#include "SignalData.h"
+
+using namespace nw2s;
+
+/*
+
+	Plays a sine from an audio rate interrupt while the main loop tops the stream up once a
+	millisecond and fires a reset or a random seek every few ticks, the way the looper's
+	trigger and glitch inputs do. The card is slow, so a trigger that read from it would
+	show up in simulated time as well as in the command count. Every trigger has to come
+	back without touching the card, and the crossfade has to keep the output from jumping
+	any further than the sine itself moves plus one step of the fade.
+
+*/
+
+#define SEEK_TEST_PERIOD 100
+#define SEEK_TEST_AMPLITUDE 20000
+#define SEEK_TEST_STREAMED_SAMPLES (SEEK_TEST_PERIOD * 2000)
+#define SEEK_TEST_CACHED_SAMPLES (SEEK_TEST_PERIOD * 40)
+#define SEEK_TEST_SECONDS 10
+#define SEEK_TEST_TRIGGER_EVERY 23
+#define SEEK_TEST_AUDIO_PERIOD 1905
+#define SEEK_TEST_CHANNEL 0
+
+/* Two sines can be anything up to twice the amplitude apart, and the fade closes that in STREAM_CROSSFADE steps */
+#define SEEK_TEST_MAX_STEP ((int)((6.2832 * SEEK_TEST_AMPLITUDE) / SEEK_TEST_PERIOD) + ((2 * SEEK_TEST_AMPLITUDE) / STREAM_CROSSFADE) + 2)
+
+static char folder[] = "LOOPS";
+static char subfolder[] = "SEEK";
+static char streamedName[] = "LONG.RAW";
+static char cachedName[] = "SHORT.RAW";
+
+static StreamingSignalData* playing;
+static int16_t lastSample;
+static int largestStep;
+static unsigned long played;
+
+static void playInterrupt()
+{
+	int16_t sample = playing->getNextSample();
+	int step = abs(sample - lastSample);
+
+	if ((played > 0) && (step > largestStep)) largestStep = step;
+
+	lastSample = sample;
+	played++;
+}
+
+static std::vector<uint8_t> sine(int samples)
+{
+	std::vector<uint8_t> data;
+
+	for (int i = 0; i < samples; i++)
+	{
+		int16_t sample = (int16_t)(SEEK_TEST_AMPLITUDE * sin((6.283185307 * i) / SEEK_TEST_PERIOD));
+
+		data.push_back(sample & 0xFF);
+		data.push_back((sample >> 8) & 0xFF);
+	}
+
+	return data;
+}
+
+static uint32_t commands(HostSdCard* card)
+{
+	uint32_t count = 0;
+
+	for (int i = 0; i < HOST_SD_COMMANDS; i++) count += card->stats.commands[i];
+
+	return count;
+}
+
+static void checkTriggers(HostSdCard* card, char* name, bool cached)
+{
+	SimulatedHAL* hal = hostTestHAL();
+
+	playing = StreamingSignalData::fromSDFile(folder, subfolder, name, true, 4, 512, cached ? STREAM_CACHE_SIZE : 0);
+
+	HOST_CHECK(playing->isAvailable());
+	HOST_CHECK(playing->isCached() == cached);
+
+	lastSample = 0;
+	largestStep = 0;
+	played = 0;
+
+	/* From here on, anything that goes near the card takes time */
+	card->setAccessTime(150);
+
+	hal->timerAttach(SEEK_TEST_CHANNEL, playInterrupt);
+	hal->timerStart(SEEK_TEST_CHANNEL, SEEK_TEST_AUDIO_PERIOD);
+
+	int triggers = 0;
+	int blocked = 0;
+	double worstNanos = 0;
+	double totalNanos = 0;
+
+	for (int t = 1; t <= SEEK_TEST_SECONDS * 1000; t++)
+	{
+		while (playing->isReadyForRefresh()) playing->refresh();
+
+		if ((t % SEEK_TEST_TRIGGER_EVERY) == 0)
+		{
+			uint32_t before = commands(card);
+			uint64_t simulated = hal->micros();
+			double start = hostTestNanos();
+
+			/* Alternate between the reset and glitch inputs */
+			if ((triggers & 1) == 0)
+			{
+				playing->reset();
+			}
+			else
+			{
+				playing->seekRandom();
+			}
+
+			double nanos = hostTestNanos() - start;
+
+			if ((commands(card) != before) || (hal->micros() != simulated)) blocked++;
+			if (nanos > worstNanos) worstNanos = nanos;
+
+			totalNanos += nanos;
+			triggers++;
+		}
+
+		hal->advance(1000);
+	}
+
+	hal->timerStop(SEEK_TEST_CHANNEL);
+	card->setAccessTime(0);
+
+	HOST_CHECK(blocked == 0);
+	HOST_CHECK(largestStep <= SEEK_TEST_MAX_STEP);
+	HOST_CHECK(playing->getUnderruns() == 0);
+
+	HOST_REPORT("%s: %d triggers, %d touched the card, trigger path mean %.0fns worst %.0fns, largest step %d of %d allowed over %lu samples", name, triggers, blocked, totalNanos / triggers, worstNanos, largestStep, SEEK_TEST_MAX_STEP, played);
+}
+
+void setup()
+{
+	HostFatImage image;
+
+	image.addFile(subfolder, streamedName, sine(SEEK_TEST_STREAMED_SAMPLES), false);
+	image.addFile(subfolder, cachedName, sine(SEEK_TEST_CACHED_SAMPLES), false);
+
+	HostSdCard* card = image.attach();
+
+	HOST_CHECK(card != NULL);
+
+	hostTestHAL()->setManualTime(true);
+
+	checkTriggers(card, streamedName, false);
+	checkTriggers(card, cachedName, true);
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
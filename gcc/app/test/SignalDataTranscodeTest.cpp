@@ -0,0 +1,267 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "HostTest.h"
+#include "HostFatImage.h"
+#include "SignalData.h"
+#include "b.h"
+#include <math.h>
+
+using namespace nw2s;
+
+/*
+
+	Loads WAV files of each depth and channel count off a generated card, and plays them
+	back against what the conversion to 16 bit mono should have made of them. A second
+	load has to use the converted file that's already there. Editing the original past
+	the frames that are summed into the header, without changing its size, has to
+	convert it again, which it can only tell from the modification time.
+
+*/
+
+#define TRANSCODE_TEST_FRAMES 30001
+#define TRANSCODE_TEST_CHUNK 100
+#define TRANSCODE_TEST_EDIT 20000
+
+static char folder[] = "LOOPS";
+static char subfolder[] = "WAV";
+
+static std::vector<int16_t> left;
+static std::vector<int16_t> right;
+
+static void put16(std::vector<uint8_t>* data, uint16_t value)
+{
+	data->push_back(value & 0xFF);
+	data->push_back(value >> 8);
+}
+
+static void put32(std::vector<uint8_t>* data, uint32_t value)
+{
+	put16(data, value & 0xFFFF);
+	put16(data, value >> 16);
+}
+
+static void putChunk(std::vector<uint8_t>* data, const char* id, const std::vector<uint8_t>& body)
+{
+	data->insert(data->end(), id, id + 4);
+	put32(data, body.size());
+	data->insert(data->end(), body.begin(), body.end());
+
+	if (body.size() & 1) data->push_back(0);
+}
+
+static void putSample(std::vector<uint8_t>* data, int16_t sample, int bits)
+{
+	/* 8 bit is unsigned and 24 bit gets a low byte the conversion throws away */
+	if (bits == 8) data->push_back((sample >> 8) + 128);
+	if (bits == 24) data->push_back(0xA5);
+	if (bits >= 16) put16(data, sample);
+}
+
+static std::vector<uint8_t> wav(int channels, int bits, bool extensible, uint16_t tag = 1)
+{
+	int align = channels * bits / 8;
+	std::vector<uint8_t> format;
+	std::vector<uint8_t> samples;
+	std::vector<uint8_t> info(3, 'x');
+	std::vector<uint8_t> trailer(500, 0x7F);
+
+	put16(&format, extensible ? 0xFFFE : tag);
+	put16(&format, channels);
+	put32(&format, 48000);
+	put32(&format, 48000 * align);
+	put16(&format, align);
+	put16(&format, bits);
+
+	if (extensible)
+	{
+		put16(&format, 22);
+		put16(&format, bits);
+		put32(&format, 3);
+		put16(&format, tag);
+
+		for (int i = 0; i < 14; i++) format.push_back(i);
+	}
+
+	for (int i = 0; i < TRANSCODE_TEST_FRAMES; i++)
+	{
+		putSample(&samples, left[i], bits);
+		if (channels == 2) putSample(&samples, right[i], bits);
+	}
+
+	/* Chunks before and after the samples are skipped, including an odd sized one */
+	std::vector<uint8_t> body;
+
+	body.insert(body.end(), "WAVE", "WAVE" + 4);
+	putChunk(&body, "fmt ", format);
+	putChunk(&body, "LIST", info);
+	putChunk(&body, "data", samples);
+	putChunk(&body, "LIST", trailer);
+
+	std::vector<uint8_t> file;
+
+	file.insert(file.end(), "RIFF", "RIFF" + 4);
+	put32(&file, body.size());
+	file.insert(file.end(), body.begin(), body.end());
+
+	return file;
+}
+
+static int16_t expected(int bits, int channels, StreamChannel channel, int i)
+{
+	int16_t l = (bits == 8) ? left[i] & 0xFF00 : left[i];
+	int16_t r = (bits == 8) ? right[i] & 0xFF00 : right[i];
+
+	if (channels == 1) return l;
+	if (channel == CHANNEL_LEFT) return l;
+	if (channel == CHANNEL_RIGHT) return r;
+
+	return (l + r) >> 1;
+}
+
+static int play(char* name, int bits, int channels, StreamChannel channel)
+{
+	StreamingSignalData* stream = StreamingSignalData::fromSDFile(folder, subfolder, name, true, 4, 512, 0, channel);
+
+	if (!HOST_CHECK(stream->isAvailable())) return -1;
+
+	HOST_CHECK(stream->getSampleCount() == TRANSCODE_TEST_FRAMES);
+
+	int16_t block[TRANSCODE_TEST_CHUNK];
+	int errors = 0;
+
+	for (int played = 0; played < TRANSCODE_TEST_FRAMES; played += TRANSCODE_TEST_CHUNK)
+	{
+		stream->getNextSamples(block, TRANSCODE_TEST_CHUNK);
+
+		for (int i = 0; (i < TRANSCODE_TEST_CHUNK) && (played + i < TRANSCODE_TEST_FRAMES); i++)
+		{
+			if (block[i] != expected(bits, channels, channel, played + i)) errors++;
+		}
+
+		while (stream->isReadyForRefresh()) stream->refresh();
+	}
+
+	HOST_CHECK(errors == 0);
+
+	return errors;
+}
+
+static void check(HostSdCard* card, char* name, int bits, int channels, StreamChannel channel)
+{
+	static const char* channelNames[] = { "mix", "left", "right" };
+
+	/* The first load converts, and the second uses what the first wrote */
+	card->resetStats();
+	int errors = play(name, bits, channels, channel);
+	uint32_t converted = card->stats.blocksWritten;
+
+	card->resetStats();
+	errors += play(name, bits, channels, channel);
+	uint32_t reused = card->stats.blocksWritten;
+
+	HOST_CHECK(((bits == 16) && (channels == 1)) ? (converted == 0) : (converted > 0));
+	HOST_CHECK(reused == 0);
+
+	HOST_REPORT("%s %s: %d errors, %lu blocks written converting, %lu loading again", name, channelNames[channel], errors, (unsigned long)converted, (unsigned long)reused);
+}
+
+static void edited(uint16_t* date, uint16_t* time)
+{
+	/* 2014-06-01 12:00 */
+	*date = (34 << 9) | (6 << 5) | 1;
+	*time = 12 << 11;
+}
+
+void setup()
+{
+	srand(3);
+
+	for (int i = 0; i < TRANSCODE_TEST_FRAMES; i++)
+	{
+		left.push_back((int16_t)(20000 * sin(2 * M_PI * i / 317.0)) + (rand() % 6001) - 3000);
+		right.push_back((int16_t)(15000 * sin(2 * M_PI * i / 91.0)) + (rand() % 6001) - 3000);
+	}
+
+	char w8m[] = "W8M.WAV";
+	char w16m[] = "W16M.WAV";
+	char w16s[] = "W16S.WAV";
+	char w24m[] = "W24M.WAV";
+	char w24s[] = "W24S.WAV";
+	char flt[] = "FLOAT.WAV";
+
+	HostFatImage image;
+
+	image.addFile(subfolder, w8m, wav(1, 8, false));
+	image.addFile(subfolder, w16m, wav(1, 16, false));
+	image.addFile(subfolder, w16s, wav(2, 16, false), true);
+	image.addFile(subfolder, w24m, wav(1, 24, false));
+	image.addFile(subfolder, w24s, wav(2, 24, true));
+	image.addFile(subfolder, flt, wav(1, 32, false, 3));
+
+	HostSdCard* card = image.attach();
+
+	if (!HOST_CHECK(card != NULL)) hostTestExit();
+
+	check(card, w8m, 8, 1, CHANNEL_MIX);
+	check(card, w16m, 16, 1, CHANNEL_MIX);
+	check(card, w24m, 24, 1, CHANNEL_MIX);
+
+	for (int channel = CHANNEL_MIX; channel <= CHANNEL_RIGHT; channel++)
+	{
+		check(card, w16s, 16, 2, (StreamChannel)channel);
+		check(card, w24s, 24, 2, (StreamChannel)channel);
+	}
+
+	/* Floating point isn't PCM that can be converted */
+	HOST_CHECK(!StreamingSignalData::fromSDFile(folder, subfolder, flt, true, 4, 512, 0)->isAvailable());
+
+	/* Change one frame well past the start of the original, keeping its size */
+	SdFile root = b::getSDRoot();
+	SdFile loops;
+	SdFile wavs;
+	SdFile original;
+
+	SdFile::dateTimeCallback(edited);
+
+	HOST_CHECK(loops.open(root, folder, O_READ) && wavs.open(loops, subfolder, O_READ) && original.open(wavs, w16s, O_RDWR));
+
+	uint8_t frame[4] = { 0x34, 0x12, 0xCC, 0xED };
+	uint32_t offset = wav(2, 16, false).size() - 8 - 500 - (4 * (TRANSCODE_TEST_FRAMES - TRANSCODE_TEST_EDIT));
+
+	HOST_CHECK(original.seekSet(offset) && (original.write(frame, sizeof(frame)) == sizeof(frame)) && original.close());
+
+	SdFile::dateTimeCallbackCancel();
+
+	left[TRANSCODE_TEST_EDIT] = 0x1234;
+	right[TRANSCODE_TEST_EDIT] = (int16_t)0xEDCC;
+
+	card->resetStats();
+	HOST_CHECK(play(w16s, 16, 2, CHANNEL_LEFT) == 0);
+	HOST_CHECK(card->stats.blocksWritten > 0);
+
+	HOST_REPORT("edited %s: %lu blocks written converting again", w16s, (unsigned long)card->stats.blocksWritten);
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,209 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "IO.h"
+#include "b.h"
+
+using namespace nw2s;
+
+/*
+
+	Checks the compiled soft tune tables against the interpolation they replace. Every mV from
+	-11V to +11V goes out on all 16 outputs in both gain modes, over a run of random tune
+	corners, and the DAC codes are taken off the SPI bus. Each one has to be the code for the
+	exact integer interpolation between its two corners. The old single-precision formula is
+	run alongside. It may only disagree where the exact interpolation lands on a whole mV and
+	the float falls short of it, and then only by one mV before the DAC scaling.
+
+*/
+
+#define SOFT_TUNE_TRIALS 40
+
+static uint16_t inputs[16];
+
+class TraceDac : public HostSpiDevice
+{
+	public:
+		TraceDac(int first)
+		{
+			this->first = first;
+			this->length = 0;
+		}
+
+		virtual void select()
+		{
+			this->length = 0;
+		}
+
+		virtual void deselect()
+		{
+			if (this->length != 2) return;
+
+			uint16_t word = (this->bytes[0] << 8) | this->bytes[1];
+
+			inputs[this->first + (word >> 15)] = word & 0x0FFF;
+		}
+
+		virtual uint8_t transfer(uint8_t data)
+		{
+			if (this->length < 2) this->bytes[this->length] = data;
+			this->length++;
+
+			return 0;
+		}
+
+	private:
+		int first;
+		uint8_t bytes[2];
+		int length;
+};
+
+static int dacCode(int cv)
+{
+	int dacval = b::cvGainMode ?
+		(4095 - ((cv + 10000) * 4000UL) / 20000) :
+		(4095 - ((cv +  5000) * 4000UL) / 10000);
+
+	return (dacval < 0) ? 0 : (dacval > 4095) ? 4095 : dacval;
+}
+
+/* The corner offset interpolated in thousandths of a mV, truncated like the firmware does */
+static int exactOffset(int pin, int cv, int* thousandths)
+{
+	int clamped = (cv < -10000) ? -10000 : (cv > 10000) ? 10000 : cv;
+
+	if (clamped == 10000)
+	{
+		*thousandths = b::outputOffset[pin][20] * 1000;
+	}
+	else
+	{
+		int range = (clamped + 10000) / 1000;
+		int position = (clamped + 10000) % 1000;
+
+		*thousandths = (b::outputOffset[pin][range] * (1000 - position)) + (b::outputOffset[pin][range + 1] * position);
+	}
+
+	return *thousandths / 1000;
+}
+
+/* What outputCV() did before the tables */
+static int floatOffset(int pin, int cv)
+{
+	int clamped = (cv < -10000) ? -10000 : (cv > 10000) ? 10000 : cv;
+
+	if (clamped == 10000) return b::outputOffset[pin][20];
+
+	int range = (clamped + 10000) / 1000;
+	int bottom = (range * 1000) - 10000;
+
+	float alpha = (clamped - bottom) / 1000.0;
+	float offset = ((1.0 - alpha) * b::outputOffset[pin][range]) + (alpha * b::outputOffset[pin][range + 1]);
+
+	return (int)offset;
+}
+
+void setup()
+{
+	SimulatedHAL* hal = hostTestHAL();
+
+	/* Each DAC's chip select carries two outputs, the first DAC is on pin 9 */
+	for (int i = 0; i < 8; i++) hal->attachSpiDevice(9 - i, new TraceDac(i * 2));
+
+	AnalogOut* outs[16];
+
+	for (int i = 0; i < 16; i++) outs[i] = AnalogOut::create(INDEX_ANALOG_OUT[i + 1]);
+
+	srand(7);
+
+	unsigned long codes = 0;
+	unsigned long wrong = 0;
+	unsigned long floatCodes = 0;
+	unsigned long floatOffsets = 0;
+
+	for (int trial = 0; trial < SOFT_TUNE_TRIALS; trial++)
+	{
+		/* Mostly realistic corners, then the whole int8_t range */
+		int span = (trial < (SOFT_TUNE_TRIALS * 3) / 4) ? 40 : 127;
+
+		for (int pin = 0; pin < 16; pin++)
+		{
+			for (int i = 0; i < 21; i++) b::outputOffset[pin][i] = (rand() % ((2 * span) + 1)) - span;
+		}
+
+		AnalogOut::compileSoftTune();
+
+		b::cvGainMode = (trial & 1) ? CV_GAIN_HIGH : CV_GAIN_LOW;
+
+		for (int pin = 0; pin < 16; pin++)
+		{
+			for (int cv = -11000; cv <= 11000; cv++)
+			{
+				outs[pin]->outputCV(cv, true);
+
+				int thousandths;
+				int exact = exactOffset(pin, cv, &thousandths);
+				int old = floatOffset(pin, cv);
+
+				codes++;
+
+				if (inputs[pin] != dacCode(cv + exact)) wrong++;
+
+				if (old != exact)
+				{
+					floatOffsets++;
+
+					HOST_CHECK((thousandths % 1000) == 0);
+					HOST_CHECK((old - exact == 1) || (exact - old == 1));
+				}
+
+				if (dacCode(cv + old) != inputs[pin])
+				{
+					int step = dacCode(cv + old) - inputs[pin];
+
+					floatCodes++;
+
+					HOST_CHECK(old != exact);
+					HOST_CHECK((step == 1) || (step == -1));
+				}
+			}
+		}
+	}
+
+	HOST_CHECK(wrong == 0);
+
+	HOST_REPORT("%lu DAC codes: %lu differ from the exact interpolation, %lu differ from the old float formula by one code (%lu offsets)", codes, wrong, floatCodes, floatOffsets);
+
+	/* Leave the outputs untuned for anything that runs after */
+	for (int pin = 0; pin < 16; pin++)
+	{
+		for (int i = 0; i < 21; i++) b::outputOffset[pin][i] = 0;
+	}
+
+	AnalogOut::compileSoftTune();
+
+	hostTestExit();
+}
+
+void loop()
+{
+}
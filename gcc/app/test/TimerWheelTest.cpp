@@ -0,0 +1,248 @@
+/*
+
+	nw2s::b - A microcontroller-based modular synth control framework
+	Copyright (C) 2013 Scott Wilson (thomas.scott.wilson@gmail.com)
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "HostTest.h"
+#include "TimerWheel.h"
+#include "EventManager.h"
+
+using namespace nw2s;
+
+/*
+
+	Runs the wheel against a plain list of wake times with a mix of short, long and parked
+	delays, and checks every device comes out on exactly the tick it asked for. Then runs the
+	main loop with 10, 100 and 1000 devices that each wake once a second, registered so they
+	are asked every tick and scheduled on the wheel, and reports ticks per second for each.
+
+*/
+
+#define WHEEL_DEVICES 1000
+#define WHEEL_BENCHMARK_TICKS 20000
+
+class WheelDevice : public TimeBasedDevice
+{
+	public:
+		unsigned long wake;
+		bool pending;
+
+		virtual void timer(unsigned long t) {}
+};
+
+static WheelDevice devices[WHEEL_DEVICES];
+
+static unsigned long randomDelay()
+{
+	/* Mostly within the first level, some in each level above and a few parked past the end */
+	switch (random(8))
+	{
+		case 0: return random(TIMER_WHEEL_LEVEL0_SIZE * TIMER_WHEEL_LEVELN_SIZE);
+		case 1: return random(TIMER_WHEEL_LEVEL0_SIZE * TIMER_WHEEL_LEVELN_SIZE * TIMER_WHEEL_LEVELN_SIZE);
+		case 2: return (random(16) == 0) ? TIMER_WHEEL_MAX_DELAY + random(1000) : random(TIMER_WHEEL_MAX_DELAY);
+		default: return random(TIMER_WHEEL_LEVEL0_SIZE * 2);
+	}
+}
+
+/* Where the wheel will actually run something - late adds run on the next tick and long ones get parked */
+static unsigned long expectedWake(unsigned long now, unsigned long wake)
+{
+	if ((long)(wake - now) < 0) return now;
+	if ((wake - now) > TIMER_WHEEL_MAX_DELAY) return now + TIMER_WHEEL_MAX_DELAY;
+
+	return wake;
+}
+
+static void checkAgainstReference()
+{
+	TimerWheel wheel;
+	vector<TimeBasedDevice*> due;
+	unsigned long t = 0;
+	int fired = 0;
+
+	randomSeed(1);
+
+	for (int i = 0; i < WHEEL_DEVICES; i++)
+	{
+		unsigned long delay = randomDelay();
+
+		devices[i].wake = expectedWake(0, delay);
+		devices[i].pending = true;
+		wheel.add(&devices[i], delay);
+	}
+
+	/* Walk through the short delays a tick at a time, then jump through the rest like a late main loop would */
+	while (fired < WHEEL_DEVICES)
+	{
+		wheel.advance(t, due);
+
+		for (unsigned int i = 0; i < due.size(); i++)
+		{
+			WheelDevice* device = (WheelDevice*)due[i];
+
+			/* Devices come out once, in the advance() that passes their wake time */
+			HOST_CHECK(device->pending);
+			HOST_CHECK((long)(t - device->wake) >= 0);
+			HOST_CHECK((t < 100000) ? (device->wake == t) : true);
+
+			device->pending = false;
+			fired++;
+
+			/* Reschedule about half of them, including some in the past */
+			if ((fired < WHEEL_DEVICES / 2) && (random(2) == 0))
+			{
+				unsigned long wake = (random(10) == 0) ? t - 5 : t + randomDelay();
+
+				/* The wheel has already moved on to the next tick */
+				device->wake = expectedWake(t + 1, wake);
+				device->pending = true;
+				wheel.add(device, wake);
+				fired--;
+			}
+		}
+
+		due.clear();
+
+		HOST_CHECK(wheel.size() == (unsigned long)(WHEEL_DEVICES - fired));
+
+		/* Nobody can still be waiting once their time has gone by */
+		if ((t % 50000) == 0)
+		{
+			for (int i = 0; i < WHEEL_DEVICES; i++) HOST_CHECK(!devices[i].pending || ((long)(devices[i].wake - t) > 0));
+		}
+
+		t += (t < 100000) ? 1 : 1 + random(5000);
+	}
+
+	for (int i = 0; i < WHEEL_DEVICES; i++) HOST_CHECK(!devices[i].pending);
+}
+
+/* Sleeps most of the time and runs once a second, like a trigger or gate between edges */
+class SleepyDevice : public TimeBasedDevice
+{
+	public:
+		unsigned long wake;
+		unsigned long runs;
+		bool retired;
+
+		SleepyDevice(unsigned long wake)
+		{
+			this->wake = wake;
+			this->runs = 0;
+			this->retired = false;
+		}
+
+		virtual void timer(unsigned long t)
+		{
+			if (this->retired || ((long)(t - this->wake) < 0)) return;
+
+			this->wake = t + 1000;
+			this->runs++;
+		}
+
+		virtual unsigned long nextWake(unsigned long t)
+		{
+			/* Out of the way of the next run, it only comes round again once per wheel */
+			return this->retired ? t + TIMER_WHEEL_MAX_DELAY : this->wake;
+		}
+};
+
+/* Adds devices up to the count and times the main loop with them, returning ticks per second */
+static double benchmarkLoop(vector<SleepyDevice*>& sleepers, unsigned int count, bool scheduled)
+{
+	SimulatedHAL* hal = hostTestHAL();
+	const unsigned long ticks = WHEEL_BENCHMARK_TICKS;
+
+	while (sleepers.size() < count)
+	{
+		SleepyDevice* device = new SleepyDevice(millis() + 1 + (sleepers.size() % 1000));
+
+		sleepers.push_back(device);
+
+		if (scheduled)
+		{
+			EventManager::scheduleDevice(device);
+		}
+		else
+		{
+			EventManager::registerDevice(device);
+		}
+	}
+
+	for (unsigned int i = 0; i < sleepers.size(); i++) sleepers[i]->runs = 0;
+
+	double start = hostTestNanos();
+
+	for (unsigned long i = 0; i < ticks; i++)
+	{
+		hal->advance(1000);
+		EventManager::loop();
+	}
+
+	double seconds = (hostTestNanos() - start) / 1e9;
+
+	/* Each one ran once a second whichever way it was asked */
+	for (unsigned int i = 0; i < sleepers.size(); i++)
+	{
+		HOST_CHECK(sleepers[i]->runs >= (ticks / 1000) - 1);
+		HOST_CHECK(sleepers[i]->runs <= (ticks / 1000) + 1);
+	}
+
+	return ticks / seconds;
+}
+
+static void benchmark()
+{
+	const unsigned int counts[3] = { 10, 100, 1000 };
+	double wheelRates[3];
+	double scanRates[3];
+	vector<SleepyDevice*> scheduled;
+	vector<SleepyDevice*> registered;
+
+	EventManager::initialize();
+	hostTestHAL()->setManualTime(true);
+
+	/* Nothing can be taken back out of the main loop, so each run adds to the last */
+	for (int i = 0; i < 3; i++) wheelRates[i] = benchmarkLoop(scheduled, counts[i], true);
+
+	/* Park the wheel's devices so they don't count against the scan */
+	for (unsigned int i = 0; i < scheduled.size(); i++) scheduled[i]->retired = true;
+
+	hostTestHAL()->advance(1000);
+	EventManager::loop();
+
+	for (int i = 0; i < 3; i++) scanRates[i] = benchmarkLoop(registered, counts[i], false);
+
+	for (int i = 0; i < 3; i++)
+	{
+		HOST_REPORT("%4u devices at 1Hz: registerDevice %9.0f ticks/s, scheduleDevice %9.0f ticks/s", counts[i], scanRates[i], wheelRates[i]);
+	}
+}
+
+void setup()
+{
+	checkAgainstReference();
+	benchmark();
+
+	hostTestExit();
+}
+
+void loop()
+{
+}